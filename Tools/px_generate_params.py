@@ -45,6 +45,9 @@ header += """
 };
 
 extern const struct px4_parameters_t px4_parameters;
+
+// Parameter indices ordered by name, for binary search in param_find()
+extern const uint16_t px4_parameters_sorted[];
 """
 
 # Generate the C file content
@@ -61,6 +64,7 @@ __attribute__((used, section("__param")))
 struct px4_parameters_t px4_parameters = {
 """
 i=0
+names=[]
 for group in root:
 	if group.tag == "group":
 		src += """
@@ -77,6 +81,7 @@ for group in root:
 			elif (param.attrib["type"] == "INT32"):
 				val_str = ".val.i = "
 			i+=1
+			names.append(param.attrib["name"])
 			src += """
 	{
 		"%s",
@@ -89,10 +94,20 @@ src += """
 };
 
 //extern const struct px4_parameters_t px4_parameters;
+""" % i
+
+# Index sorted by name; param.c compares with strcmp, so sort by byte value
+src += """
+const uint16_t px4_parameters_sorted[] = {"""
+for index in sorted(range(len(names)), key=lambda k: names[k].encode("utf-8")):
+	src += """
+	%d, /* %s */""" % (index, names[index])
+src += """
+};
 
 __END_DECLS
 
-""" % i
+"""
 
 fp_header.write(header)
 fp_src.write(src)
@@ -42,6 +42,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 namespace ringbuffer __EXPORT
 {
@@ -176,4 +177,262 @@ private:
 	RingBuffer operator=(const RingBuffer &);
 };
 
+/**
+ * A ringbuffer of items of type T for one producer and one consumer, typically
+ * a driver's measurement callout and its read().
+ *
+ * The head is only advanced by the producer and the tail by the consumer, with
+ * release/acquire ordering so the consumer sees an item once the head covers it.
+ * The exception is force(), which discards the oldest item by advancing the tail
+ * with a compare-and-swap. The consumer takes items the same way and copies them
+ * again if the producer discarded them in the meantime.
+ *
+ * The storage is rounded up to a power of two, head and tail are free running
+ * counters masked into it. T is copied with memcpy, so it has to be a plain struct.
+ */
+template<typename T>
+class TypedRingBuffer
+{
+public:
+	TypedRingBuffer(unsigned num_items) :
+		_num_items(0),
+		_mask(0),
+		_buf(nullptr),
+		_head(0),
+		_tail(0)
+	{
+		resize(num_items);
+	}
+
+	~TypedRingBuffer()
+	{
+		if (_buf != nullptr) {
+			delete[] _buf;
+		}
+	}
+
+	/**
+	 * Put an item into the buffer.
+	 *
+	 * @param val		Item to put
+	 * @return		true if the item was put, false if the buffer is full
+	 */
+	bool			put(const T &val) { return put_n(&val, 1) == 1; }
+
+	/**
+	 * Put as many items as there is space for into the buffer.
+	 *
+	 * @param vals		Items to put
+	 * @param n		Number of items
+	 * @return		The number of items put
+	 */
+	unsigned		put_n(const T *vals, unsigned n)
+	{
+		unsigned head = _head;
+		unsigned used = head - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+
+		if (n > _num_items - used) {
+			n = _num_items - used;
+		}
+
+		copy_in(head, vals, n);
+		__atomic_store_n(&_head, head + n, __ATOMIC_RELEASE);
+		return n;
+	}
+
+	/**
+	 * Force an item into the buffer, discarding the oldest item if there is not space.
+	 *
+	 * @param val		Item to put
+	 * @return		true if an item was discarded to make space
+	 */
+	bool			force(const T &val)
+	{
+		unsigned head = _head;
+		unsigned tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+		bool overwrote = false;
+
+		/* a failed swap means the consumer took an item and made space */
+		while (head - tail >= _num_items) {
+			if (advance(tail, tail + 1)) {
+				overwrote = true;
+				break;
+			}
+		}
+
+		copy_in(head, &val, 1);
+		__atomic_store_n(&_head, head + 1, __ATOMIC_RELEASE);
+		return overwrote;
+	}
+
+	/**
+	 * Get an item from the buffer.
+	 *
+	 * @param val		Item that was gotten
+	 * @return		true if an item was got, false if the buffer was empty.
+	 */
+	bool			get(T &val) { return get_n(&val, 1) == 1; }
+
+	/**
+	 * Get up to n items from the buffer, the oldest first.
+	 *
+	 * @param vals		Items that were gotten, nullptr to discard them
+	 * @param n		Maximum number of items
+	 * @return		The number of items got
+	 */
+	unsigned		get_n(T *vals, unsigned n)
+	{
+		unsigned tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+
+		for (;;) {
+			unsigned count = __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - tail;
+
+			/* the tail may have been advanced by force() in between */
+			if (count > _num_items) {
+				count = _num_items;
+			}
+
+			if (count > n) {
+				count = n;
+			}
+
+			if (vals != nullptr) {
+				copy_out(tail, vals, count);
+			}
+
+			/* the copy is only valid if force() did not discard the items meanwhile */
+			if (advance(tail, tail + count)) {
+				return count;
+			}
+		}
+	}
+
+	/*
+	 * Get the number of slots free in the buffer.
+	 */
+	unsigned		space() { return _num_items - count(); }
+
+	/*
+	 * Get the number of items in the buffer.
+	 */
+	unsigned		count()
+	{
+		unsigned tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+		unsigned used = __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - tail;
+
+		/* the tail may have been advanced by force() in between */
+		return (used > _num_items) ? _num_items : used;
+	}
+
+	bool			empty() { return count() == 0; }
+
+	bool			full() { return count() == _num_items; }
+
+	/*
+	 * Returns the capacity of the buffer, or zero if the buffer could
+	 * not be allocated.
+	 */
+	unsigned		size() { return (_buf != nullptr) ? _num_items : 0; }
+
+	/*
+	 * Empties the buffer, from the consumer side.
+	 */
+	void			flush() { get_n(nullptr, _num_items); }
+
+	/*
+	 * resize the buffer. This is unsafe to be called while
+	 * a producer or consuming is running. Caller is responsible
+	 * for any locking needed
+	 *
+	 * @param new_size	new size for buffer
+	 * @return		true if the resize succeeds, false if
+	 * 			not (allocation error)
+	 */
+	bool			resize(unsigned new_size)
+	{
+		unsigned capacity = 1;
+
+		while (capacity < new_size) {
+			capacity <<= 1;
+		}
+
+		T *new_buffer = new T[capacity];
+
+		if (new_buffer == nullptr) {
+			return false;
+		}
+
+		if (_buf != nullptr) {
+			delete[] _buf;
+		}
+
+		_buf = new_buffer;
+		_num_items = new_size;
+		_mask = capacity - 1;
+		_head = 0;
+		_tail = 0;
+		return true;
+	}
+
+	/*
+	 * printf() some info on the buffer
+	 */
+	void			print_info(const char *name)
+	{
+		printf("%s	%u/%lu (%u/%u @ %p)\n",
+		       name,
+		       _num_items,
+		       (unsigned long)(_mask + 1) * sizeof(T),
+		       _head,
+		       _tail,
+		       _buf);
+	}
+
+private:
+	unsigned		_num_items;
+	unsigned		_mask;
+	T			*_buf;
+	unsigned		_head;	/**< insertion count, written by the producer */
+	unsigned		_tail;	/**< removal count */
+
+	void			copy_in(unsigned head, const T *vals, unsigned n)
+	{
+		unsigned index = head & _mask;
+		unsigned first = (n < _mask + 1 - index) ? n : _mask + 1 - index;
+
+		memcpy(&_buf[index], vals, first * sizeof(T));
+		memcpy(&_buf[0], vals + first, (n - first) * sizeof(T));
+	}
+
+	void			copy_out(unsigned tail, T *vals, unsigned n)
+	{
+		unsigned index = tail & _mask;
+		unsigned first = (n < _mask + 1 - index) ? n : _mask + 1 - index;
+
+		memcpy(vals, &_buf[index], first * sizeof(T));
+		memcpy(vals + first, &_buf[0], (n - first) * sizeof(T));
+	}
+
+	/* advance the tail from expected, or update expected to the current tail */
+	bool			advance(unsigned &expected, unsigned desired)
+	{
+#ifdef __PX4_QURT
+		/* FIXME - clang crashes on the compare-and-swap builtins, see RingBuffer::get() */
+		if (_tail == expected) {
+			_tail = desired;
+			return true;
+		}
+
+		expected = _tail;
+		return false;
+#else
+		return __atomic_compare_exchange_n(&_tail, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+	}
+
+	/* we don't want this class to be copied */
+	TypedRingBuffer(const TypedRingBuffer &);
+	TypedRingBuffer operator=(const TypedRingBuffer &);
+};
+
 } // namespace ringbuffer
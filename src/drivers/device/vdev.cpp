@@ -44,6 +44,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 
 namespace device
 {
@@ -53,8 +54,11 @@ int px4_errno;
 struct px4_dev_t {
 	char *name;
 	void *cdev;
+	unsigned hash;		/**< hash of name */
+	unsigned slot;		/**< index in devmap */
+	px4_dev_t *next;	/**< next device in the same hash bucket */
 
-	px4_dev_t(const char *n, void *c) : cdev(c)
+	px4_dev_t(const char *n, void *c) : cdev(c), hash(0), slot(0), next(NULL)
 	{
 		name = strdup(n);
 	}
@@ -65,8 +69,107 @@ private:
 	px4_dev_t() {}
 };
 
-#define PX4_MAX_DEV 500
-static px4_dev_t *devmap[PX4_MAX_DEV];
+/*
+ * Registered devices. devmap keeps them densely packed so devList() and
+ * topicList() can iterate with an index, devhash chains them by name hash
+ * so lookups do not depend on the number of devices. Both grow on demand
+ * and are protected by devmutex.
+ */
+static px4_dev_t **devmap = NULL;
+static unsigned devmap_count = 0;
+static unsigned devmap_capacity = 0;
+static px4_dev_t **devhash = NULL;
+static unsigned devhash_size = 0;	/**< number of buckets, a power of two */
+static pthread_mutex_t devmutex = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned dev_hash(const char *name)
+{
+	/* FNV-1a */
+	unsigned h = 2166136261u;
+
+	while (*name) {
+		h ^= (unsigned char)*name++;
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+/* must be called with devmutex held */
+static px4_dev_t *dev_find(const char *name)
+{
+	if (devhash_size == 0) {
+		return NULL;
+	}
+
+	unsigned hash = dev_hash(name);
+
+	for (px4_dev_t *dev = devhash[hash & (devhash_size - 1)]; dev != NULL; dev = dev->next) {
+		if (dev->hash == hash && strcmp(dev->name, name) == 0) {
+			return dev;
+		}
+	}
+
+	return NULL;
+}
+
+/* must be called with devmutex held */
+static bool dev_grow()
+{
+	if (devmap_count == devmap_capacity) {
+		unsigned capacity = (devmap_capacity == 0) ? 64 : devmap_capacity * 2;
+		px4_dev_t **map = (px4_dev_t **)realloc(devmap, capacity * sizeof(px4_dev_t *));
+
+		if (map == NULL) {
+			return false;
+		}
+
+		devmap = map;
+		devmap_capacity = capacity;
+	}
+
+	/* keep the load factor at or below one */
+	if (devmap_count >= devhash_size) {
+		unsigned size = (devhash_size == 0) ? 64 : devhash_size * 2;
+		px4_dev_t **hash = (px4_dev_t **)calloc(size, sizeof(px4_dev_t *));
+
+		if (hash == NULL) {
+			return false;
+		}
+
+		for (unsigned i = 0; i < devmap_count; i++) {
+			px4_dev_t *dev = devmap[i];
+			dev->next = hash[dev->hash & (size - 1)];
+			hash[dev->hash & (size - 1)] = dev;
+		}
+
+		free(devhash);
+		devhash = hash;
+		devhash_size = size;
+	}
+
+	return true;
+}
+
+/* must be called with devmutex held */
+static void dev_remove(px4_dev_t *dev)
+{
+	px4_dev_t **link = &devhash[dev->hash & (devhash_size - 1)];
+
+	while (*link != dev) {
+		link = &(*link)->next;
+	}
+
+	*link = dev->next;
+
+	/* move the last device into the freed slot */
+	devmap_count--;
+	devmap[dev->slot] = devmap[devmap_count];
+	devmap[dev->slot]->slot = dev->slot;
+	devmap[devmap_count] = NULL;
+
+	delete dev;
+}
 
 /*
  * The standard NuttX operation dispatch table can't call C++ member functions
@@ -140,25 +243,30 @@ VDev::register_driver(const char *name, void *data)
 		return -EINVAL;
 	}
 
-	// Make sure the device does not already exist
-	// FIXME - convert this to a map for efficiency
-	for (int i = 0; i < PX4_MAX_DEV; ++i) {
-		if (devmap[i] && (strcmp(devmap[i]->name, name) == 0)) {
-			return -EEXIST;
-		}
-	}
+	pthread_mutex_lock(&devmutex);
 
-	for (int i = 0; i < PX4_MAX_DEV; ++i) {
-		if (devmap[i] == NULL) {
-			devmap[i] = new px4_dev_t(name, (void *)data);
+	// Make sure the device does not already exist
+	if (dev_find(name) != NULL) {
+		ret = -EEXIST;
+
+	} else if (dev_grow()) {
+		px4_dev_t *dev = new px4_dev_t(name, (void *)data);
+
+		if (dev != NULL) {
+			dev->hash = dev_hash(name);
+			dev->slot = devmap_count;
+			devmap[devmap_count++] = dev;
+			dev->next = devhash[dev->hash & (devhash_size - 1)];
+			devhash[dev->hash & (devhash_size - 1)] = dev;
 			PX4_DEBUG("Registered DEV %s", name);
 			ret = PX4_OK;
-			break;
 		}
 	}
 
-	if (ret != PX4_OK) {
-		PX4_ERR("No free devmap entries - increase PX4_MAX_DEV");
+	pthread_mutex_unlock(&devmutex);
+
+	if (ret == -ENOSPC) {
+		PX4_ERR("Out of memory registering %s", name);
 	}
 
 	return ret;
@@ -174,16 +282,18 @@ VDev::unregister_driver(const char *name)
 		return -EINVAL;
 	}
 
-	for (int i = 0; i < PX4_MAX_DEV; ++i) {
-		if (devmap[i] && (strcmp(name, devmap[i]->name) == 0)) {
-			delete devmap[i];
-			devmap[i] = NULL;
-			PX4_DEBUG("Unregistered DEV %s", name);
-			ret = PX4_OK;
-			break;
-		}
+	pthread_mutex_lock(&devmutex);
+
+	px4_dev_t *dev = dev_find(name);
+
+	if (dev != NULL) {
+		dev_remove(dev);
+		PX4_DEBUG("Unregistered DEV %s", name);
+		ret = PX4_OK;
 	}
 
+	pthread_mutex_unlock(&devmutex);
+
 	return ret;
 }
 
@@ -194,16 +304,21 @@ VDev::unregister_class_devname(const char *class_devname, unsigned class_instanc
 	char name[32];
 	snprintf(name, sizeof(name), "%s%u", class_devname, class_instance);
 
-	for (int i = 0; i < PX4_MAX_DEV; ++i) {
-		if (devmap[i] && strcmp(devmap[i]->name, name) == 0) {
-			delete devmap[i];
-			PX4_DEBUG("Unregistered class DEV %s", name);
-			devmap[i] = NULL;
-			return PX4_OK;
-		}
+	int ret = -EINVAL;
+
+	pthread_mutex_lock(&devmutex);
+
+	px4_dev_t *dev = dev_find(name);
+
+	if (dev != NULL) {
+		dev_remove(dev);
+		PX4_DEBUG("Unregistered class DEV %s", name);
+		ret = PX4_OK;
 	}
 
-	return -EINVAL;
+	pthread_mutex_unlock(&devmutex);
+
+	return ret;
 }
 
 int
@@ -391,7 +506,7 @@ VDev::poll(file_t *filep, px4_pollfd_struct_t *fds, bool setup)
 
 			/* yes? post the notification */
 			if (fds->revents != 0) {
-				px4_sem_post(fds->sem);
+				px4_pollset_notify(fds->pollset);
 			}
 
 		} else {
@@ -410,6 +525,18 @@ VDev::poll(file_t *filep, px4_pollfd_struct_t *fds, bool setup)
 	return ret;
 }
 
+pollevent_t
+VDev::poll_refresh(file_t *filep, px4_pollfd_struct_t *fds, pollevent_t consumed)
+{
+	/* lock against poll_notify() updating revents, the notified events are kept until consumed */
+	lock();
+	fds->revents = (fds->revents & ~consumed) | (fds->events & poll_state(filep));
+	pollevent_t revents = fds->revents;
+	unlock();
+
+	return revents;
+}
+
 void
 VDev::poll_notify(pollevent_t events)
 {
@@ -430,18 +557,15 @@ void
 VDev::poll_notify_one(px4_pollfd_struct_t *fds, pollevent_t events)
 {
 	PX4_DEBUG("VDev::poll_notify_one");
-	int value;
-	px4_sem_getvalue(fds->sem, &value);
 
 	/* update the reported event set */
 	fds->revents |= fds->events & events;
 
-	PX4_DEBUG(" Events fds=%p %0x %0x %0x %d", fds, fds->revents, fds->events, events, value);
+	PX4_DEBUG(" Events fds=%p %0x %0x %0x", fds, fds->revents, fds->events, events);
 
-	/* if the state is now interesting, wake the waiter if it's still asleep */
-	/* XXX semcount check here is a vile hack; counting semphores should not be abused as cvars */
-	if ((fds->revents != 0) && (value <= 0)) {
-		px4_sem_post(fds->sem);
+	/* if the state is now interesting, wake the waiter; cheap if it is awake already */
+	if (fds->revents != 0) {
+		px4_pollset_notify(fds->pollset);
 	}
 }
 
@@ -495,75 +619,87 @@ VDev::remove_poll_waiter(px4_pollfd_struct_t *fds)
 VDev *VDev::getDev(const char *path)
 {
 	PX4_DEBUG("VDev::getDev");
-	int i = 0;
-
-	for (; i < PX4_MAX_DEV; ++i) {
-		//if (devmap[i]) {
-		//	printf("%s %s\n", devmap[i]->name, path);
-		//}
-		if (devmap[i] && (strcmp(devmap[i]->name, path) == 0)) {
-			return (VDev *)(devmap[i]->cdev);
-		}
+	VDev *vdev = NULL;
+
+	pthread_mutex_lock(&devmutex);
+
+	px4_dev_t *dev = dev_find(path);
+
+	if (dev != NULL) {
+		vdev = (VDev *)dev->cdev;
 	}
 
-	return NULL;
+	pthread_mutex_unlock(&devmutex);
+
+	return vdev;
 }
 
-void VDev::showDevices()
+/*
+ * Print the registered devices whose name does (or, for prefix == NULL,
+ * does neither start with /dev/ nor /obj/).
+ */
+static void showDevicesWithPrefix(const char *prefix)
 {
-	int i = 0;
-	PX4_INFO("Devices:");
+	pthread_mutex_lock(&devmutex);
 
-	for (; i < PX4_MAX_DEV; ++i) {
-		if (devmap[i] && strncmp(devmap[i]->name, "/dev/", 5) == 0) {
-			PX4_INFO("   %s", devmap[i]->name);
+	for (unsigned i = 0; i < devmap_count; ++i) {
+		const char *name = devmap[i]->name;
+
+		if ((prefix != NULL && strncmp(name, prefix, 5) == 0) ||
+		    (prefix == NULL && strncmp(name, "/obj/", 5) != 0 && strncmp(name, "/dev/", 5) != 0)) {
+			PX4_INFO("   %s", name);
 		}
 	}
+
+	pthread_mutex_unlock(&devmutex);
 }
 
-void VDev::showTopics()
+/*
+ * Return the next registered name with prefix, starting at slot *next.
+ */
+static const char *listWithPrefix(unsigned int *next, const char *prefix)
 {
-	int i = 0;
-	PX4_INFO("Devices:");
+	const char *name = NULL;
+
+	pthread_mutex_lock(&devmutex);
 
-	for (; i < PX4_MAX_DEV; ++i) {
-		if (devmap[i] && strncmp(devmap[i]->name, "/obj/", 5) == 0) {
-			PX4_INFO("   %s", devmap[i]->name);
+	for (; *next < devmap_count; (*next)++)
+		if (strncmp(devmap[*next]->name, prefix, 5) == 0) {
+			name = devmap[(*next)++]->name;
+			break;
 		}
-	}
+
+	pthread_mutex_unlock(&devmutex);
+
+	return name;
+}
+
+void VDev::showDevices()
+{
+	PX4_INFO("Devices:");
+	showDevicesWithPrefix("/dev/");
+}
+
+void VDev::showTopics()
+{
+	PX4_INFO("Devices:");
+	showDevicesWithPrefix("/obj/");
 }
 
 void VDev::showFiles()
 {
-	int i = 0;
 	PX4_INFO("Files:");
-
-	for (; i < PX4_MAX_DEV; ++i) {
-		if (devmap[i] && strncmp(devmap[i]->name, "/obj/", 5) != 0 &&
-		    strncmp(devmap[i]->name, "/dev/", 5) != 0) {
-			PX4_INFO("   %s", devmap[i]->name);
-		}
-	}
+	showDevicesWithPrefix(NULL);
 }
 
 const char *VDev::topicList(unsigned int *next)
 {
-	for (; *next < PX4_MAX_DEV; (*next)++)
-		if (devmap[*next] && strncmp(devmap[(*next)]->name, "/obj/", 5) == 0) {
-			return devmap[(*next)++]->name;
-		}
-
-	return NULL;
+	return listWithPrefix(next, "/obj/");
 }
 
 const char *VDev::devList(unsigned int *next)
 {
-	for (; *next < PX4_MAX_DEV; (*next)++)
-		if (devmap[*next] && strncmp(devmap[(*next)]->name, "/dev/", 5) == 0) {
-			return devmap[(*next)++]->name;
-		}
-
-	return NULL;
+	return listWithPrefix(next, "/dev/");
 }
 
 } // namespace device
\ No newline at end of file
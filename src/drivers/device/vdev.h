@@ -238,6 +238,20 @@ public:
 	 */
 	virtual int	poll(file_t *filep, px4_pollfd_struct_t *fds, bool setup);
 
+	/**
+	 * Re-evaluate the events of a poll waiter that stays set up.
+	 *
+	 * Used by persistent poll sets instead of a teardown/setup cycle
+	 * before each wait. Events posted by poll_notify() stay reported
+	 * until they are consumed.
+	 *
+	 * @param filep	Pointer to the internal file structure.
+	 * @param fds		Poll descriptor being waited on.
+	 * @param consumed	Notified events the waiter has already been given.
+	 * @return		The events now reported in fds->revents.
+	 */
+	pollevent_t	poll_refresh(file_t *filep, px4_pollfd_struct_t *fds, pollevent_t consumed);
+
 	/**
 	 * Test whether the device is currently open.
 	 *
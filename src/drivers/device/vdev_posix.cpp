@@ -43,32 +43,119 @@
 #include "device.h"
 #include "vfile.h"
 
-#include <hrt_work.h>
+#include <drivers/drv_hrt.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <pthread.h>
 #include <unistd.h>
 
+#ifdef __PX4_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 using namespace device;
 
+/**
+ * Wakeup state of a poll set.
+ *
+ * Devices set pending from poll_notify_one(), the waiter clears it before
+ * re-evaluating its descriptors. The waiter only blocks while pending is
+ * clear, and notifiers only make a system call while it is blocked, so
+ * notifying a busy waiter costs two atomic operations.
+ */
+struct px4_pollset {
+	px4_pollfd_struct_t	*fds;
+	nfds_t			nfds;
+	int			pending;	/**< nonzero if notified since the last evaluation */
+	int			sleeping;	/**< nonzero while the waiter is blocked */
+	pollevent_t		*reported;	/**< events returned by the last wait, persistent sets only */
+#ifndef __PX4_LINUX
+	pthread_mutex_t		lock;
+	pthread_cond_t		wakeup;
+#endif
+};
+
 extern "C" {
 
-	static void timer_cb(void *data)
+	/*
+	 * File descriptor table. Descriptors are handed out from a free list and
+	 * the table grows in chunks that are never moved or freed, so looking up
+	 * an open descriptor needs no lock. Allocation and release take fdmutex.
+	 */
+#define PX4_FD_CHUNK 64
+#define PX4_MAX_FD_CHUNKS 1024
+
+	struct fd_chunk {
+		device::file_t *file[PX4_FD_CHUNK];
+		int next_free[PX4_FD_CHUNK];	/* free list link while the descriptor is unused */
+	};
+
+	static fd_chunk *fdtable[PX4_MAX_FD_CHUNKS] = {};
+	static unsigned fd_chunks = 0;
+	static int fd_free = -1;
+	static pthread_mutex_t fdmutex = PTHREAD_MUTEX_INITIALIZER;
+
+	int px4_errno;
+
+	static inline device::file_t *get_file(int fd)
 	{
-		px4_sem_t *p_sem = (px4_sem_t *)data;
-		px4_sem_post(p_sem);
-		PX4_DEBUG("timer_handler: Timer expired");
+		if (fd < 0 || fd >= PX4_MAX_FD_CHUNKS * PX4_FD_CHUNK) {
+			return NULL;
+		}
+
+		fd_chunk *chunk = __atomic_load_n(&fdtable[fd / PX4_FD_CHUNK], __ATOMIC_ACQUIRE);
+
+		return (chunk != NULL) ? __atomic_load_n(&chunk->file[fd % PX4_FD_CHUNK], __ATOMIC_ACQUIRE) : NULL;
 	}
 
-#define PX4_MAX_FD 200
-	static device::file_t *filemap[PX4_MAX_FD] = {};
+	static int alloc_fd()
+	{
+		pthread_mutex_lock(&fdmutex);
 
-	int px4_errno;
+		if (fd_free < 0 && fd_chunks < PX4_MAX_FD_CHUNKS) {
+			fd_chunk *chunk = new fd_chunk;
+
+			if (chunk != NULL) {
+				int base = fd_chunks * PX4_FD_CHUNK;
+
+				/* link the new descriptors so the lowest is handed out first */
+				for (int i = 0; i < PX4_FD_CHUNK; i++) {
+					chunk->file[i] = NULL;
+					chunk->next_free[i] = (i + 1 < PX4_FD_CHUNK) ? base + i + 1 : -1;
+				}
 
-	inline bool valid_fd(int fd)
+				fd_free = base;
+				__atomic_store_n(&fdtable[fd_chunks++], chunk, __ATOMIC_RELEASE);
+			}
+		}
+
+		int fd = fd_free;
+
+		if (fd >= 0) {
+			fd_free = fdtable[fd / PX4_FD_CHUNK]->next_free[fd % PX4_FD_CHUNK];
+		}
+
+		pthread_mutex_unlock(&fdmutex);
+
+		return fd;
+	}
+
+	static void set_file(int fd, device::file_t *file)
 	{
-		return (fd < PX4_MAX_FD && fd >= 0 && filemap[fd] != NULL);
+		__atomic_store_n(&fdtable[fd / PX4_FD_CHUNK]->file[fd % PX4_FD_CHUNK], file, __ATOMIC_RELEASE);
+	}
+
+	static void release_fd(int fd)
+	{
+		pthread_mutex_lock(&fdmutex);
+
+		set_file(fd, NULL);
+		fdtable[fd / PX4_FD_CHUNK]->next_free[fd % PX4_FD_CHUNK] = fd_free;
+		fd_free = fd;
+
+		pthread_mutex_unlock(&fdmutex);
 	}
 
 	int px4_open(const char *path, int flags, ...)
@@ -76,7 +163,7 @@ extern "C" {
 		PX4_DEBUG("px4_open");
 		VDev *dev = VDev::getDev(path);
 		int ret = 0;
-		int i;
+		int fd = -1;
 		mode_t mode;
 
 		if (!dev && (flags & (PX4_F_WRONLY | PX4_F_CREAT)) != 0 &&
@@ -93,19 +180,23 @@ extern "C" {
 		}
 
 		if (dev) {
-			for (i = 0; i < PX4_MAX_FD; ++i) {
-				if (filemap[i] == 0) {
-					filemap[i] = new device::file_t(flags, dev, i);
-					break;
-				}
-			}
+			fd = alloc_fd();
+
+			if (fd >= 0) {
+				device::file_t *file = new device::file_t(flags, dev, fd);
+				ret = dev->open(file);
 
-			if (i < PX4_MAX_FD) {
-				ret = dev->open(filemap[i]);
+				if (ret < 0) {
+					release_fd(fd);
+					delete file;
+
+				} else {
+					set_file(fd, file);
+				}
 
 			} else {
 				PX4_WARN("exceeded maximum number of file descriptors!");
-				ret = -ENOENT;
+				ret = -EMFILE;
 			}
 
 		} else {
@@ -117,19 +208,22 @@ extern "C" {
 			return -1;
 		}
 
-		PX4_DEBUG("px4_open fd = %d", filemap[i]->fd);
-		return filemap[i]->fd;
+		PX4_DEBUG("px4_open fd = %d", fd);
+		return fd;
 	}
 
 	int px4_close(int fd)
 	{
 		int ret;
 
-		if (valid_fd(fd)) {
-			VDev *dev = (VDev *)(filemap[fd]->vdev);
+		device::file_t *file = get_file(fd);
+
+		if (file != NULL) {
+			VDev *dev = (VDev *)(file->vdev);
 			PX4_DEBUG("px4_close fd = %d", fd);
-			ret = dev->close(filemap[fd]);
-			filemap[fd] = NULL;
+			ret = dev->close(file);
+			release_fd(fd);
+			delete file;
 
 		} else {
 			ret = -EINVAL;
@@ -147,10 +241,12 @@ extern "C" {
 	{
 		int ret;
 
-		if (valid_fd(fd)) {
-			VDev *dev = (VDev *)(filemap[fd]->vdev);
+		device::file_t *file = get_file(fd);
+
+		if (file != NULL) {
+			VDev *dev = (VDev *)(file->vdev);
 			PX4_DEBUG("px4_read fd = %d", fd);
-			ret = dev->read(filemap[fd], (char *)buffer, buflen);
+			ret = dev->read(file, (char *)buffer, buflen);
 
 		} else {
 			ret = -EINVAL;
@@ -168,10 +264,12 @@ extern "C" {
 	{
 		int ret;
 
-		if (valid_fd(fd)) {
-			VDev *dev = (VDev *)(filemap[fd]->vdev);
+		device::file_t *file = get_file(fd);
+
+		if (file != NULL) {
+			VDev *dev = (VDev *)(file->vdev);
 			PX4_DEBUG("px4_write fd = %d", fd);
-			ret = dev->write(filemap[fd], (const char *)buffer, buflen);
+			ret = dev->write(file, (const char *)buffer, buflen);
 
 		} else {
 			ret = -EINVAL;
@@ -190,9 +288,11 @@ extern "C" {
 		PX4_DEBUG("px4_ioctl fd = %d", fd);
 		int ret = 0;
 
-		if (valid_fd(fd)) {
-			VDev *dev = (VDev *)(filemap[fd]->vdev);
-			ret = dev->ioctl(filemap[fd], cmd, arg);
+		device::file_t *file = get_file(fd);
+
+		if (file != NULL) {
+			VDev *dev = (VDev *)(file->vdev);
+			ret = dev->ioctl(file, cmd, arg);
 
 		} else {
 			ret = -EINVAL;
@@ -205,70 +305,288 @@ extern "C" {
 		return ret;
 	}
 
-	int px4_poll(px4_pollfd_struct_t *fds, nfds_t nfds, int timeout)
+	static void pollset_init(px4_pollset_t *set, px4_pollfd_struct_t *fds, nfds_t nfds)
 	{
-		px4_sem_t sem;
-		int count = 0;
-		int ret = -1;
-		unsigned int i;
+		set->fds = fds;
+		set->nfds = nfds;
+		set->pending = 0;
+		set->sleeping = 0;
+		set->reported = nullptr;
+#ifndef __PX4_LINUX
+		pthread_mutex_init(&set->lock, NULL);
+		pthread_cond_init(&set->wakeup, NULL);
+#endif
+	}
 
-		PX4_DEBUG("Called px4_poll timeout = %d", timeout);
-		px4_sem_init(&sem, 0, 0);
+	static void pollset_fini(px4_pollset_t *set)
+	{
+		delete[] set->reported;
+		set->reported = nullptr;
+
+#ifndef __PX4_LINUX
+		pthread_cond_destroy(&set->wakeup);
+		pthread_mutex_destroy(&set->lock);
+#endif
+	}
+
+	static void pollset_teardown(px4_pollset_t *set, nfds_t nfds)
+	{
+		// For each fd
+		for (nfds_t i = 0; i < nfds; ++i) {
+			device::file_t *file = get_file(set->fds[i].fd);
+
+			// If fd is valid
+			if (file != NULL) {
+				VDev *dev = (VDev *)(file->vdev);
+				PX4_DEBUG("px4_poll: VDev->poll(teardown) %d", set->fds[i].fd);
+				dev->poll(file, &set->fds[i], false);
+			}
+		}
+	}
 
+	static int pollset_setup(px4_pollset_t *set)
+	{
 		// For each fd
-		for (i = 0; i < nfds; ++i) {
-			fds[i].sem     = &sem;
-			fds[i].revents = 0;
-			fds[i].priv    = NULL;
+		for (nfds_t i = 0; i < set->nfds; ++i) {
+			px4_pollfd_struct_t *fds = &set->fds[i];
+
+			fds->pollset = set;
+			fds->revents = 0;
+			fds->priv    = NULL;
+
+			device::file_t *file = get_file(fds->fd);
 
 			// If fd is valid
-			if (valid_fd(fds[i].fd)) {
-				VDev *dev = (VDev *)(filemap[fds[i].fd]->vdev);;
-				PX4_DEBUG("px4_poll: VDev->poll(setup) %d", fds[i].fd);
-				ret = dev->poll(filemap[fds[i].fd], &fds[i], true);
+			if (file != NULL) {
+				VDev *dev = (VDev *)(file->vdev);
+				PX4_DEBUG("px4_poll: VDev->poll(setup) %d", fds->fd);
+				int ret = dev->poll(file, fds, true);
 
 				if (ret < 0) {
+					pollset_teardown(set, i);
+					return ret;
+				}
+			}
+		}
+
+		return PX4_OK;
+	}
+
+	/**
+	 * Block until notified or until the deadline passes.
+	 */
+	static void pollset_sleep(px4_pollset_t *set, uint64_t deadline)
+	{
+#ifndef __PX4_QURT
+
+		if (hrt_lockstep_enabled()) {
+			/* the deadline is in simulator time, wait on its clock */
+			__atomic_store_n(&set->sleeping, 1, __ATOMIC_SEQ_CST);
+			hrt_lockstep_wait(deadline, &set->pending);
+			__atomic_store_n(&set->sleeping, 0, __ATOMIC_SEQ_CST);
+			return;
+		}
+
+#endif
+
+#ifdef __PX4_LINUX
+		struct timespec ts;
+		struct timespec *abs_timeout = NULL;
+
+		if (deadline != PX4_POLLSET_FOREVER) {
+			/* hrt time is CLOCK_MONOTONIC with an offset, translate the deadline */
+			hrt_abstime now = hrt_absolute_time();
+
+			if (now >= deadline) {
+				return;
+			}
+
+			px4_clock_gettime(CLOCK_MONOTONIC, &ts);
+			abstime_to_ts(&ts, ts_to_abstime(&ts) + (deadline - now));
+			abs_timeout = &ts;
+		}
+
+		__atomic_store_n(&set->sleeping, 1, __ATOMIC_SEQ_CST);
+
+		/* the kernel re-checks pending, so a notification cannot be missed */
+		if (__atomic_load_n(&set->pending, __ATOMIC_SEQ_CST) == 0) {
+			syscall(SYS_futex, &set->pending, FUTEX_WAIT_BITSET_PRIVATE, 0, abs_timeout, NULL,
+				FUTEX_BITSET_MATCH_ANY);
+		}
+
+		__atomic_store_n(&set->sleeping, 0, __ATOMIC_SEQ_CST);
+#else
+		pthread_mutex_lock(&set->lock);
+		set->sleeping = 1;
+
+		while (set->pending == 0) {
+			if (deadline == PX4_POLLSET_FOREVER) {
+				pthread_cond_wait(&set->wakeup, &set->lock);
+
+			} else {
+				hrt_abstime now = hrt_absolute_time();
+
+				if (now >= deadline) {
 					break;
 				}
+
+				/* condition variables time out against the wall clock */
+				struct timespec ts;
+				clock_gettime(CLOCK_REALTIME, &ts);
+				abstime_to_ts(&ts, ts_to_abstime(&ts) + (deadline - now));
+				pthread_cond_timedwait(&set->wakeup, &set->lock, &ts);
 			}
 		}
 
-		if (ret >= 0) {
-			if (timeout > 0) {
-				// Use a work queue task
-				work_s _hpwork;
+		set->sleeping = 0;
+		pthread_mutex_unlock(&set->lock);
+#endif
+	}
+
+	void px4_pollset_notify(px4_pollset_t *set)
+	{
+#ifdef __PX4_LINUX
+		__atomic_store_n(&set->pending, 1, __ATOMIC_SEQ_CST);
+
+		if (__atomic_load_n(&set->sleeping, __ATOMIC_SEQ_CST) != 0) {
+			if (hrt_lockstep_enabled()) {
+				hrt_lockstep_notify();
+			}
+
+			syscall(SYS_futex, &set->pending, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+		}
 
-				hrt_work_queue(&_hpwork, (worker_t)&timer_cb, (void *)&sem, 1000 * timeout);
-				px4_sem_wait(&sem);
+#else
+		pthread_mutex_lock(&set->lock);
+		__atomic_store_n(&set->pending, 1, __ATOMIC_SEQ_CST);
 
-				// Make sure timer thread is killed before sem goes
-				// out of scope
-				hrt_work_cancel(&_hpwork);
+		if (__atomic_load_n(&set->sleeping, __ATOMIC_SEQ_CST)) {
+#ifndef __PX4_QURT
 
-			} else if (timeout < 0) {
-				px4_sem_wait(&sem);
+			if (hrt_lockstep_enabled()) {
+				hrt_lockstep_notify();
 			}
 
+#endif
+			pthread_cond_signal(&set->wakeup);
+		}
+
+		pthread_mutex_unlock(&set->lock);
+#endif
+	}
+
+	px4_pollset_t *px4_pollset_create(px4_pollfd_struct_t *fds, nfds_t nfds)
+	{
+		px4_pollset_t *set = new px4_pollset_t;
+
+		if (set == nullptr) {
+			px4_errno = ENOMEM;
+			return nullptr;
+		}
+
+		pollset_init(set, fds, nfds);
+
+		/* the set is waited on repeatedly, notified events are consumed by the wait returning them */
+		set->reported = new pollevent_t[nfds];
+
+		if (set->reported == nullptr) {
+			pollset_fini(set);
+			delete set;
+			px4_errno = ENOMEM;
+			return nullptr;
+		}
+
+		memset(set->reported, 0, nfds * sizeof(pollevent_t));
+
+		int ret = pollset_setup(set);
+
+		if (ret < 0) {
+			pollset_fini(set);
+			delete set;
+			px4_errno = -ret;
+			return nullptr;
+		}
+
+		return set;
+	}
+
+	int px4_pollset_wait(px4_pollset_t *set, uint64_t deadline)
+	{
+		for (;;) {
+			int count = 0;
+
+			/* clear before evaluating, so a notification racing with it wakes the sleep below */
+			__atomic_store_n(&set->pending, 0, __ATOMIC_SEQ_CST);
+
 			// For each fd
-			for (i = 0; i < nfds; ++i) {
+			for (nfds_t i = 0; i < set->nfds; ++i) {
+				px4_pollfd_struct_t *fds = &set->fds[i];
+				pollevent_t consumed = 0;
+
+				if (set->reported != nullptr) {
+					consumed = set->reported[i];
+					set->reported[i] = 0;
+				}
+
+				device::file_t *file = get_file(fds->fd);
+
 				// If fd is valid
-				if (valid_fd(fds[i].fd)) {
-					VDev *dev = (VDev *)(filemap[fds[i].fd]->vdev);;
-					PX4_DEBUG("px4_poll: VDev->poll(teardown) %d", fds[i].fd);
-					ret = dev->poll(filemap[fds[i].fd], &fds[i], false);
+				if (file != NULL) {
+					VDev *dev = (VDev *)(file->vdev);
 
-					if (ret < 0) {
-						break;
+					if (dev->poll_refresh(file, fds, consumed) != 0) {
+						count += 1;
 					}
+				}
+			}
 
-					if (fds[i].revents) {
-						count += 1;
+			if (count > 0 || hrt_absolute_time() >= deadline) {
+				if (set->reported != nullptr) {
+					for (nfds_t i = 0; i < set->nfds; ++i) {
+						set->reported[i] = set->fds[i].revents;
 					}
 				}
+
+				return count;
 			}
+
+			pollset_sleep(set, deadline);
+		}
+	}
+
+	void px4_pollset_destroy(px4_pollset_t *set)
+	{
+		if (set != nullptr) {
+			pollset_teardown(set, set->nfds);
+			pollset_fini(set);
+			delete set;
+		}
+	}
+
+	int px4_poll(px4_pollfd_struct_t *fds, nfds_t nfds, int timeout)
+	{
+		px4_pollset_t set;
+		int count = 0;
+
+		PX4_DEBUG("Called px4_poll timeout = %d", timeout);
+
+		/* a poll set that lives for a single wait */
+		pollset_init(&set, fds, nfds);
+
+		int ret = pollset_setup(&set);
+
+		if (ret < 0) {
+			pollset_fini(&set);
+			px4_errno = -ret;
+			return PX4_ERROR;
 		}
 
-		px4_sem_destroy(&sem);
+		uint64_t deadline = (timeout < 0) ? PX4_POLLSET_FOREVER : hrt_absolute_time() + 1000 * (uint64_t)timeout;
+
+		count = px4_pollset_wait(&set, deadline);
+
+		pollset_teardown(&set, nfds);
+		pollset_fini(&set);
 
 		return count;
 	}
@@ -68,9 +68,16 @@ typedef void	(* hrt_callout)(void *arg);
 
 /*
  * Callout record.
+ *
+ * On POSIX the record is linked into a timer wheel and has to be zeroed
+ * (or hrt_call_init()'d) before its first use.
  */
 typedef struct hrt_call {
+#if defined(__PX4_POSIX) && !defined(__PX4_QURT)
+	struct dq_entry_s	link;
+#else
 	struct sq_entry_s	link;
+#endif
 
 	hrt_abstime		deadline;
 	hrt_abstime		period;
@@ -163,4 +170,31 @@ __EXPORT extern void	hrt_call_delay(struct hrt_call *entry, hrt_abstime delay);
  */
 __EXPORT extern void	hrt_init(void);
 
+#if defined(__PX4_POSIX) && !defined(__PX4_QURT)
+
+/*
+ * Lockstep mode for simulation: hrt_absolute_time() stops following the
+ * system clock and only advances when the simulator sets it. Work queue,
+ * callout, poll and px4_usleep() timeouts are measured against it, so the
+ * system runs as fast as the simulator steps.
+ */
+__EXPORT extern void	hrt_lockstep_enable(void);
+
+__EXPORT extern bool	hrt_lockstep_enabled(void);
+
+/*
+ * Advance the lockstep clock to now, earlier times are ignored.
+ */
+__EXPORT extern void	hrt_lockstep_set_time(hrt_abstime now);
+
+/*
+ * Block until the lockstep clock reaches deadline or, if wake is not NULL,
+ * until *wake is nonzero. Whoever sets *wake calls hrt_lockstep_notify().
+ */
+__EXPORT extern void	hrt_lockstep_wait(hrt_abstime deadline, const int *wake);
+
+__EXPORT extern void	hrt_lockstep_notify(void);
+
+#endif
+
 __END_DECLS
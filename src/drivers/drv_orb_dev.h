@@ -90,4 +90,10 @@
 /** Get the priority for the topic */
 #define ORBIOCGPRIORITY		_ORBIOC(14)
 
+/** Get a read-only view of the topic buffer into *(struct orb_peek_s *)arg */
+#define ORBIOCPEEK		_ORBIOC(15)
+
+/** Get the number of publications the subscriber missed into *(unsigned *)arg */
+#define ORBIOCGLOST		_ORBIOC(16)
+
 #endif /* _DRV_UORB_H */
@@ -233,7 +233,7 @@ private:
 	struct hrt_call		_call;
 	unsigned		_call_interval;
 
-	ringbuffer::RingBuffer	*_reports;
+	ringbuffer::TypedRingBuffer<gyro_report>	*_reports;
 
 	struct gyro_scale	_gyro_scale;
 	float			_gyro_range_scale;
@@ -484,7 +484,7 @@ L3GD20::init()
 	}
 
 	/* allocate basic report buffers */
-	_reports = new ringbuffer::RingBuffer(2, sizeof(gyro_report));
+	_reports = new ringbuffer::TypedRingBuffer<gyro_report>(2);
 
 	if (_reports == nullptr) {
 		goto out;
@@ -498,7 +498,7 @@ L3GD20::init()
 
 	/* advertise sensor topic, measure manually to initialize valid report */
 	struct gyro_report grp;
-	_reports->get(&grp);
+	_reports->get(grp);
 
 	_gyro_topic = orb_advertise_multi(ORB_ID(sensor_gyro), &grp,
 					  &_orb_class_instance, (is_external()) ? ORB_PRIO_VERY_HIGH : ORB_PRIO_DEFAULT);
@@ -566,12 +566,7 @@ L3GD20::read(struct file *filp, char *buffer, size_t buflen)
 		 * Note that we may be pre-empted by the measurement code while we are doing this;
 		 * we are careful to avoid racing with it.
 		 */
-		while (count--) {
-			if (_reports->get(gbuf)) {
-				ret += sizeof(*gbuf);
-				gbuf++;
-			}
-		}
+		ret = _reports->get_n(gbuf, count) * sizeof(*gbuf);
 
 		/* if there was no data, warn the caller */
 		return ret ? ret : -EAGAIN;
@@ -582,7 +577,7 @@ L3GD20::read(struct file *filp, char *buffer, size_t buflen)
 	measure();
 
 	/* measurement will have generated a report, copy it out */
-	if (_reports->get(gbuf)) {
+	if (_reports->get(*gbuf)) {
 		ret = sizeof(*gbuf);
 	}
 
@@ -1080,7 +1075,7 @@ L3GD20::measure()
 	report.scaling = _gyro_range_scale;
 	report.range_rad_s = _gyro_range_rad_s;
 
-	_reports->force(&report);
+	_reports->force(report);
 
 	if (gyro_notify) {
 		/* notify anyone waiting for data */
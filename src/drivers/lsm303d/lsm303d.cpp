@@ -276,8 +276,8 @@ private:
 	unsigned		_call_accel_interval;
 	unsigned		_call_mag_interval;
 
-	ringbuffer::RingBuffer	*_accel_reports;
-	ringbuffer::RingBuffer		*_mag_reports;
+	ringbuffer::TypedRingBuffer<accel_report>	*_accel_reports;
+	ringbuffer::TypedRingBuffer<mag_report>	*_mag_reports;
 
 	struct accel_scale	_accel_scale;
 	unsigned		_accel_range_m_s2;
@@ -656,13 +656,13 @@ LSM303D::init()
 	}
 
 	/* allocate basic report buffers */
-	_accel_reports = new ringbuffer::RingBuffer(2, sizeof(accel_report));
+	_accel_reports = new ringbuffer::TypedRingBuffer<accel_report>(2);
 
 	if (_accel_reports == nullptr) {
 		goto out;
 	}
 
-	_mag_reports = new ringbuffer::RingBuffer(2, sizeof(mag_report));
+	_mag_reports = new ringbuffer::TypedRingBuffer<mag_report>(2);
 
 	if (_mag_reports == nullptr) {
 		goto out;
@@ -683,7 +683,7 @@ LSM303D::init()
 
 	/* advertise sensor topic, measure manually to initialize valid report */
 	struct mag_report mrp;
-	_mag_reports->get(&mrp);
+	_mag_reports->get(mrp);
 
 	/* measurement will have generated a report, publish */
 	_mag->_mag_topic = orb_advertise_multi(ORB_ID(sensor_mag), &mrp,
@@ -698,7 +698,7 @@ LSM303D::init()
 
 	/* advertise sensor topic, measure manually to initialize valid report */
 	struct accel_report arp;
-	_accel_reports->get(&arp);
+	_accel_reports->get(arp);
 
 	/* measurement will have generated a report, publish */
 	_accel_topic = orb_advertise_multi(ORB_ID(sensor_accel), &arp,
@@ -792,12 +792,7 @@ LSM303D::read(struct file *filp, char *buffer, size_t buflen)
 		/*
 		 * While there is space in the caller's buffer, and reports, copy them.
 		 */
-		while (count--) {
-			if (_accel_reports->get(arb)) {
-				ret += sizeof(*arb);
-				arb++;
-			}
-		}
+		ret = _accel_reports->get_n(arb, count) * sizeof(*arb);
 
 		/* if there was no data, warn the caller */
 		return ret ? ret : -EAGAIN;
@@ -807,7 +802,7 @@ LSM303D::read(struct file *filp, char *buffer, size_t buflen)
 	measure();
 
 	/* measurement will have generated a report, copy it out */
-	if (_accel_reports->get(arb)) {
+	if (_accel_reports->get(*arb)) {
 		ret = sizeof(*arb);
 	}
 
@@ -832,12 +827,7 @@ LSM303D::mag_read(struct file *filp, char *buffer, size_t buflen)
 		/*
 		 * While there is space in the caller's buffer, and reports, copy them.
 		 */
-		while (count--) {
-			if (_mag_reports->get(mrb)) {
-				ret += sizeof(*mrb);
-				mrb++;
-			}
-		}
+		ret = _mag_reports->get_n(mrb, count) * sizeof(*mrb);
 
 		/* if there was no data, warn the caller */
 		return ret ? ret : -EAGAIN;
@@ -848,7 +838,7 @@ LSM303D::mag_read(struct file *filp, char *buffer, size_t buflen)
 	_mag->measure();
 
 	/* measurement will have generated a report, copy it out */
-	if (_mag_reports->get(mrb)) {
+	if (_mag_reports->get(*mrb)) {
 		ret = sizeof(*mrb);
 	}
 
@@ -1648,7 +1638,7 @@ LSM303D::measure()
 	accel_report.scaling = _accel_range_scale;
 	accel_report.range_m_s2 = _accel_range_m_s2;
 
-	_accel_reports->force(&accel_report);
+	_accel_reports->force(accel_report);
 
 	/* notify anyone waiting for data */
 	if (accel_notify) {
@@ -1734,7 +1724,7 @@ LSM303D::mag_measure()
 	_last_temperature = 25 + (raw_mag_report.temperature * 0.125f);
 	mag_report.temperature = _last_temperature;
 
-	_mag_reports->force(&mag_report);
+	_mag_reports->force(mag_report);
 
 	/* notify anyone waiting for data */
 	poll_notify(POLLIN);
@@ -72,6 +72,7 @@
 #include <drivers/device/integrator.h>
 #include <drivers/drv_accel.h>
 #include <drivers/drv_gyro.h>
+#include <uORB/topics/sensor_imu_fifo.h>
 #include <mathlib/math/filter/LowPassFilter2p.hpp>
 #include <lib/conversion/rotation.h>
 
@@ -146,8 +147,13 @@
 #define BIT_INT_ANYRD_2CLEAR		0x10
 #define BIT_RAW_RDY_EN			0x01
 #define BIT_I2C_IF_DIS			0x10
+#define BIT_USER_CTRL_FIFO_EN		0x40
+#define BIT_USER_CTRL_FIFO_RESET	0x04
 #define BIT_INT_STATUS_DATA		0x01
 
+// accel, temperature and gyro in the FIFO, in the same order as the data registers
+#define BITS_FIFO_EN_ACCEL_TEMP_GYRO	0xF8
+
 #define MPU_WHOAMI_6000			0x68
 
 // Product ID Description for MPU6000
@@ -203,12 +209,23 @@
  */
 #define MPU6000_TIMER_REDUCTION				200
 
+/*
+  in FIFO mode the sensor queues the samples at the sample rate and
+  the timer only runs at the FIFO read rate, reading all queued
+  samples in one transfer
+ */
+#define MPU6000_FIFO_DEFAULT_READ_RATE			250
+#define MPU6000_FIFO_SIZE				1024
+#define MPU6000_FIFO_SAMPLE_SIZE			14
+#define MPU6000_FIFO_MAX_SAMPLES			(MPU6000_FIFO_SIZE / MPU6000_FIFO_SAMPLE_SIZE)
+
 class MPU6000_gyro;
 
 class MPU6000 : public device::SPI
 {
 public:
-	MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation);
+	MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation,
+		bool fifo);
 	virtual ~MPU6000();
 
 	virtual int		init();
@@ -248,7 +265,7 @@ private:
 	struct hrt_call		_call;
 	unsigned		_call_interval;
 
-	ringbuffer::RingBuffer	*_accel_reports;
+	ringbuffer::TypedRingBuffer<accel_report>	*_accel_reports;
 
 	struct accel_scale	_accel_scale;
 	float			_accel_range_scale;
@@ -257,7 +274,7 @@ private:
 	int			_accel_orb_class_instance;
 	int			_accel_class_instance;
 
-	ringbuffer::RingBuffer	*_gyro_reports;
+	ringbuffer::TypedRingBuffer<gyro_report>	*_gyro_reports;
 
 	struct gyro_scale	_gyro_scale;
 	float			_gyro_range_scale;
@@ -272,6 +289,7 @@ private:
 	perf_counter_t		_good_transfers;
 	perf_counter_t		_reset_retries;
 	perf_counter_t		_duplicates;
+	perf_counter_t		_fifo_overflows;
 	perf_counter_t		_system_latency_perf;
 	perf_counter_t		_controller_latency_perf;
 
@@ -293,7 +311,7 @@ private:
 	// this is used to support runtime checking of key
 	// configuration registers to detect SPI bus errors and sensor
 	// reset
-#define MPU6000_NUM_CHECKED_REGISTERS 9
+#define MPU6000_NUM_CHECKED_REGISTERS 10
 	static const uint8_t	_checked_registers[MPU6000_NUM_CHECKED_REGISTERS];
 	uint8_t			_checked_values[MPU6000_NUM_CHECKED_REGISTERS];
 	uint8_t			_checked_next;
@@ -309,6 +327,13 @@ private:
 	uint16_t		_last_accel[3];
 	bool			_got_duplicate;
 
+	// FIFO burst mode, publishing sensor_imu_fifo
+	bool			_fifo;
+	orb_advert_t		_fifo_topic;
+	int			_fifo_orb_class_instance;
+	hrt_abstime		_fifo_last_sample;
+	hrt_abstime		_fifo_integral_start;
+
 	/**
 	 * Start automatic measurement.
 	 */
@@ -342,6 +367,49 @@ private:
 	 */
 	void			measure();
 
+	/**
+	 * Fetch all samples queued in the FIFO in one transfer and process them as a block.
+	 */
+	void			measure_fifo();
+
+	/**
+	 * Raw sample in native byte order.
+	 */
+	struct Report {
+		int16_t		accel_x;
+		int16_t		accel_y;
+		int16_t		accel_z;
+		int16_t		temp;
+		int16_t		gyro_x;
+		int16_t		gyro_y;
+		int16_t		gyro_z;
+	};
+
+	/**
+	 * Scale, filter and integrate one sample, queue the reports and publish
+	 * them whenever the integrators are due.
+	 *
+	 * @param report	The raw sample, the axes are swapped to the board frame in place.
+	 * @param timestamp	Time the sample was taken.
+	 * @param accel		The calibrated, unfiltered acceleration.
+	 * @param gyro		The calibrated, unfiltered angular rate.
+	 */
+	void			process_sample(Report &report, hrt_abstime timestamp, math::Vector<3> &accel,
+					       math::Vector<3> &gyro);
+
+	/**
+	 * Complete and publish the block of FIFO samples in _fifo_report with the integrals over the block.
+	 */
+	void			publish_fifo(hrt_abstime timestamp);
+
+	/**
+	 * Timer period, the FIFO read interval in FIFO mode.
+	 */
+	unsigned		call_period()
+	{
+		return _fifo ? (1000000 / MPU6000_FIFO_DEFAULT_READ_RATE) : (_call_interval - MPU6000_TIMER_REDUCTION);
+	}
+
 	/**
 	 * Read a register from the MPU6000
 	 *
@@ -349,7 +417,7 @@ private:
 	 * @return		The value that was read.
 	 */
 	uint8_t			read_reg(unsigned reg, uint32_t speed = MPU6000_LOW_BUS_SPEED);
-	uint16_t		read_reg16(unsigned reg);
+	uint16_t		read_reg16(unsigned reg, uint32_t speed = MPU6000_LOW_BUS_SPEED);
 
 	/**
 	 * Write a register in the MPU6000
@@ -454,7 +522,33 @@ private:
 		uint8_t		gyro_y[2];
 		uint8_t		gyro_z[2];
 	};
+
+	/**
+	 * One sample in the FIFO, the data registers without the interrupt status.
+	 */
+	struct FIFOSample {
+		uint8_t		accel_x[2];
+		uint8_t		accel_y[2];
+		uint8_t		accel_z[2];
+		uint8_t		temp[2];
+		uint8_t		gyro_x[2];
+		uint8_t		gyro_y[2];
+		uint8_t		gyro_z[2];
+	};
+
+	/**
+	 * Burst read of the FIFO, including command byte.
+	 */
+	struct FIFOTransfer {
+		uint8_t		cmd;
+		FIFOSample	samples[MPU6000_FIFO_MAX_SAMPLES];
+	};
 #pragma pack(pop)
+
+	FIFOTransfer		_fifo_transfer;
+
+	/* too large for the interrupt stack measure() runs on */
+	struct sensor_imu_fifo_s	_fifo_report;
 };
 
 /*
@@ -469,7 +563,8 @@ const uint8_t MPU6000::_checked_registers[MPU6000_NUM_CHECKED_REGISTERS] = { MPU
 									     MPUREG_GYRO_CONFIG,
 									     MPUREG_ACCEL_CONFIG,
 									     MPUREG_INT_ENABLE,
-									     MPUREG_INT_PIN_CFG
+									     MPUREG_INT_PIN_CFG,
+									     MPUREG_FIFO_EN
 									   };
 
 
@@ -507,7 +602,8 @@ private:
 /** driver 'main' command */
 extern "C" { __EXPORT int mpu6000_main(int argc, char *argv[]); }
 
-MPU6000::MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation) :
+MPU6000::MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation,
+		 bool fifo) :
 	SPI("MPU6000", path_accel, bus, device, SPIDEV_MODE3, MPU6000_LOW_BUS_SPEED),
 	_gyro(new MPU6000_gyro(this, path_gyro)),
 	_product(0),
@@ -533,6 +629,7 @@ MPU6000::MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev
 	_good_transfers(perf_alloc(PC_COUNT, "mpu6000_good_transfers")),
 	_reset_retries(perf_alloc(PC_COUNT, "mpu6000_reset_retries")),
 	_duplicates(perf_alloc(PC_COUNT, "mpu6000_duplicates")),
+	_fifo_overflows(perf_alloc(PC_COUNT, "mpu6000_fifo_overflows")),
 	_system_latency_perf(perf_alloc_once(PC_ELAPSED, "sys_latency")),
 	_controller_latency_perf(perf_alloc_once(PC_ELAPSED, "ctrl_latency")),
 	_register_wait(0),
@@ -550,7 +647,14 @@ MPU6000::MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev
 	_in_factory_test(false),
 	_last_temperature(0),
 	_last_accel{},
-	_got_duplicate(false)
+	_got_duplicate(false),
+	_fifo(fifo),
+	_fifo_topic(nullptr),
+	_fifo_orb_class_instance(-1),
+	_fifo_last_sample(0),
+	_fifo_integral_start(0),
+	_fifo_transfer{},
+	_fifo_report{}
 {
 	// disable debug() calls
 	_debug_enabled = false;
@@ -610,6 +714,7 @@ MPU6000::~MPU6000()
 	perf_free(_good_transfers);
 	perf_free(_reset_retries);
 	perf_free(_duplicates);
+	perf_free(_fifo_overflows);
 }
 
 int
@@ -627,13 +732,13 @@ MPU6000::init()
 	}
 
 	/* allocate basic report buffers */
-	_accel_reports = new ringbuffer::RingBuffer(2, sizeof(accel_report));
+	_accel_reports = new ringbuffer::TypedRingBuffer<accel_report>(2);
 
 	if (_accel_reports == nullptr) {
 		goto out;
 	}
 
-	_gyro_reports = new ringbuffer::RingBuffer(2, sizeof(gyro_report));
+	_gyro_reports = new ringbuffer::TypedRingBuffer<gyro_report>(2);
 
 	if (_gyro_reports == nullptr) {
 		goto out;
@@ -674,7 +779,7 @@ MPU6000::init()
 
 	/* advertise sensor topic, measure manually to initialize valid report */
 	struct accel_report arp;
-	_accel_reports->get(&arp);
+	_accel_reports->get(arp);
 
 	/* measurement will have generated a report, publish */
 	_accel_topic = orb_advertise_multi(ORB_ID(sensor_accel), &arp,
@@ -687,7 +792,7 @@ MPU6000::init()
 
 	/* advertise sensor topic, measure manually to initialize valid report */
 	struct gyro_report grp;
-	_gyro_reports->get(&grp);
+	_gyro_reports->get(grp);
 
 	_gyro->_gyro_topic = orb_advertise_multi(ORB_ID(sensor_gyro), &grp,
 			     &_gyro->_gyro_orb_class_instance, (is_external()) ? ORB_PRIO_MAX : ORB_PRIO_HIGH);
@@ -696,6 +801,19 @@ MPU6000::init()
 		warnx("ADVERT FAIL");
 	}
 
+	if (_fifo) {
+		/* the FIFO is only just running, advertise without samples */
+		struct sensor_imu_fifo_s fifo_report = {};
+		fifo_report.device_id = _device_id.devid;
+
+		_fifo_topic = orb_advertise_multi(ORB_ID(sensor_imu_fifo), &fifo_report,
+						  &_fifo_orb_class_instance, (is_external()) ? ORB_PRIO_MAX : ORB_PRIO_HIGH);
+
+		if (_fifo_topic == nullptr) {
+			warnx("ADVERT FAIL");
+		}
+	}
+
 out:
 	return ret;
 }
@@ -774,6 +892,18 @@ int MPU6000::reset()
 	// write_reg(MPUREG_PWR_MGMT_1,MPU_CLK_SEL_PLLGYROZ);
 	usleep(1000);
 
+	// FIFO => queue every sample, starting from an empty FIFO
+	write_checked_reg(MPUREG_FIFO_EN, _fifo ? BITS_FIFO_EN_ACCEL_TEMP_GYRO : 0);
+
+	if (_fifo) {
+		write_checked_reg(MPUREG_USER_CTRL, BIT_I2C_IF_DIS | BIT_USER_CTRL_FIFO_EN);
+		write_reg(MPUREG_USER_CTRL, BIT_I2C_IF_DIS | BIT_USER_CTRL_FIFO_EN | BIT_USER_CTRL_FIFO_RESET);
+		_fifo_last_sample = 0;
+		_fifo_integral_start = 0;
+	}
+
+	usleep(1000);
+
 	return OK;
 }
 
@@ -904,16 +1034,7 @@ MPU6000::read(struct file *filp, char *buffer, size_t buflen)
 
 	/* copy reports out of our buffer to the caller */
 	accel_report *arp = reinterpret_cast<accel_report *>(buffer);
-	int transferred = 0;
-
-	while (count--) {
-		if (!_accel_reports->get(arp)) {
-			break;
-		}
-
-		transferred++;
-		arp++;
-	}
+	int transferred = _accel_reports->get_n(arp, count);
 
 	/* return the number of bytes transferred */
 	return (transferred * sizeof(accel_report));
@@ -1224,16 +1345,7 @@ MPU6000::gyro_read(struct file *filp, char *buffer, size_t buflen)
 
 	/* copy reports out of our buffer to the caller */
 	gyro_report *grp = reinterpret_cast<gyro_report *>(buffer);
-	int transferred = 0;
-
-	while (count--) {
-		if (!_gyro_reports->get(grp)) {
-			break;
-		}
-
-		transferred++;
-		grp++;
-	}
+	int transferred = _gyro_reports->get_n(grp, count);
 
 	/* return the number of bytes transferred */
 	return (transferred * sizeof(gyro_report));
@@ -1283,9 +1395,9 @@ MPU6000::ioctl(struct file *filp, int cmd, unsigned long arg)
 						return -EINVAL;
 					}
 
-					// adjust filters
+					// adjust filters, in FIFO mode every sample is filtered
 					float cutoff_freq_hz = _accel_filter_x.get_cutoff_freq();
-					float sample_rate = 1.0e6f / ticks;
+					float sample_rate = _fifo ? _sample_rate : 1.0e6f / ticks;
 					_set_dlpf_filter(cutoff_freq_hz);
 					_accel_filter_x.set_cutoff_frequency(sample_rate, cutoff_freq_hz);
 					_accel_filter_y.set_cutoff_frequency(sample_rate, cutoff_freq_hz);
@@ -1308,7 +1420,7 @@ MPU6000::ioctl(struct file *filp, int cmd, unsigned long arg)
 					  them. This prevents aliasing due to a beat between the
 					  stm32 clock and the mpu6000 clock
 					 */
-					_call.period = _call_interval - MPU6000_TIMER_REDUCTION;
+					_call.period = call_period();
 
 					/* if we need to start the poll state machine, do it */
 					if (want_start) {
@@ -1494,12 +1606,12 @@ MPU6000::read_reg(unsigned reg, uint32_t speed)
 }
 
 uint16_t
-MPU6000::read_reg16(unsigned reg)
+MPU6000::read_reg16(unsigned reg, uint32_t speed)
 {
 	uint8_t cmd[3] = { (uint8_t)(reg | DIR_READ), 0, 0 };
 
 	// general register transfer at low clock speed
-	set_frequency(MPU6000_LOW_BUS_SPEED);
+	set_frequency(speed);
 
 	transfer(cmd, cmd, sizeof(cmd));
 
@@ -1603,7 +1715,7 @@ MPU6000::start()
 	/* start polling at the specified rate */
 	hrt_call_every(&_call,
 		       1000,
-		       _call_interval - MPU6000_TIMER_REDUCTION,
+		       call_period(),
 		       (hrt_callout)&MPU6000::measure_trampoline, this);
 }
 
@@ -1614,6 +1726,8 @@ MPU6000::stop()
 
 	/* reset internal states */
 	memset(_last_accel, 0, sizeof(_last_accel));
+	_fifo_last_sample = 0;
+	_fifo_integral_start = 0;
 
 	/* discard unread data in the buffers */
 	_accel_reports->flush();
@@ -1698,17 +1812,14 @@ MPU6000::measure()
 		return;
 	}
 
+	if (_fifo) {
+		measure_fifo();
+		return;
+	}
+
 	struct MPUReport mpu_report;
 
-	struct Report {
-		int16_t		accel_x;
-		int16_t		accel_y;
-		int16_t		accel_z;
-		int16_t		temp;
-		int16_t		gyro_x;
-		int16_t		gyro_y;
-		int16_t		gyro_z;
-	} report;
+	Report report;
 
 	/* start measuring */
 	perf_begin(_sample_perf);
@@ -1787,7 +1898,190 @@ MPU6000::measure()
 		return;
 	}
 
+	math::Vector<3> accel;
+	math::Vector<3> gyro;
+
+	process_sample(report, hrt_absolute_time(), accel, gyro);
+
+	/* stop measuring */
+	perf_end(_sample_perf);
+}
+
+void
+MPU6000::measure_fifo()
+{
+	/* start measuring */
+	perf_begin(_sample_perf);
+
+	/*
+	 * Only complete samples are read, so the FIFO stays aligned
+	 * to the sample boundaries.
+	 */
+	uint16_t fifo_count = read_reg16(MPUREG_FIFO_COUNTH, MPU6000_HIGH_BUS_SPEED);
+
+	if (fifo_count >= MPU6000_FIFO_SIZE) {
+		// the FIFO overflowed and overwrote part of a sample,
+		// start again from an empty FIFO
+		perf_count(_fifo_overflows);
+		write_reg(MPUREG_USER_CTRL, BIT_I2C_IF_DIS | BIT_USER_CTRL_FIFO_EN | BIT_USER_CTRL_FIFO_RESET);
+		_fifo_last_sample = 0;
+		perf_end(_sample_perf);
+		return;
+	}
+
+	unsigned samples = fifo_count / MPU6000_FIFO_SAMPLE_SIZE;
+
+	if (samples == 0) {
+		perf_end(_sample_perf);
+		return;
+	}
+
+	hrt_abstime now = hrt_absolute_time();
+
+	/*
+	 * Fetch all queued samples from the MPU6000 in one pass.
+	 */
+	_fifo_transfer.cmd = DIR_READ | MPUREG_FIFO_R_W;
+
+	// sensor transfer at high clock speed
+	set_frequency(MPU6000_HIGH_BUS_SPEED);
+
+	if (OK != transfer((uint8_t *)&_fifo_transfer, (uint8_t *)&_fifo_transfer, 1 + samples * MPU6000_FIFO_SAMPLE_SIZE)) {
+		perf_end(_sample_perf);
+		return;
+	}
+
+	check_registers();
+
+	perf_count(_good_transfers);
+
+	if (_register_wait != 0) {
+		// we are waiting for some good transfers before using
+		// the sensor again, the samples are dropped
+		_register_wait--;
+		_fifo_last_sample = 0;
+		perf_end(_sample_perf);
+		return;
+	}
+
+	/*
+	 * The newest sample was taken just before the read. The samples
+	 * since the previous read are spread evenly up to it, so the
+	 * timestamps keep increasing when the timer jitters against the
+	 * sensor clock.
+	 */
+	hrt_abstime interval = 1000000 / _sample_rate;
+
+	if (_fifo_last_sample != 0 && now > _fifo_last_sample &&
+	    now - _fifo_last_sample >= samples * interval / 2 &&
+	    now - _fifo_last_sample <= samples * interval * 2) {
+		interval = (now - _fifo_last_sample) / samples;
+	}
+
+	_fifo_last_sample = now;
+
+	_fifo_report.samples = 0;
+
+	for (unsigned i = 0; i < samples; i++) {
+		FIFOSample &sample = _fifo_transfer.samples[i];
+		Report report;
 
+		/*
+		 * Convert from big to little endian
+		 */
+		report.accel_x = int16_t_from_bytes(sample.accel_x);
+		report.accel_y = int16_t_from_bytes(sample.accel_y);
+		report.accel_z = int16_t_from_bytes(sample.accel_z);
+
+		report.temp = int16_t_from_bytes(sample.temp);
+
+		report.gyro_x = int16_t_from_bytes(sample.gyro_x);
+		report.gyro_y = int16_t_from_bytes(sample.gyro_y);
+		report.gyro_z = int16_t_from_bytes(sample.gyro_z);
+
+		if (report.accel_x == 0 &&
+		    report.accel_y == 0 &&
+		    report.accel_z == 0 &&
+		    report.temp == 0 &&
+		    report.gyro_x == 0 &&
+		    report.gyro_y == 0 &&
+		    report.gyro_z == 0) {
+			// all zero data - probably a SPI bus error
+			perf_count(_bad_transfers);
+			continue;
+		}
+
+		hrt_abstime timestamp = now - (samples - 1 - i) * interval;
+		math::Vector<3> accel;
+		math::Vector<3> gyro;
+
+		process_sample(report, timestamp, accel, gyro);
+
+		unsigned n = _fifo_report.samples++;
+		_fifo_report.timestamp_sample[n] = timestamp;
+		_fifo_report.accel_x[n] = accel(0);
+		_fifo_report.accel_y[n] = accel(1);
+		_fifo_report.accel_z[n] = accel(2);
+		_fifo_report.gyro_x[n] = gyro(0);
+		_fifo_report.gyro_y[n] = gyro(1);
+		_fifo_report.gyro_z[n] = gyro(2);
+
+		if (_fifo_report.samples == sensor_imu_fifo_s::MAX_SAMPLES) {
+			publish_fifo(now);
+			_fifo_report.samples = 0;
+		}
+	}
+
+	if (_fifo_report.samples > 0) {
+		publish_fifo(now);
+	}
+
+	/* stop measuring */
+	perf_end(_sample_perf);
+}
+
+void
+MPU6000::publish_fifo(hrt_abstime timestamp)
+{
+	hrt_abstime last_sample = _fifo_report.timestamp_sample[_fifo_report.samples - 1];
+
+	_fifo_report.timestamp = timestamp;
+	_fifo_report.device_id = _device_id.devid;
+	_fifo_report.error_count = perf_event_count(_bad_transfers) + perf_event_count(_bad_registers);
+	_fifo_report.dt = 1.0f / _sample_rate;
+	_fifo_report.temperature = _last_temperature;
+
+	/* the integrals since the last block, both integrators saw the same samples */
+	math::Vector<3> delta_velocity = _accel_int.read(true);
+	math::Vector<3> delta_angle = _gyro_int.read(true);
+
+	if (_fifo_integral_start == 0 || last_sample <= _fifo_integral_start) {
+		delta_velocity.zero();
+		delta_angle.zero();
+		_fifo_report.integral_dt = 0;
+
+	} else {
+		_fifo_report.integral_dt = last_sample - _fifo_integral_start;
+	}
+
+	_fifo_integral_start = last_sample;
+
+	_fifo_report.delta_velocity_x = delta_velocity(0);
+	_fifo_report.delta_velocity_y = delta_velocity(1);
+	_fifo_report.delta_velocity_z = delta_velocity(2);
+	_fifo_report.delta_angle_x = delta_angle(0);
+	_fifo_report.delta_angle_y = delta_angle(1);
+	_fifo_report.delta_angle_z = delta_angle(2);
+
+	if (_fifo_topic != nullptr && !(_pub_blocked)) {
+		/* publish it */
+		orb_publish(ORB_ID(sensor_imu_fifo), _fifo_topic, &_fifo_report);
+	}
+}
+
+void
+MPU6000::process_sample(Report &report, hrt_abstime timestamp, math::Vector<3> &accel, math::Vector<3> &gyro)
+{
 	/*
 	 * Swap axes and negate y
 	 */
@@ -1814,7 +2108,7 @@ MPU6000::measure()
 	/*
 	 * Adjust and scale results to m/s^2.
 	 */
-	grb.timestamp = arb.timestamp = hrt_absolute_time();
+	grb.timestamp = arb.timestamp = timestamp;
 
 	// report the error count as the sum of the number of bad
 	// transfers and bad register reads. This allows the higher
@@ -1859,10 +2153,19 @@ MPU6000::measure()
 	arb.y = _accel_filter_y.apply(y_in_new);
 	arb.z = _accel_filter_z.apply(z_in_new);
 
-	math::Vector<3> aval(x_in_new, y_in_new, z_in_new);
+	accel(0) = x_in_new;
+	accel(1) = y_in_new;
+	accel(2) = z_in_new;
 	math::Vector<3> aval_integrated;
 
-	bool accel_notify = _accel_int.put(arb.timestamp, aval, aval_integrated, arb.integral_dt);
+	bool accel_notify = _accel_int.put(arb.timestamp, accel, aval_integrated, arb.integral_dt);
+
+	if (!accel_notify) {
+		/* no integral is due with this sample */
+		aval_integrated.zero();
+		arb.integral_dt = 0;
+	}
+
 	arb.x_integral = aval_integrated(0);
 	arb.y_integral = aval_integrated(1);
 	arb.z_integral = aval_integrated(2);
@@ -1894,10 +2197,18 @@ MPU6000::measure()
 	grb.y = _gyro_filter_y.apply(y_gyro_in_new);
 	grb.z = _gyro_filter_z.apply(z_gyro_in_new);
 
-	math::Vector<3> gval(x_gyro_in_new, y_gyro_in_new, z_gyro_in_new);
+	gyro(0) = x_gyro_in_new;
+	gyro(1) = y_gyro_in_new;
+	gyro(2) = z_gyro_in_new;
 	math::Vector<3> gval_integrated;
 
-	bool gyro_notify = _gyro_int.put(arb.timestamp, gval, gval_integrated, grb.integral_dt);
+	bool gyro_notify = _gyro_int.put(arb.timestamp, gyro, gval_integrated, grb.integral_dt);
+
+	if (!gyro_notify) {
+		gval_integrated.zero();
+		grb.integral_dt = 0;
+	}
+
 	grb.x_integral = gval_integrated(0);
 	grb.y_integral = gval_integrated(1);
 	grb.z_integral = gval_integrated(2);
@@ -1908,8 +2219,8 @@ MPU6000::measure()
 	grb.temperature_raw = report.temp;
 	grb.temperature = _last_temperature;
 
-	_accel_reports->force(&arb);
-	_gyro_reports->force(&grb);
+	_accel_reports->force(arb);
+	_gyro_reports->force(grb);
 
 	/* notify anyone waiting for data */
 	if (accel_notify) {
@@ -1932,9 +2243,6 @@ MPU6000::measure()
 		/* publish it */
 		orb_publish(ORB_ID(sensor_gyro), _gyro->_gyro_topic, &grb);
 	}
-
-	/* stop measuring */
-	perf_end(_sample_perf);
 }
 
 void
@@ -1948,6 +2256,7 @@ MPU6000::print_info()
 	perf_print_counter(_good_transfers);
 	perf_print_counter(_reset_retries);
 	perf_print_counter(_duplicates);
+	perf_print_counter(_fifo_overflows);
 	_accel_reports->print_info("accel queue");
 	_gyro_reports->print_info("gyro queue");
 	::printf("checked_next: %u\n", _checked_next);
@@ -2054,7 +2363,7 @@ namespace mpu6000
 MPU6000	*g_dev_int; // on internal bus
 MPU6000	*g_dev_ext; // on external bus
 
-void	start(bool, enum Rotation, int range);
+void	start(bool, enum Rotation, int range, bool fifo);
 void	stop(bool);
 void	test(bool);
 void	reset(bool);
@@ -2071,7 +2380,7 @@ void	usage();
  * or failed to detect the sensor.
  */
 void
-start(bool external_bus, enum Rotation rotation, int range)
+start(bool external_bus, enum Rotation rotation, int range, bool fifo)
 {
 	int fd;
 	MPU6000 **g_dev_ptr = external_bus ? &g_dev_ext : &g_dev_int;
@@ -2087,13 +2396,15 @@ start(bool external_bus, enum Rotation rotation, int range)
 	/* create the driver */
 	if (external_bus) {
 #ifdef PX4_SPI_BUS_EXT
-		*g_dev_ptr = new MPU6000(PX4_SPI_BUS_EXT, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_EXT_MPU, rotation);
+		*g_dev_ptr = new MPU6000(PX4_SPI_BUS_EXT, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_EXT_MPU, rotation,
+					 fifo);
 #else
 		errx(0, "External SPI not available");
 #endif
 
 	} else {
-		*g_dev_ptr = new MPU6000(PX4_SPI_BUS_SENSORS, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_MPU, rotation);
+		*g_dev_ptr = new MPU6000(PX4_SPI_BUS_SENSORS, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_MPU, rotation,
+					 fifo);
 	}
 
 	if (*g_dev_ptr == nullptr) {
@@ -2339,6 +2650,7 @@ usage()
 	warnx("    -X    (external bus)");
 	warnx("    -R rotation");
 	warnx("    -a accel range (in g)");
+	warnx("    -F    (FIFO burst reads, publishes sensor_imu_fifo)");
 }
 
 } // namespace
@@ -2350,9 +2662,10 @@ mpu6000_main(int argc, char *argv[])
 	int ch;
 	enum Rotation rotation = ROTATION_NONE;
 	int accel_range = 8;
+	bool fifo = false;
 
 	/* jump over start/off/etc and look at options first */
-	while ((ch = getopt(argc, argv, "XR:a:")) != EOF) {
+	while ((ch = getopt(argc, argv, "XR:a:F")) != EOF) {
 		switch (ch) {
 		case 'X':
 			external_bus = true;
@@ -2366,6 +2679,10 @@ mpu6000_main(int argc, char *argv[])
 			accel_range = atoi(optarg);
 			break;
 
+		case 'F':
+			fifo = true;
+			break;
+
 		default:
 			mpu6000::usage();
 			exit(0);
@@ -2379,7 +2696,7 @@ mpu6000_main(int argc, char *argv[])
 
 	 */
 	if (!strcmp(verb, "start")) {
-		mpu6000::start(external_bus, rotation, accel_range);
+		mpu6000::start(external_bus, rotation, accel_range, fifo);
 	}
 
 	if (!strcmp(verb, "stop")) {
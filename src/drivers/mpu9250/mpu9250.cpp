@@ -70,8 +70,10 @@
 
 #include <drivers/device/spi.h>
 #include <drivers/device/ringbuffer.h>
+#include <drivers/device/integrator.h>
 #include <drivers/drv_accel.h>
 #include <drivers/drv_gyro.h>
+#include <uORB/topics/sensor_imu_fifo.h>
 #include <mathlib/math/filter/LowPassFilter2p.hpp>
 #include <lib/conversion/rotation.h>
 
@@ -171,12 +173,21 @@
 #define BIT_RAW_RDY_EN			0x01
 #define BIT_INT_ANYRD_2CLEAR		0x10
 
+#define BIT_USER_CTRL_FIFO_EN		0x40
+#define BIT_USER_CTRL_FIFO_RESET	0x04
+
+// accel, temperature and gyro in the FIFO, in the same order as the data registers
+#define BITS_FIFO_EN_ACCEL_TEMP_GYRO	0xF8
+
 #define MPU_WHOAMI_9250			0x71
 
 #define MPU9250_DEFAULT_ONCHIP_FILTER_FREQ	41
 #define MPU9250_ACCEL_DEFAULT_RATE	1000
+#define MPU9250_ACCEL_MAX_OUTPUT_RATE	280
 #define MPU9250_ACCEL_DEFAULT_DRIVER_FILTER_FREQ 30
 #define MPU9250_GYRO_DEFAULT_RATE	1000
+/* rates need to be the same between accel and gyro */
+#define MPU9250_GYRO_MAX_OUTPUT_RATE	MPU9250_ACCEL_MAX_OUTPUT_RATE
 #define MPU9250_GYRO_DEFAULT_DRIVER_FILTER_FREQ 30
 
 #define MPU9250_ONE_G					9.80665f
@@ -203,12 +214,23 @@
  */
 #define MPU9250_TIMER_REDUCTION				200
 
+/*
+  in FIFO mode the sensor queues the samples at the sample rate and
+  the timer only runs at the FIFO read rate, reading all queued
+  samples in one transfer
+ */
+#define MPU9250_FIFO_DEFAULT_READ_RATE			250
+#define MPU9250_FIFO_SIZE				512
+#define MPU9250_FIFO_SAMPLE_SIZE			14
+#define MPU9250_FIFO_MAX_SAMPLES			(MPU9250_FIFO_SIZE / MPU9250_FIFO_SAMPLE_SIZE)
+
 class MPU9250_gyro;
 
 class MPU9250 : public device::SPI
 {
 public:
-	MPU9250(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation);
+	MPU9250(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation,
+		bool fifo);
 	virtual ~MPU9250();
 
 	virtual int		init();
@@ -241,7 +263,7 @@ private:
 	struct hrt_call		_call;
 	unsigned		_call_interval;
 
-	ringbuffer::RingBuffer	*_accel_reports;
+	ringbuffer::TypedRingBuffer<accel_report>	*_accel_reports;
 
 	struct accel_scale	_accel_scale;
 	float			_accel_range_scale;
@@ -250,7 +272,7 @@ private:
 	int			_accel_orb_class_instance;
 	int			_accel_class_instance;
 
-	ringbuffer::RingBuffer	*_gyro_reports;
+	ringbuffer::TypedRingBuffer<gyro_report>	*_gyro_reports;
 
 	struct gyro_scale	_gyro_scale;
 	float			_gyro_range_scale;
@@ -267,6 +289,7 @@ private:
 	perf_counter_t		_good_transfers;
 	perf_counter_t		_reset_retries;
 	perf_counter_t		_duplicates;
+	perf_counter_t		_fifo_overflows;
 	perf_counter_t		_system_latency_perf;
 	perf_counter_t		_controller_latency_perf;
 
@@ -285,7 +308,7 @@ private:
 	// this is used to support runtime checking of key
 	// configuration registers to detect SPI bus errors and sensor
 	// reset
-#define MPU9250_NUM_CHECKED_REGISTERS 11
+#define MPU9250_NUM_CHECKED_REGISTERS 12
 	static const uint8_t	_checked_registers[MPU9250_NUM_CHECKED_REGISTERS];
 	uint8_t			_checked_values[MPU9250_NUM_CHECKED_REGISTERS];
 	uint8_t			_checked_bad[MPU9250_NUM_CHECKED_REGISTERS];
@@ -298,6 +321,15 @@ private:
 	uint16_t		_last_accel[3];
 	bool			_got_duplicate;
 
+	// FIFO burst mode, publishing sensor_imu_fifo
+	bool			_fifo;
+	orb_advert_t		_fifo_topic;
+	int			_fifo_orb_class_instance;
+	hrt_abstime		_fifo_last_sample;
+	hrt_abstime		_fifo_integral_start;
+	Integrator		_accel_int;
+	Integrator		_gyro_int;
+
 	/**
 	 * Start automatic measurement.
 	 */
@@ -331,6 +363,49 @@ private:
 	 */
 	void			measure();
 
+	/**
+	 * Fetch all samples queued in the FIFO in one transfer and process them as a block.
+	 */
+	void			measure_fifo();
+
+	/**
+	 * Raw sample in native byte order.
+	 */
+	struct Report {
+		int16_t		accel_x;
+		int16_t		accel_y;
+		int16_t		accel_z;
+		int16_t		temp;
+		int16_t		gyro_x;
+		int16_t		gyro_y;
+		int16_t		gyro_z;
+	};
+
+	/**
+	 * Scale, filter and integrate one sample, queue the reports and publish
+	 * them whenever the integrators are due.
+	 *
+	 * @param report	The raw sample, the axes are swapped to the board frame in place.
+	 * @param timestamp	Time the sample was taken.
+	 * @param accel		The calibrated, unfiltered acceleration.
+	 * @param gyro		The calibrated, unfiltered angular rate.
+	 */
+	void			process_sample(Report &report, hrt_abstime timestamp, math::Vector<3> &accel,
+					       math::Vector<3> &gyro);
+
+	/**
+	 * Complete and publish the block of FIFO samples in _fifo_report with the integrals over the block.
+	 */
+	void			publish_fifo(hrt_abstime timestamp);
+
+	/**
+	 * Timer period, the FIFO read interval in FIFO mode.
+	 */
+	unsigned		call_period()
+	{
+		return _fifo ? (1000000 / MPU9250_FIFO_DEFAULT_READ_RATE) : (_call_interval - MPU9250_TIMER_REDUCTION);
+	}
+
 	/**
 	 * Read a register from the MPU9250
 	 *
@@ -338,7 +413,7 @@ private:
 	 * @return		The value that was read.
 	 */
 	uint8_t			read_reg(unsigned reg, uint32_t speed = MPU9250_LOW_BUS_SPEED);
-	uint16_t		read_reg16(unsigned reg);
+	uint16_t		read_reg16(unsigned reg, uint32_t speed = MPU9250_LOW_BUS_SPEED);
 
 	/**
 	 * Write a register in the MPU9250
@@ -443,7 +518,33 @@ private:
 		uint8_t		gyro_y[2];
 		uint8_t		gyro_z[2];
 	};
+
+	/**
+	 * One sample in the FIFO, the data registers without the interrupt status.
+	 */
+	struct FIFOSample {
+		uint8_t		accel_x[2];
+		uint8_t		accel_y[2];
+		uint8_t		accel_z[2];
+		uint8_t		temp[2];
+		uint8_t		gyro_x[2];
+		uint8_t		gyro_y[2];
+		uint8_t		gyro_z[2];
+	};
+
+	/**
+	 * Burst read of the FIFO, including command byte.
+	 */
+	struct FIFOTransfer {
+		uint8_t		cmd;
+		FIFOSample	samples[MPU9250_FIFO_MAX_SAMPLES];
+	};
 #pragma pack(pop)
+
+	FIFOTransfer		_fifo_transfer;
+
+	/* too large for the interrupt stack measure() runs on */
+	struct sensor_imu_fifo_s	_fifo_report;
 };
 
 /*
@@ -460,7 +561,8 @@ const uint8_t MPU9250::_checked_registers[MPU9250_NUM_CHECKED_REGISTERS] = { MPU
 									     MPUREG_ACCEL_CONFIG,
 									     MPUREG_ACCEL_CONFIG2,
 									     MPUREG_INT_ENABLE,
-									     MPUREG_INT_PIN_CFG
+									     MPUREG_INT_PIN_CFG,
+									     MPUREG_FIFO_EN
 									   };
 
 
@@ -498,7 +600,8 @@ private:
 /** driver 'main' command */
 extern "C" { __EXPORT int mpu9250_main(int argc, char *argv[]); }
 
-MPU9250::MPU9250(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation) :
+MPU9250::MPU9250(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation,
+		 bool fifo) :
 	SPI("MPU9250", path_accel, bus, device, SPIDEV_MODE3, MPU9250_LOW_BUS_SPEED),
 	_gyro(new MPU9250_gyro(this, path_gyro)),
 	_whoami(0),
@@ -525,6 +628,7 @@ MPU9250::MPU9250(int bus, const char *path_accel, const char *path_gyro, spi_dev
 	_good_transfers(perf_alloc(PC_COUNT, "mpu9250_good_transfers")),
 	_reset_retries(perf_alloc(PC_COUNT, "mpu9250_reset_retries")),
 	_duplicates(perf_alloc(PC_COUNT, "mpu9250_duplicates")),
+	_fifo_overflows(perf_alloc(PC_COUNT, "mpu9250_fifo_overflows")),
 	_system_latency_perf(perf_alloc_once(PC_ELAPSED, "sys_latency")),
 	_controller_latency_perf(perf_alloc_once(PC_ELAPSED, "ctrl_latency")),
 	_register_wait(0),
@@ -539,7 +643,16 @@ MPU9250::MPU9250(int bus, const char *path_accel, const char *path_gyro, spi_dev
 	_checked_next(0),
 	_last_temperature(0),
 	_last_accel{},
-	_got_duplicate(false)
+	_got_duplicate(false),
+	_fifo(fifo),
+	_fifo_topic(nullptr),
+	_fifo_orb_class_instance(-1),
+	_fifo_last_sample(0),
+	_fifo_integral_start(0),
+	_accel_int(1000000 / MPU9250_ACCEL_MAX_OUTPUT_RATE),
+	_gyro_int(1000000 / MPU9250_GYRO_MAX_OUTPUT_RATE, true),
+	_fifo_transfer{},
+	_fifo_report{}
 {
 	// disable debug() calls
 	_debug_enabled = false;
@@ -599,6 +712,7 @@ MPU9250::~MPU9250()
 	perf_free(_good_transfers);
 	perf_free(_reset_retries);
 	perf_free(_duplicates);
+	perf_free(_fifo_overflows);
 }
 
 int
@@ -616,13 +730,13 @@ MPU9250::init()
 	}
 
 	/* allocate basic report buffers */
-	_accel_reports = new ringbuffer::RingBuffer(2, sizeof(accel_report));
+	_accel_reports = new ringbuffer::TypedRingBuffer<accel_report>(2);
 
 	if (_accel_reports == nullptr) {
 		goto out;
 	}
 
-	_gyro_reports = new ringbuffer::RingBuffer(2, sizeof(gyro_report));
+	_gyro_reports = new ringbuffer::TypedRingBuffer<gyro_report>(2);
 
 	if (_gyro_reports == nullptr) {
 		goto out;
@@ -663,7 +777,7 @@ MPU9250::init()
 
 	/* advertise sensor topic, measure manually to initialize valid report */
 	struct accel_report arp;
-	_accel_reports->get(&arp);
+	_accel_reports->get(arp);
 
 	/* measurement will have generated a report, publish */
 	_accel_topic = orb_advertise_multi(ORB_ID(sensor_accel), &arp,
@@ -676,7 +790,7 @@ MPU9250::init()
 
 	/* advertise sensor topic, measure manually to initialize valid report */
 	struct gyro_report grp;
-	_gyro_reports->get(&grp);
+	_gyro_reports->get(grp);
 
 	_gyro->_gyro_topic = orb_advertise_multi(ORB_ID(sensor_gyro), &grp,
 			     &_gyro->_gyro_orb_class_instance, (is_external()) ? ORB_PRIO_MAX : ORB_PRIO_HIGH);
@@ -685,6 +799,19 @@ MPU9250::init()
 		warnx("ADVERT FAIL");
 	}
 
+	if (_fifo) {
+		/* the FIFO is only just running, advertise without samples */
+		struct sensor_imu_fifo_s fifo_report = {};
+		fifo_report.device_id = _device_id.devid;
+
+		_fifo_topic = orb_advertise_multi(ORB_ID(sensor_imu_fifo), &fifo_report,
+						  &_fifo_orb_class_instance, (is_external()) ? ORB_PRIO_MAX : ORB_PRIO_HIGH);
+
+		if (_fifo_topic == nullptr) {
+			warnx("ADVERT FAIL");
+		}
+	}
+
 out:
 	return ret;
 }
@@ -732,6 +859,18 @@ int MPU9250::reset()
 	write_checked_reg(MPUREG_INT_PIN_CFG, BIT_INT_ANYRD_2CLEAR); // INT: Clear on any read
 	usleep(1000);
 
+	// FIFO => queue every sample, starting from an empty FIFO
+	write_checked_reg(MPUREG_FIFO_EN, _fifo ? BITS_FIFO_EN_ACCEL_TEMP_GYRO : 0);
+
+	if (_fifo) {
+		write_checked_reg(MPUREG_USER_CTRL, BIT_USER_CTRL_FIFO_EN);
+		write_reg(MPUREG_USER_CTRL, BIT_USER_CTRL_FIFO_EN | BIT_USER_CTRL_FIFO_RESET);
+		_fifo_last_sample = 0;
+		_fifo_integral_start = 0;
+	}
+
+	usleep(1000);
+
 	uint8_t retries = 10;
 
 	while (retries--) {
@@ -870,16 +1009,7 @@ MPU9250::read(struct file *filp, char *buffer, size_t buflen)
 
 	/* copy reports out of our buffer to the caller */
 	accel_report *arp = reinterpret_cast<accel_report *>(buffer);
-	int transferred = 0;
-
-	while (count--) {
-		if (!_accel_reports->get(arp)) {
-			break;
-		}
-
-		transferred++;
-		arp++;
-	}
+	int transferred = _accel_reports->get_n(arp, count);
 
 	/* return the number of bytes transferred */
 	return (transferred * sizeof(accel_report));
@@ -1030,16 +1160,7 @@ MPU9250::gyro_read(struct file *filp, char *buffer, size_t buflen)
 
 	/* copy reports out of our buffer to the caller */
 	gyro_report *grp = reinterpret_cast<gyro_report *>(buffer);
-	int transferred = 0;
-
-	while (count--) {
-		if (!_gyro_reports->get(grp)) {
-			break;
-		}
-
-		transferred++;
-		grp++;
-	}
+	int transferred = _gyro_reports->get_n(grp, count);
 
 	/* return the number of bytes transferred */
 	return (transferred * sizeof(gyro_report));
@@ -1089,9 +1210,9 @@ MPU9250::ioctl(struct file *filp, int cmd, unsigned long arg)
 						return -EINVAL;
 					}
 
-					// adjust filters
+					// adjust filters, in FIFO mode every sample is filtered
 					float cutoff_freq_hz = _accel_filter_x.get_cutoff_freq();
-					float sample_rate = 1.0e6f / ticks;
+					float sample_rate = _fifo ? _sample_rate : 1.0e6f / ticks;
 					_set_dlpf_filter(cutoff_freq_hz);
 					_accel_filter_x.set_cutoff_frequency(sample_rate, cutoff_freq_hz);
 					_accel_filter_y.set_cutoff_frequency(sample_rate, cutoff_freq_hz);
@@ -1114,7 +1235,7 @@ MPU9250::ioctl(struct file *filp, int cmd, unsigned long arg)
 					  them. This prevents aliasing due to a beat between the
 					  stm32 clock and the mpu9250 clock
 					 */
-					_call.period = _call_interval - MPU9250_TIMER_REDUCTION;
+					_call.period = call_period();
 
 					/* if we need to start the poll state machine, do it */
 					if (want_start) {
@@ -1324,12 +1445,12 @@ MPU9250::read_reg(unsigned reg, uint32_t speed)
 }
 
 uint16_t
-MPU9250::read_reg16(unsigned reg)
+MPU9250::read_reg16(unsigned reg, uint32_t speed)
 {
 	uint8_t cmd[3] = { (uint8_t)(reg | DIR_READ), 0, 0 };
 
 	// general register transfer at low clock speed
-	set_frequency(MPU9250_LOW_BUS_SPEED);
+	set_frequency(speed);
 
 	transfer(cmd, cmd, sizeof(cmd));
 
@@ -1422,7 +1543,7 @@ MPU9250::start()
 	/* start polling at the specified rate */
 	hrt_call_every(&_call,
 		       1000,
-		       _call_interval - MPU9250_TIMER_REDUCTION,
+		       call_period(),
 		       (hrt_callout)&MPU9250::measure_trampoline, this);
 }
 
@@ -1430,6 +1551,10 @@ void
 MPU9250::stop()
 {
 	hrt_cancel(&_call);
+
+	/* reset internal states */
+	_fifo_last_sample = 0;
+	_fifo_integral_start = 0;
 }
 
 void
@@ -1508,17 +1633,14 @@ MPU9250::measure()
 		return;
 	}
 
+	if (_fifo) {
+		measure_fifo();
+		return;
+	}
+
 	struct MPUReport mpu_report;
 
-	struct Report {
-		int16_t		accel_x;
-		int16_t		accel_y;
-		int16_t		accel_z;
-		int16_t		temp;
-		int16_t		gyro_x;
-		int16_t		gyro_y;
-		int16_t		gyro_z;
-	} report;
+	Report report;
 
 	/* start measuring */
 	perf_begin(_sample_perf);
@@ -1597,7 +1719,190 @@ MPU9250::measure()
 		return;
 	}
 
+	math::Vector<3> accel;
+	math::Vector<3> gyro;
+
+	process_sample(report, hrt_absolute_time(), accel, gyro);
+
+	/* stop measuring */
+	perf_end(_sample_perf);
+}
+
+void
+MPU9250::measure_fifo()
+{
+	/* start measuring */
+	perf_begin(_sample_perf);
+
+	/*
+	 * Only complete samples are read, so the FIFO stays aligned
+	 * to the sample boundaries.
+	 */
+	uint16_t fifo_count = read_reg16(MPUREG_FIFO_COUNTH, MPU9250_HIGH_BUS_SPEED);
+
+	if (fifo_count >= MPU9250_FIFO_SIZE) {
+		// the FIFO overflowed and overwrote part of a sample,
+		// start again from an empty FIFO
+		perf_count(_fifo_overflows);
+		write_reg(MPUREG_USER_CTRL, BIT_USER_CTRL_FIFO_EN | BIT_USER_CTRL_FIFO_RESET);
+		_fifo_last_sample = 0;
+		perf_end(_sample_perf);
+		return;
+	}
+
+	unsigned samples = fifo_count / MPU9250_FIFO_SAMPLE_SIZE;
+
+	if (samples == 0) {
+		perf_end(_sample_perf);
+		return;
+	}
+
+	hrt_abstime now = hrt_absolute_time();
+
+	/*
+	 * Fetch all queued samples from the MPU9250 in one pass.
+	 */
+	_fifo_transfer.cmd = DIR_READ | MPUREG_FIFO_R_W;
+
+	// sensor transfer at high clock speed
+	set_frequency(MPU9250_HIGH_BUS_SPEED);
+
+	if (OK != transfer((uint8_t *)&_fifo_transfer, (uint8_t *)&_fifo_transfer, 1 + samples * MPU9250_FIFO_SAMPLE_SIZE)) {
+		perf_end(_sample_perf);
+		return;
+	}
+
+	check_registers();
+
+	perf_count(_good_transfers);
+
+	if (_register_wait != 0) {
+		// we are waiting for some good transfers before using
+		// the sensor again, the samples are dropped
+		_register_wait--;
+		_fifo_last_sample = 0;
+		perf_end(_sample_perf);
+		return;
+	}
+
+	/*
+	 * The newest sample was taken just before the read. The samples
+	 * since the previous read are spread evenly up to it, so the
+	 * timestamps keep increasing when the timer jitters against the
+	 * sensor clock.
+	 */
+	hrt_abstime interval = 1000000 / _sample_rate;
+
+	if (_fifo_last_sample != 0 && now > _fifo_last_sample &&
+	    now - _fifo_last_sample >= samples * interval / 2 &&
+	    now - _fifo_last_sample <= samples * interval * 2) {
+		interval = (now - _fifo_last_sample) / samples;
+	}
+
+	_fifo_last_sample = now;
+
+	_fifo_report.samples = 0;
+
+	for (unsigned i = 0; i < samples; i++) {
+		FIFOSample &sample = _fifo_transfer.samples[i];
+		Report report;
+
+		/*
+		 * Convert from big to little endian
+		 */
+		report.accel_x = int16_t_from_bytes(sample.accel_x);
+		report.accel_y = int16_t_from_bytes(sample.accel_y);
+		report.accel_z = int16_t_from_bytes(sample.accel_z);
+
+		report.temp = int16_t_from_bytes(sample.temp);
+
+		report.gyro_x = int16_t_from_bytes(sample.gyro_x);
+		report.gyro_y = int16_t_from_bytes(sample.gyro_y);
+		report.gyro_z = int16_t_from_bytes(sample.gyro_z);
+
+		if (report.accel_x == 0 &&
+		    report.accel_y == 0 &&
+		    report.accel_z == 0 &&
+		    report.temp == 0 &&
+		    report.gyro_x == 0 &&
+		    report.gyro_y == 0 &&
+		    report.gyro_z == 0) {
+			// all zero data - probably a SPI bus error
+			perf_count(_bad_transfers);
+			continue;
+		}
+
+		hrt_abstime timestamp = now - (samples - 1 - i) * interval;
+		math::Vector<3> accel;
+		math::Vector<3> gyro;
+
+		process_sample(report, timestamp, accel, gyro);
+
+		unsigned n = _fifo_report.samples++;
+		_fifo_report.timestamp_sample[n] = timestamp;
+		_fifo_report.accel_x[n] = accel(0);
+		_fifo_report.accel_y[n] = accel(1);
+		_fifo_report.accel_z[n] = accel(2);
+		_fifo_report.gyro_x[n] = gyro(0);
+		_fifo_report.gyro_y[n] = gyro(1);
+		_fifo_report.gyro_z[n] = gyro(2);
+
+		if (_fifo_report.samples == sensor_imu_fifo_s::MAX_SAMPLES) {
+			publish_fifo(now);
+			_fifo_report.samples = 0;
+		}
+	}
+
+	if (_fifo_report.samples > 0) {
+		publish_fifo(now);
+	}
+
+	/* stop measuring */
+	perf_end(_sample_perf);
+}
+
+void
+MPU9250::publish_fifo(hrt_abstime timestamp)
+{
+	hrt_abstime last_sample = _fifo_report.timestamp_sample[_fifo_report.samples - 1];
+
+	_fifo_report.timestamp = timestamp;
+	_fifo_report.device_id = _device_id.devid;
+	_fifo_report.error_count = perf_event_count(_bad_transfers) + perf_event_count(_bad_registers);
+	_fifo_report.dt = 1.0f / _sample_rate;
+	_fifo_report.temperature = _last_temperature;
+
+	/* the integrals since the last block, both integrators saw the same samples */
+	math::Vector<3> delta_velocity = _accel_int.read(true);
+	math::Vector<3> delta_angle = _gyro_int.read(true);
+
+	if (_fifo_integral_start == 0 || last_sample <= _fifo_integral_start) {
+		delta_velocity.zero();
+		delta_angle.zero();
+		_fifo_report.integral_dt = 0;
+
+	} else {
+		_fifo_report.integral_dt = last_sample - _fifo_integral_start;
+	}
+
+	_fifo_integral_start = last_sample;
 
+	_fifo_report.delta_velocity_x = delta_velocity(0);
+	_fifo_report.delta_velocity_y = delta_velocity(1);
+	_fifo_report.delta_velocity_z = delta_velocity(2);
+	_fifo_report.delta_angle_x = delta_angle(0);
+	_fifo_report.delta_angle_y = delta_angle(1);
+	_fifo_report.delta_angle_z = delta_angle(2);
+
+	if (_fifo_topic != nullptr && !(_pub_blocked)) {
+		/* publish it */
+		orb_publish(ORB_ID(sensor_imu_fifo), _fifo_topic, &_fifo_report);
+	}
+}
+
+void
+MPU9250::process_sample(Report &report, hrt_abstime timestamp, math::Vector<3> &accel, math::Vector<3> &gyro)
+{
 	/*
 	 * Swap axes and negate y
 	 */
@@ -1624,7 +1929,7 @@ MPU9250::measure()
 	/*
 	 * Adjust and scale results to m/s^2.
 	 */
-	grb.timestamp = arb.timestamp = hrt_absolute_time();
+	grb.timestamp = arb.timestamp = timestamp;
 
 	// report the error count as the sum of the number of bad
 	// transfers and bad register reads. This allows the higher
@@ -1669,6 +1974,23 @@ MPU9250::measure()
 	arb.y = _accel_filter_y.apply(y_in_new);
 	arb.z = _accel_filter_z.apply(z_in_new);
 
+	accel(0) = x_in_new;
+	accel(1) = y_in_new;
+	accel(2) = z_in_new;
+	math::Vector<3> aval_integrated;
+
+	bool accel_notify = _accel_int.put(arb.timestamp, accel, aval_integrated, arb.integral_dt);
+
+	if (!accel_notify) {
+		/* no integral is due with this sample */
+		aval_integrated.zero();
+		arb.integral_dt = 0;
+	}
+
+	arb.x_integral = aval_integrated(0);
+	arb.y_integral = aval_integrated(1);
+	arb.z_integral = aval_integrated(2);
+
 	arb.scaling = _accel_range_scale;
 	arb.range_m_s2 = _accel_range_m_s2;
 
@@ -1696,20 +2018,41 @@ MPU9250::measure()
 	grb.y = _gyro_filter_y.apply(y_gyro_in_new);
 	grb.z = _gyro_filter_z.apply(z_gyro_in_new);
 
+	gyro(0) = x_gyro_in_new;
+	gyro(1) = y_gyro_in_new;
+	gyro(2) = z_gyro_in_new;
+	math::Vector<3> gval_integrated;
+
+	bool gyro_notify = _gyro_int.put(arb.timestamp, gyro, gval_integrated, grb.integral_dt);
+
+	if (!gyro_notify) {
+		gval_integrated.zero();
+		grb.integral_dt = 0;
+	}
+
+	grb.x_integral = gval_integrated(0);
+	grb.y_integral = gval_integrated(1);
+	grb.z_integral = gval_integrated(2);
+
 	grb.scaling = _gyro_range_scale;
 	grb.range_rad_s = _gyro_range_rad_s;
 
 	grb.temperature_raw = report.temp;
 	grb.temperature = _last_temperature;
 
-	_accel_reports->force(&arb);
-	_gyro_reports->force(&grb);
+	_accel_reports->force(arb);
+	_gyro_reports->force(grb);
 
 	/* notify anyone waiting for data */
-	poll_notify(POLLIN);
-	_gyro->parent_poll_notify();
+	if (accel_notify) {
+		poll_notify(POLLIN);
+	}
+
+	if (gyro_notify) {
+		_gyro->parent_poll_notify();
+	}
 
-	if (!(_pub_blocked)) {
+	if (accel_notify && !(_pub_blocked)) {
 		/* log the time of this report */
 		perf_begin(_controller_latency_perf);
 		perf_begin(_system_latency_perf);
@@ -1717,13 +2060,10 @@ MPU9250::measure()
 		orb_publish(ORB_ID(sensor_accel), _accel_topic, &arb);
 	}
 
-	if (!(_pub_blocked)) {
+	if (gyro_notify && !(_pub_blocked)) {
 		/* publish it */
 		orb_publish(ORB_ID(sensor_gyro), _gyro->_gyro_topic, &grb);
 	}
-
-	/* stop measuring */
-	perf_end(_sample_perf);
 }
 
 void
@@ -1737,6 +2077,7 @@ MPU9250::print_info()
 	perf_print_counter(_good_transfers);
 	perf_print_counter(_reset_retries);
 	perf_print_counter(_duplicates);
+	perf_print_counter(_fifo_overflows);
 	_accel_reports->print_info("accel queue");
 	_gyro_reports->print_info("gyro queue");
 	::printf("checked_next: %u\n", _checked_next);
@@ -1850,7 +2191,7 @@ namespace mpu9250
 MPU9250	*g_dev_int; // on internal bus
 MPU9250	*g_dev_ext; // on external bus
 
-void	start(bool, enum Rotation);
+void	start(bool, enum Rotation, bool fifo);
 void	stop(bool);
 void	test(bool);
 void	reset(bool);
@@ -1866,7 +2207,7 @@ void	usage();
  * or failed to detect the sensor.
  */
 void
-start(bool external_bus, enum Rotation rotation)
+start(bool external_bus, enum Rotation rotation, bool fifo)
 {
 	int fd;
 	MPU9250 **g_dev_ptr = external_bus ? &g_dev_ext : &g_dev_int;
@@ -1882,13 +2223,15 @@ start(bool external_bus, enum Rotation rotation)
 	/* create the driver */
 	if (external_bus) {
 #ifdef PX4_SPI_BUS_EXT
-		*g_dev_ptr = new MPU9250(PX4_SPI_BUS_EXT, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_EXT_MPU, rotation);
+		*g_dev_ptr = new MPU9250(PX4_SPI_BUS_EXT, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_EXT_MPU, rotation,
+					 fifo);
 #else
 		errx(0, "External SPI not available");
 #endif
 
 	} else {
-		*g_dev_ptr = new MPU9250(PX4_SPI_BUS_SENSORS, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_MPU, rotation);
+		*g_dev_ptr = new MPU9250(PX4_SPI_BUS_SENSORS, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_MPU, rotation,
+					 fifo);
 	}
 
 	if (*g_dev_ptr == nullptr) {
@@ -2105,6 +2448,7 @@ usage()
 	warnx("options:");
 	warnx("    -X    (external bus)");
 	warnx("    -R rotation");
+	warnx("    -F    (FIFO burst reads, publishes sensor_imu_fifo)");
 }
 
 } // namespace
@@ -2115,9 +2459,10 @@ mpu9250_main(int argc, char *argv[])
 	bool external_bus = false;
 	int ch;
 	enum Rotation rotation = ROTATION_NONE;
+	bool fifo = false;
 
 	/* jump over start/off/etc and look at options first */
-	while ((ch = getopt(argc, argv, "XR:")) != EOF) {
+	while ((ch = getopt(argc, argv, "XR:F")) != EOF) {
 		switch (ch) {
 		case 'X':
 			external_bus = true;
@@ -2127,6 +2472,10 @@ mpu9250_main(int argc, char *argv[])
 			rotation = (enum Rotation)atoi(optarg);
 			break;
 
+		case 'F':
+			fifo = true;
+			break;
+
 		default:
 			mpu9250::usage();
 			exit(0);
@@ -2140,7 +2489,7 @@ mpu9250_main(int argc, char *argv[])
 
 	 */
 	if (!strcmp(verb, "start")) {
-		mpu9250::start(external_bus, rotation);
+		mpu9250::start(external_bus, rotation, fifo);
 	}
 
 	if (!strcmp(verb, "stop")) {
@@ -2364,7 +2364,7 @@ int commander_thread_main(int argc, char *argv[])
 
 		status_changed = false;
 
-		usleep(COMMANDER_MONITORING_INTERVAL);
+		px4_usleep(COMMANDER_MONITORING_INTERVAL);
 	}
 
 	/* wait for threads to complete */
@@ -2994,12 +2994,14 @@ void *commander_low_prio_loop(void *arg)
 
 					if (((int)(cmd.param1)) == 1) {
 						answer_command(cmd, vehicle_command_s::VEHICLE_CMD_RESULT_ACCEPTED);
+						dm_flush();
 						usleep(100000);
 						/* reboot */
 						px4_systemreset(false);
 
 					} else if (((int)(cmd.param1)) == 3) {
 						answer_command(cmd, vehicle_command_s::VEHICLE_CMD_RESULT_ACCEPTED);
+						dm_flush();
 						usleep(100000);
 						/* reboot to bootloader */
 						px4_systemreset(true);
@@ -49,7 +49,8 @@ namespace control
 {
 
 BlockParamBase::BlockParamBase(Block *parent, const char *name, bool parent_prefix) :
-	_handle(PARAM_INVALID)
+	_handle(PARAM_INVALID),
+	_version(0)
 {
 	char fullname[blockNameLengthMax];
 
@@ -93,12 +94,22 @@ template <class T>
 T BlockParam<T>::get() { return _val; }
 
 template <class T>
-void BlockParam<T>::set(T val) { _val = val; }
+void BlockParam<T>::set(T val)
+{
+	_val = val;
+
+	/* the next update() restores the stored value */
+	_version = 0;
+}
 
 template <class T>
 void BlockParam<T>::update()
 {
-	if (_handle != PARAM_INVALID) { param_get(_handle, &_val); }
+	/* only read the parameter again if it changed since the last read */
+	if (_handle != PARAM_INVALID && (_version == 0 || param_changed_since(_handle, _version))) {
+		_version = param_version();
+		param_get(_handle, &_val);
+	}
 }
 
 template <class T>
@@ -66,6 +66,7 @@ public:
 	const char *getName() { return param_name(_handle); }
 protected:
 	param_t _handle;
+	uint32_t _version; /**< parameter store version the value was read at, zero to force a read */
 };
 
 /**
@@ -51,7 +51,10 @@
 #include <queue.h>
 #include <string.h>
 #include <semaphore.h>
+#include <pthread.h>
+#include <time.h>
 #include <unistd.h>
+#include <drivers/drv_hrt.h>
 
 #include "dataman.h"
 #include <systemlib/param/param.h>
@@ -66,10 +69,14 @@ __EXPORT int dataman_main(int argc, char *argv[]);
 __EXPORT ssize_t dm_read(dm_item_t item, unsigned char index, void *buffer, size_t buflen);
 __EXPORT ssize_t dm_write(dm_item_t  item, unsigned char index, dm_persitence_t persistence, const void *buffer,
 			  size_t buflen);
+__EXPORT ssize_t dm_read_range(dm_item_t item, unsigned char index, unsigned num, void *buffer, size_t buflen);
+__EXPORT ssize_t dm_write_range(dm_item_t item, unsigned char index, unsigned num, dm_persitence_t persistence,
+				const void *buffer, size_t buflen);
 __EXPORT int dm_clear(dm_item_t item);
 __EXPORT void dm_lock(dm_item_t item);
 __EXPORT void dm_unlock(dm_item_t item);
 __EXPORT int dm_restart(dm_reset_reason restart_type);
+__EXPORT int dm_flush(void);
 
 /** Types of function calls supported by the worker task */
 typedef enum {
@@ -77,6 +84,9 @@ typedef enum {
 	dm_read_func,
 	dm_clear_func,
 	dm_restart_func,
+	dm_read_range_func,
+	dm_write_range_func,
+	dm_flush_func,
 	dm_number_of_funcs
 } dm_function_t;
 
@@ -101,6 +111,21 @@ typedef struct {
 			void *buf;
 			size_t count;
 		} read_params;
+		struct {
+			dm_item_t item;
+			unsigned char index;
+			unsigned num;
+			dm_persitence_t persistence;
+			const void *buf;
+			size_t count;
+		} write_range_params;
+		struct {
+			dm_item_t item;
+			unsigned char index;
+			unsigned num;
+			void *buf;
+			size_t count;
+		} read_range_params;
 		struct {
 			dm_item_t item;
 		} clear_params;
@@ -149,7 +174,9 @@ typedef struct {
 static work_q_t g_free_q;	/* queue of free work items. So that we don't always need to call malloc and free*/
 static work_q_t g_work_q;	/* pending work items. To be consumed by worker thread */
 
-static px4_sem_t g_work_queued_sema;	/* To notify worker thread a work item has been queued */
+static pthread_mutex_t g_work_queued_mutex;	/* Protects g_work_queued */
+static pthread_cond_t g_work_queued_cond;	/* To notify worker thread a work item has been queued */
+static unsigned g_work_queued;			/* Number of notifications not yet seen by the worker thread */
 static px4_sem_t g_init_sema;
 
 static bool g_task_should_exit;	/**< if true, dataman task should exit */
@@ -157,6 +184,24 @@ static bool g_task_should_exit;	/**< if true, dataman task should exit */
 #define DM_SECTOR_HDR_SIZE 4	/* data manager per item header overhead */
 static const unsigned k_sector_size = DM_MAX_DATA_SIZE + DM_SECTOR_HDR_SIZE; /* total item sorage space */
 
+/* RAM copy of the data manager file. Requests are served from it and the modified part
+ * is written back to the file once no more requests arrive. On NuttX the file is accessed
+ * directly, a copy of it would take up too much of the RAM. */
+#ifdef __PX4_NUTTX
+static const bool k_use_cache = false;
+#else
+static const bool k_use_cache = true;
+#endif
+
+static unsigned char *g_cache = NULL;
+static unsigned g_cache_size = 0;
+static unsigned g_dirty_start, g_dirty_end;	/* byte range of the copy not written back yet */
+static hrt_abstime g_dirty_since;		/* time the first byte of the range was modified */
+static unsigned g_write_backs;
+
+static const unsigned k_write_back_delay = 50000;	/* wait this long for further requests before writing back (us) */
+static const unsigned k_write_back_max_age = 1000000;	/* but never keep modified data longer than this (us) */
+
 static void init_q(work_q_t *q)
 {
 	sq_init(&(q->q));		/* Initialize the NuttX queue structure */
@@ -263,6 +308,16 @@ dequeue_work_item(void)
 	return work;
 }
 
+/* Wake up the worker thread */
+static void
+signal_work_queued(void)
+{
+	pthread_mutex_lock(&g_work_queued_mutex);
+	g_work_queued++;
+	pthread_cond_signal(&g_work_queued_cond);
+	pthread_mutex_unlock(&g_work_queued_mutex);
+}
+
 static int
 enqueue_work_item_and_wait_for_result(work_q_item_t *item)
 {
@@ -278,7 +333,7 @@ enqueue_work_item_and_wait_for_result(work_q_item_t *item)
 	unlock_queue(&g_work_q);
 
 	/* tell the work thread that work is available */
-	px4_sem_post(&g_work_queued_sema);
+	signal_work_queued();
 
 	/* wait for the result */
 	px4_sem_wait(&item->wait_sem);
@@ -320,6 +375,115 @@ calculate_offset(dm_item_t item, unsigned char index)
  * The total size must not exceed k_sector_size
  */
 
+/* Read from the data manager file or its RAM copy, returns 0 at the end of the file */
+static ssize_t
+read_store(int offset, void *buf, size_t count)
+{
+	if (g_cache != NULL) {
+		if ((unsigned)offset >= g_cache_size) {
+			return 0;
+		}
+
+		if (count > g_cache_size - offset) {
+			count = g_cache_size - offset;
+		}
+
+		memcpy(buf, g_cache + offset, count);
+		return count;
+	}
+
+	if (lseek(g_task_fd, offset, SEEK_SET) != offset) {
+		return -1;
+	}
+
+	return read(g_task_fd, buf, count);
+}
+
+/* Write to the data manager file or its RAM copy */
+static ssize_t
+write_store(int offset, const void *buf, size_t count)
+{
+	if (g_cache != NULL) {
+		if ((unsigned)offset + count > g_cache_size) {
+			return -1;
+		}
+
+		memcpy(g_cache + offset, buf, count);
+
+		/* extend the range to write back */
+		if (g_dirty_end <= g_dirty_start) {
+			g_dirty_start = offset;
+			g_dirty_end = offset + count;
+			g_dirty_since = hrt_absolute_time();
+
+		} else {
+			if ((unsigned)offset < g_dirty_start) {
+				g_dirty_start = offset;
+			}
+
+			if (offset + count > g_dirty_end) {
+				g_dirty_end = offset + count;
+			}
+		}
+
+		return count;
+	}
+
+	if (lseek(g_task_fd, offset, SEEK_SET) != offset) {
+		return -1;
+	}
+
+	return write(g_task_fd, buf, count);
+}
+
+/* Make sure data is written to physical media, the RAM copy is written back later */
+static void
+sync_store(void)
+{
+	if (g_cache == NULL) {
+		fsync(g_task_fd);
+	}
+}
+
+/* Write the modified range of the RAM copy back to the data manager file */
+static int
+write_back(void)
+{
+	int result = 0;
+
+	if ((g_cache == NULL) || (g_dirty_end <= g_dirty_start)) {
+		return 0;
+	}
+
+	size_t len = g_dirty_end - g_dirty_start;
+
+	if ((lseek(g_task_fd, g_dirty_start, SEEK_SET) != (off_t)g_dirty_start) ||
+	    (write(g_task_fd, g_cache + g_dirty_start, len) != (ssize_t)len)) {
+		warnx("write back failed");
+		result = -1;
+	}
+
+	fsync(g_task_fd);
+
+	/* a failed write is not retried, the data is still served from RAM */
+	g_dirty_start = g_dirty_end = 0;
+	g_write_backs++;
+
+	return result;
+}
+
+/* Make sure all data accepted so far is on physical media, including the RAM copy */
+static int
+flush_store(void)
+{
+	if (g_cache == NULL) {
+		fsync(g_task_fd);
+		return 0;
+	}
+
+	return write_back();
+}
+
 /* write to the data manager file */
 static ssize_t
 _write(dm_item_t item, unsigned char index, dm_persitence_t persistence, const void *buf, size_t count)
@@ -355,11 +519,16 @@ _write(dm_item_t item, unsigned char index, dm_persitence_t persistence, const v
 
 	len = -1;
 
-	/* Seek to the right spot in the data manager file and write the data item */
-	if (lseek(g_task_fd, offset, SEEK_SET) == offset)
-		if ((len = write(g_task_fd, buffer, count)) == count) {
-			fsync(g_task_fd);        /* Make sure data is written to physical media */
+	/* Write the data item to the right spot in the data manager file */
+	if ((len = write_store(offset, buffer, count)) == count) {
+		/* The mission state has to survive a power loss right after it changed */
+		if (item == DM_KEY_MISSION_STATE) {
+			flush_store();
+
+		} else {
+			sync_store();        /* Make sure data is written to physical media */
 		}
+	}
 
 	/* Make sure the write succeeded */
 	if (len != count) {
@@ -393,9 +562,7 @@ _read(dm_item_t item, unsigned char index, void *buf, size_t count)
 	/* Read the prefix and data */
 	len = -1;
 
-	if (lseek(g_task_fd, offset, SEEK_SET) == offset) {
-		len = read(g_task_fd, buffer, count + DM_SECTOR_HDR_SIZE);
-	}
+	len = read_store(offset, buffer, count + DM_SECTOR_HDR_SIZE);
 
 	/* Check for read error */
 	if (len < 0) {
@@ -438,27 +605,23 @@ _clear(dm_item_t item)
 	/* Clear all items of this type */
 	for (i = 0; (unsigned)i < g_per_item_max_index[item]; i++) {
 		char buf[1];
+		ssize_t len = read_store(offset, buf, 1);
 
-		if (lseek(g_task_fd, offset, SEEK_SET) != offset) {
+		if (len < 0) {
 			result = -1;
 			break;
 		}
 
 		/* Avoid SD flash wear by only doing writes where necessary */
-		if (read(g_task_fd, buf, 1) < 1) {
+		if (len < 1) {
 			break;
 		}
 
 		/* If item has length greater than 0 it needs to be overwritten */
 		if (buf[0]) {
-			if (lseek(g_task_fd, offset, SEEK_SET) != offset) {
-				result = -1;
-				break;
-			}
-
 			buf[0] = 0;
 
-			if (write(g_task_fd, buf, 1) != 1) {
+			if (write_store(offset, buf, 1) != 1) {
 				result = -1;
 				break;
 			}
@@ -468,7 +631,13 @@ _clear(dm_item_t item)
 	}
 
 	/* Make sure data is actually written to physical media */
-	fsync(g_task_fd);
+	if (item == DM_KEY_MISSION_STATE) {
+		flush_store();
+
+	} else {
+		sync_store();
+	}
+
 	return result;
 }
 
@@ -483,15 +652,10 @@ _restart(dm_reset_reason reason)
 
 	/* Loop through all of the data segments and delete those that are not persistent */
 	while (1) {
-		size_t len;
+		ssize_t len;
 
 		/* Get data segment at current offset */
-		if (lseek(g_task_fd, offset, SEEK_SET) != offset) {
-			/* must be at eof */
-			break;
-		}
-
-		len = read(g_task_fd, buffer, sizeof(buffer));
+		len = read_store(offset, buffer, sizeof(buffer));
 
 		if (len != sizeof(buffer)) {
 			/* must be at eof */
@@ -516,14 +680,9 @@ _restart(dm_reset_reason reason)
 
 			/* Set segment to unused if data does not persist */
 			if (clear_entry) {
-				if (lseek(g_task_fd, offset, SEEK_SET) != offset) {
-					result = -1;
-					break;
-				}
-
 				buffer[0] = 0;
 
-				len = write(g_task_fd, buffer, 1);
+				len = write_store(offset, buffer, 1);
 
 				if (len != 1) {
 					result = -1;
@@ -535,12 +694,66 @@ _restart(dm_reset_reason reason)
 		offset += k_sector_size;
 	}
 
-	fsync(g_task_fd);
+	flush_store();
 
 	/* tell the caller how it went */
 	return result;
 }
 
+/* Retrieve consecutive items, stops at the first item that is not exactly count bytes long */
+static ssize_t
+_read_range(dm_item_t item, unsigned char index, unsigned num, void *buf, size_t count)
+{
+	unsigned char *dst = (unsigned char *)buf;
+	unsigned i;
+
+	/* Make sure the whole range is valid */
+	if ((item >= DM_KEY_NUM_KEYS) || (index + num > g_per_item_max_index[item])) {
+		return -1;
+	}
+
+	for (i = 0; i < num; i++) {
+		ssize_t len = _read(item, index + i, dst, count);
+
+		if (len < 0) {
+			return -1;
+		}
+
+		if ((size_t)len != count) {
+			break;
+		}
+
+		dst += count;
+	}
+
+	/* Return the number of complete items read */
+	return i;
+}
+
+/* Store consecutive items of count bytes each */
+static ssize_t
+_write_range(dm_item_t item, unsigned char index, unsigned num, dm_persitence_t persistence, const void *buf,
+	     size_t count)
+{
+	const unsigned char *src = (const unsigned char *)buf;
+
+	/* Make sure the whole range is valid */
+	if ((item >= DM_KEY_NUM_KEYS) || (index + num > g_per_item_max_index[item])) {
+		return -1;
+	}
+
+	for (unsigned i = 0; i < num; i++) {
+		if (_write(item, index + i, persistence, src, count) != (ssize_t)count) {
+			return -1;
+		}
+
+		src += count;
+	}
+
+	/* Return the number of items written */
+	return num;
+}
+
 /** Write to the data manager file */
 __EXPORT ssize_t
 dm_write(dm_item_t item, unsigned char index, dm_persitence_t persistence, const void *buf, size_t count)
@@ -594,6 +807,62 @@ dm_read(dm_item_t item, unsigned char index, void *buf, size_t count)
 	return (ssize_t)enqueue_work_item_and_wait_for_result(work);
 }
 
+/** Retrieve consecutive items from the data manager file */
+__EXPORT ssize_t
+dm_read_range(dm_item_t item, unsigned char index, unsigned num, void *buf, size_t count)
+{
+	work_q_item_t *work;
+
+	/* Make sure data manager has been started and is not shutting down */
+	if ((g_fd < 0) || g_task_should_exit) {
+		return -1;
+	}
+
+	/* get a work item and queue up a range read request */
+	if ((work = create_work_item()) == NULL) {
+		return -1;
+	}
+
+	work->func = dm_read_range_func;
+	work->read_range_params.item = item;
+	work->read_range_params.index = index;
+	work->read_range_params.num = num;
+	work->read_range_params.buf = buf;
+	work->read_range_params.count = count;
+
+	/* Enqueue the item on the work queue and wait for the worker thread to complete processing it */
+	return (ssize_t)enqueue_work_item_and_wait_for_result(work);
+}
+
+/** Write consecutive items to the data manager file */
+__EXPORT ssize_t
+dm_write_range(dm_item_t item, unsigned char index, unsigned num, dm_persitence_t persistence, const void *buf,
+	       size_t count)
+{
+	work_q_item_t *work;
+
+	/* Make sure data manager has been started and is not shutting down */
+	if ((g_fd < 0) || g_task_should_exit) {
+		return -1;
+	}
+
+	/* get a work item and queue up a range write request */
+	if ((work = create_work_item()) == NULL) {
+		return -1;
+	}
+
+	work->func = dm_write_range_func;
+	work->write_range_params.item = item;
+	work->write_range_params.index = index;
+	work->write_range_params.num = num;
+	work->write_range_params.persistence = persistence;
+	work->write_range_params.buf = buf;
+	work->write_range_params.count = count;
+
+	/* Enqueue the item on the work queue and wait for the worker thread to complete processing it */
+	return (ssize_t)enqueue_work_item_and_wait_for_result(work);
+}
+
 __EXPORT int
 dm_clear(dm_item_t item)
 {
@@ -673,6 +942,66 @@ dm_restart(dm_reset_reason reason)
 	return enqueue_work_item_and_wait_for_result(work);
 }
 
+/* Write all data modified so far to physical media */
+__EXPORT int
+dm_flush(void)
+{
+	work_q_item_t *work;
+
+	/* Make sure data manager has been started and is not shutting down */
+	if ((g_fd < 0) || g_task_should_exit) {
+		return -1;
+	}
+
+	/* get a work item and queue up a flush request */
+	if ((work = create_work_item()) == NULL) {
+		return -1;
+	}
+
+	work->func = dm_flush_func;
+
+	/* Enqueue the item on the work queue and wait for the worker thread to complete processing it */
+	return enqueue_work_item_and_wait_for_result(work);
+}
+
+/* Wait for a work request, returns false if none arrived within timeout (us), 0 waits forever */
+static bool
+wait_for_work(unsigned timeout)
+{
+	pthread_mutex_lock(&g_work_queued_mutex);
+
+	if (timeout == 0) {
+		while (g_work_queued == 0) {
+			pthread_cond_wait(&g_work_queued_cond, &g_work_queued_mutex);
+		}
+
+	} else {
+		/* condition variables time out against the wall clock */
+		struct timespec abstime;
+		clock_gettime(CLOCK_REALTIME, &abstime);
+		abstime.tv_sec += timeout / 1000000;
+		abstime.tv_nsec += (timeout % 1000000) * 1000;
+
+		if (abstime.tv_nsec >= 1000 * 1000 * 1000) {
+			abstime.tv_sec++;
+			abstime.tv_nsec -= 1000 * 1000 * 1000;
+		}
+
+		while (g_work_queued == 0) {
+			if (pthread_cond_timedwait(&g_work_queued_cond, &g_work_queued_mutex, &abstime) != 0) {
+				break;
+			}
+		}
+	}
+
+	bool queued = (g_work_queued > 0);
+	g_work_queued = 0;
+
+	pthread_mutex_unlock(&g_work_queued_mutex);
+
+	return queued;
+}
+
 static int
 task_main(int argc, char *argv[])
 {
@@ -705,7 +1034,9 @@ task_main(int argc, char *argv[])
 	init_q(&g_work_q);
 	init_q(&g_free_q);
 
-	px4_sem_init(&g_work_queued_sema, 1, 0);
+	pthread_mutex_init(&g_work_queued_mutex, NULL);
+	pthread_cond_init(&g_work_queued_cond, NULL);
+	g_work_queued = 0;
 
 	/* See if the data manage file exists and is a multiple of the sector size */
 	g_task_fd = open(k_data_manager_device_path, O_RDONLY | O_BINARY);
@@ -743,6 +1074,26 @@ task_main(int argc, char *argv[])
 
 	fsync(g_task_fd);
 
+	/* Load the RAM copy of the file, the part beyond the end of the file is empty */
+	if (k_use_cache) {
+		g_cache = (unsigned char *)malloc(max_offset);
+
+		if (g_cache != NULL) {
+			memset(g_cache, 0, max_offset);
+
+			if (lseek(g_task_fd, 0, SEEK_SET) != 0 || read(g_task_fd, g_cache, max_offset) < 0) {
+				warnx("Could not read data manager file %s, using it directly", k_data_manager_device_path);
+				free(g_cache);
+				g_cache = NULL;
+
+			} else {
+				g_cache_size = max_offset;
+				g_dirty_start = g_dirty_end = 0;
+				g_write_backs = 0;
+			}
+		}
+	}
+
 	printf("dataman: ");
 	/* see if we need to erase any items based on restart type */
 	int sys_restart_val;
@@ -764,6 +1115,8 @@ task_main(int argc, char *argv[])
 		printf("Unknown restart");
 	}
 
+	write_back();
+
 	/* We use two file descriptors, one for the caller context and one for the worker thread */
 	/* They are actually the same but we need to some way to reject caller request while the */
 	/* worker thread is shutting down but still processing requests */
@@ -784,8 +1137,25 @@ task_main(int argc, char *argv[])
 		}
 
 		if (!g_task_should_exit) {
-			/* wait for work */
-			px4_sem_wait(&g_work_queued_sema);
+			if (g_dirty_end > g_dirty_start) {
+				/* further requests of a burst are handled before writing back, unless the data
+				 * has been waiting for too long already */
+				hrt_abstime age = hrt_elapsed_time(&g_dirty_since);
+				unsigned timeout = k_write_back_delay;
+
+				if (age + timeout > k_write_back_max_age) {
+					timeout = (age < k_write_back_max_age) ? (unsigned)(k_write_back_max_age - age) : 0;
+				}
+
+				if ((timeout == 0) || !wait_for_work(timeout)) {
+					write_back();
+					continue;
+				}
+
+			} else {
+				/* wait for work */
+				wait_for_work(0);
+			}
 		}
 
 		/* Empty the work queue */
@@ -816,6 +1186,25 @@ task_main(int argc, char *argv[])
 				work->result = _restart(work->restart_params.reason);
 				break;
 
+			case dm_read_range_func:
+				g_func_counts[dm_read_range_func]++;
+				work->result =
+					_read_range(work->read_range_params.item, work->read_range_params.index, work->read_range_params.num,
+						    work->read_range_params.buf, work->read_range_params.count);
+				break;
+
+			case dm_write_range_func:
+				g_func_counts[dm_write_range_func]++;
+				work->result =
+					_write_range(work->write_range_params.item, work->write_range_params.index, work->write_range_params.num,
+						     work->write_range_params.persistence, work->write_range_params.buf, work->write_range_params.count);
+				break;
+
+			case dm_flush_func:
+				g_func_counts[dm_flush_func]++;
+				work->result = flush_store();
+				break;
+
 			default: /* should never happen */
 				work->result = -1;
 				break;
@@ -831,6 +1220,11 @@ task_main(int argc, char *argv[])
 		}
 	}
 
+	write_back();
+	free(g_cache);
+	g_cache = NULL;
+	g_cache_size = 0;
+
 	close(g_task_fd);
 	g_task_fd = -1;
 
@@ -847,16 +1241,25 @@ task_main(int argc, char *argv[])
 
 	destroy_q(&g_work_q);
 	destroy_q(&g_free_q);
-	px4_sem_destroy(&g_work_queued_sema);
+	pthread_cond_destroy(&g_work_queued_cond);
+	pthread_mutex_destroy(&g_work_queued_mutex);
 	px4_sem_destroy(&g_sys_state_mutex);
 
 	return 0;
 }
 
+/* The process exits on shutdown and reboot on POSIX, the RAM copy must not be lost then */
+static void
+flush_at_exit(void)
+{
+	dm_flush();
+}
+
 static int
 start(void)
 {
 	int task;
+	static bool flush_at_exit_registered = false;
 
 	px4_sem_init(&g_init_sema, 1, 0);
 
@@ -870,6 +1273,11 @@ start(void)
 	px4_sem_wait(&g_init_sema);
 	px4_sem_destroy(&g_init_sema);
 
+	if (k_use_cache && !flush_at_exit_registered) {
+		atexit(flush_at_exit);
+		flush_at_exit_registered = true;
+	}
+
 	return 0;
 }
 
@@ -881,6 +1289,13 @@ status(void)
 	warnx("Reads    %d", g_func_counts[dm_read_func]);
 	warnx("Clears   %d", g_func_counts[dm_clear_func]);
 	warnx("Restarts %d", g_func_counts[dm_restart_func]);
+	warnx("Range reads %d, writes %d", g_func_counts[dm_read_range_func], g_func_counts[dm_write_range_func]);
+	warnx("Flushes  %d", g_func_counts[dm_flush_func]);
+
+	if (g_cache != NULL) {
+		warnx("RAM copy %u bytes, write backs %u", g_cache_size, g_write_backs);
+	}
+
 	warnx("Max Q lengths work %d, free %d", g_work_q.max_size, g_free_q.max_size);
 }
 
@@ -889,7 +1304,7 @@ stop(void)
 {
 	/* Tell the worker task to shut down */
 	g_task_should_exit = true;
-	px4_sem_post(&g_work_queued_sema);
+	signal_work_queued();
 }
 
 static void
@@ -100,7 +100,13 @@ dm_read(
 	size_t buflen			/* Length in bytes of data to retrieve */
 );
 
-/** write to the data manager store */
+/**
+ * write to the data manager store
+ *
+ * On POSIX the data is kept in a RAM copy of the store when this returns and is written to the
+ * file once no further requests arrive, at the latest after one second. Use dm_flush() where the
+ * data has to survive a power loss right away, DM_KEY_MISSION_STATE is always written out.
+ */
 __EXPORT ssize_t
 dm_write(
 	dm_item_t  item,		/* The item type to store */
@@ -110,6 +116,27 @@ dm_write(
 	size_t buflen			/* Length in bytes of data to retrieve */
 );
 
+/** Retrieve consecutive items from the data manager store, returns the number of items read */
+__EXPORT ssize_t
+dm_read_range(
+	dm_item_t item,			/* The item type to retrieve */
+	unsigned char index,		/* The index of the first item */
+	unsigned num,			/* The number of items to retrieve */
+	void *buffer,			/* Pointer to caller data buffer, num * buflen bytes */
+	size_t buflen			/* Length in bytes of each item, reading stops at a shorter item */
+);
+
+/** write consecutive items to the data manager store, returns the number of items written */
+__EXPORT ssize_t
+dm_write_range(
+	dm_item_t  item,		/* The item type to store */
+	unsigned char index,		/* The index of the first item */
+	unsigned num,			/* The number of items to store */
+	dm_persitence_t persistence,	/* The persistence level of these items */
+	const void *buffer,		/* Pointer to caller data buffer, num * buflen bytes */
+	size_t buflen			/* Length in bytes of each item */
+);
+
 /** Lock all items of this type */
 __EXPORT void
 dm_lock(
@@ -128,6 +155,10 @@ dm_clear(
 	dm_item_t item			/* The item type to clear */
 );
 
+/** Write all data stored so far to physical media, returns 0 on success */
+__EXPORT int
+dm_flush(void);
+
 /** Tell the data manager about the type of the last reset */
 __EXPORT int
 dm_restart(
@@ -54,16 +54,19 @@ int buf_size_2 = 0;
 MavlinkFTP::MavlinkFTP(Mavlink* mavlink) :
 	MavlinkStream(mavlink),
 	_session_info{},
+	_session_mutex{},
 	_utRcvMsgFunc{},
 	_worker_data{}
 {
 	// initialize session
 	_session_info.fd = -1;
+	pthread_mutex_init(&_session_mutex, NULL);
 }
 
 MavlinkFTP::~MavlinkFTP()
 {
-	
+	delete[] _session_info.buf;
+	pthread_mutex_destroy(&_session_mutex);
 }
 
 const char*
@@ -81,7 +84,11 @@ MavlinkFTP::get_id(void)
 unsigned
 MavlinkFTP::get_size(void)
 {
-	if (_session_info.stream_download) {
+	pthread_mutex_lock(&_session_mutex);
+	bool stream_download = _session_info.stream_download;
+	pthread_mutex_unlock(&_session_mutex);
+
+	if (stream_download) {
 		return MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
 		
 	} else {
@@ -169,6 +176,9 @@ MavlinkFTP::_process_request(mavlink_file_transfer_protocol_t* ftp_req, uint8_t
 
 	ErrorCode errorCode = kErrNone;
 
+	// Replies go out with the session released, the unit test reply hook calls send() right away
+	pthread_mutex_lock(&_session_mutex);
+
 	// basic sanity checks; must validate length before use
 	if (payload->size > kMaxDataLength) {
 		errorCode = kErrInvalidDataSize;
@@ -179,6 +189,14 @@ MavlinkFTP::_process_request(mavlink_file_transfer_protocol_t* ftp_req, uint8_t
 	printf("ftp: channel %u opc %u size %u offset %u\n", _getServerChannel(), payload->opcode, payload->size, payload->offset);
 #endif
 
+	// Only burst uploads keep data in the write behind buffer, every other command sees the file as written.
+	// Terminate and reset write it out themselves.
+	if (payload->opcode != kCmdBurstWriteFile && payload->opcode != kCmdTerminateSession &&
+	    payload->opcode != kCmdResetSessions && _session_info.fd >= 0 && _flushBuffer() < 0) {
+		errorCode = kErrFailErrno;
+		goto out;
+	}
+
 	switch (payload->opcode) {
 	case kCmdNone:
 		break;
@@ -212,7 +230,12 @@ MavlinkFTP::_process_request(mavlink_file_transfer_protocol_t* ftp_req, uint8_t
 		break;
 
 	case kCmdBurstReadFile:
-		errorCode = _workBurst(payload, target_system_id);
+		errorCode = _workBurst(payload, target_system_id, false);
+		stream_send = true;
+		break;
+
+	case kCmdBurstReadWindow:
+		errorCode = _workBurst(payload, target_system_id, true);
 		stream_send = true;
 		break;
 			
@@ -220,6 +243,14 @@ MavlinkFTP::_process_request(mavlink_file_transfer_protocol_t* ftp_req, uint8_t
 		errorCode = _workWrite(payload);
 		break;
 
+	case kCmdBurstWriteFile: {
+			bool ack = false;
+			errorCode = _workBurstWrite(payload, ack);
+			// Burst upload packets are only acked at the end of the burst or after a gap. Unless we need to Nak.
+			stream_send = !ack;
+			break;
+		}
+
 	case kCmdRemoveFile:
 		errorCode = _workRemoveFile(payload);
 		break;
@@ -250,6 +281,9 @@ MavlinkFTP::_process_request(mavlink_file_transfer_protocol_t* ftp_req, uint8_t
 	}
 
 out:
+	int r_errno = errno;
+	pthread_mutex_unlock(&_session_mutex);
+
 	payload->seq_number++;
 	
 	// handle success vs. error
@@ -257,7 +291,6 @@ out:
 		payload->req_opcode = payload->opcode;
 		payload->opcode = kRspAck;
 	} else {
-		int r_errno = errno;
 		payload->req_opcode = payload->opcode;
 		payload->opcode = kRspNak;
 		payload->size = 1;
@@ -455,6 +488,16 @@ MavlinkFTP::_workOpen(PayloadHeader* payload, int oflag)
 	}
 	fileSize = st.st_size;
 
+	// The buffer is kept until the server goes away, the stream might still be sending from it
+	if (_session_info.buf == nullptr) {
+		_session_info.buf = new uint8_t[kFileBufferSize];
+
+		if (_session_info.buf == nullptr) {
+			errno = ENOMEM;
+			return kErrFailErrno;
+		}
+	}
+
 	// Set mode to 666 incase oflag has O_CREAT
 	int fd = ::open(filename, oflag, PX4_O_MODE_666);
 	if (fd < 0) {
@@ -463,6 +506,11 @@ MavlinkFTP::_workOpen(PayloadHeader* payload, int oflag)
 	_session_info.fd = fd;
 	_session_info.file_size = fileSize;
 	_session_info.stream_download = false;
+	_session_info.write_offset = 0;
+	_session_info.write_gap_reported = false;
+	_session_info.buf_offset = 0;
+	_session_info.buf_len = 0;
+	_session_info.buf_dirty = false;
 
 	payload->session = 0;
 	payload->size = sizeof(uint32_t);
@@ -487,13 +535,8 @@ MavlinkFTP::_workRead(PayloadHeader* payload)
 		warnx("request past EOF");
 		return kErrEOF;
 	}
-		
-	if (lseek(_session_info.fd, payload->offset, SEEK_SET) < 0) {
-		warnx("seek fail");
-		return kErrFailErrno;
-	}
 
-	int bytes_read = ::read(_session_info.fd, &payload->data[0], kMaxDataLength);
+	int bytes_read = _readBuffered(payload->offset, &payload->data[0], kMaxDataLength);
 	if (bytes_read < 0) {
 		// Negative return indicates error other than eof
 		warnx("read fail %d", bytes_read);
@@ -507,19 +550,24 @@ MavlinkFTP::_workRead(PayloadHeader* payload)
 
 /// @brief Responds to a Stream command
 MavlinkFTP::ErrorCode
-MavlinkFTP::_workBurst(PayloadHeader* payload, uint8_t target_system_id)
+MavlinkFTP::_workBurst(PayloadHeader* payload, uint8_t target_system_id, bool move_window)
 {
-	if (payload->session != 0 && _session_info.fd < 0) {
+	if (payload->session != 0 || _session_info.fd < 0) {
 		return kErrInvalidSession;
 	}
 	
 #ifdef MAVLINK_FTP_DEBUG
 	warnx("FTP: burst offset:%d", payload->offset);
 #endif
+	// A burst request (re)starts at the offset. A window request keeps a running burst going and only moves
+	// its window to the offset the client has received up to, unless the offset is past the data sent so far.
+	if (!move_window || !_session_info.stream_download || payload->offset > _session_info.stream_offset) {
+		_session_info.stream_offset = payload->offset;
+	}
+
 	// Setup for streaming sends
 	_session_info.stream_download = true;
-	_session_info.stream_offset = payload->offset;
-	_session_info.stream_chunk_transmitted = 0;
+	_session_info.stream_window_end = payload->offset + _burstSize();
 	_session_info.stream_seq_number = payload->seq_number + 1;
 	_session_info.stream_target_system_id = target_system_id;
 
@@ -530,29 +578,67 @@ MavlinkFTP::_workBurst(PayloadHeader* payload, uint8_t target_system_id)
 MavlinkFTP::ErrorCode
 MavlinkFTP::_workWrite(PayloadHeader* payload)
 {
-	if (payload->session != 0 && _session_info.fd < 0) {
+	if (payload->session != 0 || _session_info.fd < 0) {
 		return kErrInvalidSession;
 	}
 
-	if (lseek(_session_info.fd, payload->offset, SEEK_SET) < 0) {
-		// Unable to see to the specified location
-		warnx("seek fail");
-		return kErrFailErrno;
-	}
-
-	int bytes_written = ::write(_session_info.fd, &payload->data[0], payload->size);
-	if (bytes_written < 0) {
+	// The ack tells the client the data is in the file, so it does not stay in the write behind buffer
+	int bytes_written = _writeBuffered(payload->offset, &payload->data[0], payload->size);
+	if (bytes_written < 0 || _flushBuffer() < 0) {
 		// Negative return indicates error other than eof
 		warnx("write fail %d", bytes_written);
 		return kErrFailErrno;
 	}
 
+	// a burst upload can continue from here
+	_session_info.write_offset = payload->offset + bytes_written;
+	_session_info.write_gap_reported = false;
+
 	payload->size = sizeof(uint32_t);
 	*((uint32_t*)payload->data) = bytes_written;
 
 	return kErrNone;
 }
 
+/// @brief Responds to a BurstWrite command
+MavlinkFTP::ErrorCode
+MavlinkFTP::_workBurstWrite(PayloadHeader* payload, bool &ack)
+{
+	if (payload->session != 0 || _session_info.fd < 0) {
+		return kErrInvalidSession;
+	}
+
+	// The client gets an ack with the offset to continue from at the end of each burst
+	ack = payload->burst_complete;
+
+	if (payload->offset == _session_info.write_offset) {
+		if (_writeBuffered(payload->offset, &payload->data[0], payload->size) < 0) {
+			warnx("write fail");
+			return kErrFailErrno;
+		}
+
+		_session_info.write_offset += payload->size;
+		_session_info.write_gap_reported = false;
+
+	} else if (payload->offset > _session_info.write_offset && !_session_info.write_gap_reported) {
+		// A packet got lost. Everything up to the resend is dropped, tell the client once so it can
+		// go back without waiting for the end of the burst.
+		_session_info.write_gap_reported = true;
+		payload->burst_complete = false;
+		ack = true;
+	}
+
+	// Packets before write_offset are resends of data we already have
+
+#ifdef MAVLINK_FTP_DEBUG
+	warnx("FTP: burst write offset:%d next:%d ack:%d", payload->offset, _session_info.write_offset, ack);
+#endif
+	payload->offset = _session_info.write_offset;
+	payload->size = 0;
+
+	return kErrNone;
+}
+
 /// @brief Responds to a RemoveFile command
 MavlinkFTP::ErrorCode
 MavlinkFTP::_workRemoveFile(PayloadHeader* payload)
@@ -650,13 +736,14 @@ MavlinkFTP::_workTerminate(PayloadHeader* payload)
 	if (payload->session != 0 || _session_info.fd < 0) {
 		return kErrInvalidSession;
 	}
-	
-	::close(_session_info.fd);
-	_session_info.fd = -1;
-	_session_info.stream_download = false;
-	
+
 	payload->size = 0;
 
+	// This writes out what is left of an upload, it has to make it to the client if that fails
+	if (_closeSession() < 0) {
+		return kErrFailErrno;
+	}
+
 	return kErrNone;
 }
 
@@ -665,9 +752,7 @@ MavlinkFTP::ErrorCode
 MavlinkFTP::_workReset(PayloadHeader* payload)
 {
 	if (_session_info.fd != -1) {
-		::close(_session_info.fd);
-		_session_info.fd = -1;
-		_session_info.stream_download = false;
+		_closeSession();
 	}
 
 	payload->size = 0;
@@ -765,6 +850,135 @@ MavlinkFTP::_workCalcFileCRC32(PayloadHeader* payload)
 	return kErrNone;
 }
 
+/// @brief Reads from the session file through the read ahead buffer.
+///	@return Returns the number of bytes read, -1 with errno set on failure
+int
+MavlinkFTP::_readBuffered(uint32_t offset, uint8_t *dst, unsigned len)
+{
+	if (_session_info.buf_dirty || offset < _session_info.buf_offset ||
+	    offset + len > _session_info.buf_offset + _session_info.buf_len) {
+		if (_flushBuffer() < 0) {
+			return -1;
+		}
+
+		// Refill from the requested offset on, sequential reads are then served from memory
+		if (lseek(_session_info.fd, offset, SEEK_SET) < 0) {
+			return -1;
+		}
+
+		int bytes_read = ::read(_session_info.fd, _session_info.buf, kFileBufferSize);
+		if (bytes_read < 0) {
+			return -1;
+		}
+
+		_session_info.buf_offset = offset;
+		_session_info.buf_len = bytes_read;
+	}
+
+	unsigned available = _session_info.buf_offset + _session_info.buf_len - offset;
+	if (len > available) {
+		len = available;
+	}
+
+	memcpy(dst, &_session_info.buf[offset - _session_info.buf_offset], len);
+
+	return len;
+}
+
+/// @brief Writes to the session file through the write behind buffer.
+///	@return Returns the number of bytes written, -1 with errno set on failure
+int
+MavlinkFTP::_writeBuffered(uint32_t offset, const uint8_t *src, unsigned len)
+{
+	if (_session_info.buf_dirty &&
+	    (offset != _session_info.buf_offset + _session_info.buf_len || _session_info.buf_len + len > kFileBufferSize)) {
+		if (_flushBuffer() < 0) {
+			return -1;
+		}
+	}
+
+	if (!_session_info.buf_dirty) {
+		// Drop whatever was read ahead, the buffer collects the data from offset on now
+		_session_info.buf_offset = offset;
+		_session_info.buf_len = 0;
+		_session_info.buf_dirty = true;
+	}
+
+	memcpy(&_session_info.buf[_session_info.buf_len], src, len);
+	_session_info.buf_len += len;
+
+	return len;
+}
+
+/// @brief Writes the data held back in the write behind buffer to the session file.
+///	@return Returns 0 on success, -1 with errno set on failure
+int
+MavlinkFTP::_flushBuffer(void)
+{
+	if (!_session_info.buf_dirty) {
+		return 0;
+	}
+
+	// The data is dropped if the write fails, the error is reported once
+	unsigned len = _session_info.buf_len;
+	_session_info.buf_len = 0;
+	_session_info.buf_dirty = false;
+
+	if (lseek(_session_info.fd, _session_info.buf_offset, SEEK_SET) < 0) {
+		return -1;
+	}
+
+	int bytes_written = ::write(_session_info.fd, _session_info.buf, len);
+	if (bytes_written < 0) {
+		return -1;
+	}
+
+	if ((unsigned)bytes_written != len) {
+		errno = ENOSPC;
+		return -1;
+	}
+
+	return 0;
+}
+
+/// @brief Writes out buffered data and closes the session file.
+///	@return Returns 0 on success, -1 with errno set if buffered data could not be written
+int
+MavlinkFTP::_closeSession(void)
+{
+	int ret = _flushBuffer();
+	int r_errno = errno;
+
+	::close(_session_info.fd);
+	_session_info.fd = -1;
+	_session_info.stream_download = false;
+
+	errno = r_errno;
+	return ret;
+}
+
+/// @brief Returns the number of bytes a burst download may send before the client has to ask for more
+uint32_t
+MavlinkFTP::_burstSize(void)
+{
+#ifdef MAVLINK_FTP_UNIT_TEST
+	// Small windows so the unit test gets through a number of them
+	return kBurstSizeMin;
+#else
+	// About half a second worth of the link, so the next request usually arrives before the window is used up
+	uint32_t burst_size = _mavlink->get_data_rate() / 2;
+
+	if (burst_size < kBurstSizeMin) {
+		burst_size = kBurstSizeMin;
+
+	} else if (burst_size > kBurstSizeMax) {
+		burst_size = kBurstSizeMax;
+	}
+
+	return burst_size;
+#endif
+}
+
 /// @brief Guarantees that the payload data is null terminated.
 ///     @return Returns a pointer to the payload data as a char *
 char *
@@ -842,36 +1056,49 @@ MavlinkFTP::_copy_file(const char *src_path, const char *dst_path, size_t length
 void MavlinkFTP::send(const hrt_abstime t)
 {
 	// Anything to stream?
-	if (!_session_info.stream_download) {
+	if (!get_size()) {
 		return;
 	}
+
+	const unsigned packet_size = MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
 	
-#ifndef MAVLINK_FTP_UNIT_TEST
+#ifdef MAVLINK_FTP_UNIT_TEST
+	// No link when unit testing, everything up to the end of the window goes out right away
+	unsigned max_bytes_to_send = UINT32_MAX;
+#else
 	// Skip send if not enough room
 	unsigned max_bytes_to_send = _mavlink->get_free_tx_buf();
 #ifdef MAVLINK_FTP_DEBUG
     warnx("MavlinkFTP::send max_bytes_to_send(%d) get_free_tx_buf(%d)", max_bytes_to_send, _mavlink->get_free_tx_buf());
 #endif
-	if (max_bytes_to_send < get_size()) {
+	if (max_bytes_to_send < packet_size) {
 		return;
 	}
 #endif
 	
-	// Send stream packets until buffer is full
+	// Send stream packets until buffer is full or the window is used up
+	bool more;
 
-	bool more_data;
 	do {
-		more_data = false;
-		
 		ErrorCode error_code = kErrNone;
 		
 		mavlink_file_transfer_protocol_t ftp_msg;
 		PayloadHeader* payload = reinterpret_cast<PayloadHeader *>(&ftp_msg.payload[0]);
+
+		pthread_mutex_lock(&_session_mutex);
+
+		if (!_session_info.stream_download) {
+			// Stopped by a request since the last packet
+			pthread_mutex_unlock(&_session_mutex);
+			break;
+		}
 		
 		payload->seq_number = _session_info.stream_seq_number;
 		payload->session = 0;
 		payload->opcode = kRspAck;
 		payload->req_opcode = kCmdBurstReadFile;
+		payload->burst_complete = false;
+		payload->padding = 0;
 		payload->offset = _session_info.stream_offset;
 		_session_info.stream_seq_number++;
 
@@ -887,26 +1114,19 @@ void MavlinkFTP::send(const hrt_abstime t)
 		}
 		
 		if (error_code == kErrNone) {
-			if (lseek(_session_info.fd, payload->offset, SEEK_SET) < 0) {
-				error_code = kErrFailErrno;
-#ifdef MAVLINK_FTP_DEBUG
-				warnx("stream download: seek fail");
-#endif
-			}
-		}
-		
-		if (error_code == kErrNone) {
-			int bytes_read = ::read(_session_info.fd, &payload->data[0], kMaxDataLength);
+			int bytes_read = _readBuffered(payload->offset, &payload->data[0], kMaxDataLength);
 			if (bytes_read < 0) {
 				// Negative return indicates error other than eof
 				error_code = kErrFailErrno;
 #ifdef MAVLINK_FTP_DEBUG
 				warnx("stream download: read fail");
 #endif
+			} else if (bytes_read == 0) {
+				// File got shorter since it was opened
+				error_code = kErrEOF;
 			} else {
 				payload->size = bytes_read;
 				_session_info.stream_offset += bytes_read;
-				_session_info.stream_chunk_transmitted += bytes_read;
 			}
 		}
 		
@@ -921,28 +1141,18 @@ void MavlinkFTP::send(const hrt_abstime t)
 				payload->data[1] = r_errno;
 			}
 			_session_info.stream_download = false;
-		} else {
-#ifndef MAVLINK_FTP_UNIT_TEST
-			if (max_bytes_to_send < (get_size()*2)) {
-				more_data = false;
-				/* perform transfers in 35K chunks - this is determined empirical */
-				if (_session_info.stream_chunk_transmitted > 35000) {
-					payload->burst_complete = true;
-					_session_info.stream_download = false;
-					_session_info.stream_chunk_transmitted = 0;
-				}
-			} else {
-#endif
-				more_data = true;
-				payload->burst_complete = false;
-#ifndef MAVLINK_FTP_UNIT_TEST
-				max_bytes_to_send -= get_size();
-			}
-#endif
+		} else if (_session_info.stream_offset >= _session_info.stream_window_end) {
+			// Window used up, wait for the client to ask for more
+			payload->burst_complete = true;
+			_session_info.stream_download = false;
 		}
 		
 		ftp_msg.target_system = _session_info.stream_target_system_id;
+		more = _session_info.stream_download;
+		pthread_mutex_unlock(&_session_mutex);
+
 		_reply(&ftp_msg);
-	} while (more_data);
-}
 
+		max_bytes_to_send -= packet_size;
+	} while (more && max_bytes_to_send >= packet_size);
+}
@@ -37,6 +37,7 @@
 ///     @author px4dev, Don Gagne <don@thegagnes.com>
  
 #include <dirent.h>
+#include <pthread.h>
 #include <queue.h>
 
 #include <systemlib/err.h>
@@ -75,7 +76,7 @@ public:
 		uint8_t		opcode;		///< Command opcode
 		uint8_t		size;		///< Size of data
 		uint8_t		req_opcode;	///< Request opcode returned in kRspAck, kRspNak message
-		uint8_t		burst_complete; ///< Only used if req_opcode=kCmdBurstReadFile - 1: set of burst packets complete, 0: More burst packets coming.
+		uint8_t		burst_complete; ///< Only used with kCmdBurstReadFile and kCmdBurstWriteFile - 1: set of burst packets complete, 0: More burst packets coming.
 		uint8_t		padding;        ///< 32 bit aligment padding
 		uint32_t	offset;		///< Offsets for List and Read commands
 		uint8_t		data[];		///< command data, varies by Opcode
@@ -99,7 +100,9 @@ public:
 		kCmdTruncateFile,	///< Truncate file at <path> to <offset> length
 		kCmdRename,		///< Rename <path1> to <path2>
 		kCmdCalcFileCRC32,	///< Calculate CRC32 for file at <path>
-		kCmdBurstReadFile,	///< Burst download session file
+		kCmdBurstReadFile,	///< Burst download session file from <offset>
+		kCmdBurstWriteFile,	///< Burst upload <size> bytes to <offset> in <session>, acked at the end of a burst or after a gap
+		kCmdBurstReadWindow,	///< Client received session file up to <offset>, moves the window of the running burst download there
 		
 		kRspAck = 128,		///< Ack response
 		kRspNak			///< Nak response
@@ -133,8 +136,9 @@ private:
 	ErrorCode	_workList(PayloadHeader *payload, bool list_hidden = false);
 	ErrorCode	_workOpen(PayloadHeader *payload, int oflag);
 	ErrorCode	_workRead(PayloadHeader *payload);
-	ErrorCode	_workBurst(PayloadHeader* payload, uint8_t target_system_id);
+	ErrorCode	_workBurst(PayloadHeader* payload, uint8_t target_system_id, bool move_window);
 	ErrorCode	_workWrite(PayloadHeader *payload);
+	ErrorCode	_workBurstWrite(PayloadHeader *payload, bool &ack);
 	ErrorCode	_workTerminate(PayloadHeader *payload);
 	ErrorCode	_workReset(PayloadHeader* payload);
 	ErrorCode	_workRemoveDirectory(PayloadHeader *payload);
@@ -144,6 +148,12 @@ private:
 	ErrorCode	_workRename(PayloadHeader *payload);
 	ErrorCode	_workCalcFileCRC32(PayloadHeader *payload);
 	
+	int		_readBuffered(uint32_t offset, uint8_t *dst, unsigned len);
+	int		_writeBuffered(uint32_t offset, const uint8_t *src, unsigned len);
+	int		_flushBuffer(void);
+	int		_closeSession(void);
+	uint32_t	_burstSize(void);
+
 	uint8_t _getServerSystemId(void);
 	uint8_t _getServerComponentId(void);
 	uint8_t _getServerChannel(void);
@@ -157,17 +167,35 @@ private:
 	
 	/// @brief Maximum data size in RequestHeader::data
 	static const uint8_t	kMaxDataLength = MAVLINK_MSG_FILE_TRANSFER_PROTOCOL_FIELD_PAYLOAD_LEN - sizeof(PayloadHeader);
+
+	/// @brief Size of the read ahead / write behind buffer of the session
+#ifdef __PX4_NUTTX
+	static const unsigned	kFileBufferSize = 2048;
+#else
+	static const unsigned	kFileBufferSize = 16384;
+#endif
+
+	/// @brief Limits for the number of bytes a burst download sends before the client has to ask for more
+	static const uint32_t	kBurstSizeMin = 8 * kMaxDataLength;
+	static const uint32_t	kBurstSizeMax = 256 * 1024;
 	
 	struct SessionInfo {
 		int		fd;
 		uint32_t	file_size;
 		bool		stream_download;
 		uint32_t	stream_offset;
+		uint32_t	stream_window_end;	///< burst download pauses here until the client asks for more
 		uint16_t	stream_seq_number;
 		uint8_t		stream_target_system_id;
-		unsigned	stream_chunk_transmitted;
+		uint32_t	write_offset;		///< next offset expected by a burst upload
+		bool		write_gap_reported;	///< client was told where to resume after a lost packet
+		uint8_t		*buf;			///< read ahead / write behind buffer, kFileBufferSize bytes
+		uint32_t	buf_offset;		///< file offset of buf[0]
+		unsigned	buf_len;		///< valid bytes in buf
+		bool		buf_dirty;		///< buf holds data which is not written to the file yet
 	};
 	struct SessionInfo _session_info;	///< Session info, fd=-1 for no active session
+	pthread_mutex_t	_session_mutex;		///< Guards _session_info, requests arrive on the receiver thread while send() streams on the main thread
 	
 	ReceiveMessageFunc_t	_utRcvMsgFunc;	///< Unit test override for mavlink message sending
 	void			*_worker_data;	///< Additional parameter to _utRcvMsgFunc;
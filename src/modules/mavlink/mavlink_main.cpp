@@ -98,7 +98,15 @@ static const int ERROR = -1;
 #define DEFAULT_DEVICE_NAME			"/dev/ttyS1"
 #define MAX_DATA_RATE				10000000	///< max data rate in bytes/s
 #define MAIN_LOOP_DELAY 			10000	///< 100 Hz @ 1000 bytes/s data rate
+#define MAIN_LOOP_MAX_DELAY			20000	///< longest sleep of the main loop if no stream is due
 #define FLOW_CONTROL_DISABLE_THRESHOLD		40	///< picked so that some messages still would fit it.
+#define TX_DATAGRAM_SIZE			1472	///< UDP payload that fits an Ethernet frame
+#define TX_DATAGRAMS_MAX			(Mavlink::TX_BUFFER_SIZE / (TX_DATAGRAM_SIZE - MAVLINK_MAX_PACKET_LEN) + 1)
+
+#ifndef MSG_NOSIGNAL
+/* Darwin has no MSG_NOSIGNAL, SO_NOSIGPIPE is set on the socket instead */
+#define MSG_NOSIGNAL 0
+#endif
 
 static Mavlink *_mavlink_instances = nullptr;
 
@@ -143,6 +151,15 @@ Mavlink::Mavlink() :
 	_main_loop_delay(1000),
 	_subscriptions(nullptr),
 	_streams(nullptr),
+	_schedule(nullptr),
+	_schedule_count(0),
+	_schedule_size(0),
+	_schedule_dirty(true),
+	_stream_rate(0.0f),
+	_stream_const_rate(0.0f),
+	_loop_count(0),
+	_loop_timestamp(0),
+	_loop_rate(0.0f),
 	_mission_manager(nullptr),
 	_parameters_manager(nullptr),
 	_mavlink_ftp(nullptr),
@@ -182,14 +199,22 @@ Mavlink::Mavlink() :
 	_myaddr{},
 	_src_addr{},
 	_bcast_addr{},
+	_tcp_clients{},
 #endif
 	_socket_fd(-1),
 	_protocol(SERIAL),
 	_network_port(14556),
 	_rstatus {},
-	_message_buffer {},
-	_message_buffer_mutex {},
 	_send_mutex {},
+	_tx_buf {},
+	_tx_len(0),
+	_tx_frames(0),
+	_tx_free(0),
+	_tx_hold(0),
+	_main_thread {},
+	_tx_syscalls(0),
+	_tx_batches(0),
+	_tx_batch_hist {},
 	_param_initialized(false),
 	_param_system_id(0),
 	_param_component_id(0),
@@ -207,6 +232,14 @@ Mavlink::Mavlink() :
 	fops.ioctl = (int (*)(file *, int, long unsigned int))&mavlink_dev_ioctl;
 #endif
 
+#ifdef __PX4_POSIX
+
+	for (unsigned i = 0; i < TCP_CLIENTS_MAX; i++) {
+		_tcp_clients[i].fd = -1;
+	}
+
+#endif
+
 	_instance_id = Mavlink::instance_count();
 
 	/* set channel according to instance id */
@@ -429,18 +462,19 @@ Mavlink::instance_exists(const char *device_name, Mavlink *self)
 }
 
 void
-Mavlink::forward_message(const mavlink_message_t *msg, Mavlink *self)
+Mavlink::forward_frame(const uint8_t *frame, unsigned len, Mavlink *self)
 {
+	/* if not in normal mode, we are an onboard link
+	 * onboard links should only pass on messages from the same system ID */
+	if (self->_mode != MAVLINK_MODE_NORMAL && frame[3] != mavlink_system.sysid) {
+		return;
+	}
 
+	/* every target copies the received wire bytes straight into its TX batch */
 	Mavlink *inst;
 	LL_FOREACH(_mavlink_instances, inst) {
-		if (inst != self) {
-
-			/* if not in normal mode, we are an onboard link
-			 * onboard links should only pass on messages from the same system ID */
-			if (!(self->_mode != MAVLINK_MODE_NORMAL && msg->sysid != mavlink_system.sysid)) {
-				inst->pass_message(msg);
-			}
+		if (inst != self && inst->_forwarding_on) {
+			inst->send_frame(frame, len);
 		}
 	}
 }
@@ -821,12 +855,354 @@ Mavlink::get_free_tx_buf()
 #endif
 
 	// if we are using network sockets, return max lenght of one packet
-	if (get_protocol() == UDP || get_protocol() == TCP ) {
+	if (get_protocol() == UDP) {
 		return  1500;
 	}
 
-	return buf_free;
+#ifdef __PX4_POSIX
+
+	/* the slowest TCP client limits what can be sent */
+	if (get_protocol() == TCP) {
+		buf_free = TCP_CLIENT_BUFFER_SIZE;
+
+		for (unsigned i = 0; i < TCP_CLIENTS_MAX; i++) {
+			if (_tcp_clients[i].fd >= 0 && TCP_CLIENT_BUFFER_SIZE - _tcp_clients[i].len < (unsigned)buf_free) {
+				buf_free = TCP_CLIENT_BUFFER_SIZE - _tcp_clients[i].len;
+			}
+		}
+	}
+
+#endif
+
+	/* frames still queued for this loop iteration take up space as well */
+	if ((unsigned)buf_free < _tx_len) {
+		return 0;
+	}
+
+	return buf_free - _tx_len;
+}
+
+uint8_t *
+Mavlink::tx_reserve(unsigned len)
+{
+	_last_write_try_time = hrt_absolute_time();
+
+	if (_tx_len + len > sizeof(_tx_buf)) {
+		tx_flush();
+	}
+
+	if (get_protocol() == SERIAL || get_protocol() == TCP) {
+		/* the whole batch has to fit into the UART or TCP client buffer, let it overflow else */
+		if (_tx_len == 0) {
+			_tx_free = get_free_tx_buf();
+		}
+
+		if (_tx_len + len > _tx_free) {
+			/* no enough space in buffer to send */
+			count_txerr();
+			count_txerrbytes(len);
+			return nullptr;
+		}
+	}
+
+	return &_tx_buf[_tx_len];
+}
+
+void
+Mavlink::tx_flush()
+{
+	if (_tx_len == 0) {
+		return;
+	}
+
+	ssize_t ret = -1;
+#ifndef __PX4_POSIX
+
+	/* send batch to UART */
+	if (get_protocol() == SERIAL) {
+		ret = ::write(_uart_fd, _tx_buf, _tx_len);
+		_tx_syscalls++;
+	}
+
+#else
+
+	if (get_protocol() == UDP) {
+		ret = tx_send_datagrams();
+
+	} else if (get_protocol() == TCP) {
+		ret = tx_send_tcp();
+	}
+
+#endif
+
+	if (ret != (ssize_t)_tx_len) {
+		count_txerr();
+
+		if (ret > 0) {
+			count_txbytes(ret);
+			count_txerrbytes(_tx_len - ret);
+
+		} else {
+			count_txerrbytes(_tx_len);
+		}
+
+	} else {
+		_last_write_success_time = _last_write_try_time;
+		count_txbytes(_tx_len);
+	}
+
+	/* frames per batch in powers of two */
+	unsigned bin = 0;
+
+	while ((_tx_frames >> (bin + 1)) != 0 && bin < TX_BATCH_BINS - 1) {
+		bin++;
+	}
+
+	_tx_batch_hist[bin]++;
+	_tx_batches++;
+
+	_tx_len = 0;
+	_tx_frames = 0;
+}
+
+#ifdef __PX4_POSIX
+ssize_t
+Mavlink::tx_send_datagrams()
+{
+	/* cut the batch into datagrams at frame boundaries */
+	struct iovec iov[TX_DATAGRAMS_MAX];
+	unsigned count = 0;
+	unsigned start = 0;
+
+	for (unsigned pos = 0; pos < _tx_len; pos += _tx_buf[pos + 1] + MAVLINK_NUM_NON_PAYLOAD_BYTES) {
+		if (pos + _tx_buf[pos + 1] + MAVLINK_NUM_NON_PAYLOAD_BYTES - start > TX_DATAGRAM_SIZE) {
+			iov[count].iov_base = &_tx_buf[start];
+			iov[count].iov_len = pos - start;
+			count++;
+			start = pos;
+		}
+	}
+
+	iov[count].iov_base = &_tx_buf[start];
+	iov[count].iov_len = _tx_len - start;
+	count++;
+
+	ssize_t sent = 0;
+
+#ifdef __PX4_LINUX
+	struct mmsghdr msgs[TX_DATAGRAMS_MAX];
+	memset(msgs, 0, sizeof(msgs));
+
+	for (unsigned i = 0; i < count; i++) {
+		msgs[i].msg_hdr.msg_name = &_src_addr;
+		msgs[i].msg_hdr.msg_namelen = sizeof(_src_addr);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	int ret = sendmmsg(_socket_fd, msgs, count, 0);
+	_tx_syscalls++;
+
+	for (int i = 0; i < ret; i++) {
+		sent += msgs[i].msg_len;
+	}
+
+#else
+
+	for (unsigned i = 0; i < count; i++) {
+		ssize_t ret = sendto(_socket_fd, iov[i].iov_base, iov[i].iov_len, 0,
+				     (struct sockaddr *)&_src_addr, sizeof(_src_addr));
+		_tx_syscalls++;
+
+		if (ret > 0) {
+			sent += ret;
+		}
+	}
+
+#endif
+	return sent;
+}
+
+ssize_t
+Mavlink::tx_send_tcp()
+{
+	hrt_abstime now = hrt_absolute_time();
+	unsigned dropped = 0;
+
+	for (unsigned i = 0; i < TCP_CLIENTS_MAX; i++) {
+		tcp_client &client = _tcp_clients[i];
+
+		if (client.fd < 0) {
+			continue;
+		}
+
+		/* what is still queued has to go out first to keep the stream in order */
+		if (client.len > 0 && !tcp_drain(client)) {
+			continue;
+		}
+
+		unsigned sent = 0;
+
+		if (client.len == 0) {
+			ssize_t ret = ::send(client.fd, _tx_buf, _tx_len, MSG_DONTWAIT | MSG_NOSIGNAL);
+			_tx_syscalls++;
+
+			if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+				/* the receiver closes the connection once it sees the hang up */
+				shutdown(client.fd, SHUT_RDWR);
+				continue;
+			}
+
+			if (ret > 0) {
+				sent = ret;
+				client.last_send = now;
+			}
+		}
+
+		/* queue the rest, a frame may only be dropped as a whole */
+		if (client.len + _tx_len - sent > TCP_CLIENT_BUFFER_SIZE) {
+			dropped = _tx_len;
+			continue;
+		}
+
+		memcpy(&client.buf[client.len], &_tx_buf[sent], _tx_len - sent);
+		client.len += _tx_len - sent;
+
+		/* a client which does not read anything holds back all others */
+		if (client.len > 0 && now - client.last_send > TCP_CLIENT_TIMEOUT) {
+			PX4_WARN("TCP client %d stalled, disconnecting", client.fd);
+			shutdown(client.fd, SHUT_RDWR);
+		}
+	}
+
+	return _tx_len - dropped;
+}
+
+bool
+Mavlink::tcp_drain(tcp_client &client)
+{
+	ssize_t ret = ::send(client.fd, client.buf, client.len, MSG_DONTWAIT | MSG_NOSIGNAL);
+	_tx_syscalls++;
+
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return true;
+		}
+
+		shutdown(client.fd, SHUT_RDWR);
+		return false;
+	}
+
+	if (ret > 0) {
+		client.len -= ret;
+		memmove(client.buf, &client.buf[ret], client.len);
+		client.last_send = hrt_absolute_time();
+	}
+
+	return true;
+}
+
+unsigned
+Mavlink::get_tcp_poll_fds(struct pollfd *fds)
+{
+	unsigned count = 0;
+
+	pthread_mutex_lock(&_send_mutex);
+
+	fds[count].fd = _socket_fd;
+	fds[count].events = POLLIN;
+	fds[count].revents = 0;
+	count++;
+
+	for (unsigned i = 0; i < TCP_CLIENTS_MAX; i++) {
+		if (_tcp_clients[i].fd >= 0) {
+			fds[count].fd = _tcp_clients[i].fd;
+			fds[count].events = POLLIN;
+			fds[count].revents = 0;
+			count++;
+		}
+	}
+
+	pthread_mutex_unlock(&_send_mutex);
+
+	return count;
+}
+
+void
+Mavlink::tcp_accept()
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+
+	int fd = accept(_socket_fd, (struct sockaddr *)&addr, &addrlen);
+
+	if (fd < 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&_send_mutex);
+
+	tcp_client *client = nullptr;
+
+	for (unsigned i = 0; i < TCP_CLIENTS_MAX; i++) {
+		if (_tcp_clients[i].fd < 0) {
+			client = &_tcp_clients[i];
+			break;
+		}
+	}
+
+	if (client == nullptr) {
+		pthread_mutex_unlock(&_send_mutex);
+		PX4_WARN("TCP client %s rejected, %u clients connected", inet_ntoa(addr.sin_addr), TCP_CLIENTS_MAX);
+		::close(fd);
+		return;
+	}
+
+	if (client->buf == nullptr) {
+		client->buf = new uint8_t[TCP_CLIENT_BUFFER_SIZE];
+
+		if (client->buf == nullptr) {
+			pthread_mutex_unlock(&_send_mutex);
+			::close(fd);
+			return;
+		}
+	}
+
+	/* telemetry is latency sensitive and already batched, so no Nagle */
+	int opt = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+#ifdef SO_NOSIGPIPE
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &opt, sizeof(opt));
+#endif
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+	client->fd = fd;
+	client->len = 0;
+	client->last_send = hrt_absolute_time();
+
+	pthread_mutex_unlock(&_send_mutex);
+
+	PX4_INFO("TCP client %s:%hu connected", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+}
+
+void
+Mavlink::tcp_close(int fd)
+{
+	pthread_mutex_lock(&_send_mutex);
+
+	for (unsigned i = 0; i < TCP_CLIENTS_MAX; i++) {
+		if (_tcp_clients[i].fd == fd) {
+			::close(fd);
+			_tcp_clients[i].fd = -1;
+			_tcp_clients[i].len = 0;
+			PX4_INFO("TCP client %d disconnected", fd);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&_send_mutex);
 }
+#endif
 
 void
 Mavlink::send_message(const uint8_t msgid, const void *msg, uint8_t component_ID)
@@ -842,22 +1218,14 @@ Mavlink::send_message(const uint8_t msgid, const void *msg, uint8_t component_ID
 	uint8_t payload_len = mavlink_message_lengths[msgid];
 	unsigned packet_len = payload_len + MAVLINK_NUM_NON_PAYLOAD_BYTES;
 
-	_last_write_try_time = hrt_absolute_time();
+	/* serialize straight into the TX buffer */
+	uint8_t *buf = tx_reserve(packet_len);
 
-	if (get_protocol() == SERIAL) {
-		/* check if there is space in the buffer, let it overflow else */
-		unsigned buf_free = get_free_tx_buf();
-		if (buf_free < packet_len) {
-			 /* no enough space in buffer to send */
-			count_txerr();
-			count_txerrbytes(packet_len);
-			pthread_mutex_unlock(&_send_mutex);
-			return;
-		}
+	if (buf == nullptr) {
+		pthread_mutex_unlock(&_send_mutex);
+		return;
 	}
 
-	uint8_t buf[MAVLINK_MAX_PACKET_LEN];
-
 	/* header */
 	buf[0] = MAVLINK_STX;
 	buf[1] = payload_len;
@@ -879,16 +1247,12 @@ Mavlink::send_message(const uint8_t msgid, const void *msg, uint8_t component_ID
 	buf[MAVLINK_NUM_HEADER_BYTES + payload_len] = (uint8_t)(checksum & 0xFF);
 	buf[MAVLINK_NUM_HEADER_BYTES + payload_len + 1] = (uint8_t)(checksum >> 8);
 
-	size_t ret = -1;
-#ifndef __PX4_POSIX
-	/* send message to UART */
-	if (get_protocol() == SERIAL) {
-		ret = ::write(_uart_fd, buf, packet_len);
-	}
-#else
-	if (get_protocol() == UDP) {
-		ret = sendto(_socket_fd, buf, packet_len, 0, (struct sockaddr *)&_src_addr, sizeof(_src_addr));
+	tx_commit(packet_len);
+	tx_commit_flush();
 
+#ifdef __PX4_POSIX
+
+	if (get_protocol() == UDP) {
 		struct telemetry_status_s &tstatus = get_rx_status();
 
 		/* resend heartbeat via broadcast */
@@ -897,32 +1261,21 @@ Mavlink::send_message(const uint8_t msgid, const void *msg, uint8_t component_ID
 			msgid == MAVLINK_MSG_ID_HEARTBEAT) {
 
 			int bret = sendto(_socket_fd, buf, packet_len, 0, (struct sockaddr *)&_bcast_addr, sizeof(_bcast_addr));
+			_tx_syscalls++;
 
 			if (bret <= 0) {
 				PX4_WARN("sending broadcast failed");
 			}
 		}
-
-	} else if (get_protocol() == TCP) {
-		/* not implemented, but possible to do so */
-		warnx("TCP transport pending implementation");
 	}
-#endif
-
-	if (ret != (size_t) packet_len) {
-		count_txerr();
-		count_txerrbytes(packet_len);
 
-	} else {
-		_last_write_success_time = _last_write_try_time;
-		count_txbytes(packet_len);
-	}
+#endif
 
 	pthread_mutex_unlock(&_send_mutex);
 }
 
 void
-Mavlink::resend_message(mavlink_message_t *msg)
+Mavlink::send_frame(const uint8_t *frame, unsigned len)
 {
 	/* If the wait until transmit flag is on, only transmit after we've received messages.
 	   Otherwise, transmit all the time. */
@@ -932,45 +1285,43 @@ Mavlink::resend_message(mavlink_message_t *msg)
 
 	pthread_mutex_lock(&_send_mutex);
 
-	unsigned buf_free = get_free_tx_buf();
+	uint8_t *buf = tx_reserve(len);
 
-	_last_write_try_time = hrt_absolute_time();
-
-	unsigned packet_len = msg->len + MAVLINK_NUM_NON_PAYLOAD_BYTES;
-
-	/* check if there is space in the buffer, let it overflow else */
-	if (buf_free < packet_len) {
-		/* no enough space in buffer to send */
-		count_txerr();
-		count_txerrbytes(packet_len);
-		pthread_mutex_unlock(&_send_mutex);
-		return;
+	if (buf != nullptr) {
+		memcpy(buf, frame, len);
+		tx_commit(len);
+		tx_commit_flush();
 	}
 
-	uint8_t buf[MAVLINK_MAX_PACKET_LEN];
-
-	/* header and payload */
-	memcpy(&buf[0], &msg->magic, MAVLINK_NUM_HEADER_BYTES + msg->len);
+	pthread_mutex_unlock(&_send_mutex);
+}
 
-	/* checksum */
-	buf[MAVLINK_NUM_HEADER_BYTES + msg->len] = (uint8_t)(msg->checksum & 0xFF);
-	buf[MAVLINK_NUM_HEADER_BYTES + msg->len + 1] = (uint8_t)(msg->checksum >> 8);
+void
+Mavlink::tx_commit_flush()
+{
+	/* the main loop flushes once per iteration, which may be MAIN_LOOP_MAX_DELAY away */
+	if (_tx_hold == 0 && !pthread_equal(pthread_self(), _main_thread)) {
+		tx_flush();
+	}
+}
 
-#ifndef __PX4_POSIX
-	/* send message to UART */
-	ssize_t ret = ::write(_uart_fd, buf, packet_len);
+void
+Mavlink::tx_hold()
+{
+	pthread_mutex_lock(&_send_mutex);
+	_tx_hold++;
+	pthread_mutex_unlock(&_send_mutex);
+}
 
-	if (ret != (int) packet_len) {
-		count_txerr();
-		count_txerrbytes(packet_len);
+void
+Mavlink::tx_release()
+{
+	pthread_mutex_lock(&_send_mutex);
 
-	} else {
-		_last_write_success_time = _last_write_try_time;
-		count_txbytes(packet_len);
+	if (_tx_hold > 0 && --_tx_hold == 0 && !pthread_equal(pthread_self(), _main_thread)) {
+		tx_flush();
 	}
 
-#endif
-
 	pthread_mutex_unlock(&_send_mutex);
 }
 
@@ -1016,6 +1367,44 @@ Mavlink::init_udp()
 #endif
 }
 
+void
+Mavlink::init_tcp()
+{
+#if defined (__PX4_LINUX) || defined (__PX4_DARWIN)
+	PX4_INFO("Setting up TCP server w/port %d", _network_port);
+
+	memset((char *)&_myaddr, 0, sizeof(_myaddr));
+	_myaddr.sin_family = AF_INET;
+	_myaddr.sin_addr.s_addr = htonl(INADDR_ANY);
+	_myaddr.sin_port = htons(_network_port);
+
+	if ((_socket_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+		PX4_WARN("create socket failed");
+		return;
+	}
+
+	/* allow a restart while old connections are still in TIME_WAIT */
+	int reuse_opt = 1;
+	if (setsockopt(_socket_fd, SOL_SOCKET, SO_REUSEADDR, &reuse_opt, sizeof(reuse_opt)) < 0) {
+		PX4_WARN("setting address reuse failed");
+	}
+
+	if (bind(_socket_fd, (struct sockaddr *)&_myaddr, sizeof(_myaddr)) < 0) {
+		PX4_WARN("bind failed");
+		return;
+	}
+
+	if (listen(_socket_fd, TCP_CLIENTS_MAX) < 0) {
+		PX4_WARN("listen failed");
+		return;
+	}
+
+	/* the receiver polls before accepting, a client giving up in between must not block it */
+	fcntl(_socket_fd, F_SETFL, fcntl(_socket_fd, F_GETFL, 0) | O_NONBLOCK);
+
+#endif
+}
+
 void
 Mavlink::handle_message(const mavlink_message_t *msg)
 {
@@ -1027,11 +1416,6 @@ Mavlink::handle_message(const mavlink_message_t *msg)
 
 	/* handle packet with ftp component */
 	_mavlink_ftp->handle_message(msg);
-
-	if (get_forwarding_on()) {
-		/* forward any messages to other mavlink instances */
-		Mavlink::forward_message(msg, this);
-	}
 }
 
 void
@@ -1150,6 +1534,7 @@ Mavlink::configure_stream(const char *stream_name, const float rate)
 				delete stream;
 			}
 
+			_schedule_dirty = true;
 			return OK;
 		}
 	}
@@ -1168,6 +1553,7 @@ Mavlink::configure_stream(const char *stream_name, const float rate)
 			stream->set_interval(interval);
 			LL_APPEND(_streams, stream);
 
+			_schedule_dirty = true;
 			return OK;
 		}
 	}
@@ -1201,6 +1587,8 @@ Mavlink::adjust_stream_rates(const float multiplier)
 		/* set new interval */
 		stream->set_interval(interval * multiplier);
 	}
+
+	_schedule_dirty = true;
 }
 
 void
@@ -1233,135 +1621,6 @@ Mavlink::configure_stream_threadsafe(const char *stream_name, const float rate)
 	}
 }
 
-int
-Mavlink::message_buffer_init(int size)
-{
-
-	_message_buffer.size = size;
-	_message_buffer.write_ptr = 0;
-	_message_buffer.read_ptr = 0;
-	_message_buffer.data = (char *)malloc(_message_buffer.size);
-
-	int ret;
-
-	if (_message_buffer.data == 0) {
-		ret = ERROR;
-		_message_buffer.size = 0;
-
-	} else {
-		ret = OK;
-	}
-
-	return ret;
-}
-
-void
-Mavlink::message_buffer_destroy()
-{
-	_message_buffer.size = 0;
-	_message_buffer.write_ptr = 0;
-	_message_buffer.read_ptr = 0;
-	free(_message_buffer.data);
-}
-
-int
-Mavlink::message_buffer_count()
-{
-	int n = _message_buffer.write_ptr - _message_buffer.read_ptr;
-
-	if (n < 0) {
-		n += _message_buffer.size;
-	}
-
-	return n;
-}
-
-int
-Mavlink::message_buffer_is_empty()
-{
-	return _message_buffer.read_ptr == _message_buffer.write_ptr;
-}
-
-
-bool
-Mavlink::message_buffer_write(const void *ptr, int size)
-{
-	// bytes available to write
-	int available = _message_buffer.read_ptr - _message_buffer.write_ptr - 1;
-
-	if (available < 0) {
-		available += _message_buffer.size;
-	}
-
-	if (size > available) {
-		// buffer overflow
-		return false;
-	}
-
-	char *c = (char *) ptr;
-	int n = _message_buffer.size - _message_buffer.write_ptr;	// bytes to end of the buffer
-
-	if (n < size) {
-		// message goes over end of the buffer
-		memcpy(&(_message_buffer.data[_message_buffer.write_ptr]), c, n);
-		_message_buffer.write_ptr = 0;
-
-	} else {
-		n = 0;
-	}
-
-	// now: n = bytes already written
-	int p = size - n;	// number of bytes to write
-	memcpy(&(_message_buffer.data[_message_buffer.write_ptr]), &(c[n]), p);
-	_message_buffer.write_ptr = (_message_buffer.write_ptr + p) % _message_buffer.size;
-	return true;
-}
-
-int
-Mavlink::message_buffer_get_ptr(void **ptr, bool *is_part)
-{
-	// bytes available to read
-	int available = _message_buffer.write_ptr - _message_buffer.read_ptr;
-
-	if (available == 0) {
-		return 0;	// buffer is empty
-	}
-
-	int n = 0;
-
-	if (available > 0) {
-		// read pointer is before write pointer, all available bytes can be read
-		n = available;
-		*is_part = false;
-
-	} else {
-		// read pointer is after write pointer, read bytes from read_ptr to end of the buffer
-		n = _message_buffer.size - _message_buffer.read_ptr;
-		*is_part = _message_buffer.write_ptr > 0;
-	}
-
-	*ptr = &(_message_buffer.data[_message_buffer.read_ptr]);
-	return n;
-}
-
-void
-Mavlink::message_buffer_mark_read(int n)
-{
-	_message_buffer.read_ptr = (_message_buffer.read_ptr + n) % _message_buffer.size;
-}
-
-void
-Mavlink::pass_message(const mavlink_message_t *msg)
-{
-	if (_forwarding_on) {
-		/* size is 8 bytes plus variable payload */
-		int size = MAVLINK_NUM_NON_PAYLOAD_BYTES + msg->len;
-		pthread_mutex_lock(&_message_buffer_mutex);
-		message_buffer_write(msg, size);
-		pthread_mutex_unlock(&_message_buffer_mutex);
-	}
-}
-
 float
 Mavlink::get_rate_mult()
 {
@@ -1371,19 +1630,14 @@ Mavlink::get_rate_mult()
 void
 Mavlink::update_rate_mult()
 {
-	float const_rate = 0.0f;
-	float rate = 0.0f;
+	/* the bandwidth of the streams is only recalculated when they change */
+	if (_schedule_dirty) {
+		schedule_rebuild();
+	}
 
 	/* scale down rates if their theoretical bandwidth is exceeding the link bandwidth */
-	MavlinkStream *stream;
-	LL_FOREACH(_streams, stream) {
-		if (stream->const_rate()) {
-			const_rate += stream->get_size() * 1000000.0f / stream->get_interval();
-
-		} else {
-			rate += stream->get_size() * 1000000.0f / stream->get_interval();
-		}
-	}
+	float const_rate = _stream_const_rate;
+	float rate = _stream_rate;
 
 	/* don't scale up rates, only scale down if needed */
 	float bandwidth_mult = fminf(1.0f, ((float)_datarate - const_rate) / rate);
@@ -1430,11 +1684,117 @@ Mavlink::update_rate_mult()
 
 	_last_hw_rate_timestamp = tstatus.timestamp;
 
+	float rate_mult = _rate_mult;
+
 	/* pick the minimum from bandwidth mult and hardware mult as limit */
 	_rate_mult = fminf(bandwidth_mult, hardware_mult);
 
 	/* ensure the rate multiplier never drops below 5% so that something is always sent */
 	_rate_mult = fmaxf(0.05f, _rate_mult);
+
+	/* the multiplier is part of every scaled deadline */
+	if (_rate_mult != rate_mult) {
+		_schedule_dirty = true;
+	}
+}
+
+void
+Mavlink::schedule_rebuild()
+{
+	unsigned count = 0;
+	float const_rate = 0.0f;
+	float rate = 0.0f;
+
+	MavlinkStream *stream;
+	LL_FOREACH(_streams, stream) {
+		count++;
+
+		if (stream->const_rate()) {
+			const_rate += stream->get_size() * 1000000.0f / stream->get_interval();
+
+		} else {
+			rate += stream->get_size() * 1000000.0f / stream->get_interval();
+		}
+	}
+
+	_stream_const_rate = const_rate;
+	_stream_rate = rate;
+
+	if (count > _schedule_size) {
+		MavlinkStream **schedule = new MavlinkStream *[count];
+
+		if (schedule == nullptr) {
+			_schedule_count = 0;
+			return;
+		}
+
+		delete[] _schedule;
+		_schedule = schedule;
+		_schedule_size = count;
+	}
+
+	_schedule_count = 0;
+
+	LL_FOREACH(_streams, stream) {
+		stream->update_deadline();
+		_schedule[_schedule_count++] = stream;
+	}
+
+	for (unsigned i = _schedule_count / 2; i-- > 0;) {
+		schedule_sift_down(i);
+	}
+
+	_schedule_dirty = false;
+}
+
+void
+Mavlink::schedule_sift_down(unsigned i)
+{
+	MavlinkStream *stream = _schedule[i];
+
+	for (;;) {
+		unsigned child = 2 * i + 1;
+
+		if (child >= _schedule_count) {
+			break;
+		}
+
+		if (child + 1 < _schedule_count && _schedule[child + 1]->get_deadline() < _schedule[child]->get_deadline()) {
+			child++;
+		}
+
+		if (stream->get_deadline() <= _schedule[child]->get_deadline()) {
+			break;
+		}
+
+		_schedule[i] = _schedule[child];
+		i = child;
+	}
+
+	_schedule[i] = stream;
+}
+
+hrt_abstime
+Mavlink::schedule_run(const hrt_abstime t)
+{
+	if (_schedule_dirty) {
+		schedule_rebuild();
+	}
+
+	while (_schedule_count > 0 && _schedule[0]->get_deadline() <= t) {
+		MavlinkStream *stream = _schedule[0];
+		stream->update(t);
+
+		/* not due again in this iteration, even if the stream had nothing to send */
+		stream->update_deadline(t + 1);
+		schedule_sift_down(0);
+	}
+
+	if (_schedule_count == 0) {
+		return t + MAIN_LOOP_MAX_DELAY;
+	}
+
+	return _schedule[0]->get_deadline();
 }
 
 int
@@ -1464,7 +1824,7 @@ Mavlink::task_main(int argc, char *argv[])
 	char* eptr;
 	int temp_int_arg;
 
-	while ((ch = px4_getopt(argc, argv, "b:r:d:u:m:fpvwx", &myoptind, &myoptarg)) != EOF) {
+	while ((ch = px4_getopt(argc, argv, "b:r:d:u:t:m:fpvwx", &myoptind, &myoptarg)) != EOF) {
 		switch (ch) {
 		case 'b':
 			_baudrate = strtoul(myoptarg, NULL, 10);
@@ -1502,6 +1862,17 @@ Mavlink::task_main(int argc, char *argv[])
 			}
 			break;
 
+		case 't':
+			temp_int_arg = strtoul(myoptarg, &eptr, 10);
+			if ( *eptr == '\0' ) {
+				_network_port = temp_int_arg;
+				set_protocol(TCP);
+			} else {
+				warnx("invalid data tcp_port '%s'", myoptarg);
+				err_flag = true;
+			}
+			break;
+
 //		case 'e':
 //			mavlink_link_termination_allowed = true;
 //			break;
@@ -1562,8 +1933,15 @@ Mavlink::task_main(int argc, char *argv[])
 		_datarate = MAX_DATA_RATE;
 	}
 
-	if (Mavlink::instance_exists(_device_name, this)) {
-		warnx("%s already running", _device_name);
+	if (get_protocol() == SERIAL) {
+		if (Mavlink::instance_exists(_device_name, this)) {
+			warnx("%s already running", _device_name);
+			return ERROR;
+		}
+
+	} else if (Mavlink::get_instance_for_network_port(_network_port) != nullptr) {
+		/* network instances share the default device name, so tell them apart by port */
+		warnx("port %hu already in use", _network_port);
 		return ERROR;
 	}
 
@@ -1571,6 +1949,8 @@ Mavlink::task_main(int argc, char *argv[])
 	warnx("mode: %u, data rate: %d B/s on %s @ %dB", _mode, _datarate, _device_name, _baudrate);
 	} else if (get_protocol() == UDP) {
 		warnx("mode: %u, data rate: %d B/s on udp port %hu", _mode, _datarate, _network_port);
+	} else if (get_protocol() == TCP) {
+		warnx("mode: %u, data rate: %d B/s on tcp port %hu", _mode, _datarate, _network_port);
 	}
 	/* flush stdout in case MAVLink is about to take it over */
 	fflush(stdout);
@@ -1591,24 +1971,12 @@ Mavlink::task_main(int argc, char *argv[])
 	/* initialize send mutex */
 	pthread_mutex_init(&_send_mutex, NULL);
 
+	/* frames queued by this thread are flushed at the end of every loop iteration */
+	_main_thread = pthread_self();
+
 	/* initialize mavlink text message buffering */
 	mavlink_logbuffer_init(&_logbuffer, 5);
 
-	/* if we are passing on mavlink messages, we need to prepare a buffer for this instance */
-	if (_forwarding_on || _ftp_on) {
-		/* initialize message buffer if multiplexing is on or its needed for FTP.
-		 * make space for two messages plus off-by-one space as we use the empty element
-		 * marker ring buffer approach.
-		 */
-		if (OK != message_buffer_init(2 * sizeof(mavlink_message_t) + 1)) {
-			warnx("msg buf:");
-			return 1;
-		}
-
-		/* initialize message buffer mutex */
-		pthread_mutex_init(&_message_buffer_mutex, NULL);
-	}
-
 	/* create the device node that's used for sending text log messages, etc. */
 #ifdef __PX4_NUTTX
 	register_driver(MAVLINK_LOG_DEVICE, &fops, 0666, NULL);
@@ -1764,6 +2132,9 @@ Mavlink::task_main(int argc, char *argv[])
 	/* init socket if necessary */
 	if (get_protocol() == UDP) {
 		init_udp();
+
+	} else if (get_protocol() == TCP) {
+		init_tcp();
 	}
 
 	/* if the protocol is serial, we send the system version blindly */
@@ -1771,9 +2142,24 @@ Mavlink::task_main(int argc, char *argv[])
 		send_autopilot_capabilites();
 	}
 
+	hrt_abstime next_deadline = 0;
+
 	while (!_task_should_exit) {
-		/* main loop */
-		usleep(_main_loop_delay);
+		/* main loop: sleep until the next stream is due. Forwarded messages are only
+		 * buffered for a short time, so keep the loop rate up if they have to be served. */
+		hrt_abstime now = hrt_absolute_time();
+		hrt_abstime wakeup = now + ((_forwarding_on || _ftp_on) ? _main_loop_delay : MAIN_LOOP_MAX_DELAY);
+
+		if (next_deadline < wakeup) {
+			wakeup = next_deadline;
+		}
+
+		/* but never spin faster than the data rate requires, so frames still go out in batches */
+		if (wakeup < now + _main_loop_delay) {
+			wakeup = now + _main_loop_delay;
+		}
+
+		px4_usleep(wakeup - now);
 
 		perf_begin(_loop_perf);
 
@@ -1846,82 +2232,50 @@ Mavlink::task_main(int argc, char *argv[])
 					if ( get_protocol() == SERIAL ) {
 						warnx("stream %s on device %s enabled with rate %.1f Hz", _subscribe_to_stream, _device_name,
 							(double)_subscribe_to_stream_rate);
-					} else if ( get_protocol() == UDP ) {
-						warnx("stream %s on UDP port %d enabled with rate %.1f Hz", _subscribe_to_stream, _network_port,
+					} else {
+						warnx("stream %s on %s port %d enabled with rate %.1f Hz", _subscribe_to_stream,
+							(get_protocol() == UDP) ? "UDP" : "TCP", _network_port,
 							(double)_subscribe_to_stream_rate);
 					}
 
 				} else {
 					if ( get_protocol() == SERIAL ) {
 						warnx("stream %s on device %s disabled", _subscribe_to_stream, _device_name);
-					} else if ( get_protocol() == UDP ) {
-						warnx("stream %s on UDP port %d disabled", _subscribe_to_stream, _network_port);
+					} else {
+						warnx("stream %s on %s port %d disabled", _subscribe_to_stream,
+							(get_protocol() == UDP) ? "UDP" : "TCP", _network_port);
 					}
 				}
 
 			} else {
 				if ( get_protocol() == SERIAL ) {
 					warnx("stream %s on device %s not found", _subscribe_to_stream, _device_name);
-				} else if ( get_protocol() == UDP ) {
-					warnx("stream %s on UDP port %d not found", _subscribe_to_stream, _network_port);
+				} else {
+					warnx("stream %s on %s port %d not found", _subscribe_to_stream,
+						(get_protocol() == UDP) ? "UDP" : "TCP", _network_port);
 				}
 			}
 
 			_subscribe_to_stream = nullptr;
 		}
 
-		/* update streams */
-		MavlinkStream *stream;
-		LL_FOREACH(_streams, stream) {
-			stream->update(t);
-		}
-
-		/* pass messages from other UARTs or FTP worker */
-		if (_forwarding_on || _ftp_on) {
-
-			bool is_part;
-			uint8_t *read_ptr;
-			uint8_t *write_ptr;
-
-			pthread_mutex_lock(&_message_buffer_mutex);
-			int available = message_buffer_get_ptr((void **)&read_ptr, &is_part);
-			pthread_mutex_unlock(&_message_buffer_mutex);
-
-			if (available > 0) {
-				// Reconstruct message from buffer
-
-				mavlink_message_t msg;
-				write_ptr = (uint8_t *)&msg;
-
-				// Pull a single message from the buffer
-				size_t read_count = available;
-
-				if (read_count > sizeof(mavlink_message_t)) {
-					read_count = sizeof(mavlink_message_t);
-				}
+		/* update the streams that are due */
+		next_deadline = schedule_run(t);
 
-				memcpy(write_ptr, read_ptr, read_count);
-
-				// We hold the mutex until after we complete the second part of the buffer. If we don't
-				// we may end up breaking the empty slot overflow detection semantics when we mark the
-				// possibly partial read below.
-				pthread_mutex_lock(&_message_buffer_mutex);
-
-				message_buffer_mark_read(read_count);
-
-				/* write second part of buffer if there is some */
-				if (is_part && read_count < sizeof(mavlink_message_t)) {
-					write_ptr += read_count;
-					available = message_buffer_get_ptr((void **)&read_ptr, &is_part);
-					read_count = sizeof(mavlink_message_t) - read_count;
-					memcpy(write_ptr, read_ptr, read_count);
-					message_buffer_mark_read(available);
-				}
+		/* send everything queued during this iteration in one go */
+		pthread_mutex_lock(&_send_mutex);
+		tx_flush();
+		pthread_mutex_unlock(&_send_mutex);
 
-				pthread_mutex_unlock(&_message_buffer_mutex);
+		_loop_count++;
 
-				resend_message(&msg);
+		if (t > _loop_timestamp + 1000000) {
+			if (_loop_timestamp != 0) {
+				_loop_rate = _loop_count * 1000000.0f / (t - _loop_timestamp);
 			}
+
+			_loop_count = 0;
+			_loop_timestamp = t;
 		}
 
 		/* update TX/RX rates*/
@@ -1945,6 +2299,11 @@ Mavlink::task_main(int argc, char *argv[])
 		_task_running = true;
 	}
 
+	/* send what is left of the last iteration */
+	pthread_mutex_lock(&_send_mutex);
+	tx_flush();
+	pthread_mutex_unlock(&_send_mutex);
+
 	delete _subscribe_to_stream;
 	_subscribe_to_stream = nullptr;
 
@@ -1960,6 +2319,11 @@ Mavlink::task_main(int argc, char *argv[])
 
 	_streams = nullptr;
 
+	delete[] _schedule;
+	_schedule = nullptr;
+	_schedule_count = 0;
+	_schedule_size = 0;
+
 	/* delete subscriptions */
 	MavlinkOrbSubscription *sub_to_del = nullptr;
 	MavlinkOrbSubscription *sub_next = _subscriptions;
@@ -1975,6 +2339,26 @@ Mavlink::task_main(int argc, char *argv[])
 	/* wait for threads to complete */
 	pthread_join(_receive_thread, NULL);
 
+#ifdef __PX4_POSIX
+
+	if (get_protocol() == TCP) {
+		/* the receiver is gone, so nobody polls the sockets anymore */
+		for (unsigned i = 0; i < TCP_CLIENTS_MAX; i++) {
+			if (_tcp_clients[i].fd >= 0) {
+				::close(_tcp_clients[i].fd);
+				_tcp_clients[i].fd = -1;
+			}
+
+			delete[] _tcp_clients[i].buf;
+			_tcp_clients[i].buf = nullptr;
+		}
+
+		::close(_socket_fd);
+		_socket_fd = -1;
+	}
+
+#endif
+
 #ifndef __PX4_POSIX
 	/* reset the UART flags to original state */
 	tcsetattr(_uart_fd, TCSANOW, &uart_config_original);
@@ -1986,11 +2370,6 @@ Mavlink::task_main(int argc, char *argv[])
 	/* close mavlink logging device */
 	px4_close(_mavlink_fd);
 
-	if (_forwarding_on || _ftp_on) {
-		message_buffer_destroy();
-		pthread_mutex_destroy(&_message_buffer_mutex);
-	}
-
 	/* destroy log buffer */
 	mavlink_logbuffer_destroy(&_logbuffer);
 
@@ -2116,6 +2495,22 @@ Mavlink::display_status()
 	printf("\ttxerr: %.3f kB/s\n", (double)_rate_txerr);
 	printf("\trx: %.3f kB/s\n", (double)_rate_rx);
 	printf("\trate mult: %.3f\n", (double)_rate_mult);
+	printf("\tstreams: %u, main loop: %.1f Hz\n", _schedule_count, (double)_loop_rate);
+	printf("\ttx syscalls: %u, batches: %u\n", _tx_syscalls, _tx_batches);
+	printf("\tframes per batch: 1: %u, 2-3: %u, 4-7: %u, 8-15: %u, 16-31: %u, 32+: %u\n",
+	       _tx_batch_hist[0], _tx_batch_hist[1], _tx_batch_hist[2],
+	       _tx_batch_hist[3], _tx_batch_hist[4], _tx_batch_hist[5]);
+#ifdef __PX4_POSIX
+
+	if (get_protocol() == TCP) {
+		for (unsigned i = 0; i < TCP_CLIENTS_MAX; i++) {
+			if (_tcp_clients[i].fd >= 0) {
+				printf("\tTCP client %d: %u B queued\n", _tcp_clients[i].fd, _tcp_clients[i].len);
+			}
+		}
+	}
+
+#endif
 }
 
 int
@@ -2218,7 +2613,7 @@ Mavlink::stream_command(int argc, char *argv[])
 
 static void usage()
 {
-	warnx("usage: mavlink {start|stop-all|stream} [-d device] [-u udp_port] [-b baudrate]\n\t[-r rate][-m mode] [-s stream] [-f] [-p] [-v] [-w] [-x]");
+	warnx("usage: mavlink {start|stop-all|stream} [-d device] [-u udp_port] [-t tcp_port] [-b baudrate]\n\t[-r rate][-m mode] [-s stream] [-f] [-p] [-v] [-w] [-x]");
 }
 
 int mavlink_main(int argc, char *argv[])
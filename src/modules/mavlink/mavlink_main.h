@@ -46,7 +46,10 @@
 #include <nuttx/fs/fs.h>
 #else
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <drivers/device/device.h>
 #endif
@@ -122,12 +125,21 @@ public:
 
 	static bool		instance_exists(const char *device_name, Mavlink *self);
 
-	static void		forward_message(const mavlink_message_t *msg, Mavlink *self);
+	/**
+	 * Pass a received frame on to all other instances with forwarding enabled.
+	 */
+	static void		forward_frame(const uint8_t *frame, unsigned len, Mavlink *self);
 
 	static int		get_uart_fd(unsigned index);
 
 	int			get_uart_fd();
 
+	int			get_baudrate() { return _baudrate; }
+
+	bool			is_usb_uart() { return _is_usb_uart; }
+
+	int			get_data_rate() { return _datarate; }
+
 	/**
 	 * Get the MAVLink system id.
 	 *
@@ -224,9 +236,21 @@ public:
 	void			send_message(const uint8_t msgid, const void *msg, uint8_t component_ID = 0);
 
 	/**
-	 * Resend message as is, don't change sequence number and CRC.
+	 * Queue an encoded frame as is, don't change sequence number and CRC.
 	 */
-	void			resend_message(mavlink_message_t *msg);
+	void			send_frame(const uint8_t *frame, unsigned len);
+
+	/**
+	 * Queue frames sent outside of the main loop until tx_release(), so a burst of
+	 * replies goes out in one batch. Frames sent from other threads are flushed
+	 * right away otherwise, instead of waiting for the next main loop iteration.
+	 */
+	void			tx_hold();
+
+	/**
+	 * Flush the frames queued since tx_hold().
+	 */
+	void			tx_release();
 
 	void			handle_message(const mavlink_message_t *msg);
 
@@ -295,11 +319,6 @@ public:
 	bool			get_wait_to_transmit() { return _wait_to_transmit; }
 	bool			should_transmit() { return (!_wait_to_transmit || (_wait_to_transmit && _received_messages)); }
 
-	bool			message_buffer_write(const void *ptr, int size);
-
-	void			lockMessageBufferMutex(void) { pthread_mutex_lock(&_message_buffer_mutex); }
-	void			unlockMessageBufferMutex(void) { pthread_mutex_unlock(&_message_buffer_mutex); }
-
 	/**
 	 * Count a transmision error
 	 */
@@ -336,6 +355,27 @@ public:
 	int 			get_socket_fd () { return _socket_fd; };
 #ifdef __PX4_POSIX
 	struct sockaddr_in * get_client_source_address() {return &_src_addr;};
+
+	/* TCP server, the listening socket is _socket_fd */
+	static constexpr unsigned TCP_CLIENTS_MAX = 4;
+
+	/**
+	 * Get the sockets the receiver has to poll in TCP mode.
+	 *
+	 * @param fds array of at least TCP_CLIENTS_MAX + 1 entries, the listening socket comes first
+	 * @return number of entries filled in
+	 */
+	unsigned		get_tcp_poll_fds(struct pollfd *fds);
+
+	/**
+	 * Accept a pending client connection on the listening socket.
+	 */
+	void			tcp_accept();
+
+	/**
+	 * Close a client connection after it hung up or failed.
+	 */
+	void			tcp_close(int fd);
 #endif
 	static bool		boot_complete() { return _boot_complete; }
 
@@ -363,6 +403,16 @@ private:
 	MavlinkOrbSubscription	*_subscriptions;
 	MavlinkStream		*_streams;
 
+	MavlinkStream		**_schedule;		///< streams as a min-heap on their deadlines
+	unsigned		_schedule_count;
+	unsigned		_schedule_size;
+	bool			_schedule_dirty;	///< streams or their rates changed, rebuild _schedule
+	float			_stream_rate;		///< bandwidth of the rate-scaled streams, bytes/s
+	float			_stream_const_rate;	///< bandwidth of the constant rate streams, bytes/s
+	unsigned		_loop_count;		///< main loop iterations since _loop_timestamp
+	hrt_abstime		_loop_timestamp;
+	float			_loop_rate;		///< main loop iterations per second
+
 	MavlinkMissionManager		*_mission_manager;
 	MavlinkParametersManager	*_parameters_manager;
 	MavlinkFTP			*_mavlink_ftp;
@@ -419,6 +469,17 @@ private:
 	struct sockaddr_in _src_addr;
 	struct sockaddr_in _bcast_addr;
 
+	static constexpr unsigned TCP_CLIENT_BUFFER_SIZE = 16384;
+	static constexpr hrt_abstime TCP_CLIENT_TIMEOUT = 5000000;
+
+	struct tcp_client {
+		int fd;
+		uint8_t *buf;			///< output the socket did not take yet
+		unsigned len;			///< bytes queued in buf
+		hrt_abstime last_send;		///< last time the socket took any data
+	};
+
+	tcp_client		_tcp_clients[TCP_CLIENTS_MAX];
 #endif
 	int _socket_fd;
 	Protocol	_protocol;
@@ -426,18 +487,26 @@ private:
 
 	struct telemetry_status_s	_rstatus;			///< receive status
 
-	struct mavlink_message_buffer {
-		int write_ptr;
-		int read_ptr;
-		int size;
-		char *data;
-	};
-
-	mavlink_message_buffer	_message_buffer;
-
-	pthread_mutex_t		_message_buffer_mutex;
 	pthread_mutex_t		_send_mutex;
 
+	/* outgoing frames, queued by send_message() and written once per main loop iteration */
+#ifdef __PX4_NUTTX
+	static constexpr unsigned TX_BUFFER_SIZE = 1024;
+#else
+	static constexpr unsigned TX_BUFFER_SIZE = 8192;
+#endif
+	static constexpr unsigned TX_BATCH_BINS = 6;
+
+	uint8_t			_tx_buf[TX_BUFFER_SIZE];
+	unsigned		_tx_len;			///< bytes queued in _tx_buf
+	unsigned		_tx_frames;			///< frames queued in _tx_buf
+	unsigned		_tx_free;			///< free UART buffer space when the batch was started
+	unsigned		_tx_hold;			///< nesting of tx_hold(), outside of the main loop
+	pthread_t		_main_thread;			///< thread running the main loop, which flushes every iteration
+	unsigned		_tx_syscalls;			///< system calls used to transmit
+	unsigned		_tx_batches;			///< number of flushed batches
+	unsigned		_tx_batch_hist[TX_BATCH_BINS];	///< batches by frame count: 1, 2-3, 4-7, 8-15, 16-31, 32+
+
 	bool			_param_initialized;
 	param_t			_param_system_id;
 	param_t			_param_component_id;
@@ -472,27 +541,78 @@ private:
 	 */
 	void adjust_stream_rates(const float multiplier);
 
-	int message_buffer_init(int size);
+	/**
+	 * Reserve space for a frame in the TX buffer, _send_mutex must be held.
+	 *
+	 * @return pointer to write the frame to, nullptr if it has to be dropped
+	 */
+	uint8_t			*tx_reserve(unsigned len);
 
-	void message_buffer_destroy();
+	/**
+	 * Queue the frame written to the space returned by tx_reserve().
+	 */
+	void			tx_commit(unsigned len) { _tx_len += len; _tx_frames++; }
 
-	int message_buffer_count();
+	/**
+	 * Transmit all queued frames with as few system calls as possible, _send_mutex must be held.
+	 */
+	void			tx_flush();
 
-	int message_buffer_is_empty();
+	/**
+	 * Flush a frame that was just queued unless the main loop or a tx_hold() will, _send_mutex must be held.
+	 */
+	void			tx_commit_flush();
 
-	int message_buffer_get_ptr(void **ptr, bool *is_part);
+#ifdef __PX4_POSIX
+	/**
+	 * Send the TX buffer as datagrams of whole frames.
+	 *
+	 * @return number of bytes sent
+	 */
+	ssize_t			tx_send_datagrams();
 
-	void message_buffer_mark_read(int n);
+	/**
+	 * Send the TX buffer to all TCP clients, queueing what their sockets do not take.
+	 *
+	 * @return number of bytes every client got or queued
+	 */
+	ssize_t			tx_send_tcp();
 
-	void pass_message(const mavlink_message_t *msg);
+	/**
+	 * Send as much of the queued output of a TCP client as its socket takes.
+	 *
+	 * @return false if the connection failed
+	 */
+	bool			tcp_drain(tcp_client &client);
+#endif
 
 	/**
 	 * Update rate mult so total bitrate will be equal to _datarate.
 	 */
 	void update_rate_mult();
 
+	/**
+	 * Rebuild the stream schedule and the bandwidth estimate after streams were added,
+	 * removed or changed their rate.
+	 */
+	void schedule_rebuild();
+
+	/**
+	 * Restore the heap order below the schedule entry i.
+	 */
+	void schedule_sift_down(unsigned i);
+
+	/**
+	 * Update all streams that are due.
+	 *
+	 * @return the time the next stream is due
+	 */
+	hrt_abstime schedule_run(const hrt_abstime t);
+
 	void init_udp();
 
+	void init_tcp();
+
 #ifdef __PX4_NUTTX
 	static int	mavlink_dev_ioctl(struct file *filep, int cmd, unsigned long arg);
 #else
@@ -53,6 +53,12 @@ ORB_DEFINE(uavcan_parameter_value, struct uavcan_parameter_value_s);
 
 MavlinkParametersManager::MavlinkParametersManager(Mavlink *mavlink) : MavlinkStream(mavlink),
 	_send_all_index(-1),
+	_send_all_used_index(0),
+	_send_all_count(0),
+	_send_all_hash(false),
+	_send_all_matched(false),
+	_send_all_start(0),
+	_send_all_perf(perf_alloc(PC_ELAPSED, "mavlink_param_list")),
 	_rc_param_map_pub(nullptr),
 	_rc_param_map(),
 	_uavcan_parameter_request_pub(nullptr),
@@ -60,6 +66,11 @@ MavlinkParametersManager::MavlinkParametersManager(Mavlink *mavlink) : MavlinkSt
 {
 }
 
+MavlinkParametersManager::~MavlinkParametersManager()
+{
+	perf_free(_send_all_perf);
+}
+
 unsigned
 MavlinkParametersManager::get_size()
 {
@@ -78,7 +89,16 @@ MavlinkParametersManager::handle_message(const mavlink_message_t *msg)
 			if (req_list.target_system == mavlink_system.sysid &&
 			    (req_list.target_component == mavlink_system.compid || req_list.target_component == MAV_COMP_ID_ALL)) {
 
+				/* the hash goes first so a ground station with cached parameters can stop the list,
+				 * a restart of a running list is a retry and skips it */
+				if (_send_all_index < 0) {
+					_send_all_hash = true;
+					_send_all_start = hrt_absolute_time();
+				}
+
 				_send_all_index = 0;
+				_send_all_used_index = 0;
+				_send_all_count = param_count_used();
 			}
 
 			if (req_list.target_system == mavlink_system.sysid && req_list.target_component < 127 &&
@@ -111,6 +131,25 @@ MavlinkParametersManager::handle_message(const mavlink_message_t *msg)
 				strncpy(name, set.param_id, MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN);
 				/* enforce null termination */
 				name[MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN] = '\0';
+
+				if (strcmp(name, HASH_PARAM) == 0) {
+					/* the ground station has parameters with this hash cached, the list is not
+					 * needed if they are still current */
+					uint32_t hash;
+					memcpy(&hash, &set.param_value, sizeof(hash));
+
+					if (hash == param_hash_check() && (_send_all_hash || _send_all_index >= 0)) {
+						/* the list is stopped and the hash confirmed by send(), so no parameter of
+						 * the list can follow the confirmation */
+						_send_all_matched = true;
+
+					} else {
+						send_hash_check();
+					}
+
+					break;
+				}
+
 				/* attempt to find parameter, set and send it */
 				param_t param = param_find_no_notification(name);
 
@@ -166,16 +205,7 @@ MavlinkParametersManager::handle_message(const mavlink_message_t *msg)
 				if (req_read.param_index < 0) {
 					if (strncmp(req_read.param_id, HASH_PARAM, MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN) == 0) {
 						/* return hash check for cached params */
-						uint32_t hash = param_hash_check();
-
-						/* build the one-off response message */
-						mavlink_param_value_t msg;
-						msg.param_count = param_count_used();
-						msg.param_index = -1;
-						strncpy(msg.param_id, HASH_PARAM, MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN);
-						msg.param_type = MAV_PARAM_TYPE_UINT32;
-						memcpy(&msg.param_value, &hash, sizeof(hash));
-						_mavlink->send_message(MAVLINK_MSG_ID_PARAM_VALUE, &msg);
+						send_hash_check();
 					} else {
 						/* local name buffer to enforce null-terminated string */
 						char name[MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN + 1];
@@ -268,6 +298,12 @@ MavlinkParametersManager::send(const hrt_abstime t)
 {
 	bool space_available = _mavlink->get_free_tx_buf() >= get_size();
 
+	if (_send_all_matched) {
+		_send_all_matched = false;
+		send_all_done();
+		send_hash_check();
+	}
+
 	/* Send parameter values received from the UAVCAN topic */
 	if (_uavcan_parameter_value_sub < 0) {
 		_uavcan_parameter_value_sub = orb_subscribe(ORB_ID(uavcan_parameter_value));
@@ -301,20 +337,37 @@ MavlinkParametersManager::send(const hrt_abstime t)
 			return;
 		}
 
-		/* look for the first parameter which is used */
-		param_t p;
-		do {
-			/* walk through all parameters, including unused ones */
-			p = param_for_index(_send_all_index);
-			_send_all_index++;
-		} while (p != PARAM_INVALID && !param_used(p));
+		/* send as many as fit into half of the buffer, the rest is left to the other streams */
+		unsigned budget = _mavlink->get_free_tx_buf() / 2;
 
-		if (p != PARAM_INVALID) {
-			send_param(p);
+		if (budget < get_size()) {
+			budget = get_size();
 		}
 
-		if ((p == PARAM_INVALID) || (_send_all_index >= (int) param_count())) {
-			_send_all_index = -1;
+		if (_send_all_hash) {
+			send_hash_check();
+			_send_all_hash = false;
+			budget -= get_size();
+		}
+
+		while (_send_all_index >= 0 && budget >= get_size()) {
+			/* look for the next parameter which is used */
+			param_t p;
+			do {
+				/* walk through all parameters, including unused ones */
+				p = param_for_index(_send_all_index);
+				_send_all_index++;
+			} while (p != PARAM_INVALID && !param_used(p));
+
+			if (p != PARAM_INVALID) {
+				/* the indices are counted along, looking them up for each parameter takes a walk over all of them */
+				send_param(p, _send_all_used_index++, _send_all_count);
+				budget -= get_size();
+			}
+
+			if ((p == PARAM_INVALID) || (_send_all_index >= (int) param_count())) {
+				send_all_done();
+			}
 		}
 	} else if (_send_all_index == 0 && hrt_absolute_time() > 20 * 1000 * 1000) {
 		/* the boot did not seem to ever complete, warn user and set boot complete */
@@ -323,8 +376,31 @@ MavlinkParametersManager::send(const hrt_abstime t)
 	}
 }
 
+void
+MavlinkParametersManager::send_hash_check()
+{
+	uint32_t hash = param_hash_check();
+
+	/* build the one-off response message */
+	mavlink_param_value_t msg;
+	msg.param_count = param_count_used();
+	msg.param_index = -1;
+	strncpy(msg.param_id, HASH_PARAM, MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN);
+	msg.param_type = MAV_PARAM_TYPE_UINT32;
+	memcpy(&msg.param_value, &hash, sizeof(hash));
+	_mavlink->send_message(MAVLINK_MSG_ID_PARAM_VALUE, &msg);
+}
+
+void
+MavlinkParametersManager::send_all_done()
+{
+	_send_all_index = -1;
+	_send_all_hash = false;
+	perf_set(_send_all_perf, hrt_elapsed_time(&_send_all_start));
+}
+
 int
-MavlinkParametersManager::send_param(param_t param)
+MavlinkParametersManager::send_param(param_t param, int index, int count)
 {
 	if (param == PARAM_INVALID) {
 		return 1;
@@ -340,8 +416,8 @@ MavlinkParametersManager::send_param(param_t param)
 		return 2;
 	}
 
-	msg.param_count = param_count_used();
-	msg.param_index = param_get_used_index(param);
+	msg.param_count = (count < 0) ? param_count_used() : count;
+	msg.param_index = (index < 0) ? param_get_used_index(param) : index;
 
 	/* copy parameter name */
 	strncpy(msg.param_id, param_name(param), MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN);
@@ -42,6 +42,7 @@
 #pragma once
 
 #include <systemlib/param/param.h>
+#include <systemlib/perf_counter.h>
 
 #include "mavlink_bridge_header.h"
 #include "mavlink_stream.h"
@@ -102,8 +103,16 @@ public:
 	 */
 	void		start_send_all();
 
+	~MavlinkParametersManager();
+
 private:
 	int		_send_all_index;
+	int		_send_all_used_index;	///< index of the next used parameter in the list
+	int		_send_all_count;	///< number of used parameters when the list was requested
+	bool		_send_all_hash;		///< the list starts with the hash of all parameters
+	volatile bool	_send_all_matched;	///< the ground station has the parameters cached, stop the list
+	hrt_abstime	_send_all_start;	///< time the list was requested
+	perf_counter_t	_send_all_perf;		///< time from the list request until the ground station has all parameters
 
 	/* do not allow top copying this class */
 	MavlinkParametersManager(MavlinkParametersManager &);
@@ -114,7 +123,26 @@ protected:
 
 	void send(const hrt_abstime t);
 
-	int send_param(param_t param);
+	/**
+	 * Send one parameter.
+	 *
+	 * @param index		Used index of the parameter, looked up if -1
+	 * @param count		Number of used parameters, looked up if -1
+	 * @return		zero on success, 1 for an invalid parameter, 2 if the value could not be read
+	 */
+	int send_param(param_t param, int index = -1, int count = -1);
+
+	/**
+	 * Send the hash of all parameter names and values as _HASH_CHECK.
+	 *
+	 * A ground station holding parameters with the same hash can use them instead of the list.
+	 */
+	void send_hash_check();
+
+	/**
+	 * Stop the list and record how long it took to get the ground station ready.
+	 */
+	void send_all_done();
 
 	orb_advert_t _rc_param_map_pub;
 	struct rc_parameter_map_s _rc_param_map;
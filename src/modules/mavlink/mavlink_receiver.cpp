@@ -89,6 +89,8 @@ __END_DECLS
 
 static const float mg2ms2 = CONSTANTS_ONE_G / 1000.0f;
 
+static const uint8_t mavlink_message_crcs[256] = MAVLINK_MESSAGE_CRCS;
+
 MavlinkReceiver::MavlinkReceiver(Mavlink *parent) :
 	_mavlink(parent),
 	status{},
@@ -138,14 +140,37 @@ MavlinkReceiver::MavlinkReceiver(Mavlink *parent) :
 	_time_offset_avg_alpha(0.6),
 	_time_offset(0),
 	_orb_class_instance(-1),
+	_rx{},
+#ifdef __PX4_POSIX
+	_tcp_rx(nullptr),
+#endif
+	_rx_latency_perf(perf_alloc(PC_ELAPSED, "mavlink_rx_lat")),
+	_rx_crc_errors_perf(perf_alloc(PC_COUNT, "mavlink_rx_crc")),
 	_mom_switch_pos{},
 	_mom_switch_state(0)
 {
+#ifdef __PX4_POSIX
+	if (_mavlink->get_protocol() == TCP) {
+		_tcp_rx = new rx_buffer[Mavlink::TCP_CLIENTS_MAX];
+
+		if (_tcp_rx != nullptr) {
+			for (unsigned i = 0; i < Mavlink::TCP_CLIENTS_MAX; i++) {
+				_tcp_rx[i].fd = -1;
+				_tcp_rx[i].len = 0;
+			}
+		}
+	}
 
+#endif
 }
 
 MavlinkReceiver::~MavlinkReceiver()
 {
+#ifdef __PX4_POSIX
+	delete[] _tcp_rx;
+#endif
+	perf_free(_rx_latency_perf);
+	perf_free(_rx_crc_errors_perf);
 }
 
 void
@@ -1754,14 +1779,6 @@ MavlinkReceiver::receive_thread(void *arg)
 {
 
 	const int timeout = 500;
-#ifdef __PX4_POSIX
-	/* 1500 is the Wifi MTU, so we make sure to fit a full packet */
-	uint8_t buf[1600];
-#else
-	/* the serial port buffers internally as well, we just need to fit a small chunk */
-	uint8_t buf[32];
-#endif
-	mavlink_message_t msg;
 
 	struct pollfd fds[1];
 
@@ -1797,21 +1814,26 @@ MavlinkReceiver::receive_thread(void *arg)
 	ssize_t nread = 0;
 
 	while (!_mavlink->_task_should_exit) {
+#ifdef __PX4_POSIX
+		if (_mavlink->get_protocol() == TCP) {
+			receive_tcp(timeout);
+			continue;
+		}
+
+#endif
 		if (poll(&fds[0], 1, timeout) > 0) {
+			hrt_abstime t = hrt_absolute_time();
+			nread = 0;
+
 			if (_mavlink->get_protocol() == SERIAL) {
-				/* non-blocking read. read may return negative values */
-				if ((nread = ::read(uart_fd, buf, sizeof(buf))) < (ssize_t)sizeof(buf)) {
-					/* to avoid reading very small chunks wait for data before reading */
-					usleep(1000);
-				}
+				/* non-blocking read of everything there is room for. read may return negative values */
+				nread = ::read(uart_fd, &_rx.buf[_rx.len], sizeof(_rx.buf) - _rx.len);
 			}
 #ifdef __PX4_POSIX
 			if (_mavlink->get_protocol() == UDP) {
 				if (fds[0].revents & POLLIN) {
-					nread = recvfrom(_mavlink->get_socket_fd(), buf, sizeof(buf), 0, (struct sockaddr *)&srcaddr, &addrlen);
+					nread = recvfrom(_mavlink->get_socket_fd(), &_rx.buf[_rx.len], sizeof(_rx.buf) - _rx.len, 0, (struct sockaddr *)&srcaddr, &addrlen);
 				}
-			} else {
-				// could be TCP or other protocol
 			}
 
 			struct sockaddr_in * srcaddr_last = _mavlink->get_client_source_address();
@@ -1821,24 +1843,202 @@ MavlinkReceiver::receive_thread(void *arg)
 				memcpy(srcaddr_last, &srcaddr, sizeof(srcaddr));
 			}
 #endif
-			/* if read failed, this loop won't execute */
-			for (ssize_t i = 0; i < nread; i++) {
-				if (mavlink_parse_char(_mavlink->get_channel(), buf[i], &msg, &status)) {
-					/* handle generic messages and commands */
-					handle_message(&msg);
-
-					/* handle packet with parent object */
-					_mavlink->handle_message(&msg);
+			/* if read failed, there is nothing to parse */
+			if (nread > 0) {
+				_rx.len += nread;
+
+				/* send the replies to all frames of this read in one batch */
+				_mavlink->tx_hold();
+				parse_frames(_rx, t);
+				_mavlink->tx_release();
+
+				/* count received bytes */
+				_mavlink->count_rxbytes(nread);
+			}
+
+			/*
+			 * Rather than waking up for every few bytes of a frame, wait as long as the rest
+			 * of it takes at the baudrate. Complete frames are handled without any delay.
+			 */
+			if (_mavlink->get_protocol() == SERIAL) {
+				unsigned wait = frame_remaining_time(_rx);
+
+				if (wait > 0) {
+					usleep(wait);
 				}
 			}
+		}
+	}
+
+	return NULL;
+}
+
+void
+MavlinkReceiver::parse_frames(rx_buffer &rx, hrt_abstime t)
+{
+	mavlink_message_t msg;
+	unsigned pos = 0;
+
+	while (pos < rx.len) {
+		/* skip anything between frames */
+		const uint8_t *stx = (const uint8_t *)memchr(&rx.buf[pos], MAVLINK_STX, rx.len - pos);
+
+		if (stx == nullptr) {
+			pos = rx.len;
+			break;
+		}
+
+		pos = stx - rx.buf;
+
+		if (rx.len - pos < 2) {
+			break;
+		}
+
+		unsigned payload_len = rx.buf[pos + 1];
+		unsigned frame_len = payload_len + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+
+		if (rx.len - pos < frame_len) {
+			break;
+		}
+
+		const uint8_t *frame = &rx.buf[pos];
+
+		uint16_t checksum;
+		crc_init(&checksum);
+		crc_accumulate_buffer(&checksum, (const char *)&frame[1], MAVLINK_CORE_HEADER_LEN + payload_len);
+		crc_accumulate(mavlink_message_crcs[frame[5]], &checksum);
+
+		if ((checksum & 0xFF) != frame[MAVLINK_NUM_HEADER_BYTES + payload_len] ||
+		    (checksum >> 8) != frame[MAVLINK_NUM_HEADER_BYTES + payload_len + 1]) {
+			/* not a frame or a corrupted one, resync on the next STX */
+			perf_count(_rx_crc_errors_perf);
+			status.parse_error++;
+			pos++;
+			continue;
+		}
+
+		/* header and payload */
+		memcpy(&msg.magic, frame, MAVLINK_NUM_HEADER_BYTES + payload_len);
+		msg.checksum = checksum;
+
+		status.current_rx_seq = msg.seq;
+		status.packet_rx_success_count++;
+
+		/* handle generic messages and commands */
+		handle_message(&msg);
+
+		/* handle packet with parent object */
+		_mavlink->handle_message(&msg);
+
+		/* forward the frame as it was received, there is no need to encode it again */
+		if (_mavlink->get_forwarding_on()) {
+			Mavlink::forward_frame(frame, frame_len, _mavlink);
+		}
+
+		perf_set(_rx_latency_perf, hrt_elapsed_time(&t));
+
+		pos += frame_len;
+	}
+
+	/* keep the incomplete frame at the start of the buffer */
+	rx.len -= pos;
+	memmove(rx.buf, &rx.buf[pos], rx.len);
+}
+
+unsigned
+MavlinkReceiver::frame_remaining_time(const rx_buffer &rx)
+{
+	int baudrate = _mavlink->get_baudrate();
+
+	/* USB delivers whole transfers, so waiting would only add latency */
+	if (rx.len == 0 || baudrate <= 0 || _mavlink->is_usb_uart()) {
+		return 0;
+	}
+
+	unsigned frame_len = MAVLINK_NUM_NON_PAYLOAD_BYTES;
+
+	if (rx.len >= 2) {
+		frame_len += rx.buf[1];
+	}
+
+	if (frame_len <= rx.len) {
+		return 0;
+	}
+
+	/* 10 bits per byte on the wire */
+	return (uint64_t)(frame_len - rx.len) * 10 * 1000000 / baudrate;
+}
+
+#ifdef __PX4_POSIX
+void
+MavlinkReceiver::receive_tcp(int timeout)
+{
+	if (_tcp_rx == nullptr) {
+		usleep(timeout * 1000);
+		return;
+	}
+
+	struct pollfd fds[Mavlink::TCP_CLIENTS_MAX + 1];
+	unsigned count = _mavlink->get_tcp_poll_fds(fds);
+
+	if (poll(&fds[0], count, timeout) <= 0) {
+		return;
+	}
+
+	hrt_abstime t = hrt_absolute_time();
+
+	/* the listening socket comes first */
+	if (fds[0].revents & POLLIN) {
+		_mavlink->tcp_accept();
+	}
+
+	for (unsigned i = 1; i < count; i++) {
+		if (fds[i].revents == 0) {
+			continue;
+		}
+
+		/* find the receive buffer of this client, or take a free one for a new client */
+		rx_buffer *rx = nullptr;
+
+		for (unsigned j = 0; j < Mavlink::TCP_CLIENTS_MAX; j++) {
+			if (_tcp_rx[j].fd == fds[i].fd) {
+				rx = &_tcp_rx[j];
+				break;
+
+			} else if (_tcp_rx[j].fd < 0 && rx == nullptr) {
+				rx = &_tcp_rx[j];
+			}
+		}
+
+		if (rx == nullptr) {
+			continue;
+		}
+
+		if (rx->fd != fds[i].fd) {
+			rx->fd = fds[i].fd;
+			rx->len = 0;
+		}
+
+		ssize_t nread = recv(rx->fd, &rx->buf[rx->len], sizeof(rx->buf) - rx->len, MSG_DONTWAIT);
+
+		if (nread == 0 || (nread < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+			/* hung up, or shut down after a failed send */
+			_mavlink->tcp_close(rx->fd);
+			rx->fd = -1;
+			rx->len = 0;
+			continue;
+		}
+
+		if (nread > 0) {
+			rx->len += nread;
+			parse_frames(*rx, t);
 
 			/* count received bytes */
 			_mavlink->count_rxbytes(nread);
 		}
 	}
-
-	return NULL;
 }
+#endif
 
 void MavlinkReceiver::print_status()
 {
@@ -41,6 +41,7 @@
 
 #pragma once
 
+#include <drivers/drv_hrt.h>
 #include <systemlib/perf_counter.h>
 #include <uORB/uORB.h>
 #include <uORB/topics/sensor_combined.h>
@@ -140,6 +141,43 @@ private:
 
 	void *receive_thread(void *arg);
 
+	/* received bytes, the start of a frame which is not complete yet is kept at the front */
+#ifdef __PX4_POSIX
+	static constexpr unsigned RX_BUFFER_SIZE = 2048;
+#else
+	static constexpr unsigned RX_BUFFER_SIZE = 512;
+#endif
+
+	struct rx_buffer {
+		int fd;
+		unsigned len;
+		uint8_t buf[RX_BUFFER_SIZE];
+	};
+
+	/**
+	 * Handle all complete frames in the buffer.
+	 *
+	 * Frames are located by their STX and length and checked as a whole, so the bytes
+	 * of a frame are not fed through the parser one by one.
+	 *
+	 * @param t time the data was received, for the latency from arrival to publication
+	 */
+	void parse_frames(rx_buffer &rx, hrt_abstime t);
+
+	/**
+	 * Time until the rest of the incomplete frame in the buffer arrives on the UART.
+	 *
+	 * @return time to wait in us, 0 if there is no incomplete frame or the rate is unknown
+	 */
+	unsigned frame_remaining_time(const rx_buffer &rx);
+
+#ifdef __PX4_POSIX
+	/**
+	 * Wait for data from the TCP clients and handle all complete frames.
+	 */
+	void receive_tcp(int timeout);
+#endif
+
 	/**
 	 * Convert remote timestamp to local hrt time (usec)
 	 * Use timesync if available, monotonic boot time otherwise
@@ -208,6 +246,12 @@ private:
 	double _time_offset_avg_alpha;
 	uint64_t _time_offset;
 	int	_orb_class_instance;
+	rx_buffer _rx;					///< serial or UDP input
+#ifdef __PX4_POSIX
+	rx_buffer *_tcp_rx;				///< input of each TCP client
+#endif
+	perf_counter_t _rx_latency_perf;		///< time from reception until a frame is handled
+	perf_counter_t _rx_crc_errors_perf;		///< frames dropped for a bad checksum
 
 	static constexpr unsigned MOM_SWITCH_COUNT = 8;
 
@@ -47,7 +47,8 @@ MavlinkStream::MavlinkStream(Mavlink *mavlink) :
 	next(nullptr),
 	_mavlink(mavlink),
 	_interval(1000000),
-	_last_sent(0)
+	_last_sent(0),
+	_deadline(0)
 {
 }
 
@@ -64,6 +65,33 @@ MavlinkStream::set_interval(const unsigned int interval)
 	_interval = interval;
 }
 
+unsigned
+MavlinkStream::get_scaled_interval()
+{
+	unsigned int interval = _interval;
+
+	if (!const_rate()) {
+		interval /= _mavlink->get_rate_mult();
+	}
+
+	return interval;
+}
+
+/**
+ * Calculate the time the next message is due
+ */
+hrt_abstime
+MavlinkStream::update_deadline(const hrt_abstime not_before)
+{
+	_deadline = _last_sent + get_scaled_interval();
+
+	if (_deadline < not_before) {
+		_deadline = not_before;
+	}
+
+	return _deadline;
+}
+
 /**
  * Update subscriptions and send message if necessary
  */
@@ -71,11 +99,7 @@ int
 MavlinkStream::update(const hrt_abstime t)
 {
 	uint64_t dt = t - _last_sent;
-	unsigned int interval = _interval;
-
-	if (!const_rate()) {
-		interval /= _mavlink->get_rate_mult();
-	}
+	unsigned int interval = get_scaled_interval();
 
 	if (dt > 0 && dt >= interval) {
 		/* interval expired, send message */
@@ -73,6 +73,19 @@ public:
 	 * @return 0 if updated / sent, -1 if unchanged
 	 */
 	int update(const hrt_abstime t);
+
+	/**
+	 * Calculate when the next message is due, with the rate multiplier of the link applied
+	 *
+	 * @param not_before earliest time to return
+	 * @return the deadline in microseconds
+	 */
+	hrt_abstime update_deadline(const hrt_abstime not_before = 0);
+
+	/**
+	 * @return the deadline calculated by the last update_deadline() call
+	 */
+	hrt_abstime get_deadline() const { return _deadline; }
 	virtual const char *get_name() const = 0;
 	virtual uint8_t get_id() = 0;
 
@@ -96,6 +109,12 @@ protected:
 
 private:
 	hrt_abstime _last_sent;
+	hrt_abstime _deadline;
+
+	/**
+	 * @return the interval scaled by the rate multiplier of the link
+	 */
+	unsigned get_scaled_interval();
 
 	/* do not allow top copying this class */
 	MavlinkStream(const MavlinkStream &);
@@ -38,6 +38,7 @@
 #include <crc32.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <drivers/drv_hrt.h>
 
 #include "mavlink_ftp_test.h"
 #include "../mavlink_ftp.h"
@@ -554,6 +555,218 @@ bool MavlinkFtpTest::_burst_test(void)
 	return true;
 }
 
+/// @brief Tests a windowed burst download which is kept running by moving the window and which resumes after a lost packet.
+bool MavlinkFtpTest::_burst_window_test(void)
+{
+	MavlinkFTP::PayloadHeader		payload;
+	const MavlinkFTP::PayloadHeader		*reply;
+	WindowInfo				window_info;
+	mavlink_message_t			msg;
+	hrt_abstime				t = 0;
+	
+	uint8_t *bytes = _create_microsd_file(_burst_file_size);
+	ut_assert("Creating test file failed", bytes != nullptr);
+	
+	payload.opcode = MavlinkFTP::kCmdOpenFileRO;
+	payload.offset = 0;
+	
+	bool success = _send_receive_msg(&payload,				// FTP payload header
+					 strlen(_unittest_microsd_file)+1,	// size in bytes of data
+					 (uint8_t*)_unittest_microsd_file,	// Data to start into FTP message payload
+					 &reply);				// Payload inside FTP message response
+	if (!success) {
+		return false;
+	}
+	
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	
+	// Setup for window response handler, a packet in the third window gets lost
+	window_info.ftp_test_class = this;
+	window_info.file_size = _burst_file_size;
+	window_info.file_bytes = bytes;
+	window_info.received = 0;
+	window_info.next_request = MavlinkFTP::kBurstSizeMin / 2;
+	window_info.drop_offset = 20 * MavlinkFTP::kMaxDataLength;
+	window_info.window_complete = false;
+	window_info.eof = false;
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_window, &window_info);
+	
+	payload.opcode = MavlinkFTP::kCmdBurstReadFile;
+	payload.session = reply->session;
+	payload.offset = 0;
+	
+	hrt_abstime start = hrt_absolute_time();
+	unsigned resumes = 0;
+	
+	_setup_ftp_msg(&payload, 0, nullptr, &msg);
+	_ftp_server->handle_message(&msg);
+	
+	// The handler keeps the window moving, so the stream should only stop once because of the lost packet
+	for (unsigned i = 0; i < 10 && !window_info.eof; i++) {
+		window_info.window_complete = false;
+		_ftp_server->send(t);
+		
+		if (window_info.window_complete && !window_info.eof) {
+			// Resume from the lost packet
+			payload.offset = window_info.received;
+			_setup_ftp_msg(&payload, 0, nullptr, &msg);
+			_ftp_server->handle_message(&msg);
+			resumes++;
+		}
+	}
+	
+	hrt_abstime elapsed = hrt_elapsed_time(&start);
+	
+	ut_assert("Download not complete", window_info.eof);
+	ut_compare("Incorrect number of resumes", resumes, 1);
+	ut_compare("Bytes missing", window_info.received, _burst_file_size);
+	
+	warnx("burst download: %u bytes in %llu us", (unsigned)_burst_file_size, (unsigned long long)elapsed);
+	
+	// Put back generic message handler
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_generic, this);
+	
+	// Terminate session
+	payload.opcode = MavlinkFTP::kCmdTerminateSession;
+	payload.size = 0;
+	
+	success = _send_receive_msg(&payload,	// FTP payload header
+				    0,		// size in bytes of data
+				    nullptr,	// Data to start into FTP message payload
+				    &reply);	// Payload inside FTP message response
+	if (!success) {
+		return false;
+	}
+	
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	
+	delete[] bytes;
+	
+	return true;
+}
+
+/// @brief Tests a windowed burst upload which resumes after a lost packet.
+bool MavlinkFtpTest::_burst_write_test(void)
+{
+	MavlinkFTP::PayloadHeader		payload;
+	const MavlinkFTP::PayloadHeader		*reply;
+	mavlink_message_t			msg;
+	
+	// Create the file to upload, then get it out of the way of the upload
+	uint8_t *bytes = _create_microsd_file(_burst_file_size);
+	ut_assert("Creating test file failed", bytes != nullptr);
+	ut_compare("unlink failed", ::unlink(_unittest_microsd_file), 0);
+	
+	payload.opcode = MavlinkFTP::kCmdCreateFile;
+	payload.offset = 0;
+	
+	bool success = _send_receive_msg(&payload,				// FTP payload header
+					 strlen(_unittest_microsd_file)+1,	// size in bytes of data
+					 (uint8_t*)_unittest_microsd_file,	// Data to start into FTP message payload
+					 &reply);				// Payload inside FTP message response
+	if (!success) {
+		return false;
+	}
+	
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	
+	uint8_t session = reply->session;
+	uint32_t drop_offset = 20 * MavlinkFTP::kMaxDataLength;
+	uint32_t offset = 0;
+	unsigned gaps = 0;
+	
+	hrt_abstime start = hrt_absolute_time();
+	
+	while (offset < _burst_file_size) {
+		uint32_t window_end = offset + MavlinkFTP::kBurstSizeMin;
+		uint32_t resume = offset;
+		
+		if (window_end > _burst_file_size) {
+			window_end = _burst_file_size;
+		}
+		
+		for (uint32_t next = offset; next < window_end;) {
+			uint32_t size = window_end - next;
+			
+			if (size > MavlinkFTP::kMaxDataLength) {
+				size = MavlinkFTP::kMaxDataLength;
+			}
+			
+			payload.opcode = MavlinkFTP::kCmdBurstWriteFile;
+			payload.session = session;
+			payload.offset = next;
+			_setup_ftp_msg(&payload, size, &bytes[next], &msg, next + size == window_end);
+			
+			if (next == drop_offset) {
+				// Lose this one once
+				drop_offset = UINT32_MAX;
+				
+			} else {
+				memset(&_reply_msg, 0, sizeof(_reply_msg));
+				_ftp_server->handle_message(&msg);
+				reply = reinterpret_cast<const MavlinkFTP::PayloadHeader *>(_reply_msg.payload);
+				
+				// Only the end of the burst and the first packet after the gap are acked
+				if (reply->opcode != MavlinkFTP::kCmdNone) {
+					_decode_message(&_reply_msg, &reply);
+					ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+					ut_compare("Incorrect request opcode", reply->req_opcode, MavlinkFTP::kCmdBurstWriteFile);
+					
+					if (!reply->burst_complete) {
+						gaps++;
+					}
+					
+					resume = reply->offset;
+				}
+			}
+			
+			next += size;
+		}
+		
+		ut_assert("Upload makes no progress", resume > offset);
+		offset = resume;
+	}
+	
+	ut_compare("Incorrect number of gaps", gaps, 1);
+	
+	// Terminate session, this writes out the rest of the file
+	payload.opcode = MavlinkFTP::kCmdTerminateSession;
+	payload.session = session;
+	payload.size = 0;
+	
+	success = _send_receive_msg(&payload,	// FTP payload header
+				    0,		// size in bytes of data
+				    nullptr,	// Data to start into FTP message payload
+				    &reply);	// Payload inside FTP message response
+	if (!success) {
+		return false;
+	}
+	
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	
+	hrt_abstime elapsed = hrt_elapsed_time(&start);
+	warnx("burst upload: %u bytes in %llu us", (unsigned)_burst_file_size, (unsigned long long)elapsed);
+	
+	// Compare what made it to the file
+	struct stat st;
+	ut_compare("stat failed", stat(_unittest_microsd_file, &st), 0);
+	ut_compare("File size incorrect", (uint32_t)st.st_size, _burst_file_size);
+	
+	uint8_t *file_bytes = new uint8_t[_burst_file_size];
+	ut_assert("new failed", file_bytes != nullptr);
+	int fd = ::open(_unittest_microsd_file, O_RDONLY);
+	ut_assert("open failed", fd != -1);
+	int bytes_read = ::read(fd, file_bytes, _burst_file_size);
+	::close(fd);
+	ut_compare("read failed", bytes_read, (int)_burst_file_size);
+	ut_compare("File contents differ", memcmp(file_bytes, bytes, _burst_file_size), 0);
+	
+	delete[] file_bytes;
+	delete[] bytes;
+	
+	return true;
+}
+
 /// @brief Tests for correct reponse to a Read command on an invalid session.
 bool MavlinkFtpTest::_read_badsession_test(void)
 {
@@ -813,6 +1026,64 @@ bool MavlinkFtpTest::_receive_message_handler_burst(const mavlink_file_transfer_
 	return true;
 }
 
+/// Static method used as callback from MavlinkFTP for windowed burst download testing. This method will be called by
+/// MavlinkFTP when it needs to send a message out on Mavlink.
+void MavlinkFtpTest::receive_message_handler_window(const mavlink_file_transfer_protocol_t* ftp_req, void *worker_data)
+{
+	WindowInfo* window_info = (WindowInfo*)worker_data;
+	window_info->ftp_test_class->_receive_message_handler_window(ftp_req, window_info);
+}
+
+bool MavlinkFtpTest::_receive_message_handler_window(const mavlink_file_transfer_protocol_t* ftp_msg, WindowInfo* window_info)
+{
+	const MavlinkFTP::PayloadHeader* reply;
+	
+	_decode_message(ftp_msg, &reply);
+	
+	if (reply->opcode == MavlinkFTP::kRspNak) {
+		ut_compare("Incorrect error code", reply->data[0], MavlinkFTP::kErrEOF);
+		window_info->eof = true;
+		return true;
+	}
+	
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	ut_compare("Incorrect request opcode", reply->req_opcode, MavlinkFTP::kCmdBurstReadFile);
+	
+	if (reply->burst_complete) {
+		window_info->window_complete = true;
+	}
+	
+	if (reply->offset == window_info->drop_offset) {
+		// Lose this one once
+		window_info->drop_offset = UINT32_MAX;
+		return true;
+	}
+	
+	// Everything after a lost packet is of no use until the stream is resumed
+	if (reply->offset != window_info->received) {
+		return true;
+	}
+	
+	ut_compare("File contents differ", memcmp(reply->data, &window_info->file_bytes[reply->offset], reply->size), 0);
+	window_info->received += reply->size;
+	
+	// Move the window on once half of it arrived, so the stream does not have to stop
+	if (window_info->received >= window_info->next_request && window_info->received < window_info->file_size) {
+		MavlinkFTP::PayloadHeader payload;
+		mavlink_message_t msg;
+		
+		payload.opcode = MavlinkFTP::kCmdBurstReadWindow;
+		payload.session = reply->session;
+		payload.offset = window_info->received;
+		_setup_ftp_msg(&payload, 0, nullptr, &msg);
+		_ftp_server->handle_message(&msg);
+		
+		window_info->next_request = window_info->received + MavlinkFTP::kBurstSizeMin / 2;
+	}
+	
+	return true;
+}
+
 /// @brief Decode and validate the incoming message
 bool MavlinkFtpTest::_decode_message(const mavlink_file_transfer_protocol_t	*ftp_msg,	///< Incoming FTP message
 				     const MavlinkFTP::PayloadHeader		**payload)	///< Payload inside FTP message response
@@ -837,7 +1108,8 @@ bool MavlinkFtpTest::_decode_message(const mavlink_file_transfer_protocol_t	*ftp
 void MavlinkFtpTest::_setup_ftp_msg(const MavlinkFTP::PayloadHeader	*payload_header,	///< FTP payload header
 				    uint8_t				size,			///< size in bytes of data
 				    const uint8_t			*data,			///< Data to start into FTP message payload
-				    mavlink_message_t			*msg)			///< Returned mavlink message
+				    mavlink_message_t			*msg,			///< Returned mavlink message
+				    bool				burst_complete)		///< Last packet of a burst
 {
 	uint8_t payload_bytes[MAVLINK_MSG_FILE_TRANSFER_PROTOCOL_FIELD_PAYLOAD_LEN];
 	MavlinkFTP::PayloadHeader *payload = reinterpret_cast<MavlinkFTP::PayloadHeader *>(payload_bytes);
@@ -850,7 +1122,7 @@ void MavlinkFtpTest::_setup_ftp_msg(const MavlinkFTP::PayloadHeader	*payload_hea
 		memcpy(payload->data, data, size);
 	}
     
-	payload->burst_complete = 0;
+	payload->burst_complete = burst_complete;
 	payload->padding = 0;
 	
 	msg->checksum = 0;
@@ -883,6 +1155,40 @@ void MavlinkFtpTest::_cleanup_microsd(void)
 	::rmdir(_unittest_microsd_dir);
 }
 
+/// @brief Creates the test file on microsd with a known pattern
+///	@return Returns the file contents, nullptr on failure
+uint8_t *MavlinkFtpTest::_create_microsd_file(uint32_t size)
+{
+	if (::mkdir(_unittest_microsd_dir, S_IRWXU | S_IRWXG | S_IRWXO) != 0) {
+		return nullptr;
+	}
+	
+	uint8_t *bytes = new uint8_t[size];
+	if (bytes == nullptr) {
+		return nullptr;
+	}
+	
+	for (uint32_t i = 0; i < size; i++) {
+		bytes[i] = (uint8_t)(i * 7 + (i >> 8));
+	}
+	
+	int fd = ::open(_unittest_microsd_file, O_CREAT | O_EXCL | O_WRONLY, PX4_O_MODE_666);
+	if (fd < 0) {
+		delete[] bytes;
+		return nullptr;
+	}
+	
+	int bytes_written = ::write(fd, bytes, size);
+	::close(fd);
+	
+	if (bytes_written != (int)size) {
+		delete[] bytes;
+		return nullptr;
+	}
+	
+	return bytes;
+}
+
 /// @brief Runs all the unit tests
 bool MavlinkFtpTest::run_tests(void)
 {
@@ -897,6 +1203,8 @@ bool MavlinkFtpTest::run_tests(void)
 	ut_run_test(_read_test);
 	ut_run_test(_read_badsession_test);
 	ut_run_test(_burst_test);
+	ut_run_test(_burst_window_test);
+	ut_run_test(_burst_write_test);
 	ut_run_test(_removedirectory_test);
 	ut_run_test(_createdirectory_test);
 	ut_run_test(_removefile_test);
@@ -61,6 +61,20 @@ public:
 	
 	static void receive_message_handler_burst(const mavlink_file_transfer_protocol_t* ftp_req, void *worker_data);
 	
+	/// Worker data for windowed burst download handler
+	struct WindowInfo {
+		MavlinkFtpTest*		ftp_test_class;
+		uint32_t		file_size;
+		uint8_t*		file_bytes;
+		uint32_t		received;	///< all bytes before this offset were received
+		uint32_t		next_request;	///< offset at which the window is moved on next
+		uint32_t		drop_offset;	///< packet to drop to simulate a lost packet
+		bool			window_complete;
+		bool			eof;
+	};
+	
+	static void receive_message_handler_window(const mavlink_file_transfer_protocol_t* ftp_req, void *worker_data);
+	
 	static const uint8_t serverSystemId = 50;	///< System ID for server
 	static const uint8_t serverComponentId = 1;	///< Component ID for server
 	static const uint8_t serverChannel = 0;		///< Channel to send to
@@ -87,18 +101,21 @@ private:
 	bool _read_test(void);
 	bool _read_badsession_test(void);
 	bool _burst_test(void);
+	bool _burst_window_test(void);
+	bool _burst_write_test(void);
 	bool _removedirectory_test(void);
 	bool _createdirectory_test(void);
 	bool _removefile_test(void);
 	
 	void _receive_message_handler_generic(const mavlink_file_transfer_protocol_t* ftp_req);
-	void _setup_ftp_msg(const MavlinkFTP::PayloadHeader *payload_header, uint8_t size, const uint8_t *data, mavlink_message_t *msg);
+	void _setup_ftp_msg(const MavlinkFTP::PayloadHeader *payload_header, uint8_t size, const uint8_t *data, mavlink_message_t *msg, bool burst_complete = false);
 	bool _decode_message(const mavlink_file_transfer_protocol_t *ftp_msg, const MavlinkFTP::PayloadHeader **payload);
 	bool _send_receive_msg(MavlinkFTP::PayloadHeader	*payload_header,
                            uint8_t				size,
                            const uint8_t			*data,
                            const MavlinkFTP::PayloadHeader	**payload_reply);
 	void _cleanup_microsd(void);
+	uint8_t *_create_microsd_file(uint32_t size);
 	
 	/// A single download test case
 	struct DownloadTestCase {
@@ -120,6 +137,10 @@ private:
 	};
 	
 	bool _receive_message_handler_burst(const mavlink_file_transfer_protocol_t* ftp_req, BurstInfo* burst_info);
+	bool _receive_message_handler_window(const mavlink_file_transfer_protocol_t* ftp_req, WindowInfo* window_info);
+	
+	/// Size of the file moved by the windowed burst tests
+	static const uint32_t _burst_file_size = 32 * 1024;
 	
 	MavlinkFTP*	_ftp_server;
 	uint16_t	_expected_seq_number;
@@ -0,0 +1,372 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/// @file mavlink_tcp_test.cpp
+///	@brief Loopback test of the MAVLink TCP server, needs a running `mavlink start -t <port>` instance.
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <px4_posix.h>
+#include <drivers/drv_hrt.h>
+#include <uORB/uORB.h>
+#include <uORB/topics/att_pos_mocap.h>
+
+#include "mavlink_tcp_test.h"
+
+MavlinkTcpTest::MavlinkTcpTest(unsigned short port) :
+	_port(port),
+	_fd(-1),
+	_target_system(0),
+	_target_component(0)
+{
+}
+
+MavlinkTcpTest::~MavlinkTcpTest()
+{
+
+}
+
+/// @brief Called before every test to connect to the server and learn its IDs.
+void MavlinkTcpTest::_init(void)
+{
+	_fd = _connect();
+
+	mavlink_message_t msg;
+
+	if (_fd >= 0 && _receive_msg(_fd, MAVLINK_MSG_ID_HEARTBEAT, &msg)) {
+		_target_system = msg.sysid;
+		_target_component = msg.compid;
+	}
+}
+
+/// @brief Called after every test to close the connection.
+void MavlinkTcpTest::_cleanup(void)
+{
+	if (_fd >= 0) {
+		close(_fd);
+		_fd = -1;
+	}
+}
+
+/// @brief Opens a new connection to the server on localhost.
+int MavlinkTcpTest::_connect(void)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd < 0) {
+		return -1;
+	}
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(_port);
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		warnx("connecting to TCP port %hu failed", _port);
+		close(fd);
+		return -1;
+	}
+
+	int opt = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+	return fd;
+}
+
+/// @brief Sends a message to the server.
+bool MavlinkTcpTest::_send_msg(int fd, const mavlink_message_t *msg)
+{
+	uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+	uint16_t len = mavlink_msg_to_send_buffer(buf, msg);
+
+	return send(fd, buf, len, 0) == len;
+}
+
+/// @brief Reads from the server until a message with the given ID arrives.
+///	Reads byte by byte so nothing following the message is lost for the next call.
+bool MavlinkTcpTest::_receive_msg(int fd, uint8_t msgid, mavlink_message_t *msg)
+{
+	hrt_abstime deadline = hrt_absolute_time() + timeoutMs * 1000;
+	mavlink_status_t status;
+
+	while (hrt_absolute_time() < deadline) {
+		struct pollfd fds;
+		fds.fd = fd;
+		fds.events = POLLIN;
+
+		if (poll(&fds, 1, (deadline - hrt_absolute_time()) / 1000 + 1) <= 0) {
+			continue;
+		}
+
+		uint8_t c;
+
+		if (recv(fd, &c, 1, 0) != 1) {
+			return false;
+		}
+
+		if (mavlink_parse_char(clientChannel, c, msg, &status) && msg->msgid == msgid) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/// @brief Tests that a connected client gets the heartbeat of the server.
+bool MavlinkTcpTest::_heartbeat_test(void)
+{
+	ut_assert("Connection failed", _fd >= 0);
+	ut_assert("No heartbeat received", _target_system != 0);
+
+	return true;
+}
+
+/// @brief Tests that a second client is served while the first one stays connected.
+bool MavlinkTcpTest::_multiple_clients_test(void)
+{
+	ut_assert("Connection failed", _fd >= 0);
+
+	int fd = _connect();
+	ut_assert("Second connection failed", fd >= 0);
+
+	mavlink_message_t msg;
+	bool second = _receive_msg(fd, MAVLINK_MSG_ID_HEARTBEAT, &msg);
+	bool first = _receive_msg(_fd, MAVLINK_MSG_ID_HEARTBEAT, &msg);
+
+	close(fd);
+
+	ut_assert("No heartbeat on second connection", second);
+	ut_assert("No heartbeat on first connection", first);
+
+	return true;
+}
+
+/// @brief Uploads a mission and checks that every item is requested in order and the upload is acknowledged.
+bool MavlinkTcpTest::_mission_upload_test(void)
+{
+	ut_assert("Connection failed", _fd >= 0);
+	ut_assert("No heartbeat received", _target_system != 0);
+
+	mavlink_message_t msg;
+	mavlink_msg_mission_count_pack_chan(clientSystemId, clientComponentId, clientChannel, &msg,
+					    _target_system, _target_component, missionItemCount);
+	ut_assert("Sending MISSION_COUNT failed", _send_msg(_fd, &msg));
+
+	for (unsigned seq = 0; seq < missionItemCount; seq++) {
+		ut_assert("No MISSION_REQUEST received", _receive_msg(_fd, MAVLINK_MSG_ID_MISSION_REQUEST, &msg));
+
+		mavlink_mission_request_t request;
+		mavlink_msg_mission_request_decode(&msg, &request);
+		ut_compare("MISSION_REQUEST not for us", request.target_system, clientSystemId);
+		ut_compare("Unexpected item requested", request.seq, seq);
+
+		mavlink_msg_mission_item_pack_chan(clientSystemId, clientComponentId, clientChannel, &msg,
+						   _target_system, _target_component, seq,
+						   MAV_FRAME_GLOBAL_RELATIVE_ALT, MAV_CMD_NAV_WAYPOINT,
+						   seq == 0, 1,
+						   0.0f, 2.0f, 0.0f, 0.0f,
+						   47.3977f + seq * 0.0001f, 8.5456f, 10.0f);
+		ut_assert("Sending MISSION_ITEM failed", _send_msg(_fd, &msg));
+	}
+
+	ut_assert("No MISSION_ACK received", _receive_msg(_fd, MAVLINK_MSG_ID_MISSION_ACK, &msg));
+
+	mavlink_mission_ack_t ack;
+	mavlink_msg_mission_ack_decode(&msg, &ack);
+	ut_compare("Mission not accepted", ack.type, MAV_MISSION_ACCEPTED);
+
+	return true;
+}
+
+/// @brief Measures the time from sending a frame until the receiver published it, using ATT_POS_MOCAP
+///	as it is published as is and nothing acts on it unless an estimator is set up for it.
+bool MavlinkTcpTest::_latency_test(void)
+{
+	ut_assert("Connection failed", _fd >= 0);
+
+	int sub = orb_subscribe(ORB_ID(att_pos_mocap));
+	ut_assert("Subscription failed", sub >= 0);
+
+	hrt_abstime latency_min = UINT64_MAX;
+	hrt_abstime latency_max = 0;
+	hrt_abstime latency_sum = 0;
+	unsigned received = 0;
+
+	for (unsigned i = 0; i < latencySamples; i++) {
+		mavlink_message_t msg;
+		const float q[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+		mavlink_msg_att_pos_mocap_pack_chan(clientSystemId, clientComponentId, clientChannel, &msg,
+						    i, q, 0.0f, 0.0f, 0.0f);
+
+		hrt_abstime t = hrt_absolute_time();
+
+		if (!_send_msg(_fd, &msg)) {
+			break;
+		}
+
+		px4_pollfd_struct_t fds;
+		fds.fd = sub;
+		fds.events = POLLIN;
+
+		if (px4_poll(&fds, 1, 100) > 0) {
+			hrt_abstime latency = hrt_elapsed_time(&t);
+
+			struct att_pos_mocap_s mocap;
+			orb_copy(ORB_ID(att_pos_mocap), sub, &mocap);
+
+			latency_min = (latency < latency_min) ? latency : latency_min;
+			latency_max = (latency > latency_max) ? latency : latency_max;
+			latency_sum += latency;
+			received++;
+		}
+
+		/* leave some room so every sample starts with an idle receiver */
+		usleep(2000);
+	}
+
+	orb_unsubscribe(sub);
+
+	ut_compare("Frames lost", received, latencySamples);
+
+	warnx("send to publish latency: min %llu us, avg %llu us, max %llu us",
+	      (unsigned long long)latency_min, (unsigned long long)(latency_sum / received),
+	      (unsigned long long)latency_max);
+
+	return true;
+}
+
+/// @brief Downloads the parameter list, then reconnects with the parameters cached and checks that the hash check
+///	replaces the download. Prints the time until the client has all parameters in both cases.
+bool MavlinkTcpTest::_param_list_test(void)
+{
+	ut_assert("Connection failed", _fd >= 0);
+	ut_assert("No heartbeat received", _target_system != 0);
+
+	mavlink_message_t msg;
+	mavlink_param_value_t value;
+
+	hrt_abstime start = hrt_absolute_time();
+
+	mavlink_msg_param_request_list_pack_chan(clientSystemId, clientComponentId, clientChannel, &msg,
+						 _target_system, _target_component);
+	ut_assert("Sending PARAM_REQUEST_LIST failed", _send_msg(_fd, &msg));
+
+	ut_assert("No PARAM_VALUE received", _receive_msg(_fd, MAVLINK_MSG_ID_PARAM_VALUE, &msg));
+	mavlink_msg_param_value_decode(&msg, &value);
+	ut_compare("List does not start with the hash", value.param_index, UINT16_MAX);
+
+	uint32_t hash;
+	memcpy(&hash, &value.param_value, sizeof(hash));
+	unsigned count = value.param_count;
+
+	for (unsigned i = 0; i < count; i++) {
+		ut_assert("Parameter missing", _receive_msg(_fd, MAVLINK_MSG_ID_PARAM_VALUE, &msg));
+		mavlink_msg_param_value_decode(&msg, &value);
+		ut_compare("Parameter out of order", value.param_index, i);
+	}
+
+	hrt_abstime list_time = hrt_elapsed_time(&start);
+
+	/* reconnect like a ground station which keeps the parameters */
+	close(_fd);
+	_fd = _connect();
+	ut_assert("Reconnect failed", _fd >= 0);
+
+	start = hrt_absolute_time();
+
+	mavlink_msg_param_request_list_pack_chan(clientSystemId, clientComponentId, clientChannel, &msg,
+						 _target_system, _target_component);
+	ut_assert("Sending PARAM_REQUEST_LIST failed", _send_msg(_fd, &msg));
+
+	ut_assert("No PARAM_VALUE received", _receive_msg(_fd, MAVLINK_MSG_ID_PARAM_VALUE, &msg));
+	mavlink_msg_param_value_decode(&msg, &value);
+	ut_compare("List does not start with the hash", value.param_index, UINT16_MAX);
+	ut_compare("Hash changed", memcmp(&hash, &value.param_value, sizeof(hash)), 0);
+
+	mavlink_msg_param_set_pack_chan(clientSystemId, clientComponentId, clientChannel, &msg,
+					_target_system, _target_component, "_HASH_CHECK", value.param_value, MAV_PARAM_TYPE_UINT32);
+	ut_assert("Sending PARAM_SET failed", _send_msg(_fd, &msg));
+
+	/* the parameters sent before the hash matched are still coming in, in list order */
+	unsigned next = 0;
+
+	for (;;) {
+		ut_assert("Hash not confirmed", _receive_msg(_fd, MAVLINK_MSG_ID_PARAM_VALUE, &msg));
+		mavlink_msg_param_value_decode(&msg, &value);
+
+		if (value.param_index == UINT16_MAX) {
+			break;
+		}
+
+		ut_compare("Parameter out of order", value.param_index, next);
+		next++;
+	}
+
+	hrt_abstime cached_time = hrt_elapsed_time(&start);
+
+	/* the list is stopped before the hash is confirmed, nothing follows it */
+	ut_assert("List continued after the hash matched", !_receive_msg(_fd, MAVLINK_MSG_ID_PARAM_VALUE, &msg));
+
+	warnx("parameter list: %u parameters in %llu ms, cached %llu ms", count,
+	      (unsigned long long)(list_time / 1000), (unsigned long long)(cached_time / 1000));
+
+	return true;
+}
+
+bool MavlinkTcpTest::run_tests(void)
+{
+	ut_run_test(_heartbeat_test);
+	ut_run_test(_multiple_clients_test);
+	ut_run_test(_mission_upload_test);
+	ut_run_test(_latency_test);
+	ut_run_test(_param_list_test);
+
+	return (_tests_failed == 0);
+}
+
+bool mavlink_tcp_test(unsigned short port)
+{
+	MavlinkTcpTest *test = new MavlinkTcpTest(port);
+	bool success = test->run_tests();
+	test->print_results();
+	delete test;
+	return success;
+}
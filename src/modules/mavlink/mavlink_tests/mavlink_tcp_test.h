@@ -0,0 +1,82 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/// @file mavlink_tcp_test.h
+///	@brief Loopback test of the MAVLink TCP server, needs a running `mavlink start -t <port>` instance.
+
+#pragma once
+
+#include <unit_test/unit_test.h>
+#include "../mavlink_bridge_header.h"
+
+class MavlinkTcpTest : public UnitTest
+{
+public:
+	MavlinkTcpTest(unsigned short port);
+	virtual ~MavlinkTcpTest();
+
+	virtual bool run_tests(void);
+
+	static const uint8_t clientSystemId = 255;	///< System ID of the test client, as used by ground stations
+	static const uint8_t clientComponentId = 190;	///< Component ID of the test client
+	static const uint8_t clientChannel = 1;		///< Channel used to parse what the server sends
+
+	static const unsigned missionItemCount = 8;	///< Mission items uploaded by the test
+	static const unsigned timeoutMs = 3000;		///< Time to wait for an expected message
+	static const unsigned latencySamples = 200;	///< Frames sent to measure the receive latency
+
+	// We don't want any of these
+	MavlinkTcpTest(const MavlinkTcpTest&);
+	MavlinkTcpTest& operator=(const MavlinkTcpTest&);
+
+private:
+	virtual void _init(void);
+	virtual void _cleanup(void);
+
+	bool _heartbeat_test(void);
+	bool _multiple_clients_test(void);
+	bool _mission_upload_test(void);
+	bool _latency_test(void);
+	bool _param_list_test(void);
+
+	int _connect(void);
+	bool _send_msg(int fd, const mavlink_message_t *msg);
+	bool _receive_msg(int fd, uint8_t msgid, mavlink_message_t *msg);
+
+	unsigned short	_port;		///< TCP port of the server
+	int		_fd;		///< Connection to the server
+	uint8_t		_target_system;	///< System ID of the server, taken from its heartbeat
+	uint8_t		_target_component;	///< Component ID of the server, taken from its heartbeat
+};
+
+bool mavlink_tcp_test(unsigned short port);
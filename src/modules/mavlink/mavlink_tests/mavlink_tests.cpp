@@ -37,11 +37,26 @@
 
 #include <systemlib/err.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "mavlink_ftp_test.h"
+#ifdef __PX4_POSIX
+#include "mavlink_tcp_test.h"
+#endif
 
 extern "C" __EXPORT int mavlink_tests_main(int argc, char *argv[]);
 
 int mavlink_tests_main(int argc, char *argv[])
 {
+#ifdef __PX4_POSIX
+
+	/* the TCP loopback test talks to a running instance: mavlink_tests tcp [port] */
+	if (argc > 1 && !strcmp(argv[1], "tcp")) {
+		unsigned short port = (argc > 2) ? strtoul(argv[2], NULL, 10) : 5760;
+		return mavlink_tcp_test(port) ? 0 : -1;
+	}
+
+#endif
 	return mavlink_ftp_test() ? 0 : -1;
 }
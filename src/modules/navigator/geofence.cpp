@@ -70,7 +70,8 @@ Geofence::Geofence() :
 	_last_vertical_range_warning(0),
 	_altitude_min(0),
 	_altitude_max(0),
-	_vertices_count(0),
+	_polygons(),
+	_loading(),
 	_param_action(this, "ACTION"),
 	_param_altitude_mode(this, "ALTMODE"),
 	_param_source(this, "SOURCE"),
@@ -80,13 +81,15 @@ Geofence::Geofence() :
 	_outside_counter(0),
 	_mavlinkFd(-1)
 {
+	pthread_mutex_init(&_polygons_mutex, NULL);
+
 	/* Load initial params */
 	updateParams();
 }
 
 Geofence::~Geofence()
 {
-
+	pthread_mutex_destroy(&_polygons_mutex);
 }
 
 
@@ -186,71 +189,52 @@ bool Geofence::inside(double lat, double lon, float altitude)
 
 bool Geofence::inside_polygon(double lat, double lon, float altitude)
 {
-	if (valid()) {
-
-		if (!isEmpty()) {
-			/* Vertical check */
-			if (altitude > _altitude_max || altitude < _altitude_min) {
-				return false;
-			}
+	bool inside = true;
 
-			/*Horizontal check */
-			/* Adaptation of algorithm originally presented as
-			 * PNPOLY - Point Inclusion in Polygon Test
-			 * W. Randolph Franklin (WRF) */
+	pthread_mutex_lock(&_polygons_mutex);
 
-			bool c = false;
+	/* Empty or invalid fence --> accept all points */
+	if (!_polygons.isEmpty() && _polygons.isCompiled()) {
+		/* Vertical check */
+		if (altitude > _altitude_max || altitude < _altitude_min) {
+			inside = false;
 
-			struct fence_vertex_s temp_vertex_i;
-			struct fence_vertex_s temp_vertex_j;
-
-			/* Red until fence is finished */
-			for (unsigned i = 0, j = _vertices_count - 1; i < _vertices_count; j = i++) {
-				if (dm_read(DM_KEY_FENCE_POINTS, i, &temp_vertex_i, sizeof(struct fence_vertex_s)) != sizeof(struct fence_vertex_s)) {
-					break;
-				}
+		} else {
+			/* Horizontal check */
+			inside = _polygons.inside(lat, lon);
+		}
+	}
 
-				if (dm_read(DM_KEY_FENCE_POINTS, j, &temp_vertex_j, sizeof(struct fence_vertex_s)) != sizeof(struct fence_vertex_s)) {
-					break;
-				}
+	pthread_mutex_unlock(&_polygons_mutex);
 
-				// skip vertex 0 (return point)
-				if (((double)temp_vertex_i.lon >= lon) != ((double)temp_vertex_j.lon >= lon) &&
-				    (lat <= (double)(temp_vertex_j.lat - temp_vertex_i.lat) * (lon - (double)temp_vertex_i.lon) /
-				     (double)(temp_vertex_j.lon - temp_vertex_i.lon) + (double)temp_vertex_i.lat)) {
-					c = !c;
-				}
+	return inside;
+}
 
-			}
+bool
+Geofence::valid()
+{
+	pthread_mutex_lock(&_polygons_mutex);
 
-			return c;
+	// NULL fence is valid, otherwise it needs at least 3 sides
+	bool valid = _polygons.isEmpty() || _polygons.isCompiled();
 
-		} else {
-			/* Empty fence --> accept all points */
-			return true;
-		}
+	pthread_mutex_unlock(&_polygons_mutex);
 
-	} else {
-		/* Invalid fence --> accept all points */
-		return true;
+	if (!valid) {
+		warnx("Fence polygons must have at least 3 sides");
 	}
+
+	return valid;
 }
 
 bool
-Geofence::valid()
+Geofence::isEmpty()
 {
-	// NULL fence is valid
-	if (isEmpty()) {
-		return true;
-	}
-
-	// Otherwise
-	if ((_vertices_count < 4) || (_vertices_count > fence_s::GEOFENCE_MAX_VERTICES)) {
-		warnx("Fence must have at least 3 sides and not more than %d", fence_s::GEOFENCE_MAX_VERTICES - 1);
-		return false;
-	}
+	pthread_mutex_lock(&_polygons_mutex);
+	bool empty = _polygons.isEmpty();
+	pthread_mutex_unlock(&_polygons_mutex);
 
-	return true;
+	return empty;
 }
 
 void
@@ -262,7 +246,7 @@ Geofence::addPoint(int argc, char *argv[])
 	char *end;
 
 	if ((argc == 1) && (strcmp("-clear", argv[0]) == 0)) {
-		dm_clear(DM_KEY_FENCE_POINTS);
+		clearDm();
 		publishFence(0);
 		return;
 	}
@@ -291,6 +275,7 @@ Geofence::addPoint(int argc, char *argv[])
 
 	if (dm_write(DM_KEY_FENCE_POINTS, ix, DM_PERSIST_POWER_ON_RESET, &vertex, sizeof(vertex)) == sizeof(vertex)) {
 		if (last) {
+			compileFromDm((unsigned)ix + 1);
 			publishFence((unsigned)ix + 1);
 		}
 
@@ -311,6 +296,44 @@ Geofence::publishFence(unsigned vertices)
 	}
 }
 
+void
+Geofence::compileFromDm(unsigned vertices)
+{
+	struct fence_vertex_s fence[DM_KEY_FENCE_POINTS_MAX];
+
+	_loading.clear();
+
+	if (dm_read_range(DM_KEY_FENCE_POINTS, 0, vertices, fence, sizeof(struct fence_vertex_s)) != vertices) {
+		PX4_WARN("can't read fence points");
+		return;
+	}
+
+	for (unsigned i = 0; i < vertices; i++) {
+		_loading.addVertex(fence[i].lat, fence[i].lon);
+	}
+
+	if (!_loading.compile()) {
+		PX4_WARN("fence polygons must have at least 3 sides, keeping the previous fence");
+		_loading.clear();
+		return;
+	}
+
+	activateLoaded(_altitude_min, _altitude_max);
+}
+
+void
+Geofence::activateLoaded(float altitude_min, float altitude_max)
+{
+	pthread_mutex_lock(&_polygons_mutex);
+	_polygons.swap(_loading);
+	_altitude_min = altitude_min;
+	_altitude_max = altitude_max;
+	pthread_mutex_unlock(&_polygons_mutex);
+
+	/* the navigator does not use the previous fence anymore */
+	_loading.clear();
+}
+
 int
 Geofence::loadFromFile(const char *filename)
 {
@@ -320,9 +343,12 @@ Geofence::loadFromFile(const char *filename)
 	bool		gotVertical = false;
 	const char commentChar = '#';
 	int rc = ERROR;
+	float altitude_min = 0.0f;
+	float altitude_max = 0.0f;
 
-	/* Make sure no data is left in the datamanager */
-	clearDm();
+	/* Make sure no data is left in the datamanager, the fence in use is kept until the new one is loaded */
+	dm_clear(DM_KEY_FENCE_POINTS);
+	_loading.clear();
 
 	/* open the mixer definition file */
 	fp = fopen(GEOFENCE_FILENAME, "r");
@@ -354,6 +380,19 @@ Geofence::loadFromFile(const char *filename)
 		}
 
 		if (gotVertical) {
+			/* a line with include or exclude starts a new polygon, the first one is included by default */
+			if (strncmp(&line[textStart], "include", 7) == 0 || strncmp(&line[textStart], "exclude", 7) == 0) {
+				bool inclusion = (line[textStart] == 'i');
+
+				if (!_loading.beginPolygon(inclusion)) {
+					warnx("Geofence: more than %d polygons", GeofencePolygons::MAX_POLYGONS);
+					goto error;
+				}
+
+				warnx("Geofence: %s polygon %d", inclusion ? "inclusion" : "exclusion", _loading.polygonCount() - 1);
+				continue;
+			}
+
 			/* Parse the line as a geofence point */
 			struct fence_vertex_s vertex;
 
@@ -380,7 +419,8 @@ Geofence::loadFromFile(const char *filename)
 				}
 			}
 
-			if (dm_write(DM_KEY_FENCE_POINTS, pointCounter, DM_PERSIST_POWER_ON_RESET, &vertex, sizeof(vertex)) != sizeof(vertex)) {
+			if (!_loading.addVertex(vertex.lat, vertex.lon)) {
+				warnx("Geofence: more than %d points", GeofencePolygons::MAX_VERTICES);
 				goto error;
 			}
 
@@ -390,18 +430,18 @@ Geofence::loadFromFile(const char *filename)
 
 		} else {
 			/* Parse the line as the vertical limits */
-			if (sscanf(line, "%f %f", &_altitude_min, &_altitude_max) != 2) {
+			if (sscanf(line, "%f %f", &altitude_min, &altitude_max) != 2) {
 				goto error;
 			}
 
-			warnx("Geofence: alt min: %.4f, alt_max: %.4f", (double)_altitude_min, (double)_altitude_max);
+			warnx("Geofence: alt min: %.4f, alt_max: %.4f", (double)altitude_min, (double)altitude_max);
 			gotVertical = true;
 		}
 	}
 
 	/* Check if import was successful */
-	if (gotVertical && pointCounter > 0) {
-		_vertices_count = pointCounter;
+	if (gotVertical && pointCounter > 0 && _loading.compile()) {
+		activateLoaded(altitude_min, altitude_max);
 		warnx("Geofence: imported successfully");
 		mavlink_log_info(_mavlinkFd, "Geofence imported");
 		rc = OK;
@@ -412,6 +452,12 @@ Geofence::loadFromFile(const char *filename)
 	}
 
 error:
+
+	if (rc != OK) {
+		/* do not keep a partial fence, the previous one stays in use */
+		_loading.clear();
+	}
+
 	fclose(fp);
 	return rc;
 }
@@ -419,5 +465,7 @@ error:
 int Geofence::clearDm()
 {
 	dm_clear(DM_KEY_FENCE_POINTS);
+	_loading.clear();
+	activateLoaded(_altitude_min, _altitude_max);
 	return OK;
 }
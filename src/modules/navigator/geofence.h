@@ -50,6 +50,9 @@
 #include <controllib/block/BlockParam.hpp>
 #include <drivers/drv_hrt.h>
 #include <px4_defines.h>
+#include <pthread.h>
+
+#include "geofence_polygons.h"
 
 #define GEOFENCE_FILENAME PX4_ROOTFSDIR"/fs/microsd/etc/geofence.txt"
 
@@ -97,7 +100,7 @@ public:
 
 	int loadFromFile(const char *filename);
 
-	bool isEmpty() {return _vertices_count == 0;}
+	bool isEmpty();
 
 	int getAltitudeMode() { return _param_altitude_mode.get(); }
 
@@ -119,7 +122,11 @@ private:
 	float _altitude_min;
 	float _altitude_max;
 
-	uint8_t _vertices_count;
+	/* The navigator tests against _polygons while the shell commands load a new fence into
+	 * _loading, it replaces the fence in use under the mutex once it is compiled. */
+	GeofencePolygons _polygons;			/**< fence in use */
+	GeofencePolygons _loading;			/**< fence being loaded */
+	pthread_mutex_t _polygons_mutex;
 
 	/* Params */
 	control::BlockParamInt _param_action;
@@ -136,6 +143,16 @@ private:
 	bool inside(double lat, double lon, float altitude);
 	bool inside(const struct vehicle_global_position_s &global_position);
 	bool inside(const struct vehicle_global_position_s &global_position, float baro_altitude_amsl);
+
+	/**
+	 * Compile the fence from the first vertices in the dataman, which were added as points.
+	 */
+	void compileFromDm(unsigned vertices);
+
+	/**
+	 * Replace the fence in use by the one loaded, the previous fence is freed.
+	 */
+	void activateLoaded(float altitude_min, float altitude_max);
 };
 
 
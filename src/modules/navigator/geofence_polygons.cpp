@@ -0,0 +1,397 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+/**
+ * @file geofence_polygons.cpp
+ * Geofence polygons compiled for fast point-in-polygon tests
+ */
+
+#include "geofence_polygons.h"
+
+#include <string.h>
+#include <math.h>
+
+/* the number of bands grows with the number of edges, a band holds about two edges of a convex polygon */
+static constexpr unsigned MAX_BANDS_PER_POLYGON = 256;
+
+GeofencePolygons::GeofencePolygons() :
+	_polygon_count(0),
+	_lat_lon(nullptr),
+	_vertices(nullptr),
+	_vertex_count(0),
+	_vertex_capacity(0),
+	_band_offsets(nullptr),
+	_band_edges(nullptr),
+	_lat_0(0.0),
+	_lon_0(0.0),
+	_lat_scale(0.0),
+	_lon_scale(0.0),
+	_compiled(false)
+{
+	memset(_polygons, 0, sizeof(_polygons));
+}
+
+GeofencePolygons::~GeofencePolygons()
+{
+	clear();
+}
+
+template<typename T>
+static void swap_values(T &a, T &b)
+{
+	T tmp = a;
+	a = b;
+	b = tmp;
+}
+
+void
+GeofencePolygons::swap(GeofencePolygons &other)
+{
+	for (unsigned p = 0; p < MAX_POLYGONS; p++) {
+		swap_values(_polygons[p], other._polygons[p]);
+	}
+
+	swap_values(_polygon_count, other._polygon_count);
+	swap_values(_lat_lon, other._lat_lon);
+	swap_values(_vertices, other._vertices);
+	swap_values(_vertex_count, other._vertex_count);
+	swap_values(_vertex_capacity, other._vertex_capacity);
+	swap_values(_band_offsets, other._band_offsets);
+	swap_values(_band_edges, other._band_edges);
+	swap_values(_lat_0, other._lat_0);
+	swap_values(_lon_0, other._lon_0);
+	swap_values(_lat_scale, other._lat_scale);
+	swap_values(_lon_scale, other._lon_scale);
+	swap_values(_compiled, other._compiled);
+}
+
+void
+GeofencePolygons::clear()
+{
+	delete[] _lat_lon;
+	delete[] _vertices;
+	delete[] _band_offsets;
+	delete[] _band_edges;
+
+	_lat_lon = nullptr;
+	_vertices = nullptr;
+	_band_offsets = nullptr;
+	_band_edges = nullptr;
+
+	_polygon_count = 0;
+	_vertex_count = 0;
+	_vertex_capacity = 0;
+	_compiled = false;
+}
+
+bool
+GeofencePolygons::beginPolygon(bool inclusion)
+{
+	if (_polygon_count >= MAX_POLYGONS) {
+		return false;
+	}
+
+	polygon_s &polygon = _polygons[_polygon_count++];
+	memset(&polygon, 0, sizeof(polygon));
+	polygon.inclusion = inclusion;
+	polygon.first_vertex = _vertex_count;
+
+	_compiled = false;
+	return true;
+}
+
+bool
+GeofencePolygons::addVertex(double lat, double lon)
+{
+	if (_polygon_count == 0 && !beginPolygon(true)) {
+		return false;
+	}
+
+	if (_vertex_count >= MAX_VERTICES) {
+		return false;
+	}
+
+	if (_vertex_count >= _vertex_capacity) {
+		unsigned capacity = (_vertex_capacity > 0) ? _vertex_capacity * 2 : 16;
+
+		if (capacity > MAX_VERTICES) {
+			capacity = MAX_VERTICES;
+		}
+
+		double *lat_lon = new double[capacity * 2];
+
+		if (lat_lon == nullptr) {
+			return false;
+		}
+
+		if (_lat_lon != nullptr) {
+			memcpy(lat_lon, _lat_lon, _vertex_count * 2 * sizeof(double));
+			delete[] _lat_lon;
+		}
+
+		_lat_lon = lat_lon;
+		_vertex_capacity = capacity;
+	}
+
+	_lat_lon[_vertex_count * 2] = lat;
+	_lat_lon[_vertex_count * 2 + 1] = lon;
+	_vertex_count++;
+	_polygons[_polygon_count - 1].vertex_count++;
+
+	_compiled = false;
+	return true;
+}
+
+bool
+GeofencePolygons::compile()
+{
+	delete[] _vertices;
+	delete[] _band_offsets;
+	delete[] _band_edges;
+	_vertices = nullptr;
+	_band_offsets = nullptr;
+	_band_edges = nullptr;
+	_compiled = false;
+
+	if (_polygon_count == 0) {
+		return false;
+	}
+
+	for (unsigned p = 0; p < _polygon_count; p++) {
+		if (_polygons[p].vertex_count < 3) {
+			return false;
+		}
+	}
+
+	/* the local frame is centered on the fence to keep the float positions accurate */
+	double lat_min = _lat_lon[0], lat_max = _lat_lon[0];
+	double lon_min = _lat_lon[1], lon_max = _lat_lon[1];
+
+	for (unsigned i = 1; i < _vertex_count; i++) {
+		double lat = _lat_lon[i * 2];
+		double lon = _lat_lon[i * 2 + 1];
+		lat_min = (lat < lat_min) ? lat : lat_min;
+		lat_max = (lat > lat_max) ? lat : lat_max;
+		lon_min = (lon < lon_min) ? lon : lon_min;
+		lon_max = (lon > lon_max) ? lon : lon_max;
+	}
+
+	_lat_0 = (lat_min + lat_max) / 2.0;
+	_lon_0 = (lon_min + lon_max) / 2.0;
+	_lat_scale = M_DEG_TO_RAD * CONSTANTS_RADIUS_OF_EARTH;
+	_lon_scale = _lat_scale * cos(_lat_0 * M_DEG_TO_RAD);
+
+	_vertices = new vertex_s[_vertex_count];
+
+	if (_vertices == nullptr) {
+		return false;
+	}
+
+	for (unsigned i = 0; i < _vertex_count; i++) {
+		project(_lat_lon[i * 2], _lat_lon[i * 2 + 1], _vertices[i].x, _vertices[i].y);
+	}
+
+	/* bounding boxes and band layout */
+	unsigned total_bands = 0;
+
+	for (unsigned p = 0; p < _polygon_count; p++) {
+		polygon_s &polygon = _polygons[p];
+		const vertex_s *v = &_vertices[polygon.first_vertex];
+
+		polygon.x_min = polygon.x_max = v[0].x;
+		polygon.y_min = polygon.y_max = v[0].y;
+
+		for (unsigned i = 1; i < polygon.vertex_count; i++) {
+			polygon.x_min = (v[i].x < polygon.x_min) ? v[i].x : polygon.x_min;
+			polygon.x_max = (v[i].x > polygon.x_max) ? v[i].x : polygon.x_max;
+			polygon.y_min = (v[i].y < polygon.y_min) ? v[i].y : polygon.y_min;
+			polygon.y_max = (v[i].y > polygon.y_max) ? v[i].y : polygon.y_max;
+		}
+
+		polygon.band_count = polygon.vertex_count / 2;
+
+		if (polygon.band_count > MAX_BANDS_PER_POLYGON) {
+			polygon.band_count = MAX_BANDS_PER_POLYGON;
+		}
+
+		float width = polygon.y_max - polygon.y_min;
+		polygon.band_scale = (width > 0.0f) ? polygon.band_count / width : 0.0f;
+		polygon.first_band = total_bands + p;
+		total_bands += polygon.band_count;
+	}
+
+	/* each polygon has one offset more than bands, the last one is the end of its last band */
+	_band_offsets = new uint32_t[total_bands + _polygon_count];
+
+	if (_band_offsets == nullptr) {
+		return false;
+	}
+
+	memset(_band_offsets, 0, (total_bands + _polygon_count) * sizeof(uint32_t));
+
+	/* count the edges in each band, stored one band further to turn them into offsets */
+	for (unsigned p = 0; p < _polygon_count; p++) {
+		const polygon_s &polygon = _polygons[p];
+		const vertex_s *v = &_vertices[polygon.first_vertex];
+		uint32_t *offsets = &_band_offsets[polygon.first_band];
+
+		for (unsigned i = 0, j = polygon.vertex_count - 1; i < polygon.vertex_count; j = i++) {
+			unsigned first = bandIndex(polygon, (v[i].y < v[j].y) ? v[i].y : v[j].y);
+			unsigned last = bandIndex(polygon, (v[i].y < v[j].y) ? v[j].y : v[i].y);
+
+			for (unsigned b = first; b <= last; b++) {
+				offsets[b + 1]++;
+			}
+		}
+	}
+
+	uint32_t entries = 0;
+
+	for (unsigned p = 0; p < _polygon_count; p++) {
+		const polygon_s &polygon = _polygons[p];
+		uint32_t *offsets = &_band_offsets[polygon.first_band];
+
+		offsets[0] = entries;
+
+		for (unsigned b = 1; b <= polygon.band_count; b++) {
+			entries += offsets[b];
+			offsets[b] = entries;
+		}
+	}
+
+	_band_edges = new uint16_t[entries];
+
+	if (_band_edges == nullptr) {
+		return false;
+	}
+
+	/* fill the bands, using the start offset of each band as its write position */
+	for (unsigned p = 0; p < _polygon_count; p++) {
+		const polygon_s &polygon = _polygons[p];
+		const vertex_s *v = &_vertices[polygon.first_vertex];
+		uint32_t *offsets = &_band_offsets[polygon.first_band];
+
+		for (unsigned i = 0, j = polygon.vertex_count - 1; i < polygon.vertex_count; j = i++) {
+			unsigned first = bandIndex(polygon, (v[i].y < v[j].y) ? v[i].y : v[j].y);
+			unsigned last = bandIndex(polygon, (v[i].y < v[j].y) ? v[j].y : v[i].y);
+
+			for (unsigned b = first; b <= last; b++) {
+				_band_edges[offsets[b]++] = i;
+			}
+		}
+
+		/* every start has moved to the next band's start, move them back */
+		for (unsigned b = polygon.band_count; b > 0; b--) {
+			offsets[b] = offsets[b - 1];
+		}
+
+		offsets[0] = (p == 0) ? 0 : _band_offsets[_polygons[p - 1].first_band + _polygons[p - 1].band_count];
+	}
+
+	_compiled = true;
+	return true;
+}
+
+unsigned
+GeofencePolygons::bandIndex(const polygon_s &polygon, float y) const
+{
+	float band = (y - polygon.y_min) * polygon.band_scale;
+
+	if (!(band > 0.0f)) {
+		return 0;
+	}
+
+	if (band >= polygon.band_count) {
+		return polygon.band_count - 1;
+	}
+
+	return (unsigned)band;
+}
+
+bool
+GeofencePolygons::insidePolygon(const polygon_s &polygon, float x, float y) const
+{
+	if (x < polygon.x_min || x > polygon.x_max || y < polygon.y_min || y > polygon.y_max) {
+		return false;
+	}
+
+	/* Adaptation of algorithm originally presented as
+	 * PNPOLY - Point Inclusion in Polygon Test
+	 * W. Randolph Franklin (WRF)
+	 * only the edges of the band the point is in can cross the ray along x */
+	const vertex_s *v = &_vertices[polygon.first_vertex];
+	unsigned band = polygon.first_band + bandIndex(polygon, y);
+	bool c = false;
+
+	for (uint32_t e = _band_offsets[band]; e < _band_offsets[band + 1]; e++) {
+		unsigned i = _band_edges[e];
+		unsigned j = (i == 0) ? polygon.vertex_count - 1 : i - 1;
+
+		if (((v[i].y >= y) != (v[j].y >= y)) &&
+		    (x <= (v[j].x - v[i].x) * (y - v[i].y) / (v[j].y - v[i].y) + v[i].x)) {
+			c = !c;
+		}
+	}
+
+	return c;
+}
+
+bool
+GeofencePolygons::inside(double lat, double lon) const
+{
+	if (!_compiled) {
+		return true;
+	}
+
+	float x, y;
+	project(lat, lon, x, y);
+
+	bool has_inclusion = false;
+	bool included = false;
+
+	for (unsigned p = 0; p < _polygon_count; p++) {
+		const polygon_s &polygon = _polygons[p];
+
+		if (polygon.inclusion) {
+			has_inclusion = true;
+
+			if (!included && insidePolygon(polygon, x, y)) {
+				included = true;
+			}
+
+		} else if (insidePolygon(polygon, x, y)) {
+			return false;
+		}
+	}
+
+	return !has_inclusion || included;
+}
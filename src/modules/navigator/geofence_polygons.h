@@ -0,0 +1,158 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+/**
+ * @file geofence_polygons.h
+ * Geofence polygons compiled for fast point-in-polygon tests
+ *
+ * The polygons are scaled into a local frame in metres once when the fence is loaded.
+ * The scaling is linear in latitude and longitude, so the edges are the same as
+ * those of the polygon in geographic coordinates.
+ * Each polygon gets a bounding box and its edges are sorted into bands along the
+ * east axis, so a test only looks at the edges which can cross the point's band.
+ */
+
+#ifndef GEOFENCE_POLYGONS_H_
+#define GEOFENCE_POLYGONS_H_
+
+#include <stdint.h>
+#include <geo/geo.h>
+
+class GeofencePolygons
+{
+public:
+	GeofencePolygons();
+	~GeofencePolygons();
+
+	static constexpr unsigned MAX_POLYGONS = 8;
+	static constexpr unsigned MAX_VERTICES = 4096;
+
+	/**
+	 * Remove all polygons.
+	 */
+	void clear();
+
+	/**
+	 * Start a new polygon, the following vertices are added to it.
+	 *
+	 * @param inclusion true: the vehicle has to stay inside, false: the vehicle has to stay outside
+	 * @return false if there are too many polygons
+	 */
+	bool beginPolygon(bool inclusion);
+
+	/**
+	 * Add a vertex to the current polygon, vertices before the first polygon start an inclusion polygon.
+	 *
+	 * @return false if there are too many vertices or no memory
+	 */
+	bool addVertex(double lat, double lon);
+
+	/**
+	 * Project the vertices and build the edge index, needs to be called after the last vertex.
+	 *
+	 * @return false if a polygon has less than 3 vertices or there is no memory
+	 */
+	bool compile();
+
+	/**
+	 * Exchange the polygons with another set, to replace a fence in use by one that was compiled separately.
+	 */
+	void swap(GeofencePolygons &other);
+
+	/**
+	 * Whether a point is inside any inclusion polygon (if there is one) and outside of all exclusion polygons.
+	 *
+	 * @return true if the point is inside the fence or there is no fence
+	 */
+	bool inside(double lat, double lon) const;
+
+	bool isEmpty() const { return _polygon_count == 0; }
+
+	bool isCompiled() const { return _compiled; }
+
+	unsigned polygonCount() const { return _polygon_count; }
+
+	unsigned vertexCount() const { return _vertex_count; }
+
+private:
+	struct vertex_s {
+		float x;	/**< north (m) */
+		float y;	/**< east (m) */
+	};
+
+	struct polygon_s {
+		bool inclusion;
+		uint16_t first_vertex;
+		uint16_t vertex_count;
+		float x_min, x_max;
+		float y_min, y_max;
+		float band_scale;	/**< bands per m along the east axis */
+		uint16_t band_count;
+		uint32_t first_band;	/**< first entry of this polygon in _band_offsets */
+	};
+
+	polygon_s _polygons[MAX_POLYGONS];
+	unsigned _polygon_count;
+
+	/* added vertices in geographic coordinates and their local positions once compiled */
+	double *_lat_lon;
+	vertex_s *_vertices;
+	unsigned _vertex_count;
+	unsigned _vertex_capacity;
+
+	/* for each band the edges crossing it, edge i goes from vertex i - 1 to vertex i */
+	uint32_t *_band_offsets;
+	uint16_t *_band_edges;
+
+	/* local frame origin and scale (m/deg) */
+	double _lat_0;
+	double _lon_0;
+	double _lat_scale;
+	double _lon_scale;
+	bool _compiled;
+
+	void project(double lat, double lon, float &x, float &y) const
+	{
+		x = (float)((lat - _lat_0) * _lat_scale);
+		y = (float)((lon - _lon_0) * _lon_scale);
+	}
+
+	unsigned bandIndex(const polygon_s &polygon, float y) const;
+
+	bool insidePolygon(const polygon_s &polygon, float x, float y) const;
+
+	/* do not allow copying this class */
+	GeofencePolygons(const GeofencePolygons &);
+	GeofencePolygons operator=(const GeofencePolygons &);
+};
+
+#endif /* GEOFENCE_POLYGONS_H_ */
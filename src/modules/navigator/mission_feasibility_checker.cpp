@@ -55,11 +55,39 @@ MissionFeasibilityChecker::MissionFeasibilityChecker() :
 	_mavlink_fd(-1),
 	_capabilities_sub(-1),
 	_initDone(false),
-	_dist_1wp_ok(false)
+	_dist_1wp_ok(false),
+	_items_dm(DM_KEY_NUM_KEYS),
+	_items_first(0),
+	_items_count(0)
 {
 	_nav_caps = {0};
 }
 
+bool MissionFeasibilityChecker::readMissionItem(dm_item_t dm_current, size_t nMissionItems, size_t index,
+	struct mission_item_s &missionitem)
+{
+	if (index >= nMissionItems) {
+		return false;
+	}
+
+	if (dm_current != _items_dm || index < _items_first || index >= _items_first + _items_count) {
+		size_t count = math::min((size_t)READ_CHUNK_ITEMS, nMissionItems - index);
+		ssize_t ret = dm_read_range(dm_current, index, count, _items, sizeof(struct mission_item_s));
+
+		if (ret <= 0) {
+			_items_count = 0;
+			return false;
+		}
+
+		_items_dm = dm_current;
+		_items_first = index;
+		_items_count = ret;
+	}
+
+	missionitem = _items[index - _items_first];
+	return true;
+}
+
 
 bool MissionFeasibilityChecker::checkMissionFeasible(int mavlink_fd, bool isRotarywing,
 	dm_item_t dm_current, size_t nMissionItems, Geofence &geofence,
@@ -72,6 +100,9 @@ bool MissionFeasibilityChecker::checkMissionFeasible(int mavlink_fd, bool isRota
 
 	_mavlink_fd = mavlink_fd;
 
+	/* the mission may have changed since the last check */
+	_items_count = 0;
+
 	// first check if we have a valid position
 	if (!home_valid /* can later use global / local pos for finer granularity */) {
 		failed = true;
@@ -123,9 +154,8 @@ bool MissionFeasibilityChecker::checkGeofence(dm_item_t dm_current, size_t nMiss
 	if (geofence.valid()) {
 		for (size_t i = 0; i < nMissionItems; i++) {
 			struct mission_item_s missionitem;
-			const ssize_t len = sizeof(missionitem);
 
-			if (dm_read(dm_current, i, &missionitem, len) != len) {
+			if (!readMissionItem(dm_current, nMissionItems, i, missionitem)) {
 				/* not supposed to happen unless the datamanager can't access the SD card, etc. */
 				return false;
 			}
@@ -146,9 +176,8 @@ bool MissionFeasibilityChecker::checkHomePositionAltitude(dm_item_t dm_current,
 	/* Check if all all waypoints are above the home altitude, only return false if bool throw_error = true */
 	for (size_t i = 0; i < nMissionItems; i++) {
 		struct mission_item_s missionitem;
-		const ssize_t len = sizeof(struct mission_item_s);
 
-		if (dm_read(dm_current, i, &missionitem, len) != len) {
+		if (!readMissionItem(dm_current, nMissionItems, i, missionitem)) {
 			warning_issued = true;
 			/* not supposed to happen unless the datamanager can't access the SD card, etc. */
 			return false;
@@ -185,9 +214,8 @@ bool MissionFeasibilityChecker::checkMissionItemValidity(dm_item_t dm_current, s
 	// do not allow mission if we find unsupported item
 	for (size_t i = 0; i < nMissionItems; i++) {
 		struct mission_item_s missionitem;
-		const ssize_t len = sizeof(struct mission_item_s);
 
-		if (dm_read(dm_current, i, &missionitem, len) != len) {
+		if (!readMissionItem(dm_current, nMissionItems, i, missionitem)) {
 			// not supposed to happen unless the datamanager can't access the SD card, etc.
 			mavlink_log_critical(_mavlink_fd, "Rejecting Mission: Cannot access SD card");
 			return false;
@@ -221,8 +249,7 @@ bool MissionFeasibilityChecker::checkFixedWingLanding(dm_item_t dm_current, size
 
 	for (size_t i = 0; i < nMissionItems; i++) {
 		struct mission_item_s missionitem;
-		const ssize_t len = sizeof(missionitem);
-		if (dm_read(dm_current, i, &missionitem, len) != len) {
+		if (!readMissionItem(dm_current, nMissionItems, i, missionitem)) {
 			/* not supposed to happen unless the datamanager can't access the SD card, etc. */
 			return false;
 		}
@@ -230,7 +257,7 @@ bool MissionFeasibilityChecker::checkFixedWingLanding(dm_item_t dm_current, size
 		if (missionitem.nav_cmd == NAV_CMD_LAND) {
 			struct mission_item_s missionitem_previous;
 			if (i != 0) {
-				if (dm_read(dm_current, i-1, &missionitem_previous, len) != len) {
+				if (!readMissionItem(dm_current, nMissionItems, i-1, missionitem_previous)) {
 					/* not supposed to happen unless the datamanager can't access the SD card, etc. */
 					return false;
 				}
@@ -295,8 +322,7 @@ MissionFeasibilityChecker::check_dist_1wp(dm_item_t dm_current, size_t nMissionI
 
 		/* find first waypoint (with lat/lon) item in datamanager */
 		for (unsigned i = 0; i < nMissionItems; i++) {
-			if (dm_read(dm_current, i,
-					&mission_item, sizeof(mission_item_s)) == sizeof(mission_item_s)) {
+			if (readMissionItem(dm_current, nMissionItems, i, mission_item)) {
 				/* Check non navigation item */
 				if (mission_item.nav_cmd == NAV_CMD_DO_SET_SERVO){
 
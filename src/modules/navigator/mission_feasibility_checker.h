@@ -60,6 +60,15 @@ private:
 	bool _dist_1wp_ok;
 	void init();
 
+	/* Mission items are fetched from the dataman in chunks, the checks below go through them one by one */
+	static constexpr unsigned READ_CHUNK_ITEMS = 8;
+	struct mission_item_s _items[READ_CHUNK_ITEMS];
+	dm_item_t _items_dm;
+	size_t _items_first;
+	size_t _items_count;
+
+	bool readMissionItem(dm_item_t dm_current, size_t nMissionItems, size_t index, struct mission_item_s &missionitem);
+
 	/* Checks for all airframes */
 	bool checkGeofence(dm_item_t dm_current, size_t nMissionItems, Geofence &geofence);
 	bool checkHomePositionAltitude(dm_item_t dm_current, size_t nMissionItems, float home_alt, bool home_valid, bool &warning_issued, bool throw_error = false);
@@ -50,13 +50,14 @@ int logbuffer_init(struct logbuffer_s *lb, int size)
 	lb->size  = size;
 	lb->write_ptr = 0;
 	lb->read_ptr = 0;
+	lb->max_count = 0;
 	lb->data = NULL;
 	return PX4_OK;
 }
 
 int logbuffer_count(struct logbuffer_s *lb)
 {
-	int n = lb->write_ptr - lb->read_ptr;
+	int n = __atomic_load_n(&lb->write_ptr, __ATOMIC_ACQUIRE) - __atomic_load_n(&lb->read_ptr, __ATOMIC_ACQUIRE);
 
 	if (n < 0) {
 		n += lb->size;
@@ -67,7 +68,7 @@ int logbuffer_count(struct logbuffer_s *lb)
 
 int logbuffer_is_empty(struct logbuffer_s *lb)
 {
-	return lb->read_ptr == lb->write_ptr;
+	return __atomic_load_n(&lb->read_ptr, __ATOMIC_ACQUIRE) == __atomic_load_n(&lb->write_ptr, __ATOMIC_ACQUIRE);
 }
 
 bool logbuffer_write(struct logbuffer_s *lb, void *ptr, int size)
@@ -82,8 +83,9 @@ bool logbuffer_write(struct logbuffer_s *lb, void *ptr, int size)
 		return false;
 	}
 
-	// bytes available to write
-	int available = lb->read_ptr - lb->write_ptr - 1;
+	// the consumer may free space concurrently, this only ever underestimates it
+	int write_ptr = lb->write_ptr;
+	int available = __atomic_load_n(&lb->read_ptr, __ATOMIC_ACQUIRE) - write_ptr - 1;
 
 	if (available < 0) {
 		available += lb->size;
@@ -95,12 +97,12 @@ bool logbuffer_write(struct logbuffer_s *lb, void *ptr, int size)
 	}
 
 	char *c = (char *) ptr;
-	int n = lb->size - lb->write_ptr;	// bytes to end of the buffer
+	int n = lb->size - write_ptr;	// bytes to end of the buffer
 
 	if (n < size) {
 		// message goes over end of the buffer
-		memcpy(&(lb->data[lb->write_ptr]), c, n);
-		lb->write_ptr = 0;
+		memcpy(&(lb->data[write_ptr]), c, n);
+		write_ptr = 0;
 
 	} else {
 		n = 0;
@@ -108,15 +110,25 @@ bool logbuffer_write(struct logbuffer_s *lb, void *ptr, int size)
 
 	// now: n = bytes already written
 	int p = size - n;	// number of bytes to write
-	memcpy(&(lb->data[lb->write_ptr]), &(c[n]), p);
-	lb->write_ptr = (lb->write_ptr + p) % lb->size;
+	memcpy(&(lb->data[write_ptr]), &(c[n]), p);
+
+	// publish the message to the consumer only after its bytes are in place
+	__atomic_store_n(&lb->write_ptr, (write_ptr + p) % lb->size, __ATOMIC_RELEASE);
+
+	int count = lb->size - 1 - available + size;
+
+	if (count > lb->max_count) {
+		lb->max_count = count;
+	}
+
 	return true;
 }
 
 int logbuffer_get_ptr(struct logbuffer_s *lb, void **ptr, bool *is_part)
 {
 	// bytes available to read
-	int available = lb->write_ptr - lb->read_ptr;
+	int write_ptr = __atomic_load_n(&lb->write_ptr, __ATOMIC_ACQUIRE);
+	int available = write_ptr - lb->read_ptr;
 
 	if (available == 0) {
 		return 0;	// buffer is empty
@@ -132,7 +144,7 @@ int logbuffer_get_ptr(struct logbuffer_s *lb, void **ptr, bool *is_part)
 	} else {
 		// read pointer is after write pointer, read bytes from read_ptr to end of the buffer
 		n = lb->size - lb->read_ptr;
-		*is_part = lb->write_ptr > 0;
+		*is_part = write_ptr > 0;
 	}
 
 	*ptr = &(lb->data[lb->read_ptr]);
@@ -141,5 +153,6 @@ int logbuffer_get_ptr(struct logbuffer_s *lb, void **ptr, bool *is_part)
 
 void logbuffer_mark_read(struct logbuffer_s *lb, int n)
 {
-	lb->read_ptr = (lb->read_ptr + n) % lb->size;
+	// hand the space back to the producer only after the data has been consumed
+	__atomic_store_n(&lb->read_ptr, (lb->read_ptr + n) % lb->size, __ATOMIC_RELEASE);
 }
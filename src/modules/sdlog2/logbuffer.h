@@ -37,6 +37,12 @@
  *
  * Ring FIFO buffer for binary log data.
  *
+ * The buffer is a single-producer / single-consumer queue: the logging
+ * thread only ever moves write_ptr and the writer thread only ever moves
+ * read_ptr, so neither side needs a lock. The two indices live on separate
+ * cache lines to keep the threads from invalidating each other's line on
+ * every message.
+ *
  * @author Anton Babushkin <anton.babushkin@me.com>
  */
 
@@ -45,11 +51,20 @@
 
 #include <stdbool.h>
 
+#define LOGBUFFER_CACHE_LINE	64
+
 struct logbuffer_s {
 	// pointers and size are in bytes
-	int write_ptr;
-	int read_ptr;
-	int size;
+
+	/* owned by the producer */
+	int write_ptr __attribute__((aligned(LOGBUFFER_CACHE_LINE)));
+	int max_count;	/**< highest fill level seen by logbuffer_write() */
+
+	/* owned by the consumer */
+	int read_ptr __attribute__((aligned(LOGBUFFER_CACHE_LINE)));
+
+	/* constant while logging */
+	int size __attribute__((aligned(LOGBUFFER_CACHE_LINE)));
 	char *data;
 };
 
@@ -108,6 +108,7 @@
 #include <uORB/topics/vtol_vehicle_status.h>
 #include <uORB/topics/time_offset.h>
 #include <uORB/topics/mc_att_ctrl_status.h>
+#include <uORB/topics/logger_status.h>
 
 #include <systemlib/systemlib.h>
 #include <systemlib/param/param.h>
@@ -139,8 +140,13 @@ static bool logwriter_should_exit = false;	/**< Logwriter thread exit flag */
 static const unsigned MAX_NO_LOGFOLDER = 999;	/**< Maximum number of log dirs */
 static const unsigned MAX_NO_LOGFILE = 999;		/**< Maximum number of log files */
 static const int LOG_BUFFER_SIZE_DEFAULT = 8192;
-static const int MAX_WRITE_CHUNK = 512;
-static const int MIN_BYTES_TO_WRITE = 512;
+static const int LOG_WRITE_BLOCK = 4096;		/**< Log file writes are multiples of this size */
+static const hrt_abstime LOG_FLUSH_INTERVAL = 1000000;	/**< Longest time data waits for a full block */
+static const hrt_abstime LOG_SYNC_INTERVAL = 1000000;	/**< Minimum time between two fsync() calls */
+static const hrt_abstime LOG_STATUS_INTERVAL = 1000000;	/**< Period of the logger_status topic */
+static const hrt_abstime LOG_DISCOVER_INTERVAL = 1000000;	/**< Period to look for new topics in event mode */
+static const int LOG_POLL_TIMEOUT_MS = 100;		/**< Longest sleep in event mode */
+#define LOG_POLL_MAX 48					/**< Maximum number of topics in the poll set */
 
 static bool _extended_logging = false;
 static bool _gpstime_only = false;
@@ -151,9 +157,10 @@ static const char *log_root = MOUNTPOINT "/log";
 static int mavlink_fd = -1;
 struct logbuffer_s lb;
 
-/* mutex / condition to synchronize threads */
+/* mutex / condition to wake up the writer thread, the buffer itself is lock-free */
 static pthread_mutex_t logbuffer_mutex;
 static pthread_cond_t logbuffer_cond;
+static bool logwriter_waiting = false;
 
 static char log_dir[32];
 
@@ -184,11 +191,35 @@ static pthread_attr_t logwriter_attr;
 
 static perf_counter_t perf_write;
 
+/* event-driven logging (-p option): block on the logged topics instead of sleeping */
+static bool log_event_driven = false;
+/* per-topic rate cap in event mode, in ms */
+static unsigned log_interval_ms = 0;
+/* poll set of all logged topics, filled as topics get subscribed */
+static px4_pollfd_struct_t log_fds[LOG_POLL_MAX];
+static unsigned log_fds_count = 0;
+/* poll set slot + 1 of each subscription handle, 0 if not in the set */
+static uint8_t *log_fds_slot = NULL;
+static int log_fds_slot_size = 0;
+#ifdef __PX4_POSIX
+/* log_fds registered with the topics across wakeups, rebuilt when a topic is added */
+static px4_pollset_t *log_pollset = NULL;
+#endif
+/* true while the revents of log_fds are the current update state */
+static bool log_poll_valid = false;
+/* try to subscribe to topics not published yet */
+static bool log_discover = true;
+
 /**
  * Log buffer writing thread. Open and close file here.
  */
 static void *logwriter_thread(void *arg);
 
+/**
+ * Wake up the log buffer writing thread if it sleeps and has enough data to write.
+ */
+static void logwriter_wakeup(bool force);
+
 /**
  * SD log management function.
  */
@@ -197,6 +228,22 @@ __EXPORT int sdlog2_main(int argc, char *argv[]);
 static bool copy_if_updated(orb_id_t topic, int *handle, void *buffer);
 static bool copy_if_updated_multi(orb_id_t topic, int multi_instance, int *handle, void *buffer);
 
+/**
+ * Subscribe to a logged topic and add it to the poll set.
+ */
+static int log_subscribe(orb_id_t topic);
+
+/**
+ * Check a logged topic for updates. Uses the result of the last poll if there
+ * is one, so topics that were not published cost nothing.
+ */
+static bool log_check(int handle);
+
+/**
+ * Wait for one of the logged topics to be published.
+ */
+static int log_poll(int timeout_ms);
+
 /**
  * Mainloop of sd log deamon.
  */
@@ -272,13 +319,14 @@ sdlog2_usage(const char *reason)
 		fprintf(stderr, "%s\n", reason);
 	}
 
-	warnx("usage: sdlog2 {start|stop|status|on|off} [-r <log rate>] [-b <buffer size>] -e -a -t -x\n"
+	warnx("usage: sdlog2 {start|stop|status|on|off} [-r <log rate>] [-b <buffer size>] -e -a -t -x -p\n"
 		 "\t-r\tLog rate in Hz, 0 means unlimited rate\n"
 		 "\t-b\tLog buffer size in KiB, default is 8\n"
 		 "\t-e\tEnable logging by default (if not, can be started by command)\n"
 		 "\t-a\tLog only when armed (can be still overriden by command)\n"
 		 "\t-t\tUse date/time for naming log directories and files\n"
-		 "\t-x\tExtended logging");
+		 "\t-x\tExtended logging\n"
+		 "\t-p\tLog topics when they are published, at most at the log rate each");
 }
 
 /**
@@ -550,6 +598,51 @@ int open_perf_file(const char* str)
 	return fd;
 }
 
+static void logwriter_wakeup(bool force)
+{
+	/* pairs with the fence in logwriter_thread: either the writer sees the data
+	 * queued before this call, or we see that it is about to sleep */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&logwriter_waiting, __ATOMIC_RELAXED)
+	    && (force || logbuffer_count(&lb) >= LOG_WRITE_BLOCK)) {
+		pthread_mutex_lock(&logbuffer_mutex);
+		pthread_cond_signal(&logbuffer_cond);
+		pthread_mutex_unlock(&logbuffer_mutex);
+	}
+}
+
+/**
+ * Move n bytes from the log buffer to the file, in at most two writes if the
+ * data wraps around the end of the buffer.
+ */
+static int logwriter_write(int log_fd, struct logbuffer_s *logbuf, int n)
+{
+	while (n > 0) {
+		void *read_ptr;
+		bool is_part;
+		int available = logbuffer_get_ptr(logbuf, &read_ptr, &is_part);
+
+		if (available > n) {
+			available = n;
+		}
+
+		perf_begin(perf_write);
+		int ret = write(log_fd, read_ptr, available);
+		perf_end(perf_write);
+
+		if (ret <= 0) {
+			return PX4_ERROR;
+		}
+
+		logbuffer_mark_read(logbuf, ret);
+		log_bytes_written += ret;
+		n -= ret;
+	}
+
+	return PX4_OK;
+}
+
 static void *logwriter_thread(void *arg)
 {
 	/* set name */
@@ -572,78 +665,86 @@ static void *logwriter_thread(void *arg)
 
 	fsync(log_fd);
 
-	int poll_count = 0;
+	hrt_abstime last_flush = hrt_absolute_time();
 
-	void *read_ptr;
+	hrt_abstime last_sync = last_flush;
 
-	int n = 0;
-
-	bool should_wait = false;
-
-	bool is_part = false;
+	bool dirty = false;
 
 	while (true) {
-		/* make sure threads are synchronized */
-		pthread_mutex_lock(&logbuffer_mutex);
-
-		/* update read pointer if needed */
-		if (n > 0) {
-			logbuffer_mark_read(&lb, n);
-		}
-
-		/* only wait if no data is available to process */
-		if (should_wait && !logwriter_should_exit) {
-			/* blocking wait for new data at this line */
-			pthread_cond_wait(&logbuffer_cond, &logbuffer_mutex);
-		}
-
-		/* only get pointer to thread-safe data, do heavy I/O a few lines down */
-		int available = logbuffer_get_ptr(logbuf, &read_ptr, &is_part);
-
-		/* continue */
-		pthread_mutex_unlock(&logbuffer_mutex);
+		/* sample the exit flags before the fill level, so nothing queued before them is left behind */
+		bool should_exit = main_thread_should_exit || logwriter_should_exit;
 
-		if (available > 0) {
+		int available = logbuffer_count(logbuf);
 
-			/* do heavy IO here */
-			if (available > MAX_WRITE_CHUNK) {
-				n = MAX_WRITE_CHUNK;
+		hrt_abstime now = hrt_absolute_time();
 
-			} else {
-				n = available;
-			}
+		if (available == 0) {
+			/* nothing is waiting to get stale */
+			last_flush = now;
+		}
 
-			perf_begin(perf_write);
-			n = write(log_fd, read_ptr, n);
-			perf_end(perf_write);
+		/* write whole blocks only, so the file grows along the block boundaries of the card.
+		 * The remainder goes out on exit or once it has been waiting for too long. */
+		int misalign = log_bytes_written % LOG_WRITE_BLOCK;
+		int n = (misalign + available) / LOG_WRITE_BLOCK * LOG_WRITE_BLOCK - misalign;
 
-			should_wait = (n == available) && !is_part;
+		if (should_exit || now - last_flush >= LOG_FLUSH_INTERVAL) {
+			n = available;
+		}
 
-			if (n < 0) {
+		if (n > 0) {
+			if (logwriter_write(log_fd, logbuf, n) != PX4_OK) {
 				main_thread_should_exit = true;
 				warn("error writing log file");
 				break;
 			}
 
-			if (n > 0) {
-				log_bytes_written += n;
-			}
+			last_flush = now;
+			dirty = true;
+
+		} else if (should_exit) {
+			/* exit only with empty buffer */
+			break;
 
 		} else {
-			n = 0;
+			pthread_mutex_lock(&logbuffer_mutex);
+
+			/* announce the wait before looking at the buffer again, pairs with logwriter_wakeup() */
+			__atomic_store_n(&logwriter_waiting, true, __ATOMIC_RELAXED);
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+			if (!main_thread_should_exit && !logwriter_should_exit
+			    && logbuffer_count(logbuf) < LOG_WRITE_BLOCK - misalign) {
+
+				if (available > 0) {
+					/* condition variables time out against the wall clock */
+					struct timespec abstime;
+					clock_gettime(CLOCK_REALTIME, &abstime);
+					hrt_abstime timeout = last_flush + LOG_FLUSH_INTERVAL - now;
+					abstime.tv_sec += timeout / 1000000;
+					abstime.tv_nsec += (timeout % 1000000) * 1000;
+
+					if (abstime.tv_nsec >= 1000 * 1000 * 1000) {
+						abstime.tv_sec++;
+						abstime.tv_nsec -= 1000 * 1000 * 1000;
+					}
 
-			/* exit only with empty buffer */
-			if (main_thread_should_exit || logwriter_should_exit) {
-				break;
+					pthread_cond_timedwait(&logbuffer_cond, &logbuffer_mutex, &abstime);
+
+				} else {
+					pthread_cond_wait(&logbuffer_cond, &logbuffer_mutex);
+				}
 			}
 
-			should_wait = true;
+			__atomic_store_n(&logwriter_waiting, false, __ATOMIC_RELAXED);
+			pthread_mutex_unlock(&logbuffer_mutex);
 		}
 
-		if (++poll_count == 10) {
+		if (dirty && hrt_elapsed_time(&last_sync) >= LOG_SYNC_INTERVAL) {
 			fsync(log_fd);
-			poll_count = 0;
-
+			last_sync = hrt_absolute_time();
+			dirty = false;
 		}
 
 		if (log_bytes_written - last_checked_bytes_written > 20*1024*1024) {
@@ -679,6 +780,7 @@ void sdlog2_start_log()
 	start_time = hrt_absolute_time();
 	log_msgs_written = 0;
 	log_msgs_skipped = 0;
+	lb.max_count = 0;
 
 	/* initialize log buffer emptying thread */
 	pthread_attr_init(&logwriter_attr);
@@ -728,11 +830,8 @@ void sdlog2_stop_log()
 	logging_enabled = false;
 
 	/* wake up write thread one last time */
-	pthread_mutex_lock(&logbuffer_mutex);
 	logwriter_should_exit = true;
-	pthread_cond_signal(&logbuffer_cond);
-	/* unlock, now the writer thread may return */
-	pthread_mutex_unlock(&logbuffer_mutex);
+	logwriter_wakeup(true);
 
 	/* wait for write thread to return */
 	int ret;
@@ -843,6 +942,77 @@ int write_parameters(int fd)
 	return written;
 }
 
+int log_subscribe(orb_id_t topic)
+{
+	int handle = orb_subscribe(topic);
+
+	if (handle < 0 || log_fds_count >= LOG_POLL_MAX) {
+		return handle;
+	}
+
+	if (handle >= log_fds_slot_size) {
+		int size = handle + 16;
+		uint8_t *slots = realloc(log_fds_slot, size);
+
+		if (slots == NULL) {
+			return handle;
+		}
+
+		memset(&slots[log_fds_slot_size], 0, size - log_fds_slot_size);
+		log_fds_slot = slots;
+		log_fds_slot_size = size;
+	}
+
+	/* log management topics must not be delayed, everything else is capped at the log rate */
+	if (log_event_driven && topic != ORB_ID(vehicle_command) && topic != ORB_ID(vehicle_status)
+	    && topic != ORB_ID(vehicle_gps_position)) {
+		orb_set_interval(handle, log_interval_ms);
+	}
+
+	log_fds[log_fds_count].fd = handle;
+	log_fds[log_fds_count].events = POLLIN;
+	log_fds[log_fds_count].revents = 0;
+	log_fds_slot[handle] = ++log_fds_count;
+
+#ifdef __PX4_POSIX
+
+	if (log_pollset != NULL) {
+		px4_pollset_destroy(log_pollset);
+		log_pollset = NULL;
+	}
+
+#endif
+
+	return handle;
+}
+
+int log_poll(int timeout_ms)
+{
+#ifdef __PX4_POSIX
+
+	if (log_pollset == NULL) {
+		log_pollset = px4_pollset_create(log_fds, log_fds_count);
+	}
+
+	if (log_pollset != NULL) {
+		return px4_pollset_wait(log_pollset, hrt_absolute_time() + timeout_ms * 1000);
+	}
+
+#endif
+	return px4_poll(log_fds, log_fds_count, timeout_ms);
+}
+
+bool log_check(int handle)
+{
+	if (log_poll_valid && handle < log_fds_slot_size && log_fds_slot[handle] != 0) {
+		return log_fds[log_fds_slot[handle] - 1].revents & POLLIN;
+	}
+
+	bool updated = false;
+	orb_check(handle, &updated);
+	return updated;
+}
+
 bool copy_if_updated(orb_id_t topic, int *handle, void *buffer)
 {
 	return copy_if_updated_multi(topic, 0, handle, buffer);
@@ -853,8 +1023,8 @@ bool copy_if_updated_multi(orb_id_t topic, int multi_instance, int *handle, void
 	bool updated = false;
 
 	if (*handle < 0) {
-		if (OK == orb_exists(topic, multi_instance)) {
-			*handle = orb_subscribe(topic);
+		if (log_discover && OK == orb_exists(topic, multi_instance)) {
+			*handle = log_subscribe(topic);
 			/* copy first data */
 			if (*handle >= 0) {
 				orb_copy(topic, *handle, buffer);
@@ -862,7 +1032,7 @@ bool copy_if_updated_multi(orb_id_t topic, int multi_instance, int *handle, void
 			}
 		}
 	} else {
-		orb_check(*handle, &updated);
+		updated = log_check(*handle);
 
 		if (updated) {
 			orb_copy(topic, *handle, buffer);
@@ -903,7 +1073,7 @@ int sdlog2_thread_main(int argc, char *argv[])
 
 	int myoptind = 1;
 	const char *myoptarg = NULL;
-	while ((ch = px4_getopt(argc, argv, "r:b:eatx", &myoptind, &myoptarg)) != EOF) {
+	while ((ch = px4_getopt(argc, argv, "r:b:eatxp", &myoptind, &myoptarg)) != EOF) {
 		switch (ch) {
 		case 'r': {
 				unsigned long r = strtoul(myoptarg, NULL, 10);
@@ -943,6 +1113,10 @@ int sdlog2_thread_main(int argc, char *argv[])
 			_extended_logging = true;
 			break;
 
+		case 'p':
+			log_event_driven = true;
+			break;
+
 		case '?':
 			if (optopt == 'c') {
 				warnx("option -%c requires an argument", optopt);
@@ -1024,6 +1198,9 @@ int sdlog2_thread_main(int argc, char *argv[])
 	}
 
 
+	/* in event mode the log rate caps each topic instead of the loop */
+	log_interval_ms = sleep_delay / 1000;
+
 	if (check_free_space() != OK) {
 		warnx("ERR: MicroSD almost full");
 		return 1;
@@ -1038,6 +1215,13 @@ int sdlog2_thread_main(int argc, char *argv[])
 		return 1;
 	}
 
+	/* the writer takes whole blocks out of the buffer while the next one fills up */
+	log_buffer_size = (log_buffer_size + LOG_WRITE_BLOCK - 1) / LOG_WRITE_BLOCK * LOG_WRITE_BLOCK;
+
+	if (log_buffer_size < 2 * LOG_WRITE_BLOCK) {
+		log_buffer_size = 2 * LOG_WRITE_BLOCK;
+	}
+
 	/* initialize log buffer with specified size */
 	warnx("log buffer size: %i bytes", log_buffer_size);
 
@@ -1054,6 +1238,11 @@ int sdlog2_thread_main(int argc, char *argv[])
 
 	memset(&buf_gps_pos, 0, sizeof(buf_gps_pos));
 
+	/* logger statistics, to size the buffer from flight data */
+	struct logger_status_s logger_status;
+	memset(&logger_status, 0, sizeof(logger_status));
+	orb_advert_t logger_status_pub = NULL;
+
 	/* warning! using union here to save memory, elements should be used separately! */
 	union {
 		struct vehicle_command_s cmd;
@@ -1262,8 +1451,29 @@ int sdlog2_thread_main(int argc, char *argv[])
 	/* running, report */
 	thread_running = true;
 
+	hrt_abstime last_discover = 0;
+
 	while (!main_thread_should_exit) {
-		usleep(sleep_delay);
+		if (log_event_driven && logging_enabled && log_fds_count > 0) {
+			/* wake up when one of the logged topics is published */
+			log_poll_valid = log_poll(LOG_POLL_TIMEOUT_MS) >= 0;
+
+			if (!log_poll_valid) {
+				px4_usleep(sleep_delay);
+			}
+
+			/* topics that are not published yet are looked for once in a while only */
+			log_discover = hrt_elapsed_time(&last_discover) >= LOG_DISCOVER_INTERVAL;
+
+			if (log_discover) {
+				last_discover = hrt_absolute_time();
+			}
+
+		} else {
+			px4_usleep(sleep_delay);
+			log_poll_valid = false;
+			log_discover = true;
+		}
 
 		/* --- VEHICLE COMMAND - LOG MANAGEMENT --- */
 		if (copy_if_updated(ORB_ID(vehicle_command), &subs.cmd_sub, &buf.cmd)) {
@@ -1291,8 +1501,6 @@ int sdlog2_thread_main(int argc, char *argv[])
 			continue;
 		}
 
-		pthread_mutex_lock(&logbuffer_mutex);
-
 		/* write time stamp message */
 		log_msg.msg_type = LOG_TIME_MSG;
 		log_msg.body.log_TIME.t = hrt_absolute_time();
@@ -1856,14 +2064,26 @@ int sdlog2_thread_main(int argc, char *argv[])
 			LOGBUFFER_WRITE_AND_COUNT(MACS);
 		}
 
-		/* signal the other thread new data, but not yet unlock */
-		if (logbuffer_count(&lb) > MIN_BYTES_TO_WRITE) {
-			/* only request write if several packets can be written at once */
-			pthread_cond_signal(&logbuffer_cond);
-		}
+		/* wake up the writer once a whole block can be written */
+		logwriter_wakeup(false);
 
-		/* unlock, now the writer thread may run */
-		pthread_mutex_unlock(&logbuffer_mutex);
+		/* --- LOGGER STATUS --- */
+		if (hrt_elapsed_time(&logger_status.timestamp) >= LOG_STATUS_INTERVAL) {
+			logger_status.timestamp = hrt_absolute_time();
+			logger_status.buffer_size = lb.size;
+			logger_status.buffer_fill = logbuffer_count(&lb);
+			logger_status.buffer_fill_max = lb.max_count;
+			logger_status.msgs_written = log_msgs_written;
+			logger_status.msgs_dropped = log_msgs_skipped;
+			logger_status.bytes_written = log_bytes_written;
+
+			if (logger_status_pub != NULL) {
+				orb_publish(ORB_ID(logger_status), logger_status_pub, &logger_status);
+
+			} else {
+				logger_status_pub = orb_advertise(ORB_ID(logger_status), &logger_status);
+			}
+		}
 	}
 
 	if (logging_enabled) {
@@ -1875,6 +2095,19 @@ int sdlog2_thread_main(int argc, char *argv[])
 
 	free(lb.data);
 
+#ifdef __PX4_POSIX
+
+	if (log_pollset != NULL) {
+		px4_pollset_destroy(log_pollset);
+		log_pollset = NULL;
+	}
+
+#endif
+	free(log_fds_slot);
+	log_fds_slot = NULL;
+	log_fds_slot_size = 0;
+	log_fds_count = 0;
+
 	thread_running = false;
 
 	return 0;
@@ -1883,6 +2116,7 @@ int sdlog2_thread_main(int argc, char *argv[])
 void sdlog2_status()
 {
 	warnx("extended logging: %s", (_extended_logging) ? "ON" : "OFF");
+	warnx("event-driven: %s, %u topics", (log_event_driven) ? "ON" : "OFF", log_fds_count);
 	warnx("time: gps: %u seconds", (unsigned)gps_time_sec);
 	if (!logging_enabled) {
 		warnx("not logging");
@@ -1893,6 +2127,7 @@ void sdlog2_status()
 		float seconds = ((float)(hrt_absolute_time() - start_time)) / 1000000.0f;
 
 		warnx("wrote %lu msgs, %4.2f MiB (average %5.3f KiB/s), skipped %lu msgs", log_msgs_written, (double)mebibytes, (double)(kibibytes / seconds), log_msgs_skipped);
+		warnx("buffer: %i of %i bytes used, max %i", logbuffer_count(&lb), lb.size, lb.max_count);
 		mavlink_log_info(mavlink_fd, "[sdlog2] wrote %lu msgs, skipped %lu msgs", log_msgs_written, log_msgs_skipped);
 	}
 }
@@ -365,6 +365,8 @@ private:
 
 	}		_parameter_handles;		/**< handles for interesting parameters */
 
+	uint32_t	_parameter_version;		/**< parameter store version the parameters were read at */
+
 
 	int		init_sensor_class(const struct orb_metadata *meta, int *subs,
 					  uint32_t *priorities, uint32_t *errcount);
@@ -521,7 +523,8 @@ Sensors::Sensors() :
 	_mag_rotation{},
 
 	_battery_discharged(0),
-	_battery_current_timestamp(0)
+	_battery_current_timestamp(0),
+	_parameter_version(0)
 {
 	/* initialize subscriptions */
 	for (unsigned i = 0; i < SENSOR_COUNT_MAX; i++) {
@@ -680,6 +683,9 @@ Sensors::parameters_update()
 	float tmpScaleFactor = 0.0f;
 	float tmpRevFactor = 0.0f;
 
+	/* remember what we read, see parameter_update_poll() */
+	_parameter_version = param_version();
+
 	/* rc values */
 	for (unsigned int i = 0; i < _rc_max_chan_count; i++) {
 
@@ -1245,8 +1251,12 @@ Sensors::parameter_update_poll(bool forced)
 		struct parameter_update_s update;
 		orb_copy(ORB_ID(parameter_update), _params_sub, &update);
 
-		/* update parameters */
-		parameters_update();
+		/* update parameters, unless none of ours changed */
+		if (forced || param_count_changed_since((const param_t *)&_parameter_handles,
+							sizeof(_parameter_handles) / sizeof(param_t),
+							_parameter_version) > 0) {
+			parameters_update();
+		}
 
 		/* set offset parameters to new values */
 		bool failed;
@@ -129,6 +129,16 @@ int Simulator::start(int argc, char *argv[])
 	if (_instance) {
 		drv_led_start();
 
+#ifndef __PX4_QURT
+
+		if (argc > 3 && strcmp(argv[3], "-l") == 0) {
+			// from now on time only advances with the simulator
+			_instance->_lockstep = true;
+			hrt_lockstep_enable();
+		}
+
+#endif
+
 		if (argv[2][1] == 's') {
 			_instance->initializeSensorData();
 #ifndef __PX4_QURT
@@ -151,9 +161,10 @@ int Simulator::start(int argc, char *argv[])
 
 static void usage()
 {
-	PX4_WARN("Usage: simulator {start -[sc] |stop}");
+	PX4_WARN("Usage: simulator {start -[sc] [-l] |stop}");
 	PX4_WARN("Simulate raw sensors:     simulator start -s");
 	PX4_WARN("Publish sensors combined: simulator start -p");
+	PX4_WARN("Lockstep with the simulator time: -l");
 }
 
 __BEGIN_DECLS
@@ -166,8 +177,9 @@ extern "C" {
 	{
 		int ret = 0;
 
-		if (argc == 3 && strcmp(argv[1], "start") == 0) {
-			if (strcmp(argv[2], "-s") == 0 || strcmp(argv[2], "-p") == 0) {
+		if ((argc == 3 || argc == 4) && strcmp(argv[1], "start") == 0) {
+			if ((strcmp(argv[2], "-s") == 0 || strcmp(argv[2], "-p") == 0) &&
+			    (argc == 3 || strcmp(argv[3], "-l") == 0)) {
 				if (g_sim_task >= 0) {
 					warnx("Simulator already started");
 					return 0;
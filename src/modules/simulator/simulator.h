@@ -238,7 +238,10 @@ private:
 		_actuators{},
 		_attitude{},
 		_manual{},
-		_vehicle_status{}
+		_vehicle_status{},
+		_lockstep(false),
+		_lockstep_synced(false),
+		_lockstep_offset(0)
 #endif
 	{}
 	~Simulator() { _instance = NULL; }
@@ -285,6 +288,11 @@ private:
 	struct manual_control_setpoint_s _manual;
 	struct vehicle_status_s _vehicle_status;
 
+	// lockstep: the HIL_SENSOR timestamps drive hrt_absolute_time()
+	bool _lockstep;
+	bool _lockstep_synced;		///< offset is set by the first HIL_SENSOR
+	uint64_t _lockstep_offset;	///< simulator time minus hrt time
+
 	void poll_topics();
 	void handle_message(mavlink_message_t *msg, bool publish);
 	void send_controls();
@@ -111,7 +111,8 @@ void Simulator::pack_actuator_message(mavlink_hil_controls_t &actuator_msg)
 		memset(out, 0, sizeof(out));
 	}
 
-	actuator_msg.time_usec = hrt_absolute_time();
+	// in lockstep the simulator gets its own time back
+	actuator_msg.time_usec = hrt_absolute_time() + _lockstep_offset;
 	actuator_msg.roll_ailerons = out[0];
 	actuator_msg.pitch_elevator = _vehicle_status.is_rotary_wing ? out[1] : -out[1];
 	actuator_msg.yaw_rudder = out[2];
@@ -238,6 +239,16 @@ void Simulator::handle_message(mavlink_message_t *msg, bool publish)
 		mavlink_hil_sensor_t imu;
 		mavlink_msg_hil_sensor_decode(msg, &imu);
 
+		if (_lockstep) {
+			// the first sample continues from the current time, later ones advance it
+			if (!_lockstep_synced) {
+				_lockstep_offset = imu.time_usec - hrt_absolute_time();
+				_lockstep_synced = true;
+			}
+
+			hrt_lockstep_set_time(imu.time_usec - _lockstep_offset);
+		}
+
 		if (publish) {
 			publish_sensor_topics(&imu);
 		}
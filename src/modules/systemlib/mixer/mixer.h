@@ -518,6 +518,9 @@ public:
 	virtual unsigned		mix(float *outputs, unsigned space, uint16_t *status_reg);
 	virtual void			groups_required(uint32_t &groups);
 
+	/** maximum number of rotors of all geometries */
+	static constexpr unsigned	MAX_ROTORS = 8;
+
 private:
 	float				_roll_scale;
 	float				_pitch_scale;
@@ -528,7 +531,13 @@ private:
 	multirotor_motor_limits_s 	_limits;
 
 	unsigned			_rotor_count;
-	const Rotor			*_rotors;
+
+	/* the geometry table rearranged into one row per input, so each mixing pass
+	 * runs over contiguous arrays and can be vectorized */
+	float				_rotor_roll[MAX_ROTORS];
+	float				_rotor_pitch[MAX_ROTORS];
+	float				_rotor_yaw[MAX_ROTORS];
+	float				_rotor_out[MAX_ROTORS];
 
 	/* do not allow to copy due to ptr data members */
 	MultirotorMixer(const MultirotorMixer &);
@@ -90,9 +90,29 @@ MultirotorMixer::MultirotorMixer(ControlCallback control_cb,
 	_yaw_scale(yaw_scale),
 	_idle_speed(-1.0f + idle_speed * 2.0f),	/* shift to output range here to avoid runtime calculation */
 	_limits_pub(),
-	_rotor_count(_config_rotor_count[(MultirotorGeometryUnderlyingType)geometry]),
-	_rotors(_config_index[(MultirotorGeometryUnderlyingType)geometry])
+	_rotor_count(_config_rotor_count[(MultirotorGeometryUnderlyingType)geometry])
 {
+	/* the tables are checked when they are generated, never index past the arrays anyway */
+	if (_rotor_count > MAX_ROTORS) {
+		_rotor_count = MAX_ROTORS;
+	}
+
+	const Rotor *rotors = _config_index[(MultirotorGeometryUnderlyingType)geometry];
+
+	for (unsigned i = 0; i < MAX_ROTORS; i++) {
+		if (i < _rotor_count) {
+			_rotor_roll[i] = rotors[i].roll_scale;
+			_rotor_pitch[i] = rotors[i].pitch_scale;
+			_rotor_yaw[i] = rotors[i].yaw_scale;
+			_rotor_out[i] = rotors[i].out_scale;
+
+		} else {
+			_rotor_roll[i] = 0.0f;
+			_rotor_pitch[i] = 0.0f;
+			_rotor_yaw[i] = 0.0f;
+			_rotor_out[i] = 0.0f;
+		}
+	}
 }
 
 MultirotorMixer::~MultirotorMixer()
@@ -230,24 +250,20 @@ MultirotorMixer::mix(float *outputs, unsigned space, uint16_t *status_reg)
 	float thrust_increase_factor = 1.5f;
 	float thrust_decrease_factor = 0.6f;
 
-	/* perform initial mix pass yielding unbounded outputs, ignore yaw */
+	/* roll and pitch part of each output, the same in all passes below */
+	float roll_pitch[MAX_ROTORS];
+
 	for (unsigned i = 0; i < _rotor_count; i++) {
-		float out = roll * _rotors[i].roll_scale +
-			    pitch * _rotors[i].pitch_scale +
-			    thrust;
+		roll_pitch[i] = roll * _rotor_roll[i] + pitch * _rotor_pitch[i];
+	}
 
-		out *= _rotors[i].out_scale;
+	/* perform initial mix pass yielding unbounded outputs, ignore yaw */
+	for (unsigned i = 0; i < _rotor_count; i++) {
+		float out = (roll_pitch[i] + thrust) * _rotor_out[i];
 
 		/* calculate min and max output values */
-		if (out < min_out) {
-			min_out = out;
-		}
-
-		if (out > max_out) {
-			max_out = out;
-		}
-
-		outputs[i] = out;
+		min_out = (out < min_out) ? out : min_out;
+		max_out = (out > max_out) ? out : max_out;
 	}
 
 	float boost = 0.0f;				// value added to demanded thrust (can also be negative)
@@ -305,22 +321,21 @@ MultirotorMixer::mix(float *outputs, unsigned space, uint16_t *status_reg)
 	}
 
 	// mix again but now with thrust boost, scale roll/pitch and also add yaw
+	// the yaw and thrust limits of each rotor apply to the following ones, so this pass stays sequential
 	for (unsigned i = 0; i < _rotor_count; i++) {
-		float out = (roll * _rotors[i].roll_scale +
-			     pitch * _rotors[i].pitch_scale) * roll_pitch_scale +
-			    yaw * _rotors[i].yaw_scale +
+		float out = roll_pitch[i] * roll_pitch_scale +
+			    yaw * _rotor_yaw[i] +
 			    thrust + boost;
 
-		out *= _rotors[i].out_scale;
+		out *= _rotor_out[i];
 
 		// scale yaw if it violates limits. inform about yaw limit reached
 		if (out < 0.0f) {
-			if (fabsf(_rotors[i].yaw_scale) <= FLT_EPSILON) {
+			if (fabsf(_rotor_yaw[i]) <= FLT_EPSILON) {
 				yaw = 0.0f;
 
 			} else {
-				yaw = -((roll * _rotors[i].roll_scale + pitch * _rotors[i].pitch_scale) *
-					roll_pitch_scale + thrust + boost) / _rotors[i].yaw_scale;
+				yaw = -(roll_pitch[i] * roll_pitch_scale + thrust + boost) / _rotor_yaw[i];
 			}
 
 			if (status_reg != NULL) {
@@ -332,12 +347,11 @@ MultirotorMixer::mix(float *outputs, unsigned space, uint16_t *status_reg)
 			float thrust_reduction = fminf(0.15f, out - 1.0f);
 			thrust -= thrust_reduction;
 
-			if (fabsf(_rotors[i].yaw_scale) <= FLT_EPSILON) {
+			if (fabsf(_rotor_yaw[i]) <= FLT_EPSILON) {
 				yaw = 0.0f;
 
 			} else {
-				yaw = (1.0f - ((roll * _rotors[i].roll_scale + pitch * _rotors[i].pitch_scale) *
-					       roll_pitch_scale + thrust + boost)) / _rotors[i].yaw_scale;
+				yaw = (1.0f - (roll_pitch[i] * roll_pitch_scale + thrust + boost)) / _rotor_yaw[i];
 			}
 
 			if (status_reg != NULL) {
@@ -347,13 +361,14 @@ MultirotorMixer::mix(float *outputs, unsigned space, uint16_t *status_reg)
 	}
 
 	/* add yaw and scale outputs to range idle_speed...1 */
+	const float idle_range = 1.0f - _idle_speed;
+
 	for (unsigned i = 0; i < _rotor_count; i++) {
-		outputs[i] = (roll * _rotors[i].roll_scale +
-			      pitch * _rotors[i].pitch_scale) * roll_pitch_scale +
-			     yaw * _rotors[i].yaw_scale +
-			     thrust + boost;
+		float out = roll_pitch[i] * roll_pitch_scale +
+			    yaw * _rotor_yaw[i] +
+			    thrust + boost;
 
-		outputs[i] = constrain(_idle_speed + (outputs[i] * (1.0f - _idle_speed)), _idle_speed, 1.0f);
+		outputs[i] = constrain(_idle_speed + (out * idle_range), _idle_speed, 1.0f);
 	}
 
 	return _rotor_count;
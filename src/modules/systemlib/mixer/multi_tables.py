@@ -205,6 +205,13 @@ def printScaleTablesCounts():
         print("\t{}, /* {} */".format(len(table), variableName(table)))
     print("};\n")
 
+def printScaleTablesChecks():
+    # the mixer keeps the scales of one geometry in fixed size arrays
+    for table in tables:
+        print("static_assert(sizeof(_config_{0}) / sizeof(_config_{0}[0]) <= MultirotorMixer::MAX_ROTORS,".format(variableName(table)))
+        print("\t      \"{} has more rotors than MultirotorMixer::MAX_ROTORS\");".format(variableName(table)))
+    print("")
+
 
 
 printEnum()
@@ -213,6 +220,7 @@ print("namespace {")
 printScaleTables()
 printScaleTablesIndex()
 printScaleTablesCounts()
+printScaleTablesChecks()
 
 print("} // anonymous namespace\n")
 print("#endif /* _MIXER_MULTI_TABLES */")
@@ -109,6 +109,27 @@ uint8_t  *param_changed_storage = 0;
 int size_param_changed_storage_bytes = 0;
 const int bits_per_allocation_unit  = (sizeof(*param_changed_storage) * 8);
 
+/**
+ * Position of each parameter's modified value in param_values, plus one.
+ * Zero if the parameter has its default value.
+ */
+static uint16_t *param_values_slot = NULL;
+
+/** store version, incremented by every change; starts at one so zero predates everything */
+static uint32_t param_store_version = 1;
+
+/** store version of the last change of each parameter */
+static uint32_t *param_changed_version = NULL;
+
+/** store version of the last param_reset_all(), which changes every parameter */
+static uint32_t param_reset_all_version = 0;
+
+/** nesting depth of param_notify_suspend() */
+static int param_notify_suspended = 0;
+
+/** a notification was held back while suspended */
+static bool param_notify_pending = false;
+
 
 static unsigned
 get_param_info_count(void)
@@ -117,11 +138,19 @@ get_param_info_count(void)
 	if (!param_changed_storage) {
 		size_param_changed_storage_bytes  = (param_info_count / bits_per_allocation_unit) + 1;
 		param_changed_storage = calloc(size_param_changed_storage_bytes, 1);
+		param_values_slot = calloc(param_info_count, sizeof(*param_values_slot));
+		param_changed_version = calloc(param_info_count, sizeof(*param_changed_version));
 
 		/* If the allocation fails we need to indicate failure in the
 		 * API by returning PARAM_INVALID
 		 */
-		if (param_changed_storage == NULL) {
+		if (param_changed_storage == NULL || param_values_slot == NULL || param_changed_version == NULL) {
+			free(param_changed_storage);
+			free(param_values_slot);
+			free(param_changed_version);
+			param_changed_storage = NULL;
+			param_values_slot = NULL;
+			param_changed_version = NULL;
 			return 0;
 		}
 	}
@@ -180,63 +209,68 @@ handle_in_range(param_t param)
 }
 
 /**
- * Compare two modifid parameter structures to determine ordering.
+ * Locate the modified parameter structure for a parameter, if it exists.
  *
- * This function is suitable for passing to qsort or bsearch.
+ * @param param			The parameter being searched.
+ * @return			The structure holding the modified value, or
+ *				NULL if the parameter has not been modified.
  */
-static int
-param_compare_values(const void *a, const void *b)
+static struct param_wbuf_s *
+param_find_changed(param_t param)
 {
-	struct param_wbuf_s *pa = (struct param_wbuf_s *)a;
-	struct param_wbuf_s *pb = (struct param_wbuf_s *)b;
-
-	if (pa->param < pb->param) {
-		return -1;
-	}
+	param_assert_locked();
 
-	if (pa->param > pb->param) {
-		return 1;
+	if (param_values == NULL || !handle_in_range(param) || param_values_slot[param] == 0) {
+		return NULL;
 	}
 
-	return 0;
+	return (struct param_wbuf_s *)utarray_eltptr(param_values, param_values_slot[param] - 1u);
 }
 
 /**
- * Locate the modified parameter structure for a parameter, if it exists.
+ * Drop the modified value of a parameter.
  *
- * @param param			The parameter being searched.
- * @return			The structure holding the modified value, or
- *				NULL if the parameter has not been modified.
+ * The last modified value is moved into the freed position, so the
+ * removal does not depend on the number of modified parameters.
+ *
+ * @param s			The structure holding the modified value.
  */
-static struct param_wbuf_s *
-param_find_changed(param_t param)
+static void
+param_erase_changed(struct param_wbuf_s *s)
 {
-	struct param_wbuf_s	*s = NULL;
+	struct param_wbuf_s *last = (struct param_wbuf_s *)utarray_back(param_values);
 
-	param_assert_locked();
+	param_values_slot[s->param] = 0;
 
-	if (param_values != NULL) {
-#if 0	/* utarray_find requires bsearch, not available */
-		struct param_wbuf_s key;
-		key.param = param;
-		s = utarray_find(param_values, &key, param_compare_values);
-#else
+	if (s != last) {
+		*s = *last;
+		param_values_slot[s->param] = utarray_eltidx(param_values, s) + 1;
+	}
 
-		while ((s = (struct param_wbuf_s *)utarray_next(param_values, s)) != NULL) {
-			if (s->param == param) {
-				break;
-			}
-		}
+	utarray_pop_back(param_values);
+}
 
-#endif
-	}
+/**
+ * Record a change of a parameter value in the store version.
+ *
+ * @param param			The parameter that changed.
+ */
+static void
+param_mark_changed(param_t param)
+{
+	param_assert_locked();
 
-	return s;
+	param_changed_version[param] = ++param_store_version;
 }
 
 static void
 param_notify_changes(void)
 {
+	if (param_notify_suspended > 0) {
+		param_notify_pending = true;
+		return;
+	}
+
 	struct parameter_update_s pup = { .timestamp = hrt_absolute_time() };
 
 	/*
@@ -254,22 +288,47 @@ param_notify_changes(void)
 param_t
 param_find_internal(const char *name, bool notification)
 {
-	param_t param;
+	param_t param = PARAM_INVALID;
 
-	/* perform a linear search of the known parameters */
+#ifdef _UNIT_TEST
 
-	for (param = 0; handle_in_range(param); param++) {
-		if (!strcmp(param_info_base[param].name, name)) {
-			if (notification) {
-				param_set_used_internal(param);
-			}
+	/* the unit test parameters are not sorted, perform a linear search */
+	for (param_t p = 0; handle_in_range(p); p++) {
+		if (!strcmp(param_info_base[p].name, name)) {
+			param = p;
+			break;
+		}
+	}
+
+#else
+	/* binary search of the name-ordered index generated with the parameters */
+	int low = 0;
+	int high = (int)get_param_info_count() - 1;
+
+	while (low <= high) {
+		int mid = (low + high) / 2;
+		param_t p = px4_parameters_sorted[mid];
+		int cmp = strcmp(name, param_info_base[p].name);
+
+		if (cmp == 0) {
+			param = p;
+			break;
 
-			return param;
+		} else if (cmp < 0) {
+			high = mid - 1;
+
+		} else {
+			low = mid + 1;
 		}
 	}
 
-	/* not found */
-	return PARAM_INVALID;
+#endif
+
+	if (param != PARAM_INVALID && notification) {
+		param_set_used_internal(param);
+	}
+
+	return param;
 }
 
 param_t
@@ -526,11 +585,10 @@ param_set_internal(param_t param, const void *val, bool mark_saved, bool notify_
 				.unsaved = false
 			};
 
-			/* add it to the array and sort */
+			/* add it to the array and remember where */
 			utarray_push_back(param_values, &buf);
-			utarray_sort(param_values, param_compare_values);
+			param_values_slot[param] = utarray_len(param_values);
 
-			/* find it after sorting */
 			s = param_find_changed(param);
 		}
 
@@ -563,6 +621,7 @@ param_set_internal(param_t param, const void *val, bool mark_saved, bool notify_
 		}
 
 		s->unsaved = !mark_saved;
+		param_mark_changed(param);
 		params_changed = true;
 		result = 0;
 	}
@@ -633,8 +692,8 @@ param_reset(param_t param)
 
 		/* if we found one, erase it */
 		if (s != NULL) {
-			int pos = utarray_eltidx(param_values, s);
-			utarray_erase(param_values, pos, 1);
+			param_erase_changed(s);
+			param_mark_changed(param);
 		}
 
 		param_found = true;
@@ -661,6 +720,12 @@ param_reset_all(void)
 	/* mark as reset / deleted */
 	param_values = NULL;
 
+	if (get_param_info_count()) {
+		memset(param_values_slot, 0, param_info_count * sizeof(*param_values_slot));
+	}
+
+	param_reset_all_version = ++param_store_version;
+
 	param_unlock();
 
 	param_notify_changes();
@@ -669,6 +734,9 @@ param_reset_all(void)
 void
 param_reset_excludes(const char *excludes[], int num_excludes)
 {
+	/* announce all resets at once */
+	param_notify_suspend();
+
 	param_lock();
 
 	param_t	param;
@@ -696,6 +764,66 @@ param_reset_excludes(const char *excludes[], int num_excludes)
 	param_unlock();
 
 	param_notify_changes();
+	param_notify_resume();
+}
+
+uint32_t
+param_version(void)
+{
+	return param_store_version;
+}
+
+bool
+param_changed_since(param_t param, uint32_t version)
+{
+	if (!handle_in_range(param)) {
+		return false;
+	}
+
+	/* compare differences so the comparison survives the counter wrapping */
+	return (int32_t)(param_changed_version[param] - version) > 0 ||
+	       (int32_t)(param_reset_all_version - version) > 0;
+}
+
+unsigned
+param_count_changed_since(const param_t *params, unsigned count, uint32_t version)
+{
+	unsigned changed = 0;
+
+	for (unsigned i = 0; i < count; i++) {
+		if (param_changed_since(params[i], version)) {
+			changed++;
+		}
+	}
+
+	return changed;
+}
+
+void
+param_notify_suspend(void)
+{
+	param_lock();
+	param_notify_suspended++;
+	param_unlock();
+}
+
+void
+param_notify_resume(void)
+{
+	bool notify = false;
+
+	param_lock();
+
+	if (param_notify_suspended > 0 && --param_notify_suspended == 0) {
+		notify = param_notify_pending;
+		param_notify_pending = false;
+	}
+
+	param_unlock();
+
+	if (notify) {
+		param_notify_changes();
+	}
 }
 
 static const char *param_default_file = PX4_ROOTFSDIR"/eeprom/parameters";
@@ -991,11 +1119,16 @@ param_import_internal(int fd, bool mark_saved)
 
 	state.mark_saved = mark_saved;
 
+	/* announce the whole file with a single notification */
+	param_notify_suspend();
+
 	do {
 		result = bson_decoder_next(&decoder);
 
 	} while (result > 0);
 
+	param_notify_resume();
+
 out:
 
 	if (result < 0) {
@@ -251,6 +251,51 @@ __EXPORT void		param_reset_all(void);
  */
 __EXPORT void		param_reset_excludes(const char *excludes[], int num_excludes);
 
+/**
+ * Get the version of the parameter store.
+ *
+ * The version is incremented by every change of a parameter value. Remember
+ * it after reading parameters and pass it to param_changed_since() later to
+ * find out which of them need to be read again.
+ *
+ * @return		The current version, never zero.
+ */
+__EXPORT uint32_t	param_version(void);
+
+/**
+ * Test whether a parameter changed after a given version of the store.
+ *
+ * @param param		A handle returned by param_find or passed by param_foreach.
+ * @param version	A version returned by param_version().
+ * @return		True if the value of the parameter may have changed since.
+ */
+__EXPORT bool		param_changed_since(param_t param, uint32_t version);
+
+/**
+ * Count the parameters of a set that changed after a given version of the store.
+ *
+ * @param params	Array of handles, PARAM_INVALID entries are ignored.
+ * @param count		Number of handles in params.
+ * @param version	A version returned by param_version().
+ * @return		The number of parameters in the set that may have changed since.
+ */
+__EXPORT unsigned	param_count_changed_since(const param_t *params, unsigned count, uint32_t version);
+
+/**
+ * Hold back parameter_update notifications.
+ *
+ * Changes made until the matching param_notify_resume() are announced with a
+ * single notification, so bulk updates do not make every module reload its
+ * parameters once per changed value. Calls may be nested.
+ */
+__EXPORT void		param_notify_suspend(void);
+
+/**
+ * Publish the parameter_update notification held back since param_notify_suspend(),
+ * if any parameter changed in the meantime.
+ */
+__EXPORT void		param_notify_resume(void);
+
 /**
  * Export changed parameters to a file.
  *
@@ -33,6 +33,7 @@
 
 #pragma once
 
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -43,79 +44,154 @@ class DeviceNode;
 class ORBMap;
 }
 
+/**
+ * Node path to DeviceNode index.
+ *
+ * Chained hash table keyed on the FNV-1a hash of the node path. The bucket
+ * array is a power of two and doubles once the load factor exceeds one, so
+ * lookups stay O(1) independent of the number of advertised topics.
+ */
 class uORB::ORBMap
 {
 public:
 	struct Node {
 		struct Node *next;
 		const char *node_name;
+		uint32_t hash;
 		uORB::DeviceNode *node;
 	};
 
 	ORBMap() :
-		_top(nullptr),
-		_end(nullptr)
+		_buckets(nullptr),
+		_num_buckets(0),
+		_count(0)
 	{ }
 	~ORBMap()
 	{
-		while (_top != nullptr) {
-			unlinkNext(_top);
-
-			if (_top->next == nullptr) {
-				free((void *)_top->node_name);
-				free(_top);
-				_top = nullptr;
-				_end = nullptr;
+		for (unsigned i = 0; i < _num_buckets; i++) {
+			Node *p = _buckets[i];
+
+			while (p != nullptr) {
+				Node *next = p->next;
+				free((void *)p->node_name);
+				free(p);
+				p = next;
 			}
 		}
+
+		free(_buckets);
 	}
+
+	/**
+	 * Add a node, replacing the entry of an already existing node path.
+	 */
 	void insert(const char *node_name, uORB::DeviceNode *node)
 	{
-		Node **p;
+		const uint32_t h = hash(node_name);
+		Node *p = lookup(node_name, h);
 
-		if (_top == nullptr) {
-			p = &_top;
+		if (p != nullptr) {
+			p->node = node;
+			return;
+		}
 
-		} else {
-			p = &_end->next;
+		if (_count >= _num_buckets && !grow()) {
+			return;
 		}
 
-		*p = (Node *)malloc(sizeof(Node));
+		p = (Node *)malloc(sizeof(Node));
+
+		if (p == nullptr) {
+			return;
+		}
 
-		if (_end) {
-			_end = _end->next;
+		p->node_name = strdup(node_name);
 
-		} else {
-			_end = _top;
+		if (p->node_name == nullptr) {
+			free(p);
+			return;
 		}
 
-		_end->next = nullptr;
-		_end->node_name = strdup(node_name);
-		_end->node = node;
+		p->hash = h;
+		p->node = node;
+
+		Node **bucket = &_buckets[h & (_num_buckets - 1)];
+		p->next = *bucket;
+		*bucket = p;
+		_count++;
 	}
 
 	bool find(const char *node_name)
 	{
-		Node *p = _top;
+		return lookup(node_name, hash(node_name)) != nullptr;
+	}
 
-		while (p) {
-			if (strcmp(p->node_name, node_name) == 0) {
-				return true;
+	uORB::DeviceNode *get(const char *node_name)
+	{
+		Node *p = lookup(node_name, hash(node_name));
+
+		return (p != nullptr) ? p->node : nullptr;
+	}
+
+	unsigned size() const { return _count; }
+
+	unsigned buckets() const { return _num_buckets; }
+
+	/**
+	 * Number of entries in the fullest bucket, the most string compares a lookup can need.
+	 */
+	unsigned longest_chain() const
+	{
+		unsigned longest = 0;
+
+		for (unsigned i = 0; i < _num_buckets; i++) {
+			unsigned length = 0;
+
+			for (Node *p = _buckets[i]; p != nullptr; p = p->next) {
+				length++;
 			}
 
-			p = p->next;
+			if (length > longest) {
+				longest = length;
+			}
 		}
 
-		return false;
+		return longest;
 	}
 
-	uORB::DeviceNode *get(const char *node_name)
+	/**
+	 * 32 bit FNV-1a hash of a zero terminated string.
+	 */
+	static uint32_t hash(const char *s)
+	{
+		uint32_t h = 2166136261u;
+
+		while (*s) {
+			h ^= (uint8_t)*s++;
+			h *= 16777619u;
+		}
+
+		return h;
+	}
+
+private:
+	static const unsigned INITIAL_BUCKETS = 64;
+
+	Node **_buckets;
+	unsigned _num_buckets; /**< always zero or a power of two */
+	unsigned _count;
+
+	Node *lookup(const char *node_name, uint32_t h)
 	{
-		Node *p = _top;
+		if (_num_buckets == 0) {
+			return nullptr;
+		}
+
+		Node *p = _buckets[h & (_num_buckets - 1)];
 
 		while (p) {
-			if (strcmp(p->node_name, node_name) == 0) {
-				return p->node;
+			if (p->hash == h && strcmp(p->node_name, node_name) == 0) {
+				return p;
 			}
 
 			p = p->next;
@@ -124,23 +200,32 @@ public:
 		return nullptr;
 	}
 
-	void unlinkNext(Node *a)
+	bool grow()
 	{
-		Node *b = a->next;
+		const unsigned num_buckets = (_num_buckets == 0) ? INITIAL_BUCKETS : _num_buckets * 2;
+		Node **buckets = (Node **)calloc(num_buckets, sizeof(Node *));
 
-		if (b != nullptr) {
-			if (_end == b) {
-				_end = a;
-			}
+		if (buckets == nullptr) {
+			/* keep chaining into the old table if it exists */
+			return _num_buckets != 0;
+		}
+
+		/* rehash, the stored hash avoids touching the strings again */
+		for (unsigned i = 0; i < _num_buckets; i++) {
+			Node *p = _buckets[i];
 
-			a->next = b->next;
-			free((void *)b->node_name);
-			free(b);
+			while (p != nullptr) {
+				Node *next = p->next;
+				Node **bucket = &buckets[p->hash & (num_buckets - 1)];
+				p->next = *bucket;
+				*bucket = p;
+				p = next;
+			}
 		}
-	}
 
-private:
-	Node *_top;
-	Node *_end;
+		free(_buckets);
+		_buckets = buckets;
+		_num_buckets = num_buckets;
+		return true;
+	}
 };
-
@@ -45,14 +45,27 @@
 
 #include <drivers/drv_orb_dev.h>
 
+/*
+ * The high rate sensor and attitude topics have many subscribers, they are
+ * copied lock-free so the readers never hold up the publisher (POSIX only).
+ *
+ * The raw gyro and accel topics are also queued, so the sensors app collects
+ * every sample even when it misses a cycle. sensor_combined is not: it is
+ * large and multiplied by the queue depth in RAM on NuttX, and its
+ * subscribers only want the latest sample, the integrals carry the deltas.
+ */
+
 #include "topics/sensor_mag.h"
 ORB_DEFINE(sensor_mag, struct sensor_mag_s);
 
 #include "topics/sensor_accel.h"
-ORB_DEFINE(sensor_accel, struct sensor_accel_s);
+ORB_DEFINE_METADATA(sensor_accel, struct sensor_accel_s, ORB_FLAG_SEQLOCK, 4);
 
 #include "topics/sensor_gyro.h"
-ORB_DEFINE(sensor_gyro, struct sensor_gyro_s);
+ORB_DEFINE_METADATA(sensor_gyro, struct sensor_gyro_s, ORB_FLAG_SEQLOCK, 4);
+
+#include "topics/sensor_imu_fifo.h"
+ORB_DEFINE_FLAGS(sensor_imu_fifo, struct sensor_imu_fifo_s, ORB_FLAG_SEQLOCK);
 
 #include "topics/sensor_baro.h"
 ORB_DEFINE(sensor_baro, struct sensor_baro_s);
@@ -67,10 +80,10 @@ ORB_DEFINE(input_rc, struct input_rc_s);
 ORB_DEFINE(pwm_input, struct pwm_input_s);
 
 #include "topics/vehicle_attitude.h"
-ORB_DEFINE(vehicle_attitude, struct vehicle_attitude_s);
+ORB_DEFINE_FLAGS(vehicle_attitude, struct vehicle_attitude_s, ORB_FLAG_SEQLOCK);
 
 #include "topics/sensor_combined.h"
-ORB_DEFINE(sensor_combined, struct sensor_combined_s);
+ORB_DEFINE_FLAGS(sensor_combined, struct sensor_combined_s, ORB_FLAG_SEQLOCK);
 
 #include "topics/hil_sensor.h"
 ORB_DEFINE(hil_sensor, struct hil_sensor_s);
@@ -125,7 +138,7 @@ ORB_DEFINE(fw_virtual_rates_setpoint, struct fw_virtual_rates_setpoint_s);
 ORB_DEFINE(rc_channels, struct rc_channels_s);
 
 #include "topics/vehicle_command.h"
-ORB_DEFINE(vehicle_command, struct vehicle_command_s);
+ORB_DEFINE_QUEUE(vehicle_command, struct vehicle_command_s, 4);
 
 #include "topics/vehicle_control_mode.h"
 ORB_DEFINE(vehicle_control_mode, struct vehicle_control_mode_s);
@@ -216,6 +229,9 @@ ORB_DEFINE(multirotor_motor_limits, struct multirotor_motor_limits_s);
 #include "topics/telemetry_status.h"
 ORB_DEFINE(telemetry_status, struct telemetry_status_s);
 
+#include "topics/logger_status.h"
+ORB_DEFINE(logger_status, struct logger_status_s);
+
 #include "topics/test_motor.h"
 ORB_DEFINE(test_motor, struct test_motor_s);
 
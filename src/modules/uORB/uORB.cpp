@@ -115,6 +115,37 @@ int  orb_publish(const struct orb_metadata *meta, orb_advert_t handle, const voi
 	return uORB::Manager::get_instance()->orb_publish(meta, handle, data);
 }
 
+/**
+ * Borrow the topic buffer to publish without an intermediate copy.
+ *
+ * The returned buffer belongs to the topic and is filled in place by the
+ * publisher; subscribers keep seeing the previous data until
+ * orb_publish_loaned() is called.
+ *
+ * @param meta    The uORB metadata (usually from the ORB_ID() macro)
+ *      for the topic.
+ * @param handle  The handle returned from orb_advertise.
+ * @return    Pointer to meta->o_size bytes to fill, NULL on error
+ *      with errno set accordingly.
+ */
+void *orb_loan(const struct orb_metadata *meta, orb_advert_t handle)
+{
+	return uORB::Manager::get_instance()->orb_loan(meta, handle);
+}
+
+/**
+ * Publish the buffer obtained from orb_loan().
+ *
+ * @param meta    The uORB metadata (usually from the ORB_ID() macro)
+ *      for the topic.
+ * @param handle  The handle returned from orb_advertise.
+ * @return    OK on success, ERROR otherwise with errno set accordingly.
+ */
+int  orb_publish_loaned(const struct orb_metadata *meta, orb_advert_t handle)
+{
+	return uORB::Manager::get_instance()->orb_publish_loaned(meta, handle);
+}
+
 /**
  * Subscribe to a topic.
  *
@@ -212,6 +243,23 @@ int  orb_copy(const struct orb_metadata *meta, int handle, void *buffer)
 	return uORB::Manager::get_instance()->orb_copy(meta, handle, buffer);
 }
 
+/**
+ * Access the data of a topic without copying it.
+ *
+ * Resets the updated marker like orb_copy(). The data may be overwritten
+ * by the publisher at any time, check orb_peek_valid() after using it.
+ *
+ * @param meta    The uORB metadata (usually from the ORB_ID() macro)
+ *      for the topic.
+ * @param handle  A handle returned from orb_subscribe.
+ * @param peek    Returns the view of the topic data.
+ * @return    OK on success, ERROR otherwise with errno set accordingly.
+ */
+int  orb_peek(const struct orb_metadata *meta, int handle, struct orb_peek_s *peek)
+{
+	return uORB::Manager::get_instance()->orb_peek(meta, handle, peek);
+}
+
 /**
  * Check whether a topic has been published to since the last orb_copy.
  *
@@ -235,6 +283,18 @@ int  orb_check(int handle, bool *updated)
 	return uORB::Manager::get_instance()->orb_check(handle, updated);
 }
 
+/**
+ * Return the number of publications a subscription has missed.
+ *
+ * @param handle  A handle returned from orb_subscribe.
+ * @param count   Returns the number of publications missed since subscribing.
+ * @return    OK on success, ERROR otherwise with errno set accordingly.
+ */
+int  orb_lost_count(int handle, unsigned *count)
+{
+	return uORB::Manager::get_instance()->orb_lost_count(handle, count);
+}
+
 /**
  * Return the last time that the topic was updated.
  *
@@ -52,10 +52,27 @@
 struct orb_metadata {
 	const char *o_name;		/**< unique object name */
 	const size_t o_size;		/**< object size */
+	const uint8_t o_flags;		/**< ORB_FLAG_* options, zero for default behaviour */
+	const uint8_t o_queue;		/**< number of publications buffered per topic, zero or one for a single slot */
 };
 
+/**
+ * Topic option flags, see ORB_DEFINE_FLAGS().
+ */
+#define ORB_FLAG_SEQLOCK	(1 << 0)	/**< lock-free copy: orb_copy never blocks the publisher, readers retry on torn reads */
+
 typedef const struct orb_metadata *orb_id_t;
 
+/**
+ * Read-only view of a topic buffer, see orb_peek().
+ */
+struct orb_peek_s {
+	const void *data;		/**< topic data, valid as long as orb_peek_valid() says so */
+	size_t size;			/**< size of the topic data */
+	const volatile unsigned *seq;	/**< write sequence of the topic */
+	unsigned token;			/**< write sequence the data belongs to */
+};
+
 /**
  * Maximum number of multi topic instances
  */
@@ -112,9 +129,42 @@ enum ORB_PRIO {
  * @param _struct	The structure the topic provides.
  */
 #define ORB_DEFINE(_name, _struct)			\
+	ORB_DEFINE_METADATA(_name, _struct, 0, 0)
+
+/**
+ * Define (instantiate) the uORB metadata for a topic with options.
+ *
+ * Same as ORB_DEFINE(), but allows to opt into non-default topic behaviour.
+ *
+ * @param _name		The name of the topic.
+ * @param _struct	The structure the topic provides.
+ * @param _flags	Bitwise OR of ORB_FLAG_* values.
+ */
+#define ORB_DEFINE_FLAGS(_name, _struct, _flags)	\
+	ORB_DEFINE_METADATA(_name, _struct, _flags, 0)
+
+/**
+ * Define (instantiate) the uORB metadata for a queued topic.
+ *
+ * A queued topic keeps the last _queue_size publications, so subscribers
+ * that copy at a lower rate than the topic is published collect every
+ * publication in order instead of only the latest one. Publications a
+ * subscriber falls further behind on are dropped and counted, see
+ * orb_lost_count().
+ *
+ * @param _name		The name of the topic.
+ * @param _struct	The structure the topic provides.
+ * @param _queue_size	Number of publications kept, rounded up to a power of two.
+ */
+#define ORB_DEFINE_QUEUE(_name, _struct, _queue_size)	\
+	ORB_DEFINE_METADATA(_name, _struct, 0, _queue_size)
+
+#define ORB_DEFINE_METADATA(_name, _struct, _flags, _queue_size)	\
 	const struct orb_metadata __orb_##_name = {	\
 		#_name,					\
-		sizeof(_struct)				\
+		sizeof(_struct),			\
+		(_flags),				\
+		(_queue_size)				\
 	}; struct hack
 
 __BEGIN_DECLS
@@ -197,6 +247,36 @@ extern orb_advert_t orb_advertise_multi(const struct orb_metadata *meta, const v
  */
 extern int	orb_publish(const struct orb_metadata *meta, orb_advert_t handle, const void *data) __EXPORT;
 
+/**
+ * Borrow the topic buffer to publish without an intermediate copy.
+ *
+ * The returned buffer belongs to the topic and is filled in place by the
+ * publisher; subscribers keep seeing the previous data until
+ * orb_publish_loaned() is called. The content of the buffer is undefined,
+ * the publisher must write the complete topic. Only one loan per topic can
+ * be outstanding, and loans must not be taken from interrupt context.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param handle	The handle returned from orb_advertise.
+ * @return		Pointer to meta->o_size bytes to fill, NULL on error
+ *			with errno set accordingly (EBUSY if already lent out).
+ */
+extern void	*orb_loan(const struct orb_metadata *meta, orb_advert_t handle) __EXPORT;
+
+/**
+ * Publish the buffer obtained from orb_loan().
+ *
+ * Behaves like orb_publish() with the data written into the loaned buffer.
+ * The buffer must not be accessed by the publisher afterwards.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param handle	The handle returned from orb_advertise.
+ * @return		OK on success, ERROR otherwise with errno set accordingly.
+ */
+extern int	orb_publish_loaned(const struct orb_metadata *meta, orb_advert_t handle) __EXPORT;
+
 /**
  * Subscribe to a topic.
  *
@@ -283,6 +363,37 @@ extern int	orb_unsubscribe(int handle) __EXPORT;
  */
 extern int	orb_copy(const struct orb_metadata *meta, int handle, void *buffer) __EXPORT;
 
+/**
+ * Access the data of a topic without copying it.
+ *
+ * Like orb_copy(), this resets the updated marker of the subscription. Instead
+ * of copying the data, a read-only pointer into the topic buffer is returned.
+ * The publisher is not held off by the peek and may overwrite the data at any
+ * time, so after reading from the buffer the caller must check
+ * orb_peek_valid() and discard what it read if the check fails (e.g. by
+ * falling back to orb_copy()).
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param handle	A handle returned from orb_subscribe.
+ * @param peek		Returns the view of the topic data.
+ * @return		OK on success, ERROR otherwise with errno set accordingly.
+ */
+extern int	orb_peek(const struct orb_metadata *meta, int handle, struct orb_peek_s *peek) __EXPORT;
+
+/**
+ * Check whether the data returned by orb_peek() is still intact.
+ *
+ * @param peek		The view filled by orb_peek().
+ * @return		true if nothing has been published since the peek.
+ */
+static inline bool orb_peek_valid(const struct orb_peek_s *peek)
+{
+	/* order the reads of the data before the sequence check */
+	__sync_synchronize();
+	return *peek->seq == peek->token;
+}
+
 /**
  * Check whether a topic has been published to since the last orb_copy.
  *
@@ -303,6 +414,19 @@ extern int	orb_copy(const struct orb_metadata *meta, int handle, void *buffer) _
  */
 extern int	orb_check(int handle, bool *updated) __EXPORT;
 
+/**
+ * Return the number of publications a subscription has missed.
+ *
+ * A publication is missed when it has been overwritten before it was
+ * collected with orb_copy or orb_peek. For queued topics this only
+ * happens once the subscriber falls behind by more than the queue size.
+ *
+ * @param handle	A handle returned from orb_subscribe.
+ * @param count		Returns the number of publications missed since subscribing.
+ * @return		OK on success, ERROR otherwise with errno set accordingly.
+ */
+extern int	orb_lost_count(int handle, unsigned *count) __EXPORT;
+
 /**
  * Return the last time that the topic was updated.
  *
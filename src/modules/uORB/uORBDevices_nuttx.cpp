@@ -53,9 +53,13 @@ uORB::DeviceNode::DeviceNode
 ) :
 	CDev(name, path),
 	_meta(meta),
+	_queue_size(uORB::Utils::queue_size(meta)),
 	_data(nullptr),
+	_loan_data(nullptr),
+	_loaned(false),
 	_last_update(0),
 	_generation(0),
+	_seq(0),
 	_publisher(0),
 	_priority(priority),
 	_published(false),
@@ -72,6 +76,9 @@ uORB::DeviceNode::~DeviceNode()
 		delete[] _data;
 	}
 
+	if (_loan_data != nullptr) {
+		delete[] _loan_data;
+	}
 }
 
 int
@@ -185,21 +192,7 @@ uORB::DeviceNode::read(struct file *filp, char *buffer, size_t buflen)
 	irqstate_t flags = irqsave();
 
 	/* if the caller doesn't want the data, don't give it to them */
-	if (nullptr != buffer) {
-		memcpy(buffer, _data, _meta->o_size);
-	}
-
-	/* track the last generation that the file has seen */
-	sd->generation = _generation;
-
-	/* set priority */
-	sd->priority = _priority;
-
-	/*
-	 * Clear the flag that indicates that an update has been reported, as
-	 * we have just collected it.
-	 */
-	sd->update_reported = false;
+	collect(sd, buffer);
 
 	irqrestore(flags);
 
@@ -225,7 +218,7 @@ uORB::DeviceNode::write(struct file *filp, const char *buffer, size_t buflen)
 
 			/* re-check size */
 			if (nullptr == _data) {
-				_data = new uint8_t[_meta->o_size];
+				_data = new uint8_t[_meta->o_size * _queue_size];
 			}
 
 			unlock();
@@ -242,14 +235,13 @@ uORB::DeviceNode::write(struct file *filp, const char *buffer, size_t buflen)
 		return -EIO;
 	}
 
-	/* Perform an atomic copy. */
+	/* Perform an atomic copy and update the timestamp and generation count. */
 	irqstate_t flags = irqsave();
-	memcpy(_data, buffer, _meta->o_size);
-	irqrestore(flags);
-
-	/* update the timestamp and generation count */
+	memcpy(slot(_generation + 1), buffer, _meta->o_size);
 	_last_update = hrt_absolute_time();
 	_generation++;
+	bump_seq();
+	irqrestore(flags);
 
 	/* notify any poll waiters */
 	poll_notify(POLLIN);
@@ -285,6 +277,30 @@ uORB::DeviceNode::ioctl(struct file *filp, int cmd, unsigned long arg)
 		*(int *)arg = sd->priority;
 		return OK;
 
+	case ORBIOCPEEK: {
+			struct orb_peek_s *peek = (struct orb_peek_s *)arg;
+
+			/* nothing to peek at before the first publication */
+			if (_data == nullptr || _seq == 0) {
+				return -EIO;
+			}
+
+			irqstate_t flags = irqsave();
+
+			/* consumes the update just like a copy does */
+			peek->data = collect(sd, nullptr);
+			peek->size = _meta->o_size;
+			peek->seq = &_seq;
+			peek->token = _seq;
+
+			irqrestore(flags);
+			return OK;
+		}
+
+	case ORBIOCGLOST:
+		*(unsigned *)arg = sd->lost;
+		return OK;
+
 	default:
 		/* give it to the superclass */
 		return CDev::ioctl(filp, cmd, arg);
@@ -336,6 +352,106 @@ uORB::DeviceNode::publish
 	return OK;
 }
 
+void *
+uORB::DeviceNode::loan(const orb_metadata *meta, orb_advert_t handle)
+{
+	uORB::DeviceNode *DeviceNode = (uORB::DeviceNode *)handle;
+
+	if (DeviceNode == nullptr || DeviceNode->_meta != meta || up_interrupt_context()) {
+		errno = EINVAL;
+		return nullptr;
+	}
+
+	DeviceNode->lock();
+
+	/* one loan at a time, the second buffer is all there is to lend */
+	if (DeviceNode->_loaned) {
+		DeviceNode->unlock();
+		errno = EBUSY;
+		return nullptr;
+	}
+
+	if (DeviceNode->_loan_data == nullptr) {
+		DeviceNode->_loan_data = new uint8_t[meta->o_size];
+
+		if (DeviceNode->_loan_data == nullptr) {
+			DeviceNode->unlock();
+			errno = ENOMEM;
+			return nullptr;
+		}
+	}
+
+	DeviceNode->_loaned = true;
+	DeviceNode->unlock();
+
+	/* subscribers keep reading _data while the publisher fills the lent buffer */
+	return DeviceNode->_loan_data;
+}
+
+int
+uORB::DeviceNode::publish_loaned(const orb_metadata *meta, orb_advert_t handle)
+{
+	uORB::DeviceNode *DeviceNode = (uORB::DeviceNode *)handle;
+
+	if (DeviceNode == nullptr || DeviceNode->_meta != meta) {
+		errno = EINVAL;
+		return ERROR;
+	}
+
+	DeviceNode->lock();
+
+	if (!DeviceNode->_loaned) {
+		DeviceNode->unlock();
+		errno = EINVAL;
+		return ERROR;
+	}
+
+	irqstate_t flags = irqsave();
+	uint8_t *data = DeviceNode->_loan_data;
+
+	if (DeviceNode->_queue_size > 1) {
+		/* the loan cannot become one slot of the queue, copy it over */
+		data = DeviceNode->slot(DeviceNode->_generation + 1);
+		memcpy(data, DeviceNode->_loan_data, meta->o_size);
+
+	} else {
+		/* publish by swapping buffers, the old data becomes the next loan */
+		DeviceNode->_loan_data = DeviceNode->_data;
+		DeviceNode->_data = data;
+	}
+
+	DeviceNode->_last_update = hrt_absolute_time();
+	DeviceNode->_generation++;
+	DeviceNode->bump_seq();
+	irqrestore(flags);
+
+	DeviceNode->_loaned = false;
+
+	/*
+	 * send the data over the Multi-ORB link while the buffer cannot
+	 * be swapped out by another loan
+	 */
+	uORBCommunicator::IChannel *ch = uORB::Manager::get_instance()->get_uorb_communicator();
+	int ret = OK;
+
+	if (ch != nullptr) {
+		if (ch->send_message(meta->o_name, meta->o_size, data) != 0) {
+			warnx("[uORB::DeviceNode::publish_loaned(%d)]: Error Sending [%s] topic data over comm_channel",
+			      __LINE__, meta->o_name);
+			ret = ERROR;
+		}
+	}
+
+	DeviceNode->unlock();
+
+	DeviceNode->_published = true;
+
+	/* notify any poll waiters */
+	DeviceNode->poll_notify(POLLIN);
+
+	return ret;
+}
+
 pollevent_t
 uORB::DeviceNode::poll_state(struct file *filp)
 {
@@ -461,6 +577,46 @@ uORB::DeviceNode::update_deferred_trampoline(void *arg)
 	node->update_deferred();
 }
 
+const uint8_t *
+uORB::DeviceNode::collect(SubscriberData *sd, char *buffer)
+{
+	unsigned generation = _generation;
+
+	/* nothing new, hand out the latest publication again */
+	if (sd->generation != _generation) {
+		const unsigned behind = _generation - sd->generation;
+
+		/* older publications have been overwritten, continue with the oldest one kept */
+		if (behind > _queue_size) {
+			sd->lost += behind - _queue_size;
+			generation = _generation - _queue_size + 1;
+
+		} else {
+			generation = sd->generation + 1;
+		}
+	}
+
+	const uint8_t *src = slot(generation);
+
+	if (nullptr != buffer) {
+		memcpy(buffer, src, _meta->o_size);
+	}
+
+	/* track the last generation that the file has seen */
+	sd->generation = generation;
+
+	/* set priority */
+	sd->priority = _priority;
+
+	/*
+	 * Clear the flag that indicates that an update has been reported, as
+	 * we have just collected it.
+	 */
+	sd->update_reported = false;
+
+	return src;
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 void uORB::DeviceNode::add_internal_subscriber()
@@ -502,8 +658,8 @@ int16_t uORB::DeviceNode::process_add_subscription(int32_t rateInHz)
 	// send the data to the remote entity.
 	uORBCommunicator::IChannel *ch = uORB::Manager::get_instance()->get_uorb_communicator();
 
-	if (_data != nullptr && ch != nullptr) { // _data will not be null if there is a publisher.
-		ch->send_message(_meta->o_name, _meta->o_size, _data);
+	if (_data != nullptr && _generation != 0 && ch != nullptr) { // _data will not be null if there is a publisher.
+		ch->send_message(_meta->o_name, _meta->o_size, slot(_generation));
 	}
 
 	return OK;
@@ -675,11 +831,5 @@ uORB::DeviceMaster::ioctl(struct file *filp, int cmd, unsigned long arg)
 
 uORB::DeviceNode *uORB::DeviceMaster::GetDeviceNode(const char *nodepath)
 {
-	uORB::DeviceNode *rc = nullptr;
-
-	if (_node_map.find(nodepath)) {
-		rc = _node_map.get(nodepath);
-	}
-
-	return rc;
+	return _node_map.get(nodepath);
 }
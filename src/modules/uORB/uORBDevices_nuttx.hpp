@@ -122,6 +122,16 @@ public:
 		const void *data
 	);
 
+	/**
+	 * Lend the publisher a buffer to fill in place, see orb_loan().
+	 */
+	static void *loan(const orb_metadata *meta, orb_advert_t handle);
+
+	/**
+	 * Publish the buffer handed out by loan(), see orb_publish_loaned().
+	 */
+	static int publish_loaned(const orb_metadata *meta, orb_advert_t handle);
+
 	/**
 	 * processes a request for add subscription from remote
 	 * @param rateInHz
@@ -178,12 +188,17 @@ private:
 		void    *poll_priv; /**< saved copy of fds->f_priv while poll is active */
 		bool    update_reported; /**< true if we have reported the update via poll/check */
 		int   priority; /**< priority of publisher */
+		unsigned  lost; /**< number of publications overwritten before they were collected */
 	};
 
 	const struct orb_metadata *_meta; /**< object metadata information */
-	uint8_t     *_data;   /**< allocated object buffer */
+	const unsigned    _queue_size; /**< number of publications kept, a power of two */
+	uint8_t     *_data;   /**< allocated object buffer, _queue_size slots */
+	uint8_t     *_loan_data; /**< second buffer handed out by loan(), allocated on first use */
+	bool        _loaned;  /**< true while _loan_data is lent to a publisher */
 	hrt_abstime   _last_update; /**< time the object was last updated */
 	volatile unsigned   _generation;  /**< object generation count */
+	volatile unsigned   _seq;   /**< write sequence, checked by orb_peek_valid(), zero if never written */
 	pid_t     _publisher; /**< if nonzero, current publisher */
 	const int   _priority;  /**< priority of topic */
 	bool _published;  /**< has ever data been published */
@@ -219,6 +234,39 @@ private: // private class methods.
 	 */
 	bool      appears_updated(SubscriberData *sd);
 
+	/**
+	 * Slot of the object buffer holding a publication.
+	 *
+	 * @param generation  Node generation right after the publication.
+	 */
+	uint8_t      *slot(unsigned generation) { return _data + ((generation - 1) & (_queue_size - 1)) * _meta->o_size; }
+
+	/**
+	 * Collect the next publication for a subscriber and mark it as seen.
+	 *
+	 * Must be called with interrupts disabled.
+	 *
+	 * @param sd    The subscriber.
+	 * @param buffer  Destination, may be NULL to only mark the publication as seen.
+	 * @return    The slot the publication was read from.
+	 */
+	const uint8_t    *collect(SubscriberData *sd, char *buffer);
+
+	/**
+	 * Advance the write sequence by one publication.
+	 *
+	 * Must be called with interrupts disabled.
+	 */
+	void      bump_seq()
+	{
+		/* zero is reserved for "never written" */
+		_seq += 2;
+
+		if (_seq == 0) {
+			_seq = 2;
+		}
+	}
+
 	// disable copy and assignment operators
 	DeviceNode(const DeviceNode &);
 	DeviceNode &operator=(const DeviceNode &);
@@ -35,6 +35,7 @@
 #include <string.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sched.h>
 #include <algorithm>
 
 #include "uORBDevices_posix.hpp"
@@ -43,7 +44,7 @@
 #include "uORBCommunicator.hpp"
 #include <stdlib.h>
 
-std::map<std::string, uORB::DeviceNode *> uORB::DeviceMaster::_node_map;
+uORB::ORBMap uORB::DeviceMaster::_node_map;
 
 
 uORB::DeviceNode::SubscriberData  *uORB::DeviceNode::filp_to_sd(device::file_t *filp)
@@ -63,9 +64,13 @@ uORB::DeviceNode::SubscriberData  *uORB::DeviceNode::filp_to_sd(device::file_t *
 uORB::DeviceNode::DeviceNode(const struct orb_metadata *meta, const char *name, const char *path, int priority) :
 	VDev(name, path),
 	_meta(meta),
+	_queue_size(uORB::Utils::queue_size(meta)),
 	_data(nullptr),
+	_loan_data(nullptr),
+	_loaned(false),
 	_last_update(0),
 	_generation(0),
+	_seq(0),
 	_publisher(0),
 	_priority(priority),
 	_published(false),
@@ -81,6 +86,9 @@ uORB::DeviceNode::~DeviceNode()
 		delete[] _data;
 	}
 
+	if (_loan_data != nullptr) {
+		delete[] _loan_data;
+	}
 }
 
 int
@@ -192,30 +200,11 @@ uORB::DeviceNode::read(device::file_t *filp, char *buffer, size_t buflen)
 		return -EIO;
 	}
 
-	/*
-	 * Perform an atomic copy & state update
-	 */
-	lock();
-
 	/* if the caller doesn't want the data, don't give it to them */
-	if (nullptr != buffer) {
-		memcpy(buffer, _data, _meta->o_size);
+	if (collect(sd, buffer) == 0) {
+		return 0;
 	}
 
-	/* track the last generation that the file has seen */
-	sd->generation = _generation;
-
-	/* set priority */
-	sd->priority = _priority;
-
-	/*
-	 * Clear the flag that indicates that an update has been reported, as
-	 * we have just collected it.
-	 */
-	sd->update_reported = false;
-
-	unlock();
-
 	return _meta->o_size;
 }
 
@@ -237,7 +226,7 @@ uORB::DeviceNode::write(device::file_t *filp, const char *buffer, size_t buflen)
 
 		/* re-check size */
 		if (nullptr == _data) {
-			_data = new uint8_t[_meta->o_size];
+			_data = new uint8_t[_meta->o_size * _queue_size];
 		}
 
 		unlock();
@@ -253,14 +242,14 @@ uORB::DeviceNode::write(device::file_t *filp, const char *buffer, size_t buflen)
 		return -EIO;
 	}
 
-	/* Perform an atomic copy. */
+	/* Perform an atomic copy and update the timestamp and generation count. */
 	lock();
-	memcpy(_data, buffer, _meta->o_size);
-	unlock();
-
-	/* update the timestamp and generation count */
+	write_begin();
+	memcpy(slot(_generation + 1), buffer, _meta->o_size);
 	_last_update = hrt_absolute_time();
 	_generation++;
+	write_end();
+	unlock();
 
 	/* notify any poll waiters */
 	poll_notify(POLLIN);
@@ -297,6 +286,29 @@ uORB::DeviceNode::ioctl(device::file_t *filp, int cmd, unsigned long arg)
 		*(int *)arg = sd->priority;
 		return PX4_OK;
 
+	case ORBIOCPEEK: {
+			struct orb_peek_s *peek = (struct orb_peek_s *)arg;
+			const uint8_t *data;
+
+			/* consumes the update just like a copy does */
+			unsigned seq = collect(sd, nullptr, &data);
+
+			if (seq == 0) {
+				/* nothing to peek at before the first publication */
+				return -EIO;
+			}
+
+			peek->data = data;
+			peek->size = _meta->o_size;
+			peek->seq = &_seq;
+			peek->token = seq;
+			return PX4_OK;
+		}
+
+	case ORBIOCGLOST:
+		*(unsigned *)arg = sd->lost;
+		return PX4_OK;
+
 	default:
 		/* give it to the superclass */
 		return VDev::ioctl(filp, cmd, arg);
@@ -351,6 +363,104 @@ uORB::DeviceNode::publish(const orb_metadata *meta, orb_advert_t handle, const v
 	return PX4_OK;
 }
 
+void *
+uORB::DeviceNode::loan(const orb_metadata *meta, orb_advert_t handle)
+{
+	uORB::DeviceNode *devnode = (uORB::DeviceNode *)handle;
+
+	if (devnode == nullptr || devnode->_meta != meta) {
+		errno = EINVAL;
+		return nullptr;
+	}
+
+	devnode->lock();
+
+	/* one loan at a time, the second buffer is all there is to lend */
+	if (devnode->_loaned) {
+		devnode->unlock();
+		errno = EBUSY;
+		return nullptr;
+	}
+
+	if (devnode->_loan_data == nullptr) {
+		devnode->_loan_data = new uint8_t[meta->o_size];
+
+		if (devnode->_loan_data == nullptr) {
+			devnode->unlock();
+			errno = ENOMEM;
+			return nullptr;
+		}
+	}
+
+	devnode->_loaned = true;
+	devnode->unlock();
+
+	/* subscribers keep reading _data while the publisher fills the lent buffer */
+	return devnode->_loan_data;
+}
+
+int
+uORB::DeviceNode::publish_loaned(const orb_metadata *meta, orb_advert_t handle)
+{
+	uORB::DeviceNode *devnode = (uORB::DeviceNode *)handle;
+
+	if (devnode == nullptr || devnode->_meta != meta) {
+		errno = EINVAL;
+		return ERROR;
+	}
+
+	devnode->lock();
+
+	if (!devnode->_loaned) {
+		devnode->unlock();
+		errno = EINVAL;
+		return ERROR;
+	}
+
+	devnode->write_begin();
+	uint8_t *data = devnode->_loan_data;
+
+	if (devnode->_queue_size > 1) {
+		/* the loan cannot become one slot of the queue, copy it over */
+		data = devnode->slot(devnode->_generation + 1);
+		memcpy(data, devnode->_loan_data, meta->o_size);
+
+	} else {
+		/* publish by swapping buffers, the old data becomes the next loan */
+		devnode->_loan_data = devnode->_data;
+		devnode->_data = data;
+	}
+
+	devnode->_last_update = hrt_absolute_time();
+	devnode->_generation++;
+	devnode->write_end();
+	devnode->_loaned = false;
+
+	/*
+	 * send the data over the Multi-ORB link while the buffer cannot
+	 * be swapped out by another publication
+	 */
+	uORBCommunicator::IChannel *ch = uORB::Manager::get_instance()->get_uorb_communicator();
+	int ret = PX4_OK;
+
+	if (ch != nullptr) {
+		if (ch->send_message(meta->o_name, meta->o_size, data) != 0) {
+			warnx("[uORB::DeviceNode::publish_loaned(%d)]: Error Sending [%s] topic data over comm_channel",
+			      __LINE__, meta->o_name);
+			ret = ERROR;
+		}
+	}
+
+	devnode->unlock();
+
+	devnode->_published = true;
+
+	/* notify any poll waiters */
+	devnode->poll_notify(POLLIN);
+
+	return ret;
+}
+
 pollevent_t
 uORB::DeviceNode::poll_state(device::file_t *filp)
 {
@@ -456,6 +566,141 @@ out:
 	return ret;
 }
 
+unsigned
+uORB::DeviceNode::next_generation(SubscriberData *sd, unsigned generation, unsigned &lost)
+{
+	lost = 0;
+
+	/* nothing new, hand out the latest publication again */
+	if (sd->generation == generation) {
+		return generation;
+	}
+
+	const unsigned behind = generation - sd->generation;
+
+	/* older publications have been overwritten, continue with the oldest one kept */
+	if (behind > _queue_size) {
+		lost = behind - _queue_size;
+		return generation - _queue_size + 1;
+	}
+
+	return sd->generation + 1;
+}
+
+unsigned
+uORB::DeviceNode::collect(SubscriberData *sd, char *buffer, const uint8_t **data)
+{
+	unsigned seq;
+	unsigned generation;
+	unsigned lost;
+	const uint8_t *src;
+
+	if (_meta->o_flags & ORB_FLAG_SEQLOCK) {
+		/* never take the lock, so the publisher is not held up by readers */
+		for (;;) {
+			seq = __atomic_load_n(&_seq, __ATOMIC_ACQUIRE);
+
+			/* nothing written yet */
+			if (seq == 0) {
+				return 0;
+			}
+
+			/* writer in progress, try again */
+			if (seq & 1) {
+				sched_yield();
+				continue;
+			}
+
+			/* loans swap the buffer, so pick the slot within the sequence as well */
+			generation = next_generation(sd, _generation, lost);
+			src = slot(generation);
+
+			if (nullptr != buffer) {
+				memcpy(buffer, src, _meta->o_size);
+			}
+
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+			if (__atomic_load_n(&_seq, __ATOMIC_RELAXED) == seq) {
+				break;
+			}
+
+			/* a write overlapped with the copy, the data may be torn: retry */
+		}
+
+		/* the subscriber data is only touched by the thread owning the handle */
+		mark_collected(sd, generation, lost);
+
+	} else {
+		/*
+		 * Perform an atomic copy & state update
+		 */
+		lock();
+
+		seq = _seq;
+
+		if (seq == 0) {
+			unlock();
+			return 0;
+		}
+
+		generation = next_generation(sd, _generation, lost);
+		src = slot(generation);
+
+		if (nullptr != buffer) {
+			memcpy(buffer, src, _meta->o_size);
+		}
+
+		mark_collected(sd, generation, lost);
+
+		unlock();
+	}
+
+	if (data != nullptr) {
+		*data = src;
+	}
+
+	return seq;
+}
+
+void
+uORB::DeviceNode::mark_collected(SubscriberData *sd, unsigned generation, unsigned lost)
+{
+	/* track the last generation that the file has seen */
+	sd->generation = generation;
+	sd->lost += lost;
+
+	/* set priority */
+	sd->priority = _priority;
+
+	/*
+	 * Clear the flag that indicates that an update has been reported, as
+	 * we have just collected it.
+	 */
+	sd->update_reported = false;
+}
+
+void
+uORB::DeviceNode::write_begin()
+{
+	/* writers are serialized by the lock, lock-free readers only watch _seq */
+	__atomic_store_n(&_seq, _seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void
+uORB::DeviceNode::write_end()
+{
+	unsigned seq = _seq + 1;
+
+	/* zero is reserved for "never written" */
+	if (seq == 0) {
+		seq = 2;
+	}
+
+	__atomic_store_n(&_seq, seq, __ATOMIC_RELEASE);
+}
+
 void
 uORB::DeviceNode::update_deferred()
 {
@@ -515,8 +760,8 @@ int16_t uORB::DeviceNode::process_add_subscription(int32_t rateInHz)
 	// send the data to the remote entity.
 	uORBCommunicator::IChannel *ch = uORB::Manager::get_instance()->get_uorb_communicator();
 
-	if (_data != nullptr && ch != nullptr) { // _data will not be null if there is a publisher.
-		ch->send_message(_meta->o_name, _meta->o_size, _data);
+	if (_data != nullptr && _generation != 0 && ch != nullptr) { // _data will not be null if there is a publisher.
+		ch->send_message(_meta->o_name, _meta->o_size, slot(_generation));
 	}
 
 	return 0;
@@ -667,7 +912,7 @@ uORB::DeviceMaster::ioctl(device::file_t *filp, int cmd, unsigned long arg)
 
 				} else {
 					// add to the node map;.
-					_node_map[std::string(nodepath)] = node;
+					_node_map.insert(nodepath, node);
 				}
 
 
@@ -693,12 +938,5 @@ uORB::DeviceMaster::ioctl(device::file_t *filp, int cmd, unsigned long arg)
 
 uORB::DeviceNode *uORB::DeviceMaster::GetDeviceNode(const char *nodepath)
 {
-	uORB::DeviceNode *rc = nullptr;
-	std::string np(nodepath);
-
-	if (_node_map.find(np) != _node_map.end()) {
-		rc = _node_map[np];
-	}
-
-	return rc;
+	return _node_map.get(nodepath);
 }
@@ -35,9 +35,8 @@
 #define _uORBDevices_posix_hpp_
 
 #include <stdint.h>
-#include <string>
-#include <map>
 #include "uORBCommon.hpp"
+#include "ORBMap.hpp"
 
 namespace uORB
 {
@@ -59,6 +58,16 @@ public:
 
 	static ssize_t    publish(const orb_metadata *meta, orb_advert_t handle, const void *data);
 
+	/**
+	 * Lend the publisher a buffer to fill in place, see orb_loan().
+	 */
+	static void      *loan(const orb_metadata *meta, orb_advert_t handle);
+
+	/**
+	 * Publish the buffer handed out by loan(), see orb_publish_loaned().
+	 */
+	static int        publish_loaned(const orb_metadata *meta, orb_advert_t handle);
+
 	/**
 	 * processes a request for add subscription from remote
 	 * @param rateInHz
@@ -115,12 +124,17 @@ private:
 		void    *poll_priv; /**< saved copy of fds->f_priv while poll is active */
 		bool    update_reported; /**< true if we have reported the update via poll/check */
 		int   priority; /**< priority of publisher */
+		unsigned  lost; /**< number of publications overwritten before they were collected */
 	};
 
 	const struct orb_metadata *_meta; /**< object metadata information */
-	uint8_t     *_data;   /**< allocated object buffer */
+	const unsigned    _queue_size; /**< number of publications kept, a power of two */
+	uint8_t     *_data;   /**< allocated object buffer, _queue_size slots */
+	uint8_t     *_loan_data; /**< second buffer handed out by loan(), allocated on first use */
+	bool        _loaned;  /**< true while _loan_data is lent to a publisher */
 	hrt_abstime   _last_update; /**< time the object was last updated */
 	volatile unsigned   _generation;  /**< object generation count */
+	volatile unsigned   _seq;   /**< write sequence, odd while a write is in progress, zero if never written */
 	unsigned long     _publisher; /**< if nonzero, current publisher */
 	const int   _priority;  /**< priority of topic */
 	bool _published;  /**< has ever data been published */
@@ -149,6 +163,49 @@ private:
 	 */
 	bool      appears_updated(SubscriberData *sd);
 
+	/**
+	 * Slot of the object buffer holding a publication.
+	 *
+	 * @param generation  Node generation right after the publication.
+	 */
+	uint8_t      *slot(unsigned generation) { return _data + ((generation - 1) & (_queue_size - 1)) * _meta->o_size; }
+
+	/**
+	 * Pick the publication a subscriber collects next.
+	 *
+	 * @param sd    The subscriber.
+	 * @param generation  Current generation of the node.
+	 * @param lost    Returns the number of publications the subscriber missed.
+	 * @return    Generation of the publication to collect.
+	 */
+	unsigned    next_generation(SubscriberData *sd, unsigned generation, unsigned &lost);
+
+	/**
+	 * Collect the next publication for a subscriber and mark it as seen.
+	 *
+	 * Topics flagged ORB_FLAG_SEQLOCK are read without taking the lock,
+	 * retrying until a copy is obtained that no write overlapped with.
+	 *
+	 * @param sd    The subscriber.
+	 * @param buffer  Destination, may be NULL to only mark the publication as seen.
+	 * @param data    If not NULL, returns the slot the publication was read from.
+	 * @return    The write sequence of the copy, zero if nothing has been written yet.
+	 */
+	unsigned    collect(SubscriberData *sd, char *buffer, const uint8_t **data = nullptr);
+
+	/**
+	 * Update the subscriber state after it collected a publication.
+	 */
+	void      mark_collected(SubscriberData *sd, unsigned generation, unsigned lost);
+
+	/**
+	 * Mark the start and end of a modification of the object buffer.
+	 *
+	 * Must be called with the node lock held.
+	 */
+	void      write_begin();
+	void      write_end();
+
 
 	// disable copy and assignment operators
 	DeviceNode(const DeviceNode &);
@@ -172,7 +229,7 @@ public:
 	virtual int   ioctl(device::file_t *filp, int cmd, unsigned long arg);
 private:
 	Flavor      _flavor;
-	static std::map<std::string, uORB::DeviceNode *> _node_map;
+	static ORBMap _node_map;
 };
 
 #endif /* _uORBDeviceNode_posix.hpp */
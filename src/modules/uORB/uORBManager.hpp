@@ -135,6 +135,30 @@ public:
 	 */
 	int  orb_publish(const struct orb_metadata *meta, orb_advert_t handle, const void *data) ;
 
+	/**
+	 * Borrow the topic buffer to publish without an intermediate copy.
+	 *
+	 * Subscribers keep seeing the previous data until orb_publish_loaned()
+	 * is called. Only one loan per topic can be outstanding.
+	 *
+	 * @param meta    The uORB metadata (usually from the ORB_ID() macro)
+	 *      for the topic.
+	 * @param handle  The handle returned from orb_advertise.
+	 * @return    Pointer to meta->o_size bytes to fill, NULL on error
+	 *      with errno set accordingly.
+	 */
+	void *orb_loan(const struct orb_metadata *meta, orb_advert_t handle) ;
+
+	/**
+	 * Publish the buffer obtained from orb_loan().
+	 *
+	 * @param meta    The uORB metadata (usually from the ORB_ID() macro)
+	 *      for the topic.
+	 * @param handle  The handle returned from orb_advertise.
+	 * @return    OK on success, ERROR otherwise with errno set accordingly.
+	 */
+	int  orb_publish_loaned(const struct orb_metadata *meta, orb_advert_t handle) ;
+
 	/**
 	 * Subscribe to a topic.
 	 *
@@ -220,6 +244,20 @@ public:
 	 */
 	int  orb_copy(const struct orb_metadata *meta, int handle, void *buffer) ;
 
+	/**
+	 * Access the data of a topic without copying it.
+	 *
+	 * Resets the updated marker like orb_copy(). The data may be overwritten
+	 * by the publisher at any time, check orb_peek_valid() after using it.
+	 *
+	 * @param meta    The uORB metadata (usually from the ORB_ID() macro)
+	 *      for the topic.
+	 * @param handle  A handle returned from orb_subscribe.
+	 * @param peek    Returns the view of the topic data.
+	 * @return    OK on success, ERROR otherwise with errno set accordingly.
+	 */
+	int  orb_peek(const struct orb_metadata *meta, int handle, struct orb_peek_s *peek) ;
+
 	/**
 	 * Check whether a topic has been published to since the last orb_copy.
 	 *
@@ -240,6 +278,15 @@ public:
 	 */
 	int  orb_check(int handle, bool *updated) ;
 
+	/**
+	 * Return the number of publications a subscription has missed.
+	 *
+	 * @param handle  A handle returned from orb_subscribe.
+	 * @param count   Returns the number of publications missed since subscribing.
+	 * @return    OK on success, ERROR otherwise with errno set accordingly.
+	 */
+	int  orb_lost_count(int handle, unsigned *count) ;
+
 	/**
 	 * Return the last time that the topic was updated.
 	 *
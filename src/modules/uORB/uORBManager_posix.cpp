@@ -123,6 +123,16 @@ orb_advert_t uORB::Manager::orb_advertise_multi(const struct orb_metadata *meta,
 	return advertiser;
 }
 
+void *uORB::Manager::orb_loan(const struct orb_metadata *meta, orb_advert_t handle)
+{
+	return uORB::DeviceNode::loan(meta, handle);
+}
+
+int uORB::Manager::orb_publish_loaned(const struct orb_metadata *meta, orb_advert_t handle)
+{
+	return uORB::DeviceNode::publish_loaned(meta, handle);
+}
+
 int uORB::Manager::orb_subscribe(const struct orb_metadata *meta)
 {
 	return node_open(PUBSUB, meta, nullptr, false);
@@ -162,11 +172,32 @@ int uORB::Manager::orb_copy(const struct orb_metadata *meta, int handle, void *b
 	return PX4_OK;
 }
 
+int uORB::Manager::orb_peek(const struct orb_metadata *meta, int handle, struct orb_peek_s *peek)
+{
+	int ret = px4_ioctl(handle, ORBIOCPEEK, (unsigned long)(uintptr_t)peek);
+
+	if (ret < 0) {
+		return ERROR;
+	}
+
+	if (peek->size != meta->o_size) {
+		errno = EIO;
+		return ERROR;
+	}
+
+	return PX4_OK;
+}
+
 int uORB::Manager::orb_check(int handle, bool *updated)
 {
 	return px4_ioctl(handle, ORBIOCUPDATED, (unsigned long)(uintptr_t)updated);
 }
 
+int uORB::Manager::orb_lost_count(int handle, unsigned *count)
+{
+	return px4_ioctl(handle, ORBIOCGLOST, (unsigned long)(uintptr_t)count);
+}
+
 int uORB::Manager::orb_stat(int handle, uint64_t *time)
 {
 	return px4_ioctl(handle, ORBIOCLASTUPDATE, (unsigned long)(uintptr_t)time);
@@ -36,6 +36,7 @@
 #include <px4_config.h>
 #include <px4_time.h>
 #include <stdio.h>
+#include <string.h>
 
 uORBTest::UnitTest &uORBTest::UnitTest::instance()
 {
@@ -158,6 +159,42 @@ int uORBTest::UnitTest::test()
 		return ret;
 	}
 
+	ret = test_seqlock();
+
+	if (ret != OK) {
+		return ret;
+	}
+
+	ret = test_loan_peek();
+
+	if (ret != OK) {
+		return ret;
+	}
+
+	ret = test_queue(ORB_ID(orb_test_queue));
+
+	if (ret != OK) {
+		return ret;
+	}
+
+	ret = test_queue(ORB_ID(orb_test_queue_seqlock));
+
+	if (ret != OK) {
+		return ret;
+	}
+
+	ret = test_poll_wakeup();
+
+	if (ret != OK) {
+		return ret;
+	}
+
+	ret = test_many_subscriptions();
+
+	if (ret != OK) {
+		return ret;
+	}
+
 	return OK;
 }
 
@@ -392,6 +429,486 @@ int uORBTest::UnitTest::test_multi_reversed()
 	return test_note("PASS multi-topic reversed");
 }
 
+int uORBTest::UnitTest::test_loan_peek()
+{
+	test_note("try zero-copy loan and peek");
+
+	struct orb_test_large t, u;
+	struct orb_peek_s peek;
+	bool updated;
+
+	memset(&t, 0, sizeof(t));
+	orb_advert_t ptopic = orb_advertise(ORB_ID(orb_test_loan), &t);
+
+	if (ptopic == nullptr) {
+		return test_fail("advertise failed: %d", errno);
+	}
+
+	int sfd = orb_subscribe(ORB_ID(orb_test_loan));
+
+	if (sfd < 0) {
+		return test_fail("subscribe failed: %d", errno);
+	}
+
+	orb_copy(ORB_ID(orb_test_loan), sfd, &u);
+
+	struct orb_test_large *loaned = (struct orb_test_large *)orb_loan(ORB_ID(orb_test_loan), ptopic);
+
+	if (loaned == nullptr) {
+		return test_fail("loan failed: %d", errno);
+	}
+
+	if (orb_loan(ORB_ID(orb_test_loan), ptopic) != nullptr) {
+		return test_fail("second loan granted");
+	}
+
+	loaned->val = 42;
+	loaned->time = hrt_absolute_time();
+
+	/* the loan is not visible before it is published */
+	if (PX4_OK != orb_check(sfd, &updated) || updated) {
+		return test_fail("loan visible before publication");
+	}
+
+	if (PX4_OK != orb_publish_loaned(ORB_ID(orb_test_loan), ptopic)) {
+		return test_fail("publish loaned failed");
+	}
+
+	if (PX4_OK != orb_check(sfd, &updated) || !updated) {
+		return test_fail("missing updated flag after loaned publication");
+	}
+
+	if (PX4_OK != orb_peek(ORB_ID(orb_test_loan), sfd, &peek)) {
+		return test_fail("peek failed: %d", errno);
+	}
+
+	if (((const struct orb_test_large *)peek.data)->val != 42 || !orb_peek_valid(&peek)) {
+		return test_fail("peek mismatch: %d", ((const struct orb_test_large *)peek.data)->val);
+	}
+
+	/* the peek consumed the update */
+	if (PX4_OK != orb_check(sfd, &updated) || updated) {
+		return test_fail("updated flag not cleared by peek");
+	}
+
+	/* a new publication invalidates the view */
+	t.val = 43;
+
+	if (PX4_OK != orb_publish(ORB_ID(orb_test_loan), ptopic, &t)) {
+		return test_fail("publish failed");
+	}
+
+	if (orb_peek_valid(&peek)) {
+		return test_fail("peek still valid after publication");
+	}
+
+	if (PX4_OK != orb_copy(ORB_ID(orb_test_loan), sfd, &u) || u.val != 43) {
+		return test_fail("copy after peek mismatch: %d", u.val);
+	}
+
+	orb_unsubscribe(sfd);
+
+	return test_note("PASS loan and peek test");
+}
+
+int uORBTest::UnitTest::test_queue(const struct orb_metadata *meta)
+{
+	test_note("try queued topic %s", meta->o_name);
+
+	struct orb_test t, u;
+	unsigned lost;
+	bool updated;
+
+	t.val = 0;
+	orb_advert_t ptopic = orb_advertise(meta, &t);
+
+	if (ptopic == nullptr) {
+		return test_fail("advertise failed: %d", errno);
+	}
+
+	int sfd = orb_subscribe(meta);
+
+	if (sfd < 0) {
+		return test_fail("subscribe failed: %d", errno);
+	}
+
+	if (PX4_OK != orb_copy(meta, sfd, &u) || u.val != 0) {
+		return test_fail("copy(0) mismatch: %d", u.val);
+	}
+
+	/* overrun the queue of four by two publications */
+	for (t.val = 1; t.val <= 6; t.val++) {
+		if (PX4_OK != orb_publish(meta, ptopic, &t)) {
+			return test_fail("publish %d failed", t.val);
+		}
+	}
+
+	/* the oldest publications kept are collected in order */
+	for (int expected = 3; expected <= 6; expected++) {
+		if (PX4_OK != orb_check(sfd, &updated) || !updated) {
+			return test_fail("missing updated flag before %d", expected);
+		}
+
+		if (PX4_OK != orb_copy(meta, sfd, &u) || u.val != expected) {
+			return test_fail("copy mismatch: %d expected %d", u.val, expected);
+		}
+	}
+
+	if (PX4_OK != orb_check(sfd, &updated) || updated) {
+		return test_fail("spurious updated flag after draining the queue");
+	}
+
+	if (PX4_OK != orb_lost_count(sfd, &lost) || lost != 2) {
+		return test_fail("lost count mismatch: %u expected 2", lost);
+	}
+
+	/* copying again without an update returns the latest publication */
+	if (PX4_OK != orb_copy(meta, sfd, &u) || u.val != 6) {
+		return test_fail("re-copy mismatch: %d expected 6", u.val);
+	}
+
+	orb_unsubscribe(sfd);
+
+	return test_note("PASS queued topic test");
+}
+
+int uORBTest::UnitTest::test_poll_wakeup()
+{
+#ifdef __PX4_NUTTX
+	return OK;
+#else
+	test_note("compare px4_poll with a persistent poll set");
+
+	struct orb_test_medium t;
+	memset(&t, 0, sizeof(t));
+	poll_pub = orb_advertise(ORB_ID(orb_test_poll), &t);
+
+	if (poll_pub == nullptr) {
+		return test_fail("advertise failed: %d", errno);
+	}
+
+	if (PX4_OK != poll_wakeup_test(false)) {
+		return test_fail("px4_poll wakeup test failed");
+	}
+
+	if (PX4_OK != poll_wakeup_test(true)) {
+		return test_fail("poll set wakeup test failed");
+	}
+
+	return test_note("PASS poll wakeup test");
+#endif
+}
+
+int uORBTest::UnitTest::test_many_subscriptions()
+{
+	test_note("try many concurrent subscriptions");
+
+	const unsigned count = 300;
+	int fds[count];
+
+	/* twice, so the second round has to reuse the released descriptors */
+	for (unsigned round = 0; round < 2; round++) {
+		for (unsigned i = 0; i < count; i++) {
+			fds[i] = orb_subscribe(ORB_ID(orb_test));
+
+			if (fds[i] < 0) {
+				for (unsigned j = 0; j < i; j++) {
+					orb_unsubscribe(fds[j]);
+				}
+
+				return test_fail("subscribe %u failed: %d", i, errno);
+			}
+		}
+
+		for (unsigned i = 0; i < count; i++) {
+			orb_unsubscribe(fds[i]);
+		}
+	}
+
+	return test_note("PASS many subscriptions test");
+}
+
+int uORBTest::UnitTest::poll_wakeup_test(bool persistent)
+{
+#ifdef __PX4_NUTTX
+	return OK;
+#else
+	struct orb_test_medium t;
+	int sfd = orb_subscribe(ORB_ID(orb_test_poll));
+
+	if (sfd < 0) {
+		return test_fail("subscribe failed: %d", errno);
+	}
+
+	orb_copy(ORB_ID(orb_test_poll), sfd, &t);
+
+	px4_pollfd_struct_t fds[1];
+	fds[0].fd = sfd;
+	fds[0].events = POLLIN;
+
+	px4_pollset_t *set = nullptr;
+
+	if (persistent) {
+		set = px4_pollset_create(fds, 1);
+
+		if (set == nullptr) {
+			orb_unsubscribe(sfd);
+			return test_fail("poll set create failed: %d", px4_errno);
+		}
+	}
+
+	poll_run = true;
+
+	char *const args[1] = { NULL };
+	int task = px4_task_spawn_cmd("uorb_poll_pub",
+				      SCHED_DEFAULT,
+				      SCHED_PRIORITY_MAX - 5,
+				      1500,
+				      (px4_main_t)&uORBTest::UnitTest::poll_publisher_threadEntry,
+				      args);
+
+	if (task < 0) {
+		poll_run = false;
+		px4_pollset_destroy(set);
+		orb_unsubscribe(sfd);
+		return test_fail("failed launching publisher task");
+	}
+
+	const unsigned wakeups = 1000;
+	unsigned received = 0;
+	uint64_t latency_sum = 0;
+	hrt_abstime latency_max = 0;
+	int ret = PX4_OK;
+
+#ifdef __PX4_LINUX
+	struct timespec cpu_start, cpu_end;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+#endif
+
+	while (received < wakeups) {
+		int pret = persistent ? px4_pollset_wait(set, hrt_absolute_time() + 100000) : px4_poll(fds, 1, 100);
+
+		if (pret <= 0) {
+			ret = test_fail("%s: no publication within 100 ms after %u wakeups",
+					persistent ? "poll set" : "px4_poll", received);
+			break;
+		}
+
+		orb_copy(ORB_ID(orb_test_poll), sfd, &t);
+
+		hrt_abstime latency = hrt_elapsed_time(&t.time);
+		latency_sum += latency;
+
+		if (latency > latency_max) {
+			latency_max = latency;
+		}
+
+		received++;
+	}
+
+	unsigned cpu_per_wakeup = 0;
+
+#ifdef __PX4_LINUX
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+	cpu_per_wakeup = (unsigned)((ts_to_abstime(&cpu_end) - ts_to_abstime(&cpu_start)) / (received > 0 ? received : 1));
+#endif
+
+	poll_run = false;
+
+	/* let the publisher finish before the next run reuses the topic */
+	usleep(20000);
+
+	px4_pollset_destroy(set);
+	orb_unsubscribe(sfd);
+
+	if (ret == PX4_OK) {
+		test_note("%s: wakeup latency mean %u us max %u us, waiter cpu %u us per wakeup",
+			  persistent ? "poll set" : "px4_poll", (unsigned)(latency_sum / received),
+			  (unsigned)latency_max, cpu_per_wakeup);
+	}
+
+	return ret;
+#endif
+}
+
+int uORBTest::UnitTest::poll_publisher_threadEntry(char *const argv[])
+{
+	uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
+	return t.poll_publisher_main();
+}
+
+int uORBTest::UnitTest::poll_publisher_main(void)
+{
+	struct orb_test_medium t;
+	memset(&t, 0, sizeof(t));
+
+	/* 1 kHz publisher */
+	while (poll_run) {
+		t.val++;
+		t.time = hrt_absolute_time();
+		orb_publish(ORB_ID(orb_test_poll), poll_pub, &t);
+		usleep(1000);
+	}
+
+	return 0;
+}
+
+int uORBTest::UnitTest::test_seqlock()
+{
+	test_note("try lock-free (seqlock) topic under reader contention");
+
+	const unsigned num_readers = 8;
+
+	/* run the locked topic first as the reference */
+	if (PX4_OK != contention_test(ORB_ID(orb_test_medium), num_readers)) {
+		return test_fail("locked contention test failed");
+	}
+
+	if (PX4_OK != contention_test(ORB_ID(orb_test_medium_seqlock), num_readers)) {
+		return test_fail("seqlock contention test failed");
+	}
+
+	return test_note("PASS seqlock test");
+}
+
+int uORBTest::UnitTest::contention_test(orb_id_t T, unsigned num_readers)
+{
+	struct orb_test_medium t;
+	memset(&t, 0, sizeof(t));
+	t.time = hrt_absolute_time();
+
+	orb_advert_t pub = orb_advertise(T, &t);
+
+	if (pub == nullptr) {
+		return test_fail("%s: advertise failed: %d", T->o_name, errno);
+	}
+
+	contention_topic = T;
+	contention_readers = 0;
+	contention_copies = 0;
+	contention_torn = 0;
+	contention_latency_sum = 0;
+	contention_run = true;
+
+	char *const args[1] = { NULL };
+
+	for (unsigned i = 0; i < num_readers; i++) {
+		int task = px4_task_spawn_cmd("uorb_contention",
+					      SCHED_DEFAULT,
+					      SCHED_PRIORITY_MAX - 5,
+					      1500,
+					      (px4_main_t)&uORBTest::UnitTest::contention_reader_threadEntry,
+					      args);
+
+		if (task < 0) {
+			contention_run = false;
+			return test_fail("failed launching reader task");
+		}
+	}
+
+	/* wait for all readers to be subscribed */
+	while (contention_readers < num_readers) {
+		usleep(1000);
+	}
+
+	const unsigned publications = 2000;
+	hrt_abstime pub_max = 0;
+	uint64_t pub_sum = 0;
+
+	for (unsigned i = 1; i <= publications; i++) {
+		t.val = i;
+		memset(t.junk, (char)i, sizeof(t.junk));
+		t.time = hrt_absolute_time();
+
+		if (PX4_OK != orb_publish(T, pub, &t)) {
+			contention_run = false;
+			return test_fail("%s: publish failed", T->o_name);
+		}
+
+		hrt_abstime elapsed = hrt_elapsed_time(&t.time);
+		pub_sum += elapsed;
+
+		if (elapsed > pub_max) {
+			pub_max = elapsed;
+		}
+
+		/* 1 kHz publisher */
+		usleep(1000);
+	}
+
+	contention_run = false;
+
+	/* wait for the readers to unsubscribe */
+	while (contention_readers > 0) {
+		usleep(1000);
+	}
+
+	test_note("%s: %u readers, publish mean %u us max %u us, copy latency mean %u us over %u copies",
+		  T->o_name, num_readers, (unsigned)(pub_sum / publications), (unsigned)pub_max,
+		  (contention_copies > 0) ? (unsigned)(contention_latency_sum / contention_copies) : 0,
+		  contention_copies);
+
+	if (contention_torn > 0) {
+		return test_fail("%s: %u torn copies", T->o_name, contention_torn);
+	}
+
+	return PX4_OK;
+}
+
+int uORBTest::UnitTest::contention_reader_main(void)
+{
+	int sub = orb_subscribe(contention_topic);
+
+	if (sub < 0) {
+		return uORB::ERROR;
+	}
+
+	px4_pollfd_struct_t fds[1];
+	fds[0].fd = sub;
+	fds[0].events = POLLIN;
+
+	struct orb_test_medium t;
+
+	__sync_fetch_and_add(&contention_readers, 1);
+
+	while (contention_run) {
+		int pret = px4_poll(&fds[0], 1, 100);
+
+		if (pret <= 0 || !(fds[0].revents & POLLIN)) {
+			continue;
+		}
+
+		if (PX4_OK != orb_copy(contention_topic, sub, &t)) {
+			continue;
+		}
+
+		hrt_abstime latency = hrt_elapsed_time(&t.time);
+
+		/* every byte of the payload was written with the same publication counter */
+		for (unsigned i = 0; i < sizeof(t.junk); i++) {
+			if (t.junk[i] != (char)t.val) {
+				__sync_fetch_and_add(&contention_torn, 1);
+				break;
+			}
+		}
+
+		__sync_fetch_and_add(&contention_copies, 1);
+		__sync_fetch_and_add(&contention_latency_sum, (unsigned)latency);
+	}
+
+	orb_unsubscribe(sub);
+
+	__sync_fetch_and_sub(&contention_readers, 1);
+
+	return PX4_OK;
+}
+
+int uORBTest::UnitTest::contention_reader_threadEntry(char *const argv[])
+{
+	uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
+	return t.contention_reader_main();
+}
+
 int uORBTest::UnitTest::test_fail(const char *fmt, ...)
 {
 	va_list ap;
@@ -50,6 +50,7 @@ struct orb_test_medium {
 	char junk[64];
 };
 ORB_DEFINE(orb_test_medium, struct orb_test_medium);
+ORB_DEFINE_FLAGS(orb_test_medium_seqlock, struct orb_test_medium, ORB_FLAG_SEQLOCK);
 
 struct orb_test_large {
 	int val;
@@ -57,6 +58,10 @@ struct orb_test_large {
 	char junk[512];
 };
 ORB_DEFINE(orb_test_large, struct orb_test_large);
+ORB_DEFINE(orb_test_loan, struct orb_test_large);
+ORB_DEFINE_QUEUE(orb_test_queue, struct orb_test, 4);
+ORB_DEFINE_METADATA(orb_test_queue_seqlock, struct orb_test, ORB_FLAG_SEQLOCK, 4);
+ORB_DEFINE(orb_test_poll, struct orb_test_medium);
 
 
 namespace uORBTest
@@ -87,9 +92,32 @@ private:
 	bool pubsubtest_print;
 	int pubsubtest_res = OK;
 
+	// contention test state, shared with the reader tasks
+	static int contention_reader_threadEntry(char *const argv[]);
+	int contention_reader_main(void);
+	orb_id_t contention_topic = nullptr;
+	volatile bool contention_run = false;
+	volatile unsigned contention_readers = 0;
+	volatile unsigned contention_copies = 0;
+	volatile unsigned contention_torn = 0;
+	volatile unsigned contention_latency_sum = 0;
+
+	// poll wakeup benchmark state, shared with the publisher task
+	static int poll_publisher_threadEntry(char *const argv[]);
+	int poll_publisher_main(void);
+	orb_advert_t poll_pub = nullptr;
+	volatile bool poll_run = false;
+
 	int test_single();
 	int test_multi();
 	int test_multi_reversed();
+	int test_seqlock();
+	int test_loan_peek();
+	int test_queue(const struct orb_metadata *meta);
+	int test_poll_wakeup();
+	int test_many_subscriptions();
+	int poll_wakeup_test(bool persistent);
+	int contention_test(orb_id_t T, unsigned num_readers);
 
 	int test_fail(const char *fmt, ...);
 	int test_note(const char *fmt, ...);
@@ -80,3 +80,17 @@ int uORB::Utils::node_mkpath(char *buf, Flavor f,
 
 	return OK;
 }
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+unsigned uORB::Utils::queue_size(const struct orb_metadata *meta)
+{
+	unsigned size = 1;
+
+	/* a power of two keeps the slot index continuous across generation wrap */
+	while (size < meta->o_queue) {
+		size <<= 1;
+	}
+
+	return size;
+}
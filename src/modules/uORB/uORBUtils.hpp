@@ -57,6 +57,12 @@ public:
 	 */
 	static int node_mkpath(char *buf, Flavor f, const char *orbMsgName);
 
+	/**
+	 * Number of publications a topic node buffers, the o_queue of the
+	 * metadata rounded up to a power of two.
+	 */
+	static unsigned queue_size(const struct orb_metadata *meta);
+
 };
 
 #endif // _uORBUtils_hpp_
@@ -328,7 +328,7 @@ GPSSIM::task_main()
 				}
 			}
 
-			usleep(2e5);
+			px4_usleep(2e5);
 
 		} else {
 			//Publish initial report that we have access to a GPS
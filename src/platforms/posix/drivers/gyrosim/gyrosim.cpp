@@ -71,8 +71,10 @@
 
 #include <drivers/device/device.h>
 #include <drivers/device/ringbuffer.h>
+#include <drivers/device/integrator.h>
 #include <drivers/drv_accel.h>
 #include <drivers/drv_gyro.h>
+#include <uORB/topics/sensor_imu_fifo.h>
 #include <mathlib/math/filter/LowPassFilter2p.hpp>
 #include <lib/conversion/rotation.h>
 
@@ -88,19 +90,36 @@
 #define MPUREG_GYRO_CONFIG		0x1B
 #define MPUREG_ACCEL_CONFIG		0x1C
 #define MPUREG_INT_STATUS		0x3A
+#define MPUREG_USER_CTRL		0x6A
+#define MPUREG_FIFO_COUNTH		0x72
+#define MPUREG_FIFO_R_W			0x74
 #define MPUREG_PRODUCT_ID		0x0C
 
+#define BIT_USER_CTRL_FIFO_EN		0x40
+#define BIT_USER_CTRL_FIFO_RESET	0x04
+
 // Product ID Description for GYROSIM
 // high 4 bits 	low 4 bits
 // Product Name	Product Revision
 #define GYROSIMES_REV_C4		0x14
 
 #define GYROSIM_ACCEL_DEFAULT_RATE	1000
+#define GYROSIM_ACCEL_MAX_OUTPUT_RATE	280
 
 #define GYROSIM_GYRO_DEFAULT_RATE	1000
+/* rates need to be the same between accel and gyro */
+#define GYROSIM_GYRO_MAX_OUTPUT_RATE	GYROSIM_ACCEL_MAX_OUTPUT_RATE
 
 #define GYROSIM_ONE_G			9.80665f
 
+/*
+  in FIFO mode the simulated sensor queues a sample every sample
+  interval and the timer only runs at the FIFO read rate, reading
+  all queued samples in one transfer
+ */
+#define GYROSIM_FIFO_DEFAULT_READ_RATE	250
+#define GYROSIM_FIFO_SIZE		1024
+
 #ifdef PX4_SPI_BUS_EXT
 #define EXTERNAL_BUS PX4_SPI_BUS_EXT
 #else
@@ -117,7 +136,7 @@ class GYROSIM_gyro;
 class GYROSIM : public device::VDev
 {
 public:
-	GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation rotation);
+	GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation rotation, bool fifo);
 	virtual ~GYROSIM();
 
 	virtual int		init();
@@ -133,6 +152,11 @@ public:
 
 	void			print_registers();
 
+	/**
+	 * Whether the samples are read in bursts from the emulated FIFO.
+	 */
+	bool			fifo_enabled() { return _fifo; }
+
 protected:
 	friend class GYROSIM_gyro;
 
@@ -165,8 +189,10 @@ private:
 	perf_counter_t		_accel_reads;
 	perf_counter_t		_gyro_reads;
 	perf_counter_t		_sample_perf;
+	perf_counter_t		_bad_transfers;
 	perf_counter_t		_good_transfers;
 	perf_counter_t		_reset_retries;
+	perf_counter_t		_fifo_overflows;
 	perf_counter_t		_system_latency_perf;
 	perf_counter_t		_controller_latency_perf;
 
@@ -175,6 +201,19 @@ private:
 	// last temperature reading for print_info()
 	float			_last_temperature;
 
+	// FIFO burst mode, publishing sensor_imu_fifo
+	bool			_fifo;
+	orb_advert_t		_fifo_topic;
+	int			_fifo_orb_class_instance;
+	hrt_abstime		_fifo_last_sample;
+	hrt_abstime		_fifo_integral_start;
+	Integrator		_accel_int;
+	Integrator		_gyro_int;
+
+	// emulated FIFO, the samples queued since _fifo_time
+	unsigned		_fifo_count;
+	hrt_abstime		_fifo_time;
+
 	/**
 	 * Start automatic measurement.
 	 */
@@ -208,6 +247,42 @@ private:
 	 */
 	void			measure();
 
+	/**
+	 * Fetch all samples queued in the FIFO in one transfer and process them as a block.
+	 */
+	void			measure_fifo();
+
+#pragma pack(push, 1)
+	/**
+	 * One sample, the data registers in SI units.
+	 */
+	struct FIFOSample {
+		float		accel_x;
+		float		accel_y;
+		float		accel_z;
+		float		temp;
+		float		gyro_x;
+		float		gyro_y;
+		float		gyro_z;
+	};
+#pragma pack(pop)
+
+	/**
+	 * Convert and integrate one sample, queue the reports and publish
+	 * them whenever the integrators are due.
+	 */
+	void			process_sample(const FIFOSample &sample, hrt_abstime timestamp);
+
+	/**
+	 * Complete and publish a block of FIFO samples with the integrals over the block.
+	 */
+	void			publish_fifo(sensor_imu_fifo_s &fifo_report, hrt_abstime timestamp);
+
+	/**
+	 * Timer period, the FIFO read interval in FIFO mode.
+	 */
+	unsigned		call_period() { return _fifo ? (1000000 / GYROSIM_FIFO_DEFAULT_READ_RATE) : _call_interval; }
+
 	/**
 	 * Read a register from the GYROSIM
 	 *
@@ -283,8 +358,18 @@ private:
 		float		gyro_y;
 		float		gyro_z;
 	};
+
+	/**
+	 * Burst read of the FIFO, including command byte.
+	 */
+	struct FIFOTransfer {
+		uint8_t		cmd;
+		FIFOSample	samples[GYROSIM_FIFO_SIZE / sizeof(FIFOSample)];
+	};
 #pragma pack(pop)
 
+	FIFOTransfer		_fifo_transfer;
+
 	uint8_t _regdata[108];
 };
 
@@ -321,7 +406,7 @@ private:
 /** driver 'main' command */
 extern "C" { __EXPORT int gyrosim_main(int argc, char *argv[]); }
 
-GYROSIM::GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation rotation) :
+GYROSIM::GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation rotation, bool fifo) :
 	VDev("GYROSIM", path_accel),
 	_gyro(new GYROSIM_gyro(this, path_gyro)),
 	_product(GYROSIMES_REV_C4),
@@ -342,12 +427,24 @@ GYROSIM::GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation ro
 	_accel_reads(perf_alloc(PC_COUNT, "gyrosim_accel_read")),
 	_gyro_reads(perf_alloc(PC_COUNT, "gyrosim_gyro_read")),
 	_sample_perf(perf_alloc(PC_ELAPSED, "gyrosim_read")),
+	_bad_transfers(perf_alloc(PC_COUNT, "gyrosim_bad_transfers")),
 	_good_transfers(perf_alloc(PC_COUNT, "gyrosim_good_transfers")),
 	_reset_retries(perf_alloc(PC_COUNT, "gyrosim_reset_retries")),
+	_fifo_overflows(perf_alloc(PC_COUNT, "gyrosim_fifo_overflows")),
 	_system_latency_perf(perf_alloc_once(PC_ELAPSED, "sys_latency")),
 	_controller_latency_perf(perf_alloc_once(PC_ELAPSED, "ctrl_latency")),
 	_rotation(rotation),
-	_last_temperature(0)
+	_last_temperature(0),
+	_fifo(fifo),
+	_fifo_topic(nullptr),
+	_fifo_orb_class_instance(-1),
+	_fifo_last_sample(0),
+	_fifo_integral_start(0),
+	_accel_int(1000000 / GYROSIM_ACCEL_MAX_OUTPUT_RATE),
+	_gyro_int(1000000 / GYROSIM_GYRO_MAX_OUTPUT_RATE, true),
+	_fifo_count(0),
+	_fifo_time(0),
+	_fifo_transfer{}
 {
 	// disable debug() calls
 	_debug_enabled = false;
@@ -405,7 +502,9 @@ GYROSIM::~GYROSIM()
 	perf_free(_sample_perf);
 	perf_free(_accel_reads);
 	perf_free(_gyro_reads);
+	perf_free(_bad_transfers);
 	perf_free(_good_transfers);
+	perf_free(_fifo_overflows);
 }
 
 int
@@ -500,12 +599,32 @@ GYROSIM::init()
 		PX4_WARN("ADVERT FAIL");
 	}
 
+	if (_fifo) {
+		/* the FIFO is only just running, advertise without samples */
+		struct sensor_imu_fifo_s fifo_report = {};
+		fifo_report.device_id = _device_id.devid;
+
+		_fifo_topic = orb_advertise_multi(ORB_ID(sensor_imu_fifo), &fifo_report,
+						  &_fifo_orb_class_instance, ORB_PRIO_HIGH);
+
+		if (_fifo_topic == nullptr) {
+			PX4_WARN("ADVERT FAIL");
+		}
+	}
+
 out:
 	return ret;
 }
 
 int GYROSIM::reset()
 {
+	if (_fifo) {
+		// start again from an empty FIFO
+		write_reg(MPUREG_USER_CTRL, BIT_USER_CTRL_FIFO_EN | BIT_USER_CTRL_FIFO_RESET);
+		_fifo_last_sample = 0;
+		_fifo_integral_start = 0;
+	}
+
 	return OK;
 }
 
@@ -530,6 +649,49 @@ GYROSIM::transfer(uint8_t *send, uint8_t *recv, unsigned len)
 		// skip cmd and status bytes
 		sim->getMPUReport(&recv[2], len - 2);
 
+	} else if (cmd == (MPUREG_FIFO_COUNTH | DIR_READ)) {
+		// the emulated FIFO queues a sample every sample interval,
+		// the count saturates at the FIFO size like on the MPU6000
+		hrt_abstime now = hrt_absolute_time();
+		unsigned interval = 1000000 / _sample_rate;
+		unsigned queued = (now - _fifo_time) / interval;
+
+		_fifo_time += (hrt_abstime)queued * interval;
+		_fifo_count += queued;
+
+		uint16_t count = GYROSIM_FIFO_SIZE;
+
+		if (_fifo_count * sizeof(FIFOSample) < GYROSIM_FIFO_SIZE) {
+			count = _fifo_count * sizeof(FIFOSample);
+
+		} else {
+			_fifo_count = GYROSIM_FIFO_SIZE / sizeof(FIFOSample) + 1;
+		}
+
+		recv[1] = count >> 8;
+		recv[2] = count & 0xff;
+
+	} else if (cmd == (MPUREG_FIFO_R_W | DIR_READ)) {
+		Simulator *sim = Simulator::getInstance();
+
+		if (sim == NULL) {
+			PX4_WARN("failed accessing simulator");
+			return ENODEV;
+		}
+
+		// the simulator only provides the latest sample, the
+		// simulated sensor samples it at the sample rate
+		unsigned samples = (len - 1) / sizeof(FIFOSample);
+		FIFOSample sample;
+
+		sim->getMPUReport((uint8_t *)&sample, sizeof(sample));
+
+		for (unsigned i = 0; i < samples; i++) {
+			memcpy(&recv[1 + i * sizeof(FIFOSample)], &sample, sizeof(sample));
+		}
+
+		_fifo_count -= math::min(samples, _fifo_count);
+
 	} else if (cmd & DIR_READ) {
 		PX4_DEBUG("Reading %u bytes from register %u", len - 1, reg);
 		memcpy(&_regdata[reg - MPUREG_PRODUCT_ID], &send[1], len - 1);
@@ -537,6 +699,11 @@ GYROSIM::transfer(uint8_t *send, uint8_t *recv, unsigned len)
 	} else {
 		PX4_DEBUG("Writing %u bytes to register %u", len - 1, reg);
 
+		if (reg == MPUREG_USER_CTRL && (send[1] & BIT_USER_CTRL_FIFO_RESET)) {
+			_fifo_count = 0;
+			_fifo_time = hrt_absolute_time();
+		}
+
 		if (recv) {
 			memcpy(&recv[1], &_regdata[reg - MPUREG_PRODUCT_ID], len - 1);
 		}
@@ -573,7 +740,7 @@ GYROSIM::_set_sample_rate(unsigned desired_sample_rate_hz)
 	PX4_INFO("GYROSIM: Changed sample rate to %uHz", _sample_rate);
 	_call_interval = 1000000 / _sample_rate;
 	hrt_cancel(&_call);
-	hrt_call_every(&_call, _call_interval, _call_interval, (hrt_callout)&GYROSIM::measure_trampoline, this);
+	hrt_call_every(&_call, call_period(), call_period(), (hrt_callout)&GYROSIM::measure_trampoline, this);
 }
 
 ssize_t
@@ -796,6 +963,9 @@ GYROSIM::ioctl(device::file_t *filp, int cmd, unsigned long arg)
 
 			/* adjust to a legal polling interval in Hz */
 			default: {
+					/* do we need to start internal polling? */
+					bool want_start = (_call_interval == 0);
+
 					/* convert hz to hrt interval via microseconds */
 					unsigned ticks = 1000000 / arg;
 
@@ -807,9 +977,6 @@ GYROSIM::ioctl(device::file_t *filp, int cmd, unsigned long arg)
 					/* update interval for next measurement */
 					_call_interval = ticks;
 
-					/* do we need to start internal polling? */
-					bool want_start = (_call_interval == 0);
-
 					/* if we need to start the poll state machine, do it */
 					if (want_start) {
 						start();
@@ -1032,7 +1199,7 @@ GYROSIM::start()
 
 	/* start polling at the specified rate */
 	if (_call_interval > 0) {
-		hrt_call_every(&_call, _call_interval, _call_interval, (hrt_callout)&GYROSIM::measure_trampoline, this);
+		hrt_call_every(&_call, call_period(), call_period(), (hrt_callout)&GYROSIM::measure_trampoline, this);
 	}
 }
 
@@ -1068,6 +1235,12 @@ GYROSIM::measure()
 	}
 
 #endif
+
+	if (_fifo) {
+		measure_fifo();
+		return;
+	}
+
 	struct MPUReport mpu_report = {};
 
 	/* start measuring */
@@ -1081,23 +1254,174 @@ GYROSIM::measure()
 	// sensor transfer at high clock speed
 	//set_frequency(GYROSIM_HIGH_BUS_SPEED);
 	if (OK != transfer((uint8_t *)&mpu_report, ((uint8_t *)&mpu_report), sizeof(mpu_report))) {
+		perf_count(_bad_transfers);
+		perf_end(_sample_perf);
+		return;
+	}
+
+	/* the data registers have the same layout as a FIFO sample */
+	FIFOSample sample;
+	memcpy(&sample, &mpu_report.accel_x, sizeof(sample));
+
+	// for now use local time but this should be the timestamp of the simulator
+	process_sample(sample, hrt_absolute_time());
+
+	/* stop measuring */
+	perf_end(_sample_perf);
+}
+
+void
+GYROSIM::measure_fifo()
+{
+	/* start measuring */
+	perf_begin(_sample_perf);
+
+	/*
+	 * Only complete samples are read, so the FIFO stays aligned
+	 * to the sample boundaries.
+	 */
+	uint8_t cmd[3] = { (uint8_t)(MPUREG_FIFO_COUNTH | DIR_READ), 0, 0 };
+
+	if (OK != transfer(cmd, cmd, sizeof(cmd))) {
+		perf_count(_bad_transfers);
+		perf_end(_sample_perf);
+		return;
+	}
+
+	uint16_t fifo_count = (uint16_t)(cmd[1] << 8) | cmd[2];
+
+	if (fifo_count >= GYROSIM_FIFO_SIZE) {
+		// the FIFO overflowed, start again from an empty FIFO
+		perf_count(_fifo_overflows);
+		write_reg(MPUREG_USER_CTRL, BIT_USER_CTRL_FIFO_EN | BIT_USER_CTRL_FIFO_RESET);
+		_fifo_last_sample = 0;
+		perf_end(_sample_perf);
+		return;
+	}
+
+	unsigned samples = fifo_count / sizeof(FIFOSample);
+
+	if (samples == 0) {
+		perf_end(_sample_perf);
 		return;
 	}
 
+	hrt_abstime now = hrt_absolute_time();
+
+	/*
+	 * Fetch all queued samples from the GYROSIM in one pass.
+	 */
+	_fifo_transfer.cmd = DIR_READ | MPUREG_FIFO_R_W;
+
+	if (OK != transfer((uint8_t *)&_fifo_transfer, (uint8_t *)&_fifo_transfer, 1 + samples * sizeof(FIFOSample))) {
+		perf_count(_bad_transfers);
+		perf_end(_sample_perf);
+		return;
+	}
+
+	perf_count(_good_transfers);
+
+	/*
+	 * The newest sample was taken just before the read. The samples
+	 * since the previous read are spread evenly up to it, so the
+	 * timestamps keep increasing when the timer jitters against the
+	 * sensor clock.
+	 */
+	hrt_abstime interval = 1000000 / _sample_rate;
+
+	if (_fifo_last_sample != 0 && now > _fifo_last_sample &&
+	    now - _fifo_last_sample >= samples * interval / 2 &&
+	    now - _fifo_last_sample <= samples * interval * 2) {
+		interval = (now - _fifo_last_sample) / samples;
+	}
+
+	_fifo_last_sample = now;
+
+	struct sensor_imu_fifo_s fifo_report = {};
+
+	for (unsigned i = 0; i < samples; i++) {
+		const FIFOSample &sample = _fifo_transfer.samples[i];
+		hrt_abstime timestamp = now - (samples - 1 - i) * interval;
+
+		process_sample(sample, timestamp);
+
+		unsigned n = fifo_report.samples++;
+		fifo_report.timestamp_sample[n] = timestamp;
+		fifo_report.accel_x[n] = sample.accel_x;
+		fifo_report.accel_y[n] = sample.accel_y;
+		fifo_report.accel_z[n] = sample.accel_z;
+		fifo_report.gyro_x[n] = sample.gyro_x;
+		fifo_report.gyro_y[n] = sample.gyro_y;
+		fifo_report.gyro_z[n] = sample.gyro_z;
+
+		if (fifo_report.samples == sensor_imu_fifo_s::MAX_SAMPLES) {
+			publish_fifo(fifo_report, now);
+			fifo_report.samples = 0;
+		}
+	}
+
+	if (fifo_report.samples > 0) {
+		publish_fifo(fifo_report, now);
+	}
+
+	/* stop measuring */
+	perf_end(_sample_perf);
+}
+
+void
+GYROSIM::publish_fifo(sensor_imu_fifo_s &fifo_report, hrt_abstime timestamp)
+{
+	hrt_abstime last_sample = fifo_report.timestamp_sample[fifo_report.samples - 1];
+
+	fifo_report.timestamp = timestamp;
+	fifo_report.device_id = _device_id.devid;
+	fifo_report.error_count = perf_event_count(_bad_transfers);
+	fifo_report.dt = 1.0f / _sample_rate;
+	fifo_report.temperature = _last_temperature;
+
+	/* the integrals since the last block, both integrators saw the same samples */
+	math::Vector<3> delta_velocity = _accel_int.read(true);
+	math::Vector<3> delta_angle = _gyro_int.read(true);
+
+	if (_fifo_integral_start == 0 || last_sample <= _fifo_integral_start) {
+		delta_velocity.zero();
+		delta_angle.zero();
+		fifo_report.integral_dt = 0;
+
+	} else {
+		fifo_report.integral_dt = last_sample - _fifo_integral_start;
+	}
+
+	_fifo_integral_start = last_sample;
+
+	fifo_report.delta_velocity_x = delta_velocity(0);
+	fifo_report.delta_velocity_y = delta_velocity(1);
+	fifo_report.delta_velocity_z = delta_velocity(2);
+	fifo_report.delta_angle_x = delta_angle(0);
+	fifo_report.delta_angle_y = delta_angle(1);
+	fifo_report.delta_angle_z = delta_angle(2);
+
+	if (_fifo_topic != nullptr && !(_pub_blocked)) {
+		/* publish it */
+		orb_publish(ORB_ID(sensor_imu_fifo), _fifo_topic, &fifo_report);
+	}
+}
+
+void
+GYROSIM::process_sample(const FIFOSample &sample, hrt_abstime timestamp)
+{
 	/*
 	 * Report buffers.
 	 */
 	accel_report	arb = {};
 	gyro_report	grb = {};
 
-	// for now use local time but this should be the timestamp of the simulator
-	grb.timestamp = hrt_absolute_time();
+	grb.timestamp = timestamp;
 	arb.timestamp = grb.timestamp;
-	// report the error count as the sum of the number of bad
-	// transfers and bad register reads. This allows the higher
-	// level code to decide if it should use this sensor based on
-	// whether it has had failures
-	grb.error_count = arb.error_count = 0;	// FIXME
+	// report the error count as the number of bad transfers. This
+	// allows the higher level code to decide if it should use this
+	// sensor based on whether it has had failures
+	grb.error_count = arb.error_count = perf_event_count(_bad_transfers);
 
 	/*
 	 * 1) Scale raw value to SI units using scaling from datasheet.
@@ -1117,45 +1441,78 @@ GYROSIM::measure()
 
 	/* NOTE: Axes have been swapped to match the board a few lines above. */
 
-	arb.x_raw = (int16_t)(mpu_report.accel_x / _accel_range_scale);
-	arb.y_raw = (int16_t)(mpu_report.accel_y / _accel_range_scale);
-	arb.z_raw = (int16_t)(mpu_report.accel_z / _accel_range_scale);
+	arb.x_raw = (int16_t)(sample.accel_x / _accel_range_scale);
+	arb.y_raw = (int16_t)(sample.accel_y / _accel_range_scale);
+	arb.z_raw = (int16_t)(sample.accel_z / _accel_range_scale);
 
 	arb.scaling = _accel_range_scale;
 	arb.range_m_s2 = _accel_range_m_s2;
 
-	_last_temperature = mpu_report.temp;
+	_last_temperature = sample.temp;
 
-	arb.temperature_raw = (int16_t)((mpu_report.temp - 35.0f) * 361.0f);
+	arb.temperature_raw = (int16_t)((sample.temp - 35.0f) * 361.0f);
 	arb.temperature = _last_temperature;
 
-	arb.x = mpu_report.accel_x;
-	arb.y = mpu_report.accel_y;
-	arb.z = mpu_report.accel_z;
+	arb.x = sample.accel_x;
+	arb.y = sample.accel_y;
+	arb.z = sample.accel_z;
+
+	math::Vector<3> accel(sample.accel_x, sample.accel_y, sample.accel_z);
+	math::Vector<3> aval_integrated;
 
-	grb.x_raw = (int16_t)(mpu_report.gyro_x / _gyro_range_scale);
-	grb.y_raw = (int16_t)(mpu_report.gyro_y / _gyro_range_scale);
-	grb.z_raw = (int16_t)(mpu_report.gyro_z / _gyro_range_scale);
+	bool accel_notify = _accel_int.put(arb.timestamp, accel, aval_integrated, arb.integral_dt);
+
+	if (!accel_notify) {
+		/* no integral is due with this sample */
+		aval_integrated.zero();
+		arb.integral_dt = 0;
+	}
+
+	arb.x_integral = aval_integrated(0);
+	arb.y_integral = aval_integrated(1);
+	arb.z_integral = aval_integrated(2);
+
+	grb.x_raw = (int16_t)(sample.gyro_x / _gyro_range_scale);
+	grb.y_raw = (int16_t)(sample.gyro_y / _gyro_range_scale);
+	grb.z_raw = (int16_t)(sample.gyro_z / _gyro_range_scale);
 
 	grb.scaling = _gyro_range_scale;
 	grb.range_rad_s = _gyro_range_rad_s;
 
-	grb.temperature_raw = (int16_t)((mpu_report.temp - 35.0f) * 361.0f);
+	grb.temperature_raw = (int16_t)((sample.temp - 35.0f) * 361.0f);
 	grb.temperature = _last_temperature;
 
-	grb.x = mpu_report.gyro_x;
-	grb.y = mpu_report.gyro_y;
-	grb.z = mpu_report.gyro_z;
+	grb.x = sample.gyro_x;
+	grb.y = sample.gyro_y;
+	grb.z = sample.gyro_z;
+
+	math::Vector<3> gyro(sample.gyro_x, sample.gyro_y, sample.gyro_z);
+	math::Vector<3> gval_integrated;
+
+	bool gyro_notify = _gyro_int.put(arb.timestamp, gyro, gval_integrated, grb.integral_dt);
+
+	if (!gyro_notify) {
+		gval_integrated.zero();
+		grb.integral_dt = 0;
+	}
+
+	grb.x_integral = gval_integrated(0);
+	grb.y_integral = gval_integrated(1);
+	grb.z_integral = gval_integrated(2);
 
 	_accel_reports->force(&arb);
 	_gyro_reports->force(&grb);
 
-
 	/* notify anyone waiting for data */
-	poll_notify(POLLIN);
-	_gyro->parent_poll_notify();
+	if (accel_notify) {
+		poll_notify(POLLIN);
+	}
 
-	if (!(_pub_blocked)) {
+	if (gyro_notify) {
+		_gyro->parent_poll_notify();
+	}
+
+	if (accel_notify && !(_pub_blocked)) {
 		/* log the time of this report */
 		perf_begin(_controller_latency_perf);
 		perf_begin(_system_latency_perf);
@@ -1163,13 +1520,10 @@ GYROSIM::measure()
 		orb_publish(ORB_ID(sensor_accel), _accel_topic, &arb);
 	}
 
-	if (!(_pub_blocked)) {
+	if (gyro_notify && !(_pub_blocked)) {
 		/* publish it */
 		orb_publish(ORB_ID(sensor_gyro), _gyro->_gyro_topic, &grb);
 	}
-
-	/* stop measuring */
-	perf_end(_sample_perf);
 }
 
 void
@@ -1178,8 +1532,10 @@ GYROSIM::print_info()
 	perf_print_counter(_sample_perf);
 	perf_print_counter(_accel_reads);
 	perf_print_counter(_gyro_reads);
+	perf_print_counter(_bad_transfers);
 	perf_print_counter(_good_transfers);
 	perf_print_counter(_reset_retries);
+	perf_print_counter(_fifo_overflows);
 	_accel_reports->print_info("accel queue");
 	_gyro_reports->print_info("gyro queue");
 	PX4_INFO("temperature: %.1f", (double)_last_temperature);
@@ -1279,9 +1635,10 @@ namespace gyrosim
 
 GYROSIM	*g_dev_sim; // on simulated bus
 
-int	start(enum Rotation);
+int	start(enum Rotation, bool fifo);
 int	stop();
 int	test();
+int	test_fifo();
 int	reset();
 int	info();
 int	regdump();
@@ -1294,7 +1651,7 @@ void	usage();
  * or failed to detect the sensor.
  */
 int
-start(enum Rotation rotation)
+start(enum Rotation rotation, bool fifo)
 {
 	int fd;
 	GYROSIM **g_dev_ptr = &g_dev_sim;
@@ -1308,7 +1665,7 @@ start(enum Rotation rotation)
 	}
 
 	/* create the driver */
-	*g_dev_ptr = new GYROSIM(path_accel, path_gyro, rotation);
+	*g_dev_ptr = new GYROSIM(path_accel, path_gyro, rotation, fifo);
 
 	if (*g_dev_ptr == nullptr) {
 		goto fail;
@@ -1442,12 +1799,110 @@ test()
 
 	px4_close(fd);
 	reset();
+
+	if (g_dev_sim != nullptr && g_dev_sim->fifo_enabled() && test_fifo() != 0) {
+		PX4_ERR("FIFO test failed");
+		return 1;
+	}
+
 	PX4_INFO("PASS");
 
 
 	return 0;
 }
 
+/**
+ * Check the sample blocks published in FIFO mode for a second: the
+ * samples come at the sample rate while the blocks come at the lower
+ * FIFO read rate, and the sample timestamps keep increasing.
+ */
+int
+test_fifo()
+{
+	int sub = orb_subscribe(ORB_ID(sensor_imu_fifo));
+
+	if (sub < 0) {
+		PX4_ERR("sensor_imu_fifo subscription failed");
+		return 1;
+	}
+
+	px4_pollfd_struct_t fds[1];
+	fds[0].fd = sub;
+	fds[0].events = POLLIN;
+
+	struct sensor_imu_fifo_s fifo_report;
+	hrt_abstime first_sample = 0;
+	hrt_abstime last_sample = 0;
+	unsigned blocks = 0;
+	unsigned samples = 0;
+	unsigned errors = 0;
+	float dt = 0.0f;
+
+	while (blocks == 0 || last_sample - first_sample < 1000000) {
+		if (px4_poll(fds, 1, 1000) <= 0) {
+			PX4_ERR("no sensor_imu_fifo data");
+			orb_unsubscribe(sub);
+			return 1;
+		}
+
+		orb_copy(ORB_ID(sensor_imu_fifo), sub, &fifo_report);
+
+		if (fifo_report.samples == 0 || fifo_report.samples > sensor_imu_fifo_s::MAX_SAMPLES) {
+			PX4_ERR("invalid sample count %u", (unsigned)fifo_report.samples);
+			errors++;
+			continue;
+		}
+
+		hrt_abstime previous_sample = last_sample;
+
+		for (unsigned i = 0; i < fifo_report.samples; i++) {
+			if (fifo_report.timestamp_sample[i] > fifo_report.timestamp ||
+			    (last_sample != 0 && fifo_report.timestamp_sample[i] <= last_sample)) {
+				PX4_ERR("sample timestamp %" PRIu64 " out of order", fifo_report.timestamp_sample[i]);
+				errors++;
+			}
+
+			last_sample = fifo_report.timestamp_sample[i];
+		}
+
+		/* the first block may hold samples from before the subscription */
+		if (blocks++ == 0) {
+			first_sample = last_sample;
+			continue;
+		}
+
+		/* the integrals span from the last sample of the previous block */
+		if (fifo_report.integral_dt != 0 && fifo_report.integral_dt != last_sample - previous_sample) {
+			PX4_ERR("integral_dt %" PRIu64 " does not cover the block", fifo_report.integral_dt);
+			errors++;
+		}
+
+		samples += fifo_report.samples;
+		dt = fifo_report.dt;
+	}
+
+	orb_unsubscribe(sub);
+
+	float elapsed = (last_sample - first_sample) * 1e-6f;
+	float sample_rate = samples / elapsed;
+	float block_rate = (blocks - 1) / elapsed;
+
+	PX4_INFO("FIFO: %u samples in %u blocks, %.0f Hz samples, %.0f Hz blocks",
+		 samples, blocks - 1, (double)sample_rate, (double)block_rate);
+
+	if (fabsf(sample_rate * dt - 1.0f) > 0.1f) {
+		PX4_ERR("sample rate %.0f Hz, expected %.0f Hz", (double)sample_rate, (double)(1.0f / dt));
+		errors++;
+	}
+
+	if (block_rate > sample_rate / 2) {
+		PX4_ERR("samples are not batched");
+		errors++;
+	}
+
+	return (errors == 0) ? 0 : 1;
+}
+
 /**
  * Reset the driver.
  */
@@ -1525,6 +1980,7 @@ usage()
 	PX4_INFO("missing command: try 'start', 'info', 'test', 'stop', 'reset', 'regdump'");
 	PX4_INFO("options:");
 	PX4_INFO("    -R rotation");
+	PX4_INFO("    -F    (FIFO burst reads, publishes sensor_imu_fifo)");
 }
 
 } // namespace
@@ -1534,18 +1990,23 @@ gyrosim_main(int argc, char *argv[])
 {
 	int ch;
 	enum Rotation rotation = ROTATION_NONE;
+	bool fifo = false;
 	int ret;
 
 	/* jump over start/off/etc and look at options first */
 	int myoptind = 1;
 	const char *myoptarg = NULL;
 
-	while ((ch = px4_getopt(argc, argv, "R:", &myoptind, &myoptarg)) != EOF) {
+	while ((ch = px4_getopt(argc, argv, "R:F", &myoptind, &myoptarg)) != EOF) {
 		switch (ch) {
 		case 'R':
 			rotation = (enum Rotation)atoi(myoptarg);
 			break;
 
+		case 'F':
+			fifo = true;
+			break;
+
 		default:
 			gyrosim::usage();
 			return 0;
@@ -1559,7 +2020,7 @@ gyrosim_main(int argc, char *argv[])
 
 	 */
 	if (!strcmp(verb, "start")) {
-		ret = gyrosim::start(rotation);
+		ret = gyrosim::start(rotation, fifo);
 	}
 
 	else if (!strcmp(verb, "stop")) {
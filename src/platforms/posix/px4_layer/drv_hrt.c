@@ -37,6 +37,8 @@
  * High-resolution timer with callouts and timekeeping.
  */
 
+#include <px4_defines.h>
+#include <px4_log.h>
 #include <px4_time.h>
 #include <px4_workqueue.h>
 #include <drivers/drv_hrt.h>
@@ -46,9 +48,12 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 #include <errno.h>
-#include "hrt_work.h"
-
-static struct sq_queue_s	callout_queue;
+#include <pthread.h>
+#include <unistd.h>
+#include <px4_tasks.h>
+#ifdef __PX4_LINUX
+#include <sys/prctl.h>
+#endif
 
 /* latency histogram */
 #define LATENCY_BUCKET_COUNT 8
@@ -56,29 +61,59 @@ __EXPORT const uint16_t latency_bucket_count = LATENCY_BUCKET_COUNT;
 __EXPORT const uint16_t	latency_buckets[LATENCY_BUCKET_COUNT] = { 1, 2, 5, 10, 20, 50, 100, 1000 };
 __EXPORT uint32_t	latency_counters[LATENCY_BUCKET_COUNT + 1];
 
-static void		hrt_call_reschedule(void);
-
-// Intervals in usec
-#define HRT_INTERVAL_MIN	50
-#define HRT_INTERVAL_MAX	50000000
-
-static px4_sem_t 	_hrt_lock;
-static struct work_s	_hrt_work;
+/*
+ * Callouts are kept in a hierarchical timer wheel. A level 0 slot holds the
+ * callouts due within one tick, a slot on the next level covers a whole turn
+ * of the level below. Entering and cancelling a callout is O(1), when the
+ * wheel turns the next slot of the level above is spread over the level
+ * below. Callouts beyond the last level are parked in its furthest slot.
+ *
+ * A timer thread waits for the earliest deadline on a condition variable
+ * and runs the callouts, serialised like in the timer interrupt on NuttX.
+ */
+#define HRT_WHEEL_TICK		50	/* us per level 0 slot */
+#define HRT_WHEEL_BITS		6
+#define HRT_WHEEL_SLOTS		(1 << HRT_WHEEL_BITS)
+#define HRT_WHEEL_MASK		(HRT_WHEEL_SLOTS - 1)
+#define HRT_WHEEL_LEVELS	4
+
+struct hrt_wheel_level {
+	struct dq_entry_s	slot[HRT_WHEEL_SLOTS];	/* circular lists, the head is the slot */
+	uint64_t		occupied;		/* bit per slot which may have entries */
+};
+
+static struct hrt_wheel_level	_wheel[HRT_WHEEL_LEVELS];
+static uint64_t		_wheel_tick;	/* first tick which is not processed yet */
+static hrt_abstime	_next_wakeup;	/* of the timer thread, 0 while it runs callouts */
+static int		_timer_wake;	/* set when a callout is entered before _next_wakeup */
+
+static pthread_mutex_t	_hrt_mutex;
+static pthread_cond_t	_hrt_cond;
 static hrt_abstime px4_timestart = 0;
 
-static void
-hrt_call_invoke(void);
-
 __EXPORT hrt_abstime hrt_reset(void);
 
+static void hrt_wheel_rebase(hrt_abstime shift);
+
+/*
+ * Lockstep clock. Once enabled, hrt_absolute_time() returns the time set by
+ * the simulator and all lockstep waits block until it passes their deadline.
+ * Time changes and notifications wake every waiter, they re-check their own
+ * condition.
+ */
+static int		_lockstep_enabled = 0;
+static hrt_abstime	_lockstep_time = 0;
+static pthread_mutex_t	_lockstep_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	_lockstep_cond = PTHREAD_COND_INITIALIZER;
+
 static void hrt_lock(void)
 {
-	px4_sem_wait(&_hrt_lock);
+	pthread_mutex_lock(&_hrt_mutex);
 }
 
 static void hrt_unlock(void)
 {
-	px4_sem_post(&_hrt_lock);
+	pthread_mutex_unlock(&_hrt_mutex);
 }
 
 #ifdef __PX4_DARWIN
@@ -128,6 +163,10 @@ hrt_abstime hrt_absolute_time(void)
 {
 	struct timespec ts;
 
+	if (__atomic_load_n(&_lockstep_enabled, __ATOMIC_ACQUIRE)) {
+		return __atomic_load_n(&_lockstep_time, __ATOMIC_ACQUIRE);
+	}
+
 	if (!px4_timestart) {
 		px4_clock_gettime(CLOCK_MONOTONIC, &ts);
 		px4_timestart = ts_to_abstime(&ts);
@@ -139,8 +178,90 @@ hrt_abstime hrt_absolute_time(void)
 
 __EXPORT hrt_abstime hrt_reset(void)
 {
+	if (hrt_lockstep_enabled()) {
+		return hrt_absolute_time();
+	}
+
+	hrt_lock();
+	hrt_abstime before = hrt_absolute_time();
 	px4_timestart = 0;
-	return hrt_absolute_time();
+	hrt_abstime now = hrt_absolute_time();
+
+	/* queued callouts keep their delay */
+	hrt_wheel_rebase(before - now);
+	hrt_unlock();
+
+	return now;
+}
+
+/*
+ * Switch to the lockstep clock, it starts at the current time.
+ */
+void hrt_lockstep_enable(void)
+{
+	pthread_mutex_lock(&_lockstep_mutex);
+
+	if (!_lockstep_enabled) {
+		__atomic_store_n(&_lockstep_time, hrt_absolute_time(), __ATOMIC_RELEASE);
+		__atomic_store_n(&_lockstep_enabled, 1, __ATOMIC_RELEASE);
+	}
+
+	pthread_mutex_unlock(&_lockstep_mutex);
+}
+
+bool hrt_lockstep_enabled(void)
+{
+	return __atomic_load_n(&_lockstep_enabled, __ATOMIC_ACQUIRE) != 0;
+}
+
+/*
+ * Advance the lockstep clock, the time never goes backwards.
+ */
+void hrt_lockstep_set_time(hrt_abstime now)
+{
+	pthread_mutex_lock(&_lockstep_mutex);
+
+	if (now > _lockstep_time) {
+		__atomic_store_n(&_lockstep_time, now, __ATOMIC_RELEASE);
+		pthread_cond_broadcast(&_lockstep_cond);
+	}
+
+	pthread_mutex_unlock(&_lockstep_mutex);
+}
+
+/*
+ * Wake the lockstep waiters, to be called after setting a wake flag.
+ */
+void hrt_lockstep_notify(void)
+{
+	pthread_mutex_lock(&_lockstep_mutex);
+	pthread_cond_broadcast(&_lockstep_cond);
+	pthread_mutex_unlock(&_lockstep_mutex);
+}
+
+/*
+ * Block until the lockstep clock reaches the deadline or wake is set.
+ */
+void hrt_lockstep_wait(hrt_abstime deadline, const int *wake)
+{
+	pthread_mutex_lock(&_lockstep_mutex);
+
+	while (_lockstep_time < deadline &&
+	       (wake == NULL || __atomic_load_n(wake, __ATOMIC_SEQ_CST) == 0)) {
+		pthread_cond_wait(&_lockstep_cond, &_lockstep_mutex);
+	}
+
+	pthread_mutex_unlock(&_lockstep_mutex);
+}
+
+int px4_usleep(useconds_t usec)
+{
+	if (hrt_lockstep_enabled()) {
+		hrt_lockstep_wait(hrt_absolute_time() + usec, NULL);
+		return 0;
+	}
+
+	return usleep(usec);
 }
 
 /*
@@ -192,13 +313,143 @@ bool	hrt_called(struct hrt_call *entry)
 	return (entry->deadline == 0);
 }
 
+static inline bool
+hrt_wheel_queued(struct hrt_call *entry)
+{
+	return entry->link.flink != NULL;
+}
+
+static inline void
+hrt_wheel_remove(struct hrt_call *entry)
+{
+	entry->link.blink->flink = entry->link.flink;
+	entry->link.flink->blink = entry->link.blink;
+	entry->link.flink = NULL;
+	entry->link.blink = NULL;
+}
+
+/*
+ * Put an entry into the slot for its deadline.
+ */
+static void
+hrt_wheel_add(struct hrt_call *entry)
+{
+	uint64_t tick = entry->deadline / HRT_WHEEL_TICK;
+	unsigned level;
+
+	/* overdue callouts run with the current tick */
+	if (tick < _wheel_tick) {
+		tick = _wheel_tick;
+	}
+
+	for (level = 0; level < HRT_WHEEL_LEVELS - 1; level++) {
+		if (tick - _wheel_tick < ((uint64_t)1 << (HRT_WHEEL_BITS * (level + 1)))) {
+			break;
+		}
+	}
+
+	if (tick - _wheel_tick >= ((uint64_t)1 << (HRT_WHEEL_BITS * HRT_WHEEL_LEVELS))) {
+		/* too far ahead, it is looked at again when the furthest slot comes around */
+		tick = _wheel_tick + ((uint64_t)1 << (HRT_WHEEL_BITS * HRT_WHEEL_LEVELS)) - 1;
+	}
+
+	unsigned slot = (tick >> (HRT_WHEEL_BITS * level)) & HRT_WHEEL_MASK;
+	struct dq_entry_s *head = &_wheel[level].slot[slot];
+
+	entry->link.flink = head;
+	entry->link.blink = head->blink;
+	head->blink->flink = &entry->link;
+	head->blink = &entry->link;
+
+	_wheel[level].occupied |= (uint64_t)1 << slot;
+}
+
+/*
+ * Move all entries of a slot on a higher level to where they belong now.
+ */
+static void
+hrt_wheel_requeue(unsigned level, unsigned slot)
+{
+	struct dq_entry_s *head = &_wheel[level].slot[slot];
+
+	_wheel[level].occupied &= ~((uint64_t)1 << slot);
+
+	while (head->flink != head) {
+		struct hrt_call *entry = (struct hrt_call *)head->flink;
+		hrt_wheel_remove(entry);
+		hrt_wheel_add(entry);
+	}
+}
+
+/*
+ * The wheel has moved to _wheel_tick, bring down the slots of the levels which turned.
+ */
+static void
+hrt_wheel_cascade(void)
+{
+	for (unsigned level = 1; level < HRT_WHEEL_LEVELS; level++) {
+		if ((_wheel_tick & (((uint64_t)1 << (HRT_WHEEL_BITS * level)) - 1)) != 0) {
+			break;
+		}
+
+		unsigned slot = (_wheel_tick >> (HRT_WHEEL_BITS * level)) & HRT_WHEEL_MASK;
+
+		if (_wheel[level].occupied & ((uint64_t)1 << slot)) {
+			hrt_wheel_requeue(level, slot);
+		}
+	}
+}
+
+static void
+hrt_wheel_rebase(hrt_abstime shift)
+{
+	struct dq_entry_s pending;
+	pending.flink = &pending;
+	pending.blink = &pending;
+
+	/* collect everything, the slots depend on the current tick */
+	for (unsigned level = 0; level < HRT_WHEEL_LEVELS; level++) {
+		for (unsigned slot = 0; slot < HRT_WHEEL_SLOTS; slot++) {
+			struct dq_entry_s *head = &_wheel[level].slot[slot];
+
+			while (head->flink != head) {
+				struct hrt_call *entry = (struct hrt_call *)head->flink;
+				hrt_wheel_remove(entry);
+
+				entry->link.flink = &pending;
+				entry->link.blink = pending.blink;
+				pending.blink->flink = &entry->link;
+				pending.blink = &entry->link;
+			}
+		}
+
+		_wheel[level].occupied = 0;
+	}
+
+	_wheel_tick = hrt_absolute_time() / HRT_WHEEL_TICK;
+
+	while (pending.flink != &pending) {
+		struct hrt_call *entry = (struct hrt_call *)pending.flink;
+		hrt_wheel_remove(entry);
+		entry->deadline = (entry->deadline > shift) ? entry->deadline - shift : 1;
+		hrt_wheel_add(entry);
+	}
+
+	__atomic_store_n(&_timer_wake, 1, __ATOMIC_SEQ_CST);
+	pthread_cond_signal(&_hrt_cond);
+}
+
 /*
  * Remove the entry from the callout list.
  */
 void	hrt_cancel(struct hrt_call *entry)
 {
 	hrt_lock();
-	sq_rem(&entry->link, &callout_queue);
+
+	if (hrt_wheel_queued(entry)) {
+		hrt_wheel_remove(entry);
+	}
+
 	entry->deadline = 0;
 
 	/* if this is a periodic call being removed by the callout, prevent it from
@@ -206,7 +457,6 @@ void	hrt_cancel(struct hrt_call *entry)
 	 */
 	entry->period = 0;
 	hrt_unlock();
-	// endif
 }
 
 /*
@@ -229,119 +479,277 @@ void	hrt_call_delay(struct hrt_call *entry, hrt_abstime delay)
 	entry->deadline = hrt_absolute_time() + delay;
 }
 
+static void
+hrt_call_enter(struct hrt_call *entry)
+{
+	hrt_wheel_add(entry);
+
+	/* wake the timer thread if it sleeps past the new deadline */
+	if (entry->deadline < _next_wakeup) {
+		__atomic_store_n(&_timer_wake, 1, __ATOMIC_SEQ_CST);
+		pthread_cond_signal(&_hrt_cond);
+
+		if (hrt_lockstep_enabled()) {
+			hrt_lockstep_notify();
+		}
+	}
+}
+
+static void
+hrt_latency_update(hrt_abstime latency)
+{
+	unsigned index;
+
+	/* bounded buckets */
+	for (index = 0; index < LATENCY_BUCKET_COUNT; index++) {
+		if (latency <= latency_buckets[index]) {
+			latency_counters[index]++;
+			return;
+		}
+	}
+
+	/* catch-all at the end */
+	latency_counters[index]++;
+}
+
 /*
- * Initialise the HRT.
+ * Run a callout which is due, called with the lock held.
  */
-void	hrt_init(void)
+static void
+hrt_call_invoke(struct hrt_call *call, hrt_abstime now)
 {
-	sq_init(&callout_queue);
+	hrt_wheel_remove(call);
+
+	/* save the intended deadline for periodic calls */
+	hrt_abstime deadline = call->deadline;
+
+	/* zero the deadline, as the call has occurred */
+	call->deadline = 0;
+
+	hrt_latency_update(now - deadline);
 
-	int sem_ret = px4_sem_init(&_hrt_lock, 0, 1);
+	/* invoke the callout (if there is one) */
+	if (call->callout) {
+		// Unlock so we don't deadlock in callback
+		hrt_unlock();
 
-	if (sem_ret) {
-		PX4_ERR("SEM INIT FAIL: %s", strerror(errno));
+		call->callout(call->arg);
+
+		hrt_lock();
 	}
 
-	memset(&_hrt_work, 0, sizeof(_hrt_work));
+	/* if the callout has a non-zero period, it has to be re-entered */
+	if (call->period != 0 && !hrt_wheel_queued(call)) {
+		// re-check call->deadline to allow for
+		// callouts to re-schedule themselves
+		// using hrt_call_delay()
+		if (call->deadline <= now) {
+			call->deadline = deadline + call->period;
+		}
+
+		hrt_wheel_add(call);
+	}
 }
 
+/*
+ * Run all callouts which are due and turn the wheel up to now.
+ */
 static void
-hrt_call_enter(struct hrt_call *entry)
+hrt_wheel_run(void)
 {
-	struct hrt_call	*call, *next;
+	for (;;) {
+		hrt_abstime now = hrt_absolute_time();
+		uint64_t now_tick = now / HRT_WHEEL_TICK;
 
-	//PX4_INFO("hrt_call_enter");
-	call = (struct hrt_call *)sq_peek(&callout_queue);
+		if (_wheel_tick <= now_tick && _wheel[0].occupied == 0) {
+			/* nothing on level 0, skip to the next turn */
+			uint64_t turn = (_wheel_tick | HRT_WHEEL_MASK) + 1;
 
-	if ((call == NULL) || (entry->deadline < call->deadline)) {
-		sq_addfirst(&entry->link, &callout_queue);
-		//if (call != NULL) PX4_INFO("call enter at head, reschedule (%lu %lu)", entry->deadline, call->deadline);
-		/* we changed the next deadline, reschedule the timer event */
-		hrt_call_reschedule();
+			if (turn > now_tick + 1) {
+				_wheel_tick = now_tick + 1;
+				return;
+			}
+
+			_wheel_tick = turn;
+			hrt_wheel_cascade();
+			continue;
+		}
+
+		unsigned slot = _wheel_tick & HRT_WHEEL_MASK;
+		struct dq_entry_s *head = &_wheel[0].slot[slot];
+		struct dq_entry_s *node = head->flink;
+		bool invoked = false;
+		bool waiting = false;
 
-	} else {
-		do {
-			next = (struct hrt_call *)sq_next(&call->link);
+		while (node != head) {
+			struct hrt_call *call = (struct hrt_call *)node;
+			node = node->flink;
 
-			if ((next == NULL) || (entry->deadline < next->deadline)) {
-				//lldbg("call enter after head\n");
-				sq_addafter(&call->link, &entry->link, &callout_queue);
+			if (call->deadline <= now) {
+				/* the callout may change the slot, start over afterwards */
+				hrt_call_invoke(call, now);
+				invoked = true;
 				break;
+
+			} else if (call->deadline / HRT_WHEEL_TICK > _wheel_tick) {
+				/* moved by hrt_call_delay() */
+				hrt_wheel_remove(call);
+				hrt_wheel_add(call);
+
+			} else {
+				waiting = true;
 			}
-		} while ((call = next) != NULL);
+		}
+
+		if (invoked) {
+			continue;
+		}
+
+		/* the rest of the slot is due later, or the wheel has caught up with the time */
+		if (waiting || _wheel_tick > now_tick) {
+			return;
+		}
+
+		_wheel[0].occupied &= ~((uint64_t)1 << slot);
+		_wheel_tick++;
+		hrt_wheel_cascade();
 	}
+}
+
+/*
+ * Whether the wheel turning at tick brings down entries, or might on a higher level.
+ */
+static bool
+hrt_wheel_turn_pending(uint64_t tick)
+{
+	unsigned slot = (tick >> HRT_WHEEL_BITS) & HRT_WHEEL_MASK;
 
-	//PX4_INFO("scheduled");
+	return slot == 0 || (_wheel[1].occupied & ((uint64_t)1 << slot)) != 0;
 }
 
-/**
- * Timer interrupt handler
- *
- * This routine simulates a timer interrupt handler
+/*
+ * When the timer thread has to look at the wheel again.
  */
-static void
-hrt_tim_isr(void *p)
+static hrt_abstime
+hrt_wheel_next(void)
 {
+	uint64_t tick = _wheel_tick;
+
+	/* the earliest deadline on level 0, unless the wheel turns before */
+	for (unsigned i = 0; i < HRT_WHEEL_SLOTS; i++, tick++) {
+		unsigned slot = tick & HRT_WHEEL_MASK;
+
+		if (i > 0 && slot == 0 && hrt_wheel_turn_pending(tick)) {
+			return tick * HRT_WHEEL_TICK;
+		}
+
+		if (_wheel[0].occupied & ((uint64_t)1 << slot)) {
+			struct dq_entry_s *head = &_wheel[0].slot[slot];
+			hrt_abstime deadline = UINT64_MAX;
+
+			for (struct dq_entry_s *node = head->flink; node != head; node = node->flink) {
+				if (((struct hrt_call *)node)->deadline < deadline) {
+					deadline = ((struct hrt_call *)node)->deadline;
+				}
+			}
+
+			if (deadline != UINT64_MAX) {
+				return deadline;
+			}
+
+			/* emptied by hrt_cancel() */
+			_wheel[0].occupied &= ~((uint64_t)1 << slot);
+		}
+	}
+
+	/* level 0 is empty, wait for the turn which brings down entries */
+	tick = (_wheel_tick | HRT_WHEEL_MASK) + 1;
+
+	while (!hrt_wheel_turn_pending(tick)) {
+		tick += HRT_WHEEL_SLOTS;
+	}
+
+	return tick * HRT_WHEEL_TICK;
+}
 
-	//PX4_INFO("hrt_tim_isr");
-	/* run any callouts that have met their deadline */
-	hrt_call_invoke();
+static int
+hrt_timer_thread(int argc, char *argv[])
+{
+#ifdef __PX4_LINUX
+	/* the default timer slack of 50 us would add to the callout latency */
+	prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+#endif
 
 	hrt_lock();
 
-	/* and schedule the next interrupt */
-	hrt_call_reschedule();
+	for (;;) {
+		__atomic_store_n(&_timer_wake, 0, __ATOMIC_SEQ_CST);
+		_next_wakeup = 0;
 
-	hrt_unlock();
+		hrt_wheel_run();
+
+		hrt_abstime next = hrt_wheel_next();
+		_next_wakeup = next;
+
+		if (hrt_lockstep_enabled()) {
+			hrt_unlock();
+			hrt_lockstep_wait(next, &_timer_wake);
+			hrt_lock();
+			continue;
+		}
+
+		struct timespec ts;
+#ifdef __PX4_DARWIN
+		/* condition variables time out against the wall clock */
+		hrt_abstime now = hrt_absolute_time();
+		clock_gettime(CLOCK_REALTIME, &ts);
+		abstime_to_ts(&ts, ts_to_abstime(&ts) + ((next > now) ? next - now : 0));
+#else
+		abstime_to_ts(&ts, next + px4_timestart);
+#endif
+		pthread_cond_timedwait(&_hrt_cond, &_hrt_mutex, &ts);
+	}
+
+	return PX4_OK;
 }
 
-/**
- * Reschedule the next timer interrupt.
- *
- * This routine must be called with interrupts disabled.
+/*
+ * Initialise the HRT.
  */
-static void
-hrt_call_reschedule()
-{
-	hrt_abstime	now = hrt_absolute_time();
-	hrt_abstime	delay = HRT_INTERVAL_MAX;
-	struct hrt_call	*next = (struct hrt_call *)sq_peek(&callout_queue);
-	hrt_abstime	deadline = now + HRT_INTERVAL_MAX;
-
-	//PX4_INFO("hrt_call_reschedule");
-
-	/*
-	 * Determine what the next deadline will be.
-	 *
-	 * Note that we ensure that this will be within the counter
-	 * period, so that when we truncate all but the low 16 bits
-	 * the next time the compare matches it will be the deadline
-	 * we want.
-	 *
-	 * It is important for accurate timekeeping that the compare
-	 * interrupt fires sufficiently often that the base_time update in
-	 * hrt_absolute_time runs at least once per timer period.
-	 */
-	if (next != NULL) {
-		//lldbg("entry in queue\n");
-		if (next->deadline <= (now + HRT_INTERVAL_MIN)) {
-			//lldbg("pre-expired\n");
-			/* set a minimal deadline so that we call ASAP */
-			delay = HRT_INTERVAL_MIN;
-
-		} else if (next->deadline < deadline) {
-			//lldbg("due soon\n");
-			delay = next->deadline - now;
+void	hrt_init(void)
+{
+	pthread_mutex_init(&_hrt_mutex, NULL);
+
+	pthread_condattr_t cond_attr;
+	pthread_condattr_init(&cond_attr);
+#ifndef __PX4_DARWIN
+	/* hrt time is CLOCK_MONOTONIC with an offset */
+	pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+#endif
+	pthread_cond_init(&_hrt_cond, &cond_attr);
+	pthread_condattr_destroy(&cond_attr);
+
+	for (unsigned level = 0; level < HRT_WHEEL_LEVELS; level++) {
+		for (unsigned slot = 0; slot < HRT_WHEEL_SLOTS; slot++) {
+			_wheel[level].slot[slot].flink = &_wheel[level].slot[slot];
+			_wheel[level].slot[slot].blink = &_wheel[level].slot[slot];
 		}
+
+		_wheel[level].occupied = 0;
 	}
 
-	// There is no timer ISR, so simulate one by putting an event on the
-	// high priority work queue
+	_wheel_tick = hrt_absolute_time() / HRT_WHEEL_TICK;
 
-	// Remove the existing expiry and update with the new expiry
-	hrt_work_cancel(&_hrt_work);
+	int pid = px4_task_spawn_cmd("hrt_timer",
+				     SCHED_DEFAULT,
+				     SCHED_PRIORITY_MAX,
+				     2000,
+				     hrt_timer_thread,
+				     (char *const *)NULL);
 
-	hrt_work_queue(&_hrt_work, (worker_t)&hrt_tim_isr, NULL, delay);
+	if (pid < 0) {
+		PX4_ERR("timer thread start failed");
+	}
 }
 
 static void
@@ -350,28 +758,11 @@ hrt_call_internal(struct hrt_call *entry, hrt_abstime deadline, hrt_abstime inte
 	PX4_DEBUG("hrt_call_internal deadline=%lu interval = %lu", deadline, interval);
 	hrt_lock();
 
-	//PX4_INFO("hrt_call_internal after lock");
 	/* if the entry is currently queued, remove it */
-	/* note that we are using a potentially uninitialised
-	   entry->link here, but it is safe as sq_rem() doesn't
-	   dereference the passed node unless it is found in the
-	   list. So we potentially waste a bit of time searching the
-	   queue for the uninitialised entry->link but we don't do
-	   anything actually unsafe.
-	*/
-	if (entry->deadline != 0) {
-		sq_rem(&entry->link, &callout_queue);
+	if (hrt_wheel_queued(entry)) {
+		hrt_wheel_remove(entry);
 	}
 
-#if 1
-
-	// Use this to debug busy CPU that keeps rescheduling with 0 period time
-	/*if (interval < HRT_INTERVAL_MIN) {*/
-	/*PX4_ERR("hrt_call_internal interval too short: %" PRIu64, interval);*/
-	/*PX4_BACKTRACE();*/
-	/*}*/
-
-#endif
 	entry->deadline = deadline;
 	entry->period = interval;
 	entry->callout = callout;
@@ -389,7 +780,6 @@ hrt_call_internal(struct hrt_call *entry, hrt_abstime deadline, hrt_abstime inte
  */
 void	hrt_call_after(struct hrt_call *entry, hrt_abstime delay, hrt_callout callout, void *arg)
 {
-	//printf("hrt_call_after\n");
 	hrt_call_internal(entry,
 			  hrt_absolute_time() + delay,
 			  0,
@@ -420,69 +810,12 @@ void	hrt_call_at(struct hrt_call *entry, hrt_abstime calltime, hrt_callout callo
 	hrt_call_internal(entry, calltime, 0, callout, arg);
 }
 
-#if 0
 /*
  * Convert absolute time to a timespec.
  */
-void	abstime_to_ts(struct timespec *ts, hrt_abstime abstime);
-#endif
-
-static void
-hrt_call_invoke(void)
+void	abstime_to_ts(struct timespec *ts, hrt_abstime abstime)
 {
-	struct hrt_call	*call;
-	hrt_abstime deadline;
-
-	hrt_lock();
-
-	while (true) {
-		/* get the current time */
-		hrt_abstime now = hrt_absolute_time();
-
-		call = (struct hrt_call *)sq_peek(&callout_queue);
-
-		if (call == NULL) {
-			break;
-		}
-
-		if (call->deadline > now) {
-			break;
-		}
-
-		sq_rem(&call->link, &callout_queue);
-		//PX4_INFO("call pop");
-
-		/* save the intended deadline for periodic calls */
-		deadline = call->deadline;
-
-		/* zero the deadline, as the call has occurred */
-		call->deadline = 0;
-
-		/* invoke the callout (if there is one) */
-		if (call->callout) {
-			// Unlock so we don't deadlock in callback
-			hrt_unlock();
-
-			//PX4_INFO("call %p: %p(%p)", call, call->callout, call->arg);
-			call->callout(call->arg);
-
-			hrt_lock();
-		}
-
-		/* if the callout has a non-zero period, it has to be re-entered */
-		if (call->period != 0) {
-			// re-check call->deadline to allow for
-			// callouts to re-schedule themselves
-			// using hrt_call_delay()
-			if (call->deadline <= now) {
-				call->deadline = deadline + call->period;
-				//PX4_INFO("call deadline set to %lu now=%lu", call->deadline,  now);
-			}
-
-			hrt_call_enter(call);
-		}
-	}
-
-	hrt_unlock();
+	ts->tv_sec = abstime / 1000000;
+	abstime -= ts->tv_sec * 1000000;
+	ts->tv_nsec = abstime * 1000;
 }
-
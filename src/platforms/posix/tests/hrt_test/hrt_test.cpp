@@ -50,6 +50,26 @@ px4::AppState HRTTest::appState;
 static struct hrt_call t1;
 static int update_interval = 1;
 
+static struct hrt_call t2;
+static const hrt_abstime jitter_interval = 1000;
+static hrt_abstime jitter_expected;
+static hrt_abstime jitter_max;
+static uint64_t jitter_sum;
+static unsigned jitter_count;
+
+static void jitter_expired(void *arg)
+{
+	hrt_abstime late = hrt_absolute_time() - jitter_expected;
+
+	if (late > jitter_max) {
+		jitter_max = late;
+	}
+
+	jitter_sum += late;
+	jitter_count++;
+	jitter_expected += jitter_interval;
+}
+
 static void timer_expired(void *arg)
 {
 	static int i = 0;
@@ -87,5 +107,13 @@ int HRTTest::main()
 	hrt_cancel(&t1);
 	PX4_INFO("HRT_CALL + %d\n", hrt_called(&t1));
 
+	memset(&t2, 0, sizeof(t2));
+	jitter_expected = hrt_absolute_time() + jitter_interval;
+	hrt_call_every(&t2, jitter_interval, jitter_interval, jitter_expired, (void *)0);
+	sleep(1);
+	hrt_cancel(&t2);
+	PX4_INFO("1 kHz callout: %u calls, %llu us mean, %llu us max late\n", jitter_count,
+		 (unsigned long long)(jitter_count > 0 ? jitter_sum / jitter_count : 0), (unsigned long long)jitter_max);
+
 	return 0;
 }
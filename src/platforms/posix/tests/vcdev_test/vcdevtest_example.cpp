@@ -43,6 +43,7 @@
 #include <px4_time.h>
 #include "vcdevtest_example.h"
 #include <drivers/drv_device.h>
+#include <drivers/drv_hrt.h>
 #include <drivers/device/device.h>
 #include <unistd.h>
 #include <stdio.h>
@@ -266,6 +267,63 @@ int VCDevExample::do_poll(int fd, int timeout, int iterations, int delayms_after
 fail:
 	return 1;
 }
+/* the device only signals through poll_notify(), a notification has to be reported once */
+int VCDevExample::do_pollset(int fd, int iterations)
+{
+	int pollret, readret;
+	int loop_count = 0;
+	char readbuf[10];
+	px4_pollfd_struct_t fds[1];
+
+	fds[0].fd = fd;
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+
+	px4_pollset_t *set = px4_pollset_create(fds, 1);
+
+	if (set == nullptr) {
+		PX4_ERR("Reader: px4_pollset_create failed %d FAIL", px4_errno);
+		return 1;
+	}
+
+	while ((!appState.exitRequested()) && (loop_count < iterations)) {
+		// the writer writes every 2 seconds
+		pollret = px4_pollset_wait(set, hrt_absolute_time() + 5000000);
+
+		if (pollret != 1 || !(fds[0].revents & POLLIN)) {
+			PX4_ERR("Reader: px4_pollset_wait returned %d, revents %x FAIL", pollret, fds[0].revents);
+			goto fail;
+		}
+
+		// a write the previous tests did not poll for may still be unread
+		readret = px4_read(fd, readbuf, sizeof(readbuf) - 1);
+
+		if (readret < 1) {
+			PX4_ERR("Reader:     read failed %d FAIL", readret);
+			goto fail;
+		}
+
+		readbuf[readret] = '\0';
+		PX4_INFO("Reader: px4_pollset_wait returned %d, read '%s' PASS", pollret, readbuf);
+
+		// the notification was consumed, nothing is written for a while
+		pollret = px4_pollset_wait(set, hrt_absolute_time() + 100000);
+
+		if (pollret != 0) {
+			PX4_ERR("Reader: px4_pollset_wait reported a consumed notification FAIL");
+			goto fail;
+		}
+
+		loop_count++;
+	}
+
+	px4_pollset_destroy(set);
+	return 0;
+fail:
+	px4_pollset_destroy(set);
+	return 1;
+}
+
 int VCDevExample::main()
 {
 	appState.setRunning(true);
@@ -350,6 +408,13 @@ int VCDevExample::main()
 		goto fail2;
 	}
 
+	PX4_INFO("TEST: NOTIFY ONLY POLL SET ---------");
+
+	if (do_pollset(fd, 3)) {
+		ret = 1;
+		goto fail2;
+	}
+
 fail2:
 	g_exit = true;
 	px4_close(fd);
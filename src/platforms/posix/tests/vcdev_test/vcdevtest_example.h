@@ -56,6 +56,7 @@ public:
 
 private:
 	int do_poll(int fd, int timeout, int iterations, int delayms_after_poll);
+	int do_pollset(int fd, int iterations);
 
 	VCDevNode *_node;
 };
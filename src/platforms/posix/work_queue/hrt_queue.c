@@ -125,6 +125,13 @@ int hrt_work_queue(struct work_s *work, worker_t worker, void *arg, uint32_t del
 	px4_task_kill(wqueue->pid, SIGALRM);      /* Wake up the worker thread */
 #else
 	px4_task_kill(wqueue->pid, SIGCONT);      /* Wake up the worker thread */
+
+	/* a worker waiting on the lockstep clock is not interrupted by the signal */
+	if (hrt_lockstep_enabled()) {
+		__atomic_store_n(&wqueue->wake, 1, __ATOMIC_SEQ_CST);
+		hrt_lockstep_notify();
+	}
+
 #endif
 
 	hrt_work_unlock();
@@ -128,6 +128,9 @@ static void hrt_work_process()
 
 	hrt_work_lock();
 
+	/* cleared before the scan, work queued after it ends the lockstep wait */
+	__atomic_store_n(&wqueue->wake, 0, __ATOMIC_SEQ_CST);
+
 	work  = (struct work_s *)wqueue->q.head;
 
 	while (work) {
@@ -206,6 +209,15 @@ static void hrt_work_process()
 	 */
 	hrt_work_unlock();
 
+#ifndef __PX4_QURT
+
+	if (hrt_lockstep_enabled()) {
+		hrt_lockstep_wait(hrt_absolute_time() + next, &wqueue->wake);
+		return;
+	}
+
+#endif
+
 	/* might sleep less if a signal received and new item was queued */
 	//PX4_INFO("Sleeping for %u usec", next);
 	usleep(next);
@@ -88,8 +88,6 @@
 
 int work_cancel(int qid, struct work_s *work)
 {
-	struct wqueue_s *wqueue = &g_work[qid];
-
 	//DEBUGASSERT(work != NULL && (unsigned)qid < NWORKERS);
 
 	/* Cancelling the work is simply a matter of removing the work structure
@@ -109,8 +107,9 @@ int work_cancel(int qid, struct work_s *work)
 		 * mark as availalbe (i.e., the worker field is nullified).
 		 */
 
-		dq_rem((dq_entry_t *)work, &wqueue->q);
+		dq_rem((dq_entry_t *)work, work->q);
 		work->worker = NULL;
+		work->q = NULL;
 	}
 
 	work_unlock(qid);
@@ -32,18 +32,105 @@
  ****************************************************************************/
 #include <px4_log.h>
 #include <px4_posix.h>
+#include <px4_tasks.h>
+#include <signal.h>
 #include <stdio.h>
+#include <time.h>
 #include "work_lock.h"
 
 
-extern px4_sem_t _work_lock[];
+#ifdef __PX4_QURT
 
 void work_lock(int id)
 {
-	px4_sem_wait(&_work_lock[id]);
+	px4_sem_wait(&g_work[id].lock);
 }
 
 void work_unlock(int id)
 {
-	px4_sem_post(&_work_lock[id]);
+	px4_sem_post(&g_work[id].lock);
 }
+
+void work_wait(int id, struct work_worker_s *worker, hrt_abstime deadline)
+{
+	/* the worker is interrupted by a signal when woken */
+	hrt_abstime now = hrt_absolute_time();
+	hrt_abstime sleep = (deadline > now) ? deadline - now : 0;
+
+	if (sleep > CONFIG_SCHED_WORKPERIOD) {
+		sleep = CONFIG_SCHED_WORKPERIOD;
+	}
+
+	work_unlock(id);
+	usleep(sleep);
+	work_lock(id);
+}
+
+void work_signal(int id, struct work_worker_s *worker)
+{
+	worker->sleeping = false;
+	px4_task_kill(worker->pid, SIGALRM);
+}
+
+#else
+
+void work_lock(int id)
+{
+	pthread_mutex_lock(&g_work[id].lock);
+}
+
+void work_unlock(int id)
+{
+	pthread_mutex_unlock(&g_work[id].lock);
+}
+
+void work_wait(int id, struct work_worker_s *worker, hrt_abstime deadline)
+{
+	if (hrt_lockstep_enabled()) {
+		work_unlock(id);
+		hrt_lockstep_wait(deadline, &worker->wake);
+		work_lock(id);
+		return;
+	}
+
+	hrt_abstime now = hrt_absolute_time();
+
+	if (deadline == WORK_FOREVER) {
+		pthread_cond_wait(&worker->cond, &g_work[id].lock);
+		return;
+	}
+
+	/* bounded, in case the clock is switched to lockstep while waiting */
+	hrt_abstime sleep = (deadline > now) ? deadline - now : 0;
+
+	if (sleep > CONFIG_SCHED_WORKPERIOD) {
+		sleep = CONFIG_SCHED_WORKPERIOD;
+	}
+
+	struct timespec ts;
+#ifdef __PX4_DARWIN
+	/* condition variables time out against the wall clock */
+	clock_gettime(CLOCK_REALTIME, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	sleep += ts.tv_nsec / 1000;
+	ts.tv_sec += sleep / 1000000;
+	ts.tv_nsec = (sleep % 1000000) * 1000;
+
+	pthread_cond_timedwait(&worker->cond, &g_work[id].lock, &ts);
+}
+
+void work_signal(int id, struct work_worker_s *worker)
+{
+	worker->sleeping = false;
+	__atomic_store_n(&worker->wake, 1, __ATOMIC_SEQ_CST);
+
+	if (hrt_lockstep_enabled()) {
+		hrt_lockstep_notify();
+	}
+
+	pthread_cond_signal(&worker->cond);
+}
+
+#endif
@@ -37,7 +37,81 @@
 
 //#pragma once
 
+#include <px4_config.h>
+#include <px4_posix.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <queue.h>
+#include <px4_workqueue.h>
+#include <drivers/drv_hrt.h>
+#include <systemlib/perf_counter.h>
+
+#define WORK_MAXTHREADS	8	/* worker threads per queue */
+#define WORK_MAXSTATS	32	/* work callbacks with perf counters per queue */
+#define WORK_FOREVER	UINT64_MAX
+
+/* A worker thread of a queue. Work queued from a worker goes on its own lists,
+ * work queued from any other thread is spread round robin. A worker runs its
+ * ready work from the head, an idle worker steals from the tail of the others.
+ */
+struct work_worker_s {
+	pid_t             pid;      /* The task ID of the worker thread */
+	pthread_t         thread;
+	char              name[16];
+	struct dq_queue_s ready;    /* Work that is due */
+	struct dq_queue_s delayed;  /* Work waiting for its delay */
+	struct work_s    *running;  /* Work currently performed, never run twice at once */
+	bool              sleeping;
+	int               wake;     /* Set when woken, ends a lockstep wait */
+#ifndef __PX4_QURT
+	pthread_cond_t    cond;
+#endif
+};
+
+/* Perf counters of one work callback, named after its address (resolve it
+ * with nm or addr2line on the binary).
+ */
+struct work_stats_s {
+	worker_t          worker;
+	perf_counter_t    runtime;
+	perf_counter_t    latency;
+	char              names[2][32];
+};
+
+/* The workers of one queue share a lock. Of the idle workers only the leader
+ * waits for the next delayed work, the others sleep until they are woken.
+ */
+struct work_pool_s {
+#ifdef __PX4_QURT
+	px4_sem_t         lock;
+#else
+	pthread_mutex_t   lock;
+#endif
+	const char       *name;
+	unsigned          nthreads;
+	unsigned          next;     /* Worker for work queued from other threads */
+	int               leader;   /* Index of the worker waiting for delayed work or -1 */
+	hrt_abstime       deadline; /* When the leader wakes up */
+	struct work_worker_s workers[WORK_MAXTHREADS];
+	perf_counter_t    runtime;  /* Runtime of the work callbacks */
+	perf_counter_t    latency;  /* Latency from due time to start of the work callbacks */
+	char              perf_names[2][16];
+	struct work_stats_s stats[WORK_MAXSTATS]; /* The same per work callback */
+	unsigned          nstats;
+};
+
+extern struct work_pool_s g_work[NWORKERS];
+
 void work_lock(int id);
 void work_unlock(int id);
 
+/* Sleep with the lock held until woken or until the deadline */
+void work_wait(int id, struct work_worker_s *worker, hrt_abstime deadline);
+
+/* Wake a sleeping worker, called with the lock held */
+void work_signal(int id, struct work_worker_s *worker);
+
+/* Wake an idle worker, preferably not the leader, called with the lock held */
+bool work_wake_idle(int id);
+
 #endif // _work_lock_h_
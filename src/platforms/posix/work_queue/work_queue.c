@@ -40,11 +40,11 @@
 #include <px4_config.h>
 #include <px4_defines.h>
 
-#include <signal.h>
 #include <stdint.h>
 #include <queue.h>
 #include <stdio.h>
-#include <semaphore.h>
+#include <pthread.h>
+#include <drivers/drv_hrt.h>
 #include <px4_workqueue.h>
 #include "work_lock.h"
 
@@ -105,7 +105,7 @@
 
 int work_queue(int qid, struct work_s *work, worker_t worker, void *arg, uint32_t delay)
 {
-	struct wqueue_s *wqueue = &g_work[qid];
+	struct work_pool_s *pool = &g_work[qid];
 
 	//DEBUGASSERT(work != NULL && (unsigned)qid < NWORKERS);
 
@@ -116,19 +116,64 @@ int work_queue(int qid, struct work_s *work, worker_t worker, void *arg, uint32_
 	work->delay  = delay;            /* Delay until work performed */
 
 	/* Now, time-tag that entry and put it in the work queue.  This must be
-	 * done with interrupts disabled.  This permits this function to be called
-	 * from with task logic or interrupt handlers.
+	 * done with the lock held.
 	 */
 
 	work_lock(qid);
-	work->qtime  = clock_systimer(); /* Time work queued */
-
-	dq_addlast((dq_entry_t *)work, &wqueue->q);
-#ifdef __PX4_QURT
-	px4_task_kill(wqueue->pid, SIGALRM);      /* Wake up the worker thread */
-#else
-	px4_task_kill(wqueue->pid, SIGCONT);      /* Wake up the worker thread */
-#endif
+	work->qtime  = hrt_absolute_time(); /* Time work queued */
+
+	/* Work queued by a worker stays with it, other work is spread over the
+	 * workers.
+	 */
+
+	struct work_worker_s *owner = NULL;
+	pthread_t self = pthread_self();
+
+	for (unsigned i = 0; i < pool->nthreads; i++) {
+		if (pthread_equal(pool->workers[i].thread, self)) {
+			owner = &pool->workers[i];
+			break;
+		}
+	}
+
+	if (owner == NULL) {
+		owner = &pool->workers[pool->next];
+		pool->next = (pool->next + 1) % pool->nthreads;
+	}
+
+	if (delay == 0) {
+		work->q = &owner->ready;
+		dq_addlast((dq_entry_t *)work, work->q);
+
+		/* Wake up the owner, or any idle worker to take it */
+
+		if (owner->sleeping) {
+			work_signal(qid, owner);
+
+		} else {
+			work_wake_idle(qid);
+		}
+
+	} else {
+		work->q = &owner->delayed;
+		dq_addlast((dq_entry_t *)work, work->q);
+
+		/* Wake up the leader if the work is due before it wakes up anyway,
+		 * or an idle worker to become the leader.
+		 */
+
+		hrt_abstime due = work->qtime + (hrt_abstime)USEC_PER_TICK * delay;
+
+		if (pool->leader >= 0) {
+			if (due < pool->deadline) {
+				pool->deadline = due;
+				work_signal(qid, &pool->workers[pool->leader]);
+			}
+
+		} else {
+			work_wake_idle(qid);
+		}
+	}
 
 	work_unlock(qid);
 	return PX4_OK;
@@ -43,6 +43,7 @@
 #include <px4_time.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <queue.h>
 #include <px4_workqueue.h>
@@ -64,123 +65,365 @@
  ****************************************************************************/
 
 /* The state of each work queue. */
-struct wqueue_s g_work[NWORKERS];
+struct work_pool_s g_work[NWORKERS];
 
 /****************************************************************************
  * Private Variables
  ****************************************************************************/
-px4_sem_t _work_lock[NWORKERS];
 
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
 /****************************************************************************
- * Name: work_process
+ * Name: work_promote
  *
  * Description:
- *   This is the logic that performs actions placed on any work list.
+ *   Move the delayed work of a worker that is due to its ready list.
  *
  * Input parameters:
- *   wqueue - Describes the work queue to be processed
+ *   worker - The worker owning the lists
+ *   now    - The current time
+ *   next   - Updated with the time the next delayed work is due
+ *
+ ****************************************************************************/
+
+static void work_promote(struct work_worker_s *worker, hrt_abstime now, hrt_abstime *next)
+{
+	struct work_s *work = (struct work_s *)worker->delayed.head;
+
+	while (work) {
+		struct work_s *following = (struct work_s *)work->dq.flink;
+		hrt_abstime due = work->qtime + (hrt_abstime)USEC_PER_TICK * work->delay;
+
+		if (due <= now) {
+			dq_rem((dq_entry_t *)work, &worker->delayed);
+			dq_addlast((dq_entry_t *)work, &worker->ready);
+			work->q = &worker->ready;
+
+		} else if (due < *next) {
+			*next = due;
+		}
+
+		work = following;
+	}
+}
+
+/****************************************************************************
+ * Name: work_take
+ *
+ * Description:
+ *   Find the next work for a worker: the oldest of its own ready work, else
+ *   the newest ready work of another worker. Work that is still being
+ *   performed by another worker (because it was queued again from a
+ *   different thread) is left for later.
+ *
+ ****************************************************************************/
+
+static bool work_running(struct work_pool_s *pool, struct work_s *work)
+{
+	for (unsigned i = 0; i < pool->nthreads; i++) {
+		if (pool->workers[i].running == work) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static struct work_s *work_take(struct work_pool_s *pool, unsigned index)
+{
+	struct work_s *work;
+
+	for (work = (struct work_s *)pool->workers[index].ready.head; work; work = (struct work_s *)work->dq.flink) {
+		if (!work_running(pool, work)) {
+			return work;
+		}
+	}
+
+	for (unsigned i = 1; i < pool->nthreads; i++) {
+		struct work_worker_s *victim = &pool->workers[(index + i) % pool->nthreads];
+
+		for (work = (struct work_s *)victim->ready.tail; work; work = (struct work_s *)work->dq.blink) {
+			if (!work_running(pool, work)) {
+				return work;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/****************************************************************************
+ * Name: work_account
+ *
+ * Description:
+ *   Add the latency and runtime of a work callback to the perf counters of
+ *   its queue and to its own, called with the lock held. Callbacks beyond
+ *   the first WORK_MAXSTATS only count towards the queue.
+ *
+ ****************************************************************************/
+
+static void work_account(struct work_pool_s *pool, worker_t worker, hrt_abstime due, hrt_abstime start,
+			 hrt_abstime end)
+{
+	struct work_stats_s *stats = NULL;
+
+	perf_set(pool->runtime, end - start);
+	perf_set(pool->latency, (int64_t)(start - due));
+
+	for (unsigned i = 0; i < pool->nstats; i++) {
+		if (pool->stats[i].worker == worker) {
+			stats = &pool->stats[i];
+			break;
+		}
+	}
+
+	if (stats == NULL) {
+		if (pool->nstats == WORK_MAXSTATS) {
+			return;
+		}
+
+		stats = &pool->stats[pool->nstats++];
+		stats->worker = worker;
+		snprintf(stats->names[0], sizeof(stats->names[0]), "wq_%s %p run", pool->name, worker);
+		snprintf(stats->names[1], sizeof(stats->names[1]), "wq_%s %p lat", pool->name, worker);
+		stats->runtime = perf_alloc(PC_ELAPSED, stats->names[0]);
+		stats->latency = perf_alloc(PC_ELAPSED, stats->names[1]);
+	}
+
+	perf_set(stats->runtime, end - start);
+	perf_set(stats->latency, (int64_t)(start - due));
+}
+
+/****************************************************************************
+ * Name: work_wake_idle
+ *
+ * Description:
+ *   Wake a sleeping worker other than the leader if there is one, else the
+ *   leader.
  *
  * Returned Value:
- *   None
+ *   false if no worker is sleeping
  *
  ****************************************************************************/
 
-static void work_process(struct wqueue_s *wqueue, int lock_id)
+bool work_wake_idle(int qid)
 {
-	volatile struct work_s *work;
-	worker_t  worker;
-	void *arg;
-	uint64_t elapsed;
-	uint32_t remaining;
-	uint32_t next;
+	struct work_pool_s *pool = &g_work[qid];
+	int found = -1;
 
-	/* Then process queued work.  We need to keep interrupts disabled while
-	 * we process items in the work list.
-	 */
+	for (unsigned i = 0; i < pool->nthreads; i++) {
+		if (pool->workers[i].sleeping) {
+			found = i;
 
-	next  = CONFIG_SCHED_WORKPERIOD;
+			if ((int)i != pool->leader) {
+				break;
+			}
+		}
+	}
 
-	work_lock(lock_id);
+	if (found < 0) {
+		return false;
+	}
 
-	work  = (struct work_s *)wqueue->q.head;
+	work_signal(qid, &pool->workers[found]);
+	return true;
+}
 
-	while (work) {
-		/* Is this work ready?  It is ready if there is no delay or if
-		 * the delay has elapsed. qtime is the time that the work was added
-		 * to the work queue.  It will always be greater than or equal to
-		 * zero.  Therefore a delay of zero will always execute immediately.
-		 */
+/****************************************************************************
+ * Name: work_process
+ *
+ * Description:
+ *   This is the logic that performs actions placed on any work list.
+ *
+ * Input parameters:
+ *   qid   - The work queue
+ *   index - The worker thread in the queue
+ *
+ * Returned Value:
+ *   Does not return
+ *
+ ****************************************************************************/
 
-		elapsed = USEC2TICK(clock_systimer() - work->qtime);
+static void work_process(int qid, unsigned index)
+{
+	struct work_pool_s *pool = &g_work[qid];
+	struct work_worker_s *self = &pool->workers[index];
 
-		//printf("work_process: in ticks elapsed=%lu delay=%u\n", elapsed, work->delay);
-		if (elapsed >= work->delay) {
-			/* Remove the ready-to-execute work from the list */
+	work_lock(qid);
+	self->thread = pthread_self();
 
-			(void)dq_rem((struct dq_entry_s *)work, &wqueue->q);
+	for (;;) {
+		/* cleared before the scan, work queued after it ends a lockstep wait */
 
-			/* Extract the work description from the entry (in case the work
-			 * instance by the re-used after it has been de-queued).
-			 */
+		__atomic_store_n(&self->wake, 0, __ATOMIC_SEQ_CST);
 
-			worker = work->worker;
-			arg    = work->arg;
+		hrt_abstime now = hrt_absolute_time();
+		hrt_abstime next = WORK_FOREVER;
 
-			/* Mark the work as no longer being queued */
+		for (unsigned i = 0; i < pool->nthreads; i++) {
+			work_promote(&pool->workers[i], now, &next);
+		}
 
-			work->worker = NULL;
+		struct work_s *work = work_take(pool, index);
 
-			/* Do the work.  Re-enable interrupts while the work is being
-			 * performed... we don't have any idea how long that will take!
+		if (work == NULL) {
+			/* Nothing to do. The first idle worker waits for the next delayed
+			 * work, the others until work is queued.
 			 */
 
-			work_unlock(lock_id);
+			hrt_abstime deadline = WORK_FOREVER;
 
-			if (!worker) {
-				PX4_WARN("MESSED UP: worker = 0\n");
+			if (pool->leader < 0 && next != WORK_FOREVER) {
+				pool->leader = index;
+				pool->deadline = next;
+				deadline = next;
+			}
+
+			self->sleeping = true;
+			work_wait(qid, self, deadline);
+			self->sleeping = false;
 
-			} else {
-				worker(arg);
+			if (pool->leader == (int)index) {
+				pool->leader = -1;
 			}
 
-			/* Now, unfortunately, since we re-enabled interrupts we don't
-			 * know the state of the work list and we will have to start
-			 * back at the head of the list.
-			 */
+			continue;
+		}
+
+		/* Remove the ready-to-execute work from the list */
 
-			work_lock(lock_id);
-			work  = (struct work_s *)wqueue->q.head;
+		dq_rem((dq_entry_t *)work, work->q);
+
+		/* Extract the work description from the entry (in case the work
+		 * instance by the re-used after it has been de-queued).
+		 */
+
+		worker_t worker = work->worker;
+		void *arg = work->arg;
+		hrt_abstime due = work->qtime + (hrt_abstime)USEC_PER_TICK * work->delay;
+
+		/* Mark the work as no longer being queued */
+
+		work->worker = NULL;
+		work->q = NULL;
+		self->running = work;
+
+		/* Hand over waiting for the delayed work while this worker is busy,
+		 * and let an idle worker pick up any other ready work.
+		 */
+
+		if (pool->leader < 0 && next != WORK_FOREVER) {
+			work_wake_idle(qid);
+
+		} else if (work_take(pool, index) != NULL) {
+			work_wake_idle(qid);
+		}
+
+		/* Do the work, without the lock: we don't have any idea how long
+		 * that will take!
+		 */
+
+		work_unlock(qid);
+
+		hrt_abstime start = hrt_absolute_time();
+
+		if (!worker) {
+			PX4_WARN("MESSED UP: worker = 0\n");
 
 		} else {
-			/* This one is not ready.. will it be ready before the next
-			 * scheduled wakeup interval?
-			 */
+			worker(arg);
+		}
 
-			/* Here: elapsed < work->delay */
-			remaining = USEC_PER_TICK * (work->delay - elapsed);
+		hrt_abstime end = hrt_absolute_time();
 
-			if (remaining < next) {
-				/* Yes.. Then schedule to wake up when the work is ready */
+		work_lock(qid);
+		self->running = NULL;
 
-				next = remaining;
-			}
+		if (worker) {
+			work_account(pool, worker, due, start, end);
+		}
+	}
+}
 
-			/* Then try the next in the list. */
+/****************************************************************************
+ * Name: work_pool_init
+ *
+ * Description:
+ *   Start the worker threads of a work queue.
+ *
+ ****************************************************************************/
 
-			work = (struct work_s *)work->dq.flink;
+static void work_pool_init(int qid, const char *name, const char *thread_name, unsigned nthreads, int priority,
+			   px4_main_t entry)
+{
+	struct work_pool_s *pool = &g_work[qid];
+
+#ifdef __PX4_QURT
+	/* workers are only woken by signals here, keep the queue serialised */
+	nthreads = 1;
+	px4_sem_init(&pool->lock, 0, 1);
+#else
+	pthread_mutex_init(&pool->lock, NULL);
+#endif
+
+	if (nthreads < 1) {
+		nthreads = 1;
+
+	} else if (nthreads > WORK_MAXTHREADS) {
+		nthreads = WORK_MAXTHREADS;
+	}
+
+	pool->name = name;
+	pool->nthreads = nthreads;
+	pool->leader = -1;
+
+	snprintf(pool->perf_names[0], sizeof(pool->perf_names[0]), "wq_%s run", name);
+	snprintf(pool->perf_names[1], sizeof(pool->perf_names[1]), "wq_%s lat", name);
+	pool->runtime = perf_alloc(PC_ELAPSED, pool->perf_names[0]);
+	pool->latency = perf_alloc(PC_ELAPSED, pool->perf_names[1]);
+
+	for (unsigned i = 0; i < nthreads; i++) {
+		struct work_worker_s *worker = &pool->workers[i];
+
+#ifndef __PX4_QURT
+		pthread_condattr_t cond_attr;
+		pthread_condattr_init(&cond_attr);
+#ifndef __PX4_DARWIN
+		pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+#endif
+		pthread_cond_init(&worker->cond, &cond_attr);
+		pthread_condattr_destroy(&cond_attr);
+#endif
+
+		if (i == 0) {
+			snprintf(worker->name, sizeof(worker->name), "%s", thread_name);
+
+		} else {
+			snprintf(worker->name, sizeof(worker->name), "%s%u", thread_name, i);
 		}
 	}
 
-	/* Wait awhile to check the work list.  We will wait here until either
-	 * the time elapses or until we are awakened by a signal.
-	 */
-	work_unlock(lock_id);
+	for (unsigned i = 0; i < nthreads; i++) {
+		char index[4];
+		char *const argv[] = { index, NULL };
+		snprintf(index, sizeof(index), "%u", i);
+
+		pool->workers[i].pid = px4_task_spawn_cmd(pool->workers[i].name,
+					SCHED_DEFAULT,
+					priority,
+					2000,
+					entry,
+					argv);
+	}
+}
+
+/* The index of the worker in its queue, passed as the first argument */
 
-	usleep(next);
+static unsigned work_thread_index(int argc, char *argv[])
+{
+	return (argc > 0 && argv[0] != NULL) ? strtoul(argv[0], NULL, 10) : 0;
 }
 
 /****************************************************************************
@@ -188,55 +431,26 @@ static void work_process(struct wqueue_s *wqueue, int lock_id)
  ****************************************************************************/
 void work_queues_init(void)
 {
-	px4_sem_init(&_work_lock[HPWORK], 0, 1);
-	px4_sem_init(&_work_lock[LPWORK], 0, 1);
-#ifdef CONFIG_SCHED_USRWORK
-	px4_sem_init(&_work_lock[USRWORK], 0, 1);
-#endif
-
-	// Create high priority worker thread
-	g_work[HPWORK].pid = px4_task_spawn_cmd("wkr_high",
-						SCHED_DEFAULT,
-						SCHED_PRIORITY_MAX - 1,
-						2000,
-						work_hpthread,
-						(char *const *)NULL);
-
-	// Create low priority worker thread
-	g_work[LPWORK].pid = px4_task_spawn_cmd("wkr_low",
-						SCHED_DEFAULT,
-						SCHED_PRIORITY_MIN,
-						2000,
-						work_lpthread,
-						(char *const *)NULL);
+	// Create high priority worker threads
+	work_pool_init(HPWORK, "hp", "wkr_high", CONFIG_SCHED_HPNTHREADS, SCHED_PRIORITY_MAX - 1, work_hpthread);
 
+	// Create low priority worker threads
+	work_pool_init(LPWORK, "lp", "wkr_low", CONFIG_SCHED_LPNTHREADS, SCHED_PRIORITY_MIN, work_lpthread);
 }
 
 /****************************************************************************
- * Name: work_hpthread, work_lpthread, and work_usrthread
+ * Name: work_hpthread, work_lpthread
  *
  * Description:
  *   These are the worker threads that performs actions placed on the work
- *   lists.
- *
- *   work_hpthread and work_lpthread:  These are the kernel mode work queues
- *     (also build in the flat build).  One of these threads also performs
- *     periodic garbage collection (that is otherwise performed by the idle
- *     thread if CONFIG_SCHED_WORKQUEUE is not defined).
- *
- *     These worker threads are started by the OS during normal bringup.
+ *   lists. Each queue has a pool of them, configured with
+ *   CONFIG_SCHED_HPNTHREADS and CONFIG_SCHED_LPNTHREADS.
  *
- *   work_usrthread:  This is a user mode work queue.  It must be built into
- *     the applicatino blob during the user phase of a kernel build.  The
- *     user work thread will then automatically be started when the system
- *     boots by calling through the pointer found in the header on the user
- *     space blob.
- *
- *   All of these entrypoints are referenced by OS internally and should not
- *   not be accessed by application logic.
+ *   These worker threads are started by work_queues_init() and should not
+ *   be accessed by application logic.
  *
  * Input parameters:
- *   argc, argv (not used)
+ *   argc, argv - the index of the worker in its queue
  *
  * Returned Value:
  *   Does not return
@@ -247,26 +461,7 @@ void work_queues_init(void)
 
 int work_hpthread(int argc, char *argv[])
 {
-	/* Loop forever */
-
-	for (;;) {
-		/* First, perform garbage collection.  This cleans-up memory de-allocations
-		 * that were queued because they could not be freed in that execution
-		 * context (for example, if the memory was freed from an interrupt handler).
-		 * NOTE: If the work thread is disabled, this clean-up is performed by
-		 * the IDLE thread (at a very, very low priority).
-		 */
-
-#ifndef CONFIG_SCHED_LPWORK
-		sched_garbagecollection();
-#endif
-
-		/* Then process queued work.  We need to keep interrupts disabled while
-		 * we process items in the work list.
-		 */
-
-		work_process(&g_work[HPWORK], HPWORK);
-	}
+	work_process(HPWORK, work_thread_index(argc, argv));
 
 	return PX4_OK; /* To keep some compilers happy */
 }
@@ -275,24 +470,7 @@ int work_hpthread(int argc, char *argv[])
 
 int work_lpthread(int argc, char *argv[])
 {
-	/* Loop forever */
-
-	for (;;) {
-		/* First, perform garbage collection.  This cleans-up memory de-allocations
-		 * that were queued because they could not be freed in that execution
-		 * context (for example, if the memory was freed from an interrupt handler).
-		 * NOTE: If the work thread is disabled, this clean-up is performed by
-		 * the IDLE thread (at a very, very low priority).
-		 */
-
-		//sched_garbagecollection();
-
-		/* Then process queued work.  We need to keep interrupts disabled while
-		 * we process items in the work list.
-		 */
-
-		work_process(&g_work[LPWORK], LPWORK);
-	}
+	work_process(LPWORK, work_thread_index(argc, argv));
 
 	return PX4_OK; /* To keep some compilers happy */
 }
@@ -300,25 +478,6 @@ int work_lpthread(int argc, char *argv[])
 #endif /* CONFIG_SCHED_LPWORK */
 #endif /* CONFIG_SCHED_HPWORK */
 
-#ifdef CONFIG_SCHED_USRWORK
-
-int work_usrthread(int argc, char *argv[])
-{
-	/* Loop forever */
-
-	for (;;) {
-		/* Then process queued work.  We need to keep interrupts disabled while
-		 * we process items in the work list.
-		 */
-
-		work_process(&g_work[USRWORK], USRWORK);
-	}
-
-	return PX4_OK; /* To keep some compilers happy */
-}
-
-#endif /* CONFIG_SCHED_USRWORK */
-
 uint32_t clock_systimer()
 {
 	//printf("clock_systimer: %0lx\n", hrt_absolute_time());
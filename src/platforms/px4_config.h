@@ -54,6 +54,15 @@
 /** time in ms between checks for work in work queues **/
 #define CONFIG_SCHED_WORKPERIOD 50000
 
+/** worker threads of the high and low priority work queues, only raise them for
+ * targets whose work items need to run in parallel **/
+#ifndef CONFIG_SCHED_HPNTHREADS
+#define CONFIG_SCHED_HPNTHREADS 1
+#endif
+#ifndef CONFIG_SCHED_LPNTHREADS
+#define CONFIG_SCHED_LPNTHREADS 1
+#endif
+
 #define CONFIG_SCHED_INSTRUMENTATION 1
 #define CONFIG_MAX_TASKS 32
 
@@ -116,6 +116,9 @@ typedef struct pollfd px4_pollfd_struct_t;
 
 typedef short pollevent_t;
 
+/* Persistent set of descriptors to wait on, see px4_pollset_create() */
+typedef struct px4_pollset px4_pollset_t;
+
 typedef struct {
 	/* This part of the struct is POSIX-like */
 	int		fd;       /* The descriptor being polled */
@@ -123,10 +126,13 @@ typedef struct {
 	pollevent_t 	revents;  /* The output event flags */
 
 	/* Required for PX4 compatability */
-	px4_sem_t   *sem;  	/* Pointer to semaphore used to post output event */
+	px4_pollset_t   *pollset;	/* Poll set to wake on output events */
 	void   *priv;     	/* For use by drivers */
 } px4_pollfd_struct_t;
 
+/* Deadline for px4_pollset_wait() that never expires */
+#define PX4_POLLSET_FOREVER	UINT64_MAX
+
 __BEGIN_DECLS
 
 __EXPORT int 		px4_open(const char *path, int flags, ...);
@@ -135,6 +141,17 @@ __EXPORT ssize_t	px4_read(int fd, void *buffer, size_t buflen);
 __EXPORT ssize_t	px4_write(int fd, const void *buffer, size_t buflen);
 __EXPORT int		px4_ioctl(int fd, int cmd, unsigned long arg);
 __EXPORT int		px4_poll(px4_pollfd_struct_t *fds, nfds_t nfds, int timeout);
+
+/*
+ * Persistent poll set: px4_poll() registers with and unregisters from every
+ * device on each call, a poll set registers once and can be waited on many
+ * times. The fds array must stay valid, and the descriptors open, until the
+ * set is destroyed.
+ */
+__EXPORT px4_pollset_t	*px4_pollset_create(px4_pollfd_struct_t *fds, nfds_t nfds);
+__EXPORT int		px4_pollset_wait(px4_pollset_t *set, uint64_t deadline);
+__EXPORT void		px4_pollset_destroy(px4_pollset_t *set);
+__EXPORT void		px4_pollset_notify(px4_pollset_t *set);
 __EXPORT int		px4_fsync(int fd);
 __EXPORT int		px4_access(const char *pathname, int mode);
 __EXPORT unsigned long	px4_getpid(void);
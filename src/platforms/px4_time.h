@@ -43,3 +43,20 @@ __EXPORT unsigned int sleep(unsigned int sec);
 
 __END_DECLS
 #endif
+
+#if defined(__PX4_POSIX) && !defined(__PX4_QURT)
+
+#include <unistd.h>
+
+__BEGIN_DECLS
+
+/* usleep() measured in hrt time, which follows the simulator in lockstep mode */
+__EXPORT int px4_usleep(useconds_t usec);
+
+__END_DECLS
+
+#else
+
+#define px4_usleep usleep
+
+#endif
@@ -60,10 +60,9 @@ __BEGIN_DECLS
 struct wqueue_s {
 	pid_t             pid; /* The task ID of the worker thread */
 	struct dq_queue_s q;   /* The queue of pending work */
+	int               wake; /* Set when work is queued, wakes a lockstep wait */
 };
 
-extern struct wqueue_s g_work[NWORKERS];
-
 /* Defines the work callback */
 
 typedef void (*worker_t)(void *arg);
@@ -74,6 +73,7 @@ struct work_s {
 	void *arg;             /* Callback argument */
 	uint64_t  qtime;       /* Time work queued */
 	uint32_t  delay;       /* Delay until work performed */
+	struct dq_queue_s *q;  /* List of the worker thread the work is queued on */
 };
 
 /****************************************************************************
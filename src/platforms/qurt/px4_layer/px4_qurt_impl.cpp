@@ -142,6 +142,40 @@ dm_write(
 	return 0;
 }
 
+/** Retrieve consecutive items from the data manager store */
+ssize_t
+dm_read_range(
+	dm_item_t item,                 /* The item type to retrieve */
+	unsigned char index,            /* The index of the first item */
+	unsigned num,                   /* The number of items to retrieve */
+	void *buffer,                   /* Pointer to caller data buffer */
+	size_t buflen                   /* Length in bytes of each item */
+)
+{
+	return 0;
+}
+
+/** write consecutive items to the data manager store */
+ssize_t
+dm_write_range(
+	dm_item_t  item,                /* The item type to store */
+	unsigned char index,            /* The index of the first item */
+	unsigned num,                   /* The number of items to store */
+	dm_persitence_t persistence,    /* The persistence level of these items */
+	const void *buffer,             /* Pointer to caller data buffer */
+	size_t buflen                   /* Length in bytes of each item */
+)
+{
+	return 0;
+}
+
+/** Write all data stored so far to physical media */
+int
+dm_flush(void)
+{
+	return 0;
+}
+
 size_t strnlen(const char *s, size_t maxlen)
 {
 	size_t i = 0;
@@ -146,6 +146,85 @@ fail:
 	return -1;
 }
 
+/* Time a mission upload followed by the reads of a feasibility check, item by item and in one range */
+static int
+mission_benchmark(void)
+{
+	const unsigned num_items = NUM_MISSIONS_SUPPORTED;
+	struct mission_item_s item;
+	struct mission_item_s *items;
+	hrt_abstime start, upload, check, range_read, range_write;
+	int ret = -1;
+
+	items = (struct mission_item_s *)malloc(num_items * sizeof(struct mission_item_s));
+
+	if (items == NULL) {
+		warnx("mission benchmark out of memory");
+		return -1;
+	}
+
+	memset(&item, 0, sizeof(item));
+	item.nav_cmd = NAV_CMD_WAYPOINT;
+	start = hrt_absolute_time();
+
+	/* an upload stores one item per received message */
+	for (unsigned i = 0; i < num_items; i++) {
+		item.lat = 47.0 + i * 1e-4;
+		item.lon = 8.0 + i * 1e-4;
+		item.altitude = i;
+
+		if (dm_write(DM_KEY_WAYPOINTS_OFFBOARD_1, i, DM_PERSIST_IN_FLIGHT_RESET, &item, sizeof(item)) != sizeof(item)) {
+			warnx("mission benchmark write failed, index %d", i);
+			goto out;
+		}
+	}
+
+	upload = hrt_absolute_time() - start;
+	start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < num_items; i++) {
+		if (dm_read(DM_KEY_WAYPOINTS_OFFBOARD_1, i, &item, sizeof(item)) != sizeof(item)) {
+			warnx("mission benchmark read failed, index %d", i);
+			goto out;
+		}
+	}
+
+	check = hrt_absolute_time() - start;
+	start = hrt_absolute_time();
+
+	if (dm_read_range(DM_KEY_WAYPOINTS_OFFBOARD_1, 0, num_items, items, sizeof(struct mission_item_s)) != (ssize_t)num_items) {
+		warnx("mission benchmark range read failed");
+		goto out;
+	}
+
+	range_read = hrt_absolute_time() - start;
+
+	for (unsigned i = 0; i < num_items; i++) {
+		if ((items[i].nav_cmd != NAV_CMD_WAYPOINT) || (items[i].altitude != (float)i)) {
+			warnx("mission benchmark data verification failed, index %d", i);
+			goto out;
+		}
+	}
+
+	start = hrt_absolute_time();
+
+	if (dm_write_range(DM_KEY_WAYPOINTS_OFFBOARD_1, 0, num_items, DM_PERSIST_IN_FLIGHT_RESET, items,
+			   sizeof(struct mission_item_s)) != (ssize_t)num_items) {
+		warnx("mission benchmark range write failed");
+		goto out;
+	}
+
+	range_write = hrt_absolute_time() - start;
+
+	warnx("Mission of %d items: upload %llums, check %llums, range read %lluus, range write %llums",
+	      num_items, upload / 1000, check / 1000, range_read, range_write / 1000);
+	ret = 0;
+
+out:
+	free(items);
+	return ret;
+}
+
 int test_dataman(int argc, char *argv[])
 {
 	int i, num_tasks = 4;
@@ -179,6 +258,11 @@ int test_dataman(int argc, char *argv[])
 	}
 
 	free(sems);
+
+	if (mission_benchmark() != 0) {
+		return -1;
+	}
+
 	dm_restart(DM_INIT_REASON_IN_FLIGHT);
 
 	for (i = 0; i < NUM_MISSIONS_SUPPORTED; i++) {
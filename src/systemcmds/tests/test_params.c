@@ -39,6 +39,7 @@
 
 #include <px4_defines.h>
 #include <stdio.h>
+#include <drivers/drv_hrt.h>
 #include "systemlib/err.h"
 #include "systemlib/param/param.h"
 #include "tests.h"
@@ -85,6 +86,9 @@ test_param(int argc, char *argv[])
 
 	val = PARAM_MAGIC2;
 
+	uint32_t version = param_version();
+	param_t other = param_for_index(0);
+
 	if (param_set(p, &val) != OK) {
 		warnx("failed to write test parameter");
 		return 1;
@@ -100,6 +104,49 @@ test_param(int argc, char *argv[])
 		return 1;
 	}
 
+	if (!param_changed_since(p, version) || param_changed_since(p, param_version())) {
+		warnx("parameter change not tracked");
+		return 1;
+	}
+
+	if (other != p && param_changed_since(other, version)) {
+		warnx("unchanged parameter reported as changed");
+		return 1;
+	}
+
+	/* resolve every parameter by name, as the modules do on boot */
+	unsigned count = param_count();
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < count; i++) {
+		if (param_find_no_notification(param_name(param_for_index(i))) != param_for_index(i)) {
+			warnx("lookup of %s failed", param_name(param_for_index(i)));
+			return 1;
+		}
+	}
+
+	hrt_abstime find_time = hrt_elapsed_time(&start);
+
+	/* read back a changed and a default value */
+	const unsigned gets = 10000;
+	param_t q = param_for_index(0);
+	start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < gets; i++) {
+		param_get(p, &val);
+		param_get(q, &val);
+	}
+
+	hrt_abstime get_time = hrt_elapsed_time(&start);
+
+	warnx("param_find: %u params in %u us, param_get: %u ns per call",
+	      count, (unsigned)find_time, (unsigned)(get_time * 1000 / (2 * gets)));
+
+	if (param_reset(p) != OK) {
+		warnx("failed param reset");
+		return 1;
+	}
+
 	warnx("parameter test PASS");
 
 	return 0;
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <drivers/drv_hrt.h>
+#include <navigator/geofence_polygons.h>
+
+#include "gtest/gtest.h"
+
+static const double home_lat = 47.397742;
+static const double home_lon = 8.545594;
+
+/* metres to degrees around the home position */
+static double north_to_lat(double north) { return home_lat + north / 111195.0; }
+static double east_to_lon(double east) { return home_lon + east / (111195.0 * cos(home_lat * M_PI / 180.0)); }
+
+/* star shaped polygon around home with radii between 500 and 1000 m */
+static void make_polygon(unsigned count, double *lat, double *lon)
+{
+	for (unsigned i = 0; i < count; i++) {
+		double angle = 2.0 * M_PI * i / count;
+		double radius = 500.0 + (rand() % 500);
+		lat[i] = north_to_lat(radius * cos(angle));
+		lon[i] = east_to_lon(radius * sin(angle));
+	}
+}
+
+/* the original test, going through all edges in geographic coordinates */
+static bool inside_brute_force(unsigned count, const double *lat, const double *lon, double plat, double plon)
+{
+	bool c = false;
+
+	for (unsigned i = 0, j = count - 1; i < count; j = i++) {
+		if ((lon[i] >= plon) != (lon[j] >= plon) &&
+		    (plat <= (lat[j] - lat[i]) * (plon - lon[i]) / (lon[j] - lon[i]) + lat[i])) {
+			c = !c;
+		}
+	}
+
+	return c;
+}
+
+TEST(GeofenceTest, Square)
+{
+	GeofencePolygons fence;
+
+	ASSERT_TRUE(fence.inside(home_lat, home_lon));
+
+	fence.addVertex(north_to_lat(-100), east_to_lon(-100));
+	fence.addVertex(north_to_lat(100), east_to_lon(-100));
+	fence.addVertex(north_to_lat(100), east_to_lon(100));
+	ASSERT_FALSE(fence.isCompiled());
+	fence.addVertex(north_to_lat(-100), east_to_lon(100));
+	ASSERT_TRUE(fence.compile());
+
+	ASSERT_TRUE(fence.inside(home_lat, home_lon));
+	ASSERT_TRUE(fence.inside(north_to_lat(90), east_to_lon(-90)));
+	ASSERT_FALSE(fence.inside(north_to_lat(110), east_to_lon(0)));
+	ASSERT_FALSE(fence.inside(north_to_lat(0), east_to_lon(-110)));
+	ASSERT_FALSE(fence.inside(north_to_lat(1000), east_to_lon(1000)));
+}
+
+TEST(GeofenceTest, TooFewVertices)
+{
+	GeofencePolygons fence;
+
+	fence.addVertex(north_to_lat(-100), east_to_lon(-100));
+	fence.addVertex(north_to_lat(100), east_to_lon(-100));
+	ASSERT_FALSE(fence.compile());
+
+	fence.clear();
+	ASSERT_TRUE(fence.isEmpty());
+}
+
+TEST(GeofenceTest, Swap)
+{
+	GeofencePolygons fence;
+	GeofencePolygons loading;
+
+	loading.addVertex(north_to_lat(-100), east_to_lon(-100));
+	loading.addVertex(north_to_lat(100), east_to_lon(-100));
+	loading.addVertex(north_to_lat(100), east_to_lon(100));
+	loading.addVertex(north_to_lat(-100), east_to_lon(100));
+	ASSERT_TRUE(loading.compile());
+
+	fence.swap(loading);
+	ASSERT_TRUE(loading.isEmpty());
+	ASSERT_TRUE(fence.isCompiled());
+	ASSERT_EQ(4u, fence.vertexCount());
+	ASSERT_TRUE(fence.inside(home_lat, home_lon));
+	ASSERT_FALSE(fence.inside(north_to_lat(110), east_to_lon(0)));
+
+	/* the previous fence is freed without touching the one in use */
+	fence.swap(loading);
+	fence.clear();
+	ASSERT_FALSE(loading.inside(north_to_lat(110), east_to_lon(0)));
+}
+
+TEST(GeofenceTest, InclusionExclusion)
+{
+	GeofencePolygons fence;
+
+	/* two separate areas, the first one with a hole */
+	ASSERT_TRUE(fence.beginPolygon(true));
+	fence.addVertex(north_to_lat(-100), east_to_lon(-100));
+	fence.addVertex(north_to_lat(100), east_to_lon(-100));
+	fence.addVertex(north_to_lat(100), east_to_lon(100));
+	fence.addVertex(north_to_lat(-100), east_to_lon(100));
+
+	ASSERT_TRUE(fence.beginPolygon(true));
+	fence.addVertex(north_to_lat(500), east_to_lon(500));
+	fence.addVertex(north_to_lat(600), east_to_lon(500));
+	fence.addVertex(north_to_lat(550), east_to_lon(600));
+
+	ASSERT_TRUE(fence.beginPolygon(false));
+	fence.addVertex(north_to_lat(-10), east_to_lon(-10));
+	fence.addVertex(north_to_lat(10), east_to_lon(-10));
+	fence.addVertex(north_to_lat(10), east_to_lon(10));
+	fence.addVertex(north_to_lat(-10), east_to_lon(10));
+
+	ASSERT_TRUE(fence.compile());
+	ASSERT_EQ(3, fence.polygonCount());
+	ASSERT_EQ(11, fence.vertexCount());
+
+	ASSERT_FALSE(fence.inside(home_lat, home_lon));
+	ASSERT_TRUE(fence.inside(north_to_lat(50), east_to_lon(50)));
+	ASSERT_TRUE(fence.inside(north_to_lat(540), east_to_lon(530)));
+	ASSERT_FALSE(fence.inside(north_to_lat(300), east_to_lon(300)));
+
+	/* only an exclusion polygon, everything else is allowed */
+	fence.clear();
+	ASSERT_TRUE(fence.beginPolygon(false));
+	fence.addVertex(north_to_lat(-10), east_to_lon(-10));
+	fence.addVertex(north_to_lat(10), east_to_lon(-10));
+	fence.addVertex(north_to_lat(10), east_to_lon(10));
+	ASSERT_TRUE(fence.compile());
+
+	ASSERT_FALSE(fence.inside(north_to_lat(5), east_to_lon(0)));
+	ASSERT_TRUE(fence.inside(north_to_lat(300), east_to_lon(300)));
+}
+
+TEST(GeofenceTest, Benchmark)
+{
+	const unsigned sizes[] = { 10, 100, 1000 };
+	const unsigned num_points = 10000;
+
+	srand(1234);
+
+	double *points = new double[num_points * 2];
+
+	for (unsigned i = 0; i < num_points; i++) {
+		points[i * 2] = north_to_lat((rand() % 2400) - 1200.0);
+		points[i * 2 + 1] = east_to_lon((rand() % 2400) - 1200.0);
+	}
+
+	for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		unsigned count = sizes[s];
+		double *lat = new double[count];
+		double *lon = new double[count];
+		make_polygon(count, lat, lon);
+
+		GeofencePolygons fence;
+
+		for (unsigned i = 0; i < count; i++) {
+			ASSERT_TRUE(fence.addVertex(lat[i], lon[i]));
+		}
+
+		hrt_abstime start = hrt_absolute_time();
+		ASSERT_TRUE(fence.compile());
+		hrt_abstime compile_time = hrt_absolute_time() - start;
+
+		unsigned inside_brute = 0, inside_compiled = 0;
+
+		start = hrt_absolute_time();
+
+		for (unsigned i = 0; i < num_points; i++) {
+			inside_brute += inside_brute_force(count, lat, lon, points[i * 2], points[i * 2 + 1]);
+		}
+
+		hrt_abstime brute_time = hrt_absolute_time() - start;
+		start = hrt_absolute_time();
+
+		for (unsigned i = 0; i < num_points; i++) {
+			inside_compiled += fence.inside(points[i * 2], points[i * 2 + 1]);
+		}
+
+		hrt_abstime compiled_time = hrt_absolute_time() - start;
+
+		printf("%4u vertices: compile %llu us, all edges %.3f us/test, compiled %.3f us/test, %u of %u inside\n",
+		       count, (unsigned long long)compile_time,
+		       (double)brute_time / num_points, (double)compiled_time / num_points, inside_compiled, num_points);
+
+		/* rounding in the local frame may move a few points right on the border */
+		ASSERT_NEAR(inside_brute, inside_compiled, num_points / 1000);
+
+		delete[] lat;
+		delete[] lon;
+	}
+
+	delete[] points;
+}
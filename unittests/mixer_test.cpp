@@ -1,4 +1,12 @@
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <drivers/drv_hrt.h>
+#include <px4iofirmware/protocol.h>
 #include <systemlib/mixer/mixer.h>
+#include <systemlib/mixer/mixer_multirotor.generated.h>
 #include <systemlib/err.h>
 #include "../../src/systemcmds/tests/tests.h"
 
@@ -10,3 +18,277 @@ TEST(MixerTest, Mixer)
 	char *args[] = {"empty", "../ROMFS/px4fmu_common/mixers/IO_pass.mix", "../ROMFS/px4fmu_common/mixers/quad_w.main.mix"};
 	ASSERT_EQ(test_mixer(3, args), 0) << "IO_pass.mix failed";
 }
+
+static float mixer_controls[4];
+
+static int mixer_control_cb(uintptr_t handle, uint8_t control_group, uint8_t control_index, float &control)
+{
+	control = mixer_controls[control_index];
+	return 0;
+}
+
+/* the multirotor mixer before its rotor table was rearranged, to compare the outputs with */
+static float constrain_ref(float val, float min, float max)
+{
+	return (val < min) ? min : ((val > max) ? max : val);
+}
+
+class ReferenceMultirotorMixer : public Mixer
+{
+public:
+	ReferenceMultirotorMixer(MultirotorGeometry geometry) :
+		Mixer(mixer_control_cb, 0),
+		_rotor_count(_config_rotor_count[(MultirotorGeometryUnderlyingType)geometry]),
+		_rotors(_config_index[(MultirotorGeometryUnderlyingType)geometry])
+	{
+	}
+
+	virtual unsigned mix(float *outputs, unsigned space, uint16_t *status_reg);
+	virtual void groups_required(uint32_t &groups) {}
+
+private:
+	unsigned _rotor_count;
+	const MultirotorMixer::Rotor *_rotors;
+};
+
+unsigned ReferenceMultirotorMixer::mix(float *outputs, unsigned space, uint16_t *status_reg)
+{
+	const float _roll_scale = 1.0f;
+	const float _pitch_scale = 1.0f;
+	const float _yaw_scale = 1.0f;
+	const float _idle_speed = -1.0f;
+
+	float		roll    = constrain_ref(get_control(0, 0) * _roll_scale, -1.0f, 1.0f);
+	float		pitch   = constrain_ref(get_control(0, 1) * _pitch_scale, -1.0f, 1.0f);
+	float		yaw     = constrain_ref(get_control(0, 2) * _yaw_scale, -1.0f, 1.0f);
+	float		thrust  = constrain_ref(get_control(0, 3), 0.0f, 1.0f);
+	float		min_out = 0.0f;
+	float		max_out = 0.0f;
+
+	(*status_reg) = 0;
+
+	float thrust_increase_factor = 1.5f;
+	float thrust_decrease_factor = 0.6f;
+
+	for (unsigned i = 0; i < _rotor_count; i++) {
+		float out = roll * _rotors[i].roll_scale +
+			    pitch * _rotors[i].pitch_scale +
+			    thrust;
+
+		out *= _rotors[i].out_scale;
+
+		if (out < min_out) {
+			min_out = out;
+		}
+
+		if (out > max_out) {
+			max_out = out;
+		}
+
+		outputs[i] = out;
+	}
+
+	float boost = 0.0f;
+	float roll_pitch_scale = 1.0f;
+
+	if (min_out < 0.0f && max_out < 1.0f && -min_out <= 1.0f - max_out) {
+		float max_thrust_diff = thrust * thrust_increase_factor - thrust;
+
+		if (max_thrust_diff >= -min_out) {
+			boost = -min_out;
+
+		} else {
+			boost = max_thrust_diff;
+			roll_pitch_scale = (thrust + boost) / (thrust - min_out);
+		}
+
+	} else if (max_out > 1.0f && min_out > 0.0f && min_out >= max_out - 1.0f) {
+		float max_thrust_diff = thrust - thrust_decrease_factor * thrust;
+
+		if (max_thrust_diff >= max_out - 1.0f) {
+			boost = -(max_out - 1.0f);
+
+		} else {
+			boost = -max_thrust_diff;
+			roll_pitch_scale = (1 - (thrust + boost)) / (max_out - thrust);
+		}
+
+	} else if (min_out < 0.0f && max_out < 1.0f && -min_out > 1.0f - max_out) {
+		float max_thrust_diff = thrust * thrust_increase_factor - thrust;
+		boost = constrain_ref(-min_out - (1.0f - max_out) / 2.0f, 0.0f, max_thrust_diff);
+		roll_pitch_scale = (thrust + boost) / (thrust - min_out);
+
+	} else if (max_out > 1.0f && min_out > 0.0f && min_out < max_out - 1.0f) {
+		float max_thrust_diff = thrust - thrust_decrease_factor * thrust;
+		boost = constrain_ref(-(max_out - 1.0f - min_out) / 2.0f, -max_thrust_diff, 0.0f);
+		roll_pitch_scale = (1 - (thrust + boost)) / (max_out - thrust);
+
+	} else if (min_out < 0.0f && max_out > 1.0f) {
+		boost = constrain_ref(-(max_out - 1.0f + min_out) / 2.0f, thrust_decrease_factor * thrust - thrust,
+				      thrust_increase_factor * thrust - thrust);
+		roll_pitch_scale = (thrust + boost) / (thrust - min_out);
+	}
+
+	if (min_out < 0.0f) {
+		(*status_reg) |= PX4IO_P_STATUS_MIXER_LOWER_LIMIT;
+	}
+
+	if (max_out > 0.0f) {
+		(*status_reg) |= PX4IO_P_STATUS_MIXER_UPPER_LIMIT;
+	}
+
+	for (unsigned i = 0; i < _rotor_count; i++) {
+		float out = (roll * _rotors[i].roll_scale +
+			     pitch * _rotors[i].pitch_scale) * roll_pitch_scale +
+			    yaw * _rotors[i].yaw_scale +
+			    thrust + boost;
+
+		out *= _rotors[i].out_scale;
+
+		if (out < 0.0f) {
+			if (fabsf(_rotors[i].yaw_scale) <= FLT_EPSILON) {
+				yaw = 0.0f;
+
+			} else {
+				yaw = -((roll * _rotors[i].roll_scale + pitch * _rotors[i].pitch_scale) *
+					roll_pitch_scale + thrust + boost) / _rotors[i].yaw_scale;
+			}
+
+			(*status_reg) |= PX4IO_P_STATUS_MIXER_YAW_LIMIT;
+
+		} else if (out > 1.0f) {
+			float thrust_reduction = fminf(0.15f, out - 1.0f);
+			thrust -= thrust_reduction;
+
+			if (fabsf(_rotors[i].yaw_scale) <= FLT_EPSILON) {
+				yaw = 0.0f;
+
+			} else {
+				yaw = (1.0f - ((roll * _rotors[i].roll_scale + pitch * _rotors[i].pitch_scale) *
+					       roll_pitch_scale + thrust + boost)) / _rotors[i].yaw_scale;
+			}
+
+			(*status_reg) |= PX4IO_P_STATUS_MIXER_YAW_LIMIT;
+		}
+	}
+
+	for (unsigned i = 0; i < _rotor_count; i++) {
+		outputs[i] = (roll * _rotors[i].roll_scale +
+			      pitch * _rotors[i].pitch_scale) * roll_pitch_scale +
+			     yaw * _rotors[i].yaw_scale +
+			     thrust + boost;
+
+		outputs[i] = constrain_ref(_idle_speed + (outputs[i] * (1.0f - _idle_speed)), _idle_speed, 1.0f);
+	}
+
+	return _rotor_count;
+}
+
+static const struct {
+	const char *name;
+	MultirotorGeometry geometry;
+} mixer_geometries[] = {
+	{ "4x", MultirotorGeometry::QUAD_X },
+	{ "4+", MultirotorGeometry::QUAD_PLUS },
+	{ "4v", MultirotorGeometry::QUAD_V },
+	{ "4w", MultirotorGeometry::QUAD_WIDE },
+	{ "4dc", MultirotorGeometry::QUAD_DEADCAT },
+	{ "6x", MultirotorGeometry::HEX_X },
+	{ "6+", MultirotorGeometry::HEX_PLUS },
+	{ "6c", MultirotorGeometry::HEX_COX },
+	{ "8x", MultirotorGeometry::OCTA_X },
+	{ "8+", MultirotorGeometry::OCTA_PLUS },
+	{ "8c", MultirotorGeometry::OCTA_COX },
+	{ "2-", MultirotorGeometry::TWIN_ENGINE },
+	{ "3y", MultirotorGeometry::TRI_Y },
+};
+
+static float random_control(float min, float max)
+{
+	return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+TEST(MixerTest, MultirotorMatchesReference)
+{
+	srand(42);
+
+	for (unsigned g = 0; g < sizeof(mixer_geometries) / sizeof(mixer_geometries[0]); g++) {
+		char buf[64];
+		snprintf(buf, sizeof(buf), "R: %s 10000 10000 10000 0\n", mixer_geometries[g].name);
+		unsigned buflen = strlen(buf);
+
+		MultirotorMixer *mixer = MultirotorMixer::from_text(mixer_control_cb, 0, buf, buflen);
+		ASSERT_NE(nullptr, mixer) << buf;
+
+		ReferenceMultirotorMixer reference(mixer_geometries[g].geometry);
+		unsigned rotor_count = _config_rotor_count[(MultirotorGeometryUnderlyingType)mixer_geometries[g].geometry];
+
+		for (unsigned n = 0; n < 20000; n++) {
+			/* cover the saturated cases with controls beyond their range */
+			mixer_controls[0] = random_control(-1.5f, 1.5f);
+			mixer_controls[1] = random_control(-1.5f, 1.5f);
+			mixer_controls[2] = random_control(-1.5f, 1.5f);
+			mixer_controls[3] = random_control(-0.2f, 1.2f);
+
+			float outputs[MultirotorMixer::MAX_ROTORS];
+			float expected[MultirotorMixer::MAX_ROTORS];
+			uint16_t status = 0, expected_status = 0;
+
+			ASSERT_EQ(rotor_count, mixer->mix(outputs, MultirotorMixer::MAX_ROTORS, &status));
+			reference.mix(expected, MultirotorMixer::MAX_ROTORS, &expected_status);
+
+			ASSERT_EQ(expected_status, status);
+			ASSERT_EQ(0, memcmp(expected, outputs, rotor_count * sizeof(float))) << buf;
+		}
+
+		delete mixer;
+	}
+}
+
+TEST(MixerTest, MultirotorBenchmark)
+{
+	const unsigned iterations = 1000000;
+	char buf[] = "R: 8x 10000 10000 10000 0\n";
+	unsigned buflen = strlen(buf);
+
+	Mixer *mixer = MultirotorMixer::from_text(mixer_control_cb, 0, buf, buflen);
+	ASSERT_NE(nullptr, mixer);
+
+	Mixer *reference = new ReferenceMultirotorMixer(MultirotorGeometry::OCTA_X);
+	float outputs[MultirotorMixer::MAX_ROTORS];
+	uint16_t status;
+	volatile float sink = 0.0f;
+
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned n = 0; n < iterations; n++) {
+		mixer_controls[0] = (n & 0xff) / 255.0f - 0.5f;
+		mixer_controls[1] = 0.1f;
+		mixer_controls[2] = 0.1f;
+		mixer_controls[3] = 0.5f;
+		reference->mix(outputs, MultirotorMixer::MAX_ROTORS, &status);
+		sink = outputs[0];
+	}
+
+	hrt_abstime reference_time = hrt_absolute_time() - start;
+	start = hrt_absolute_time();
+
+	for (unsigned n = 0; n < iterations; n++) {
+		mixer_controls[0] = (n & 0xff) / 255.0f - 0.5f;
+		mixer_controls[1] = 0.1f;
+		mixer_controls[2] = 0.1f;
+		mixer_controls[3] = 0.5f;
+		mixer->mix(outputs, MultirotorMixer::MAX_ROTORS, &status);
+		sink = outputs[0];
+	}
+
+	hrt_abstime mixer_time = hrt_absolute_time() - start;
+
+	printf("octa x mix: reference %.1f ns, mixer %.1f ns\n",
+	       reference_time * 1000.0 / iterations, mixer_time * 1000.0 / iterations);
+
+	(void)sink;
+
+	delete reference;
+	delete mixer;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <time.h>
+#include <uORB/ORBMap.hpp>
+
+#include "gtest/gtest.h"
+
+static uint64_t now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Fills the map with num_topics node paths and returns the mean cost of a
+ * lookup in nanoseconds, checking every lookup on the way.
+ */
+static double _lookup_benchmark(unsigned num_topics)
+{
+	uORB::ORBMap map;
+	char path[64];
+
+	for (unsigned i = 0; i < num_topics; i++) {
+		snprintf(path, sizeof(path), "/obj/benchmark_topic_%u0", i);
+		map.insert(path, (uORB::DeviceNode *)(uintptr_t)(i + 1));
+	}
+
+	EXPECT_EQ(num_topics, map.size());
+
+	const unsigned rounds = 200;
+	unsigned misses = 0;
+	uint64_t start = now_ns();
+
+	for (unsigned r = 0; r < rounds; r++) {
+		for (unsigned i = 0; i < num_topics; i++) {
+			snprintf(path, sizeof(path), "/obj/benchmark_topic_%u0", i);
+
+			if (map.get(path) != (uORB::DeviceNode *)(uintptr_t)(i + 1)) {
+				misses++;
+			}
+		}
+	}
+
+	uint64_t elapsed = now_ns() - start;
+
+	EXPECT_EQ(0u, misses);
+
+	double per_lookup = (double)elapsed / (rounds * num_topics);
+	printf("ORBMap: %u topics, %.1f ns per lookup\n", num_topics, per_lookup);
+	return per_lookup;
+}
+
+TEST(ORBMapTest, InsertFindReplace)
+{
+	uORB::ORBMap map;
+
+	ASSERT_FALSE(map.find("/obj/sensor_gyro0"));
+	ASSERT_EQ(nullptr, map.get("/obj/sensor_gyro0"));
+
+	map.insert("/obj/sensor_gyro0", (uORB::DeviceNode *)0x10);
+	map.insert("/obj/sensor_gyro1", (uORB::DeviceNode *)0x20);
+
+	ASSERT_TRUE(map.find("/obj/sensor_gyro0"));
+	ASSERT_EQ((uORB::DeviceNode *)0x10, map.get("/obj/sensor_gyro0"));
+	ASSERT_EQ((uORB::DeviceNode *)0x20, map.get("/obj/sensor_gyro1"));
+	ASSERT_FALSE(map.find("/obj/sensor_gyro2"));
+
+	/* re-inserting a path replaces the node */
+	map.insert("/obj/sensor_gyro0", (uORB::DeviceNode *)0x30);
+	ASSERT_EQ((uORB::DeviceNode *)0x30, map.get("/obj/sensor_gyro0"));
+	ASSERT_EQ(2u, map.size());
+}
+
+TEST(ORBMapTest, LookupScalesWithTopicCount)
+{
+	uORB::ORBMap map;
+	char path[64];
+
+	for (unsigned i = 0; i < 500; i++) {
+		snprintf(path, sizeof(path), "/obj/benchmark_topic_%u0", i);
+		map.insert(path, (uORB::DeviceNode *)(uintptr_t)(i + 1));
+
+		/* the table grows with the topics, so the chains stay short */
+		ASSERT_LE(map.size(), map.buckets());
+		ASSERT_LE(map.longest_chain(), 8u) << "with " << map.size() << " topics";
+	}
+
+	/* timings for information only, they are too noisy to assert on */
+	_lookup_benchmark(80);
+	_lookup_benchmark(500);
+}
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <drivers/drv_hrt.h>
+#include <drivers/device/ringbuffer.h>
+
+#include "gtest/gtest.h"
+
+/* a report sized item, the check value catches torn copies */
+struct item_s {
+	uint64_t seq;
+	uint32_t pad[10];
+	uint64_t check;
+};
+
+static void make_item(item_s &item, uint64_t seq)
+{
+	item.seq = seq;
+
+	for (unsigned i = 0; i < sizeof(item.pad) / sizeof(item.pad[0]); i++) {
+		item.pad[i] = (uint32_t)(seq * 31 + i);
+	}
+
+	item.check = ~seq;
+}
+
+static bool item_valid(const item_s &item)
+{
+	for (unsigned i = 0; i < sizeof(item.pad) / sizeof(item.pad[0]); i++) {
+		if (item.pad[i] != (uint32_t)(item.seq * 31 + i)) {
+			return false;
+		}
+	}
+
+	return item.check == ~item.seq;
+}
+
+TEST(RingBufferTest, PutGet)
+{
+	ringbuffer::TypedRingBuffer<item_s> buffer(3);
+	item_s item;
+
+	ASSERT_EQ(3u, buffer.size());
+	ASSERT_TRUE(buffer.empty());
+	ASSERT_FALSE(buffer.get(item));
+
+	for (uint64_t seq = 0; seq < 3; seq++) {
+		make_item(item, seq);
+		ASSERT_TRUE(buffer.put(item));
+	}
+
+	/* the depth is kept even though the storage is a power of two */
+	ASSERT_TRUE(buffer.full());
+	ASSERT_EQ(0u, buffer.space());
+	make_item(item, 3);
+	ASSERT_FALSE(buffer.put(item));
+
+	/* force discards the oldest */
+	ASSERT_TRUE(buffer.force(item));
+	ASSERT_EQ(3u, buffer.count());
+
+	for (uint64_t seq = 1; seq < 4; seq++) {
+		ASSERT_TRUE(buffer.get(item));
+		ASSERT_EQ(seq, item.seq);
+		ASSERT_TRUE(item_valid(item));
+	}
+
+	ASSERT_TRUE(buffer.empty());
+	ASSERT_FALSE(buffer.force(item));
+	buffer.flush();
+	ASSERT_TRUE(buffer.empty());
+}
+
+TEST(RingBufferTest, Batch)
+{
+	ringbuffer::TypedRingBuffer<item_s> buffer(8);
+	item_s in[20], out[20];
+	uint64_t put_seq = 0, get_seq = 0;
+
+	/* batches of different sizes wrap around the end of the storage */
+	for (unsigned round = 0; round < 100; round++) {
+		unsigned n = 1 + round % 7;
+
+		for (unsigned i = 0; i < n; i++) {
+			make_item(in[i], put_seq + i);
+		}
+
+		unsigned space = buffer.space();
+		unsigned put = buffer.put_n(in, n);
+		ASSERT_EQ((n < space) ? n : space, put);
+		put_seq += put;
+
+		unsigned got = buffer.get_n(out, 1 + round % 5);
+
+		for (unsigned i = 0; i < got; i++) {
+			ASSERT_EQ(get_seq++, out[i].seq);
+			ASSERT_TRUE(item_valid(out[i]));
+		}
+	}
+
+	/* the buffer stops at its depth */
+	buffer.flush();
+
+	for (unsigned i = 0; i < 20; i++) {
+		make_item(in[i], i);
+	}
+
+	ASSERT_EQ(8u, buffer.put_n(in, 20));
+	ASSERT_EQ(8u, buffer.get_n(out, 20));
+	ASSERT_EQ(7u, out[7].seq);
+}
+
+struct stress_s {
+	ringbuffer::TypedRingBuffer<item_s> *buffer;
+	uint64_t items;
+	bool force;
+	volatile bool done;
+	uint64_t received;
+	uint64_t errors;
+};
+
+static void *producer(void *arg)
+{
+	stress_s *stress = (stress_s *)arg;
+	item_s item;
+
+	for (uint64_t seq = 0; seq < stress->items;) {
+		make_item(item, seq);
+
+		if (stress->force) {
+			stress->buffer->force(item);
+			seq++;
+
+			/* let the consumer keep up with part of the items */
+			if ((seq & 3) == 0) {
+				sched_yield();
+			}
+
+		} else if (stress->buffer->put(item)) {
+			seq++;
+
+		} else {
+			sched_yield();
+		}
+	}
+
+	stress->done = true;
+	return nullptr;
+}
+
+static void *consumer(void *arg)
+{
+	stress_s *stress = (stress_s *)arg;
+	item_s items[5];
+	uint64_t next = 0;
+
+	for (;;) {
+		bool done = stress->done;
+		unsigned got = stress->buffer->get_n(items, 5);
+
+		for (unsigned i = 0; i < got; i++) {
+			/* in order, without duplicates and only skipping items when forced */
+			if (!item_valid(items[i]) || items[i].seq < next || (!stress->force && items[i].seq != next)) {
+				stress->errors++;
+			}
+
+			next = items[i].seq + 1;
+			stress->received++;
+		}
+
+		if (got == 0) {
+			if (done) {
+				break;
+			}
+
+			sched_yield();
+		}
+	}
+
+	return nullptr;
+}
+
+static void run_stress(bool force)
+{
+	ringbuffer::TypedRingBuffer<item_s> buffer(6);
+	stress_s stress = { &buffer, 2000000, force, false, 0, 0 };
+	pthread_t threads[2];
+
+	hrt_abstime start = hrt_absolute_time();
+	pthread_create(&threads[0], nullptr, consumer, &stress);
+	pthread_create(&threads[1], nullptr, producer, &stress);
+	pthread_join(threads[1], nullptr);
+	pthread_join(threads[0], nullptr);
+
+	printf("%s: %llu items, %llu received in %llu ms\n", force ? "force" : "put",
+	       (unsigned long long)stress.items, (unsigned long long)stress.received,
+	       (unsigned long long)(hrt_absolute_time() - start) / 1000);
+
+	ASSERT_EQ(0u, stress.errors);
+
+	if (!force) {
+		ASSERT_EQ(stress.items, stress.received);
+	}
+}
+
+TEST(RingBufferTest, StressPut)
+{
+	run_stress(false);
+}
+
+TEST(RingBufferTest, StressForce)
+{
+	run_stress(true);
+}
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <px4_workqueue.h>
+#include <drivers/drv_hrt.h>
+#include <systemlib/perf_counter.h>
+
+extern "C" {
+#include <platforms/posix/work_queue/work_lock.h>
+}
+
+#include "gtest/gtest.h"
+
+/* built with CONFIG_SCHED_LPNTHREADS=4, the low priority queue is a pool */
+static const unsigned num_workers = 4;
+
+static void start_queues()
+{
+	static bool started = false;
+
+	if (!started) {
+		work_queues_init();
+		started = true;
+	}
+}
+
+/* wait until count reaches target, false after two seconds */
+static bool wait_for(volatile int *count, int target)
+{
+	hrt_abstime deadline = hrt_absolute_time() + 2000000;
+
+	while (__atomic_load_n(count, __ATOMIC_SEQ_CST) < target) {
+		if (hrt_absolute_time() > deadline) {
+			return false;
+		}
+
+		usleep(1000);
+	}
+
+	return true;
+}
+
+/* work that sleeps and records how many items ran at the same time */
+struct busy_s {
+	struct work_s work;
+	unsigned duration;
+	hrt_abstime start;
+	hrt_abstime end;
+};
+
+static volatile int g_running;
+static volatile int g_max_running;
+static volatile int g_done;
+
+static void busy_reset()
+{
+	g_running = 0;
+	g_max_running = 0;
+	g_done = 0;
+}
+
+static void busy_worker(void *arg)
+{
+	struct busy_s *busy = (struct busy_s *)arg;
+	busy->start = hrt_absolute_time();
+
+	int running = __atomic_add_fetch(&g_running, 1, __ATOMIC_SEQ_CST);
+	int max = __atomic_load_n(&g_max_running, __ATOMIC_SEQ_CST);
+
+	while (running > max && !__atomic_compare_exchange_n(&g_max_running, &max, running, false, __ATOMIC_SEQ_CST,
+			__ATOMIC_SEQ_CST)) {
+	}
+
+	usleep(busy->duration);
+
+	__atomic_sub_fetch(&g_running, 1, __ATOMIC_SEQ_CST);
+	busy->end = hrt_absolute_time();
+	__atomic_add_fetch(&g_done, 1, __ATOMIC_SEQ_CST);
+}
+
+TEST(WorkQueueTest, Pool)
+{
+	start_queues();
+
+	ASSERT_EQ(num_workers, g_work[LPWORK].nthreads);
+	ASSERT_EQ(1u, g_work[HPWORK].nthreads);
+}
+
+TEST(WorkQueueTest, Parallel)
+{
+	struct busy_s busy[8];
+
+	start_queues();
+	busy_reset();
+	memset(busy, 0, sizeof(busy));
+
+	for (unsigned i = 0; i < 8; i++) {
+		busy[i].duration = 20000;
+		ASSERT_EQ(PX4_OK, work_queue(LPWORK, &busy[i].work, busy_worker, &busy[i], 0));
+	}
+
+	ASSERT_TRUE(wait_for(&g_done, 8));
+
+	/* work queued from outside is spread over the workers */
+	ASSERT_GE(g_max_running, 2);
+}
+
+/* work queued from a worker stays on its lists until an idle worker steals it */
+static struct busy_s g_children[3];
+static struct busy_s g_parent;
+
+static void parent_worker(void *arg)
+{
+	for (unsigned i = 0; i < 3; i++) {
+		g_children[i].duration = 20000;
+		work_queue(LPWORK, &g_children[i].work, busy_worker, &g_children[i], 0);
+	}
+
+	busy_worker(arg);
+}
+
+TEST(WorkQueueTest, Stealing)
+{
+	start_queues();
+	busy_reset();
+	memset(&g_parent, 0, sizeof(g_parent));
+	memset(g_children, 0, sizeof(g_children));
+
+	g_parent.duration = 100000;
+	ASSERT_EQ(PX4_OK, work_queue(LPWORK, &g_parent.work, parent_worker, &g_parent, 0));
+	ASSERT_TRUE(wait_for(&g_done, 4));
+
+	/* the children ran on the other workers while the parent was busy */
+	for (unsigned i = 0; i < 3; i++) {
+		ASSERT_LT(g_children[i].start, g_parent.end);
+	}
+
+	ASSERT_GE(g_max_running, 2);
+}
+
+TEST(WorkQueueTest, DelayedWhileBusy)
+{
+	struct busy_s delayed;
+	struct busy_s busy[num_workers - 1];
+
+	start_queues();
+	busy_reset();
+	memset(&delayed, 0, sizeof(delayed));
+	memset(busy, 0, sizeof(busy));
+
+	/* an idle worker waits for the delayed work */
+	delayed.duration = 0;
+	hrt_abstime queued = hrt_absolute_time();
+	ASSERT_EQ(PX4_OK, work_queue(LPWORK, &delayed.work, busy_worker, &delayed, USEC2TICK(50000)));
+
+	/*
+	 * Keep all other workers busy for longer than the delay. Whichever of
+	 * them was waiting for the delayed work hands that over to the idle one.
+	 */
+	for (unsigned i = 0; i < num_workers - 1; i++) {
+		busy[i].duration = 300000;
+		ASSERT_EQ(PX4_OK, work_queue(LPWORK, &busy[i].work, busy_worker, &busy[i], 0));
+	}
+
+	ASSERT_TRUE(wait_for(&g_done, num_workers));
+
+	ASSERT_GE(delayed.start, queued + 40000);
+	ASSERT_LT(delayed.start, queued + 200000);
+}
+
+static void counted_worker(void *arg)
+{
+	__atomic_add_fetch((volatile int *)arg, 1, __ATOMIC_SEQ_CST);
+}
+
+TEST(WorkQueueTest, PerfCounters)
+{
+	struct work_s work;
+	volatile int count = 0;
+
+	start_queues();
+	memset(&work, 0, sizeof(work));
+
+	for (int i = 1; i <= 5; i++) {
+		ASSERT_EQ(PX4_OK, work_queue(LPWORK, &work, counted_worker, (void *)&count, 0));
+		ASSERT_TRUE(wait_for(&count, i));
+	}
+
+	/* the counters are updated right after the callback returns */
+	usleep(10000);
+
+	struct work_pool_s *pool = &g_work[LPWORK];
+	struct work_stats_s *stats = NULL;
+
+	work_lock(LPWORK);
+
+	for (unsigned i = 0; i < pool->nstats; i++) {
+		if (pool->stats[i].worker == counted_worker) {
+			stats = &pool->stats[i];
+		}
+	}
+
+	work_unlock(LPWORK);
+
+	ASSERT_TRUE(stats != NULL);
+	ASSERT_EQ(5u, perf_event_count(stats->runtime));
+	ASSERT_EQ(5u, perf_event_count(stats->latency));
+	ASSERT_GE(perf_event_count(pool->runtime), 5u);
+}